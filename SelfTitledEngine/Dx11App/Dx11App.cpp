@@ -1,11 +1,12 @@
 #include "Dx11App.h"
 
-#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
 #include <iostream>
-
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
+#include <map>
+#include <numeric>
+#include <stdexcept>
 
 #include <d3dcompiler.h>
 #include <dxgidebug.h>
@@ -13,6 +14,60 @@
 #pragma comment (lib, "d3dcompiler.lib")
 
 #include "../helpers/helpers.h"
+#include "../pipeline/IndexBuffer.h"
+#include "../pipeline/ModelImporter.h"
+#include "../pipeline/PackFile.h"
+#include "../pipeline/Simplifier.h"
+#include "../pipeline/VertexFormat.h"
+
+
+namespace {
+
+// room in the material table, it is sized once at startup
+const UINT MaxMaterials = 256;
+
+// coarsest level of detail whose error stays under this many pixels is drawn
+const float MaxLodPixels = 1.0f;
+
+// what the viewer shows. A file placed more than once is loaded once, and meshes with the
+// same geometry are stored once whichever file they came from.
+struct ScenePlacement {
+    const char* filePath;
+    DirectX::XMFLOAT3 position;
+};
+
+const ScenePlacement Scene[] = {
+    { "Assets/teapot.obj", DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f) },
+    { "Assets/teapot.obj", DirectX::XMFLOAT3(-7.0f, 0.0f, 6.0f) },
+    { "Assets/teapot.obj", DirectX::XMFLOAT3(7.0f, 0.0f, 6.0f) },
+};
+
+const char* const VertexShaderPath = "VertexShader.hlsl.cso";
+const char* const PixelShaderPath = "PixelShader.hlsl.cso";
+
+double MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+DXGI_FORMAT ToDxgiFormat(pipeline::ElementType type) {
+    switch (type) {
+    case pipeline::ElementType::Float3:
+        return DXGI_FORMAT_R32G32B32_FLOAT;
+    case pipeline::ElementType::Float4:
+        return DXGI_FORMAT_R32G32B32A32_FLOAT;
+    case pipeline::ElementType::Unorm16x4:
+        return DXGI_FORMAT_R16G16B16A16_UNORM;
+    case pipeline::ElementType::Unorm8x4:
+        return DXGI_FORMAT_R8G8B8A8_UNORM;
+    }
+    return DXGI_FORMAT_UNKNOWN;
+}
+
+DXGI_FORMAT ToDxgiFormat(IndexFormat format) {
+    return format == IndexFormat::Uint16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+}
+
+}
 
 
 Dx11App::~Dx11App() {
@@ -22,6 +77,31 @@ Dx11App::~Dx11App() {
 HRESULT Dx11App::Init(HWND hWnd) {
     HRESULT hr = S_OK;
 
+    // start loading right away so the import overlaps device creation
+    pipeline::ImportOptions options;
+    options.optimizeOverdraw = true;
+    options.generateLods = true;
+    options.compressGeometry = true;
+    options.vertexFormat.position = PositionFormat::Unorm16;
+    for (const ScenePlacement& placement : Scene) {
+        auto model = std::find_if(_sceneModels.begin(), _sceneModels.end(), [&](const SceneModel& loaded) {
+            return loaded.filePath == placement.filePath;
+        });
+        if (model == _sceneModels.end()) {
+            _sceneModels.push_back({ placement.filePath, _assetLoader.RequestModel(placement.filePath, options), {} });
+            model = _sceneModels.end() - 1;
+        }
+        _placements.push_back({ static_cast<size_t>(model - _sceneModels.begin()), placement.position });
+    }
+
+    // saved models and rebuilt shaders are picked up while running, unless they come out of
+    // a pack, which doesn't change under us
+    if (!pipeline::AnyPacksMounted()) {
+        std::string error;
+        if (!_watcher.Start({ "Assets", "." }, error))
+            std::cout << error << std::endl;
+    }
+
     RECT rc;
     GetClientRect(hWnd, &rc);
     UINT width = rc.right - rc.left;
@@ -93,80 +173,19 @@ HRESULT Dx11App::Init(HWND hWnd) {
     vp.TopLeftY = 0;
     _context->RSSetViewports(1, &vp);
 
-    // Create the vertex buffer
-    loadModel("Assets/teapot.obj");
-    auto mesh = _meshes[0];
-
-    // vertex buffer
-    D3D11_BUFFER_DESC vertBufferDesc;
-    ZeroMemory(&vertBufferDesc, sizeof(vertBufferDesc));
-    vertBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-    vertBufferDesc.ByteWidth = sizeof(Vertex) * mesh.numberOfVertices;
-    vertBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    vertBufferDesc.CPUAccessFlags = 0;
-    D3D11_SUBRESOURCE_DATA vertData;
-    ZeroMemory(&vertData, sizeof(vertData));
-    vertData.pSysMem = mesh.vertices.data();
-    hr = _device->CreateBuffer(&vertBufferDesc, &vertData, &_vertexBuffer);
-
-    if (FAILED(hr))
-        return hr;
-
-    UINT stride = sizeof(Vertex);
-    UINT offset = 0;
-    _context->IASetVertexBuffers(0, 1, &_vertexBuffer, &stride, &offset);
-
-    //index buffer
-    D3D11_BUFFER_DESC indexBufferDesc;
-    ZeroMemory(&indexBufferDesc, sizeof(indexBufferDesc));
-
-    indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-    indexBufferDesc.ByteWidth = sizeof(uint32_t) * mesh.numberOfIndices; // numIndices should be the total number of indices in your .obj file.
-    indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-    indexBufferDesc.CPUAccessFlags = 0;
-    indexBufferDesc.MiscFlags = 0;
-
-    D3D11_SUBRESOURCE_DATA indexData;
-    indexData.pSysMem = mesh.indices.data();; // indices should be an array containing the indices from your .obj file.
-    indexData.SysMemPitch = 0;
-    indexData.SysMemSlicePitch = 0;
-
-    hr = _device->CreateBuffer(&indexBufferDesc, &indexData, &_indexBuffer); // 'device' should be your ID3D11Device pointer, and 'indexBuffer' should be your ID3D11Buffer pointer.
-
-    if (FAILED(hr)) 
-        return hr;
-
-    _context->IASetIndexBuffer(_indexBuffer, DXGI_FORMAT_R32_UINT, 0); // 'deviceContext' should be your ID3D11DeviceContext pointer.
-
     // Set the primitive topology
     _context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-    // Load and create the vertex shader
-    std::vector<char> vs = loadCompiledShader(L"VertexShader.hlsl.cso");
-    hr = _device->CreateVertexShader(vs.data(), vs.size(), nullptr, &_vertexShader);
+    // Load and create the vertex shader, the code is kept to build input layouts against
+    // once the model's vertex format is known
+    _vertexShaderCode = loadCompiledShader(VertexShaderPath);
+    hr = _device->CreateVertexShader(_vertexShaderCode.data(), _vertexShaderCode.size(), nullptr, &_vertexShader);
 
     if (FAILED(hr)) 
         return hr;
 
-    // Define the input layout
-    D3D11_INPUT_ELEMENT_DESC layout[] =
-    {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 }
-    };
-    UINT numElements = ARRAYSIZE(layout);
-
-    // Create the input layout
-    hr = _device->CreateInputLayout(layout, numElements, vs.data(), vs.size(), &_vertexLayout);
-
-    if (FAILED(hr))
-        return hr;
-
-    // Set the input layout
-    _context->IASetInputLayout(_vertexLayout);
-
     // Load and create the pixel shader
-    std::vector<char> ps = loadCompiledShader(L"PixelShader.hlsl.cso");
+    std::vector<char> ps = loadCompiledShader(PixelShaderPath);
     hr = _device->CreatePixelShader(ps.data(), ps.size(), nullptr, &_pixelShader);
 
     if (FAILED(hr))
@@ -206,6 +225,9 @@ HRESULT Dx11App::Init(HWND hWnd) {
 
     Camera camera{ DirectX::XMMatrixTranspose(viewMatrix), DirectX::XMMatrixTranspose(projectionMatrix) };
 
+    _cameraPosition = cameraPosition;
+    _pixelsPerUnit = static_cast<float>(height) / (2.0f * std::tan(fovAngleY / 2.0f));
+
     D3D11_MAPPED_SUBRESOURCE mappedResource;
     hr = _context->Map(_cameraBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
 
@@ -218,6 +240,30 @@ HRESULT Dx11App::Init(HWND hWnd) {
 
     _context->VSSetConstantBuffers(0, 1, &_cameraBuffer);
 
+    // Per mesh dequantization constants and material index, filled in when the model arrives
+    D3D11_BUFFER_DESC meshBufferDesc;
+    ZeroMemory(&meshBufferDesc, sizeof(meshBufferDesc));
+    meshBufferDesc.ByteWidth = sizeof(MeshConstants);
+    meshBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+    meshBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+    hr = _device->CreateBuffer(&meshBufferDesc, nullptr, &_meshBuffer);
+
+    if (FAILED(hr))
+        return hr;
+
+    _context->VSSetConstantBuffers(1, 1, &_meshBuffer);
+    _context->PSSetConstantBuffers(1, 1, &_meshBuffer);
+
+    // Material table, the pixel shader looks up the draw's material in it
+    hr = _materials.Init(_device, MaxMaterials);
+
+    if (FAILED(hr))
+        return hr;
+
+    ID3D11ShaderResourceView* materialView = _materials.View();
+    _context->PSSetShaderResources(0, 1, &materialView);
+
     // Create a rasterizer state description that culls front-facing triangles
     D3D11_RASTERIZER_DESC rasterDesc = {};
     rasterDesc.FillMode = D3D11_FILL_SOLID;
@@ -246,6 +292,10 @@ HRESULT Dx11App::Init(HWND hWnd) {
 
 
 void Dx11App::Render() {
+    // everything that changed lands here, between two frames
+    pollAssets();
+    pollChanges();
+
     // Clear the back buffer
     float clearColor[4] = { 0.392f, 0.584f, 0.929f, 1.0f };
     _context->ClearRenderTargetView(_renderTarget, clearColor);
@@ -254,27 +304,67 @@ void Dx11App::Render() {
     _context->VSSetShader(_vertexShader, nullptr, 0);
     _context->PSSetShader(_pixelShader, nullptr, 0);
 
-    // Draw the triangle
-    _context->DrawIndexed(_meshes[0].numberOfIndices, 0, 0);
+    // Draw the model's meshes once it has been loaded, all from the same buffers and one draw
+    // per mesh however often it is placed
+    if (!_draws.empty()) {
+        ID3D11Buffer* buffers[2] = { _vertexBuffer, _instanceBuffer };
+        UINT strides[2] = { _stride, sizeof(DirectX::XMFLOAT3) };
+        UINT offsets[2] = { 0, 0 };
+        _context->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+    }
+
+    // the draws come grouped by index format, so each index buffer is bound once
+    const Draw* previous = nullptr;
+    for (const Draw& draw : _draws) {
+        if (!previous || draw.indexFormat != previous->indexFormat)
+            _context->IASetIndexBuffer(_indexBuffers[size_t(draw.indexFormat)], ToDxgiFormat(draw.indexFormat), 0);
+        previous = &draw;
+
+        _context->UpdateSubresource(_meshBuffer, 0, nullptr, &draw.constants, 0, 0);
+        _context->DrawIndexedInstanced(draw.numberOfIndices, draw.numberOfInstances, draw.firstIndex, draw.baseVertex, draw.firstInstance);
+    }
 
     // Present the back buffer to the screen
     _swapChain->Present(0, 0);
+
+    for (auto reload = _reloads.begin(); reload != _reloads.end();) {
+        if (!reload->swapped) {
+            ++reload;
+            continue;
+        }
+
+        std::cout << "reload " << reload->filePath << ": " << MsSince(reload->firstSeen) << " ms from save to frame" << std::endl;
+        reload = _reloads.erase(reload);
+    }
 }
 
 void Dx11App::Cleanup() {
+    _watcher.Stop();
 
     if (_context)
         _context->ClearState();
 
+    _draws.clear();
+
     if (_vertexBuffer)
         _vertexBuffer->Release();
 
-    if (_indexBuffer)
-        _indexBuffer->Release();
+    for (ID3D11Buffer* indexBuffer : _indexBuffers) {
+        if (indexBuffer)
+            indexBuffer->Release();
+    }
+
+    if (_instanceBuffer)
+        _instanceBuffer->Release();
 
     if (_cameraBuffer)
         _cameraBuffer->Release();
 
+    if (_meshBuffer)
+        _meshBuffer->Release();
+
+    _materials.Release();
+
     if (_vertexLayout)
         _vertexLayout->Release();
 
@@ -297,105 +387,384 @@ void Dx11App::Cleanup() {
         _device->Release();
 }
 
-std::vector<char> Dx11App::loadCompiledShader(const std::wstring& filePath) {
-    std::ifstream file(filePath, std::ios::binary | std::ios::ate);
-    if (!file.is_open()) {
+std::vector<char> Dx11App::loadCompiledShader(const std::string& filePath) {
+    // out of the content pack when one is mounted
+    pipeline::AssetFile file;
+    if (!file.Open(filePath)) {
         throw std::runtime_error("Failed to open compiled shader file");
     }
 
-    size_t fileSize = static_cast<size_t>(file.tellg());
-    std::vector<char> buffer(fileSize);
+    const char* data = reinterpret_cast<const char*>(file.Data());
+    return std::vector<char>(data, data + file.Size());
+}
+
+void Dx11App::pollAssets() {
+    for (pipeline::AssetLoader::Completed& completed : _assetLoader.TakeCompleted()) {
+        auto sceneModel = std::find_if(_sceneModels.begin(), _sceneModels.end(), [&](const SceneModel& loaded) {
+            return loaded.handle == completed.handle;
+        });
+        if (sceneModel == _sceneModels.end())
+            continue;
+
+        pipeline::ModelData& model = *completed.model;
+        std::string changed = pipeline::NormalizePackPath(model.filePath);
+        if (_assetLoader.State(completed.handle) == pipeline::AssetState::Failed) {
+            // a broken save keeps the model that was there
+            if (!sceneModel->meshes.empty()) {
+                std::cout << "Reload of " << model.filePath << " failed: " << model.error << std::endl;
+                _reloads.erase(std::remove_if(_reloads.begin(), _reloads.end(), [&](const Reload& reload) {
+                    return pipeline::NormalizePackPath(reload.filePath) == changed;
+                }), _reloads.end());
+                continue;
+            }
+
+            // maybe write a convert method for this, if it comes up a lot
+            std::vector<wchar_t> wideMessage(model.error.begin(), model.error.end());
+            wideMessage.push_back(L'\0');
+
+            MessageBox(nullptr, wideMessage.data(), L"Model Error", MB_OK | MB_ICONERROR);
+            continue;
+        }
+
+        // added before the old meshes go, so a reload that changed nothing keeps its copies
+        std::vector<pipeline::GeometryLibrary::MeshId> meshes;
+        std::string error;
+        if (!_geometry.Add(model, meshes, error)) {
+            std::cout << "Failed to add " << model.filePath << " to the scene: " << error << std::endl;
+            continue;
+        }
+        _geometry.Release(sceneModel->meshes);
+        sceneModel->meshes = std::move(meshes);
+
+        if (FAILED(updateSceneBuffers())) {
+            std::cout << "Failed to create buffers for " << model.filePath << std::endl;
+            continue;
+        }
+
+        for (Reload& reload : _reloads) {
+            if (pipeline::NormalizePackPath(reload.filePath) == changed)
+                reload.swapped = true;
+        }
+    }
+}
 
-    file.seekg(0, std::ios::beg);
-    file.read(buffer.data(), fileSize);
-    file.close();
+void Dx11App::pollChanges() {
+    for (const pipeline::FileWatcher::Change& change : _watcher.TakeChanges()) {
+        std::string changed = pipeline::NormalizePackPath(change.filePath);
+
+        // compiled shaders are a few KB, read and swapped in right here
+        bool vertexShader = changed == pipeline::NormalizePackPath(VertexShaderPath);
+        if (vertexShader || changed == pipeline::NormalizePackPath(PixelShaderPath)) {
+            if (FAILED(reloadShader(change.filePath, vertexShader)))
+                std::cout << "Reload of " << change.filePath << " failed, keeping the old shader" << std::endl;
+            else
+                _reloads.push_back({ change.filePath, change.firstSeen, true });
+            continue;
+        }
 
-    return buffer;
+        // models reimport on the loader's workers and swap in through pollAssets
+        if (_assetLoader.ReloadChanged(change.filePath) > 0)
+            _reloads.push_back({ change.filePath, change.firstSeen, false });
+    }
 }
 
-bool Dx11App::loadModel(const std::string& filePath) {
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(filePath, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices);
+HRESULT Dx11App::reloadShader(const std::string& filePath, bool vertexShader) {
+    std::vector<char> code;
+    try {
+        code = loadCompiledShader(filePath);
+    }
+    catch (const std::runtime_error&) {
+        return E_FAIL;
+    }
 
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-        
-        // maybe write a convert method for this, if it comes up a lot
-        std::string msg(importer.GetErrorString());
-        std::vector<wchar_t> wideMessage(msg.begin(), msg.end());
-        wideMessage.push_back(L'\0');
+    HRESULT hr = S_OK;
+    if (!vertexShader) {
+        ID3D11PixelShader* pixelShader = nullptr;
+        hr = _device->CreatePixelShader(code.data(), code.size(), nullptr, &pixelShader);
+        if (FAILED(hr))
+            return hr;
 
-        MessageBox(nullptr, wideMessage.data(), L"Assimp Error", MB_OK | MB_ICONERROR);
-        return false;
+        _pixelShader->Release();
+        _pixelShader = pixelShader;
+        return S_OK;
     }
 
-    for (size_t meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++) {
-        aiMesh* aiMesh = scene->mMeshes[meshIndex];
-        Mesh mesh;
-
-        // get the vertices
-        for (size_t vertexIndex = 0; vertexIndex < aiMesh->mNumVertices; ++vertexIndex) {
-            Vertex vertex;
-            vertex.Pos.x = aiMesh->mVertices[vertexIndex].x;
-            vertex.Pos.y = aiMesh->mVertices[vertexIndex].y;
-            vertex.Pos.z = aiMesh->mVertices[vertexIndex].z;
-            vertex.Color.x = 0.949f;
-            vertex.Color.y = 0.353f;
-            vertex.Color.z = 0.114f;
-            vertex.Color.w = 1.0f;
-            mesh.vertices.push_back(vertex);
+    ID3D11VertexShader* shader = nullptr;
+    hr = _device->CreateVertexShader(code.data(), code.size(), nullptr, &shader);
+    if (FAILED(hr))
+        return hr;
+
+    // layouts are checked against the shader's input signature, so the model's is rebuilt too
+    ID3D11InputLayout* layout = nullptr;
+    if (!_draws.empty()) {
+        hr = createInputLayout(_vertexFormat, code, &layout);
+        if (FAILED(hr)) {
+            shader->Release();
+            return hr;
         }
 
-        // get the indices
-        for (size_t triangleIndex = 0; triangleIndex < aiMesh->mNumFaces; triangleIndex++) {
-            // TODO: error check this, in case there aren't three indices
-            mesh.indices.push_back(DirectX::XMUINT3{
-                aiMesh->mFaces[triangleIndex].mIndices[0],
-                aiMesh->mFaces[triangleIndex].mIndices[1],
-                aiMesh->mFaces[triangleIndex].mIndices[2]
-            });
+        _vertexLayout->Release();
+        _vertexLayout = layout;
+        _context->IASetInputLayout(_vertexLayout);
+    }
+
+    _vertexShader->Release();
+    _vertexShader = shader;
+    _vertexShaderCode = std::move(code);
+    return S_OK;
+}
+
+HRESULT Dx11App::createInputLayout(const VertexFormat& format, const std::vector<char>& shaderCode, ID3D11InputLayout** layout) {
+    std::vector<D3D11_INPUT_ELEMENT_DESC> elements;
+    for (const pipeline::VertexElement& element : pipeline::VertexElements(format))
+        elements.push_back({ element.semantic, 0, ToDxgiFormat(element.type), 0, element.offset, D3D11_INPUT_PER_VERTEX_DATA, 0 });
+    // the placement, stepped once per instance out of the second buffer
+    elements.push_back({ "PLACEMENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 });
+
+    return _device->CreateInputLayout(elements.data(), static_cast<UINT>(elements.size()), shaderCode.data(), shaderCode.size(), layout);
+}
+
+// every distinct mesh of the scene sits in one vertex buffer and the index buffer of its own
+// index format at the ranges the library gave it, and the placements that share a mesh draw
+// the same range. Only the meshes added since the last call go up, so a reload uploads what
+// changed and nothing else. When the library's extents outgrow the buffers they are replaced
+// by larger ones holding a gpu side copy of the old, and a change of vertex format rebuilds
+// them all from every mesh. Nothing drawn now is released until all of that succeeded.
+HRESULT Dx11App::updateSceneBuffers() {
+    std::vector<pipeline::GeometryLibrary::MeshId> live = _geometry.LiveMeshes();
+    if (live.empty())
+        return E_FAIL;
+
+    const VertexFormat& format = _geometry.Format();
+    UINT stride = pipeline::VertexStride(format);
+    UINT64 vertexBytes = UINT64(_geometry.VertexExtent()) * stride;
+    bool rebuild = !_vertexBuffer || format.position != _vertexFormat.position;
+
+    HRESULT hr = S_OK;
+    ID3D11InputLayout* vertexLayout = nullptr;
+    ID3D11Buffer* vertexBuffer = _vertexBuffer;
+    UINT vertexCapacity = _vertexCapacity;
+    ID3D11Buffer* indexBuffers[IndexFormatCount] = { _indexBuffers[0], _indexBuffers[1] };
+    UINT indexCapacities[IndexFormatCount] = { _indexCapacities[0], _indexCapacities[1] };
+
+    // what this call created so far, for when a later step fails
+    auto discard = [&]() {
+        for (size_t i = 0; i < IndexFormatCount; i++) {
+            if (indexBuffers[i] != _indexBuffers[i])
+                indexBuffers[i]->Release();
         }
+        if (vertexBuffer != _vertexBuffer)
+            vertexBuffer->Release();
+        if (vertexLayout)
+            vertexLayout->Release();
+    };
 
-        // normalize the verts
-        //DirectX::XMFLOAT3 minCoord(mesh.vertices[0].Pos.x, mesh.vertices[0].Pos.y, mesh.vertices[0].Pos.z);
-        //DirectX::XMFLOAT3 maxCoord(mesh.vertices[0].Pos.x, mesh.vertices[0].Pos.y, mesh.vertices[0].Pos.z);
+    // input layout matching the packed vertex format, the same for every mesh of the scene
+    if (rebuild) {
+        hr = createInputLayout(format, _vertexShaderCode, &vertexLayout);
+        if (FAILED(hr))
+            return hr;
+    }
 
-        //for (const auto& vertex : mesh.vertices) {
-        //    minCoord.x = std::min(minCoord.x, vertex.Pos.x);
-        //    minCoord.y = std::min(minCoord.y, vertex.Pos.y);
-        //    minCoord.z = std::min(minCoord.z, vertex.Pos.z);
+    hr = growBuffer(D3D11_BIND_VERTEX_BUFFER, vertexBytes, !rebuild, vertexBuffer, vertexCapacity);
+    if (FAILED(hr)) {
+        discard();
+        return hr;
+    }
 
-        //    maxCoord.x = std::max(maxCoord.x, vertex.Pos.x);
-        //    maxCoord.y = std::max(maxCoord.y, vertex.Pos.y);
-        //    maxCoord.z = std::max(maxCoord.z, vertex.Pos.z);
-        //}
+    for (size_t i = 0; i < IndexFormatCount; i++) {
+        // no buffer for a format no mesh has used
+        UINT64 indexBytes = UINT64(_geometry.IndexExtent(IndexFormat(i))) * pipeline::IndexSize(IndexFormat(i));
+        if (indexBytes == 0 && !indexBuffers[i])
+            continue;
 
-        //std::cout << "max: { " << maxCoord.x << ", " << maxCoord.y << ", " << maxCoord.z << "}" << std::endl;
-        //std::cout << "min: { " << minCoord.x << ", " << minCoord.y << ", " << minCoord.z << "}" << std::endl;
+        hr = growBuffer(D3D11_BIND_INDEX_BUFFER, indexBytes, !rebuild, indexBuffers[i], indexCapacities[i]);
+        if (FAILED(hr)) {
+            discard();
+            return hr;
+        }
+    }
 
-        //DirectX::XMFLOAT3 center(
-        //    (minCoord.x + maxCoord.x) / 2.0f,
-        //    (minCoord.y + maxCoord.y) / 2.0f,
-        //    (minCoord.z + maxCoord.z) / 2.0f
-        //);
+    // the importers don't read materials yet, every mesh gets the default one
+    if (_material == MaterialTable::InvalidMaterial)
+        _material = _materials.Add(pipeline::DefaultMaterial);
+    _materials.Upload(_context);
+
+    // placements of the same mesh that picked the same level of detail are one draw
+    std::vector<Draw> draws;
+    std::vector<std::vector<DirectX::XMFLOAT3>> positions;
+    std::map<std::pair<pipeline::GeometryLibrary::MeshId, UINT>, size_t> drawOf;
+    std::vector<pipeline::GeometryLibrary::MeshId> uses;
+    for (const Placement& placement : _placements) {
+        const DirectX::XMFLOAT3& position = placement.position;
+        for (pipeline::GeometryLibrary::MeshId id : _sceneModels[placement.model].meshes) {
+            const MeshView& mesh = _geometry.View(id);
+            const pipeline::SubmeshRange& range = _geometry.Range(id);
+            uses.push_back(id);
+
+            Draw draw = {};
+            draw.indexFormat = range.indexFormat;
+            draw.firstIndex = range.firstIndex;
+            draw.numberOfIndices = range.numberOfIndices;
+            draw.baseVertex = range.baseVertex;
+
+            // the camera doesn't move, so the level can be picked once, against the nearest
+            // point of the placed bounds
+            if (mesh.numberOfLods > 0) {
+                const Bounds& bounds = mesh.bounds;
+                float dx = std::max({ bounds.minCoord.x + position.x - _cameraPosition.x, 0.0f, _cameraPosition.x - bounds.maxCoord.x - position.x });
+                float dy = std::max({ bounds.minCoord.y + position.y - _cameraPosition.y, 0.0f, _cameraPosition.y - bounds.maxCoord.y - position.y });
+                float dz = std::max({ bounds.minCoord.z + position.z - _cameraPosition.z, 0.0f, _cameraPosition.z - bounds.maxCoord.z - position.z });
+                float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+                const MeshLod& lod = mesh.lods[pipeline::SelectLod(mesh.lods, mesh.numberOfLods, distance, _pixelsPerUnit, MaxLodPixels)];
+                draw.firstIndex += lod.firstIndex;
+                draw.numberOfIndices = lod.numberOfIndices;
+            }
+
+            auto found = drawOf.emplace(std::make_pair(id, draw.firstIndex), draws.size());
+            if (found.second) {
+                // the placement goes in through the instance buffer, only the mesh's own
+                // dequantization is left here
+                const Dequantization& dequantization = mesh.dequantization;
+                draw.constants.positionOffset = DirectX::XMFLOAT4(dequantization.offset.x, dequantization.offset.y, dequantization.offset.z, 0.0f);
+                draw.constants.positionScale = DirectX::XMFLOAT4(dequantization.scale.x, dequantization.scale.y, dequantization.scale.z, 0.0f);
+                draw.constants.material = _material;
+                draws.push_back(draw);
+                positions.emplace_back();
+            }
+            positions[found.first->second].push_back(position);
+        }
+    }
 
-        //float maxRange = std::max({ maxCoord.x - minCoord.x, maxCoord.y - minCoord.y, maxCoord.z - minCoord.z });
-        //float scaleFactor = 2.0f / maxRange;
+    // grouped by index format for Render, 16 bit first
+    std::vector<size_t> order(draws.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return draws[a].indexFormat < draws[b].indexFormat; });
+
+    std::vector<Draw> grouped;
+    std::vector<DirectX::XMFLOAT3> instances;
+    for (size_t i : order) {
+        grouped.push_back(draws[i]);
+        grouped.back().firstInstance = static_cast<UINT>(instances.size());
+        grouped.back().numberOfInstances = static_cast<UINT>(positions[i].size());
+        instances.insert(instances.end(), positions[i].begin(), positions[i].end());
+    }
+    draws.swap(grouped);
+
+    // a few bytes per placement, rewritten whole
+    ID3D11Buffer* instanceBuffer = _instanceBuffer;
+    UINT instanceCapacity = _instanceCapacity;
+    UINT64 instanceBytes = UINT64(instances.size()) * sizeof(DirectX::XMFLOAT3);
+    hr = growBuffer(D3D11_BIND_VERTEX_BUFFER, instanceBytes, false, instanceBuffer, instanceCapacity);
+    if (FAILED(hr)) {
+        discard();
+        return hr;
+    }
 
-        //std::cout << "max range: " << maxRange << std::endl;
-        //std::cout << "scale factor: " << scaleFactor << std::endl;
+    // taken only now, so meshes added by a call that failed above go up with the next one
+    std::vector<pipeline::GeometryLibrary::MeshId> added = _geometry.TakeAdded();
+    if (rebuild)
+        added = live;
 
+    UINT64 uploaded = 0;
+    for (pipeline::GeometryLibrary::MeshId id : added)
+        uploaded += uploadMesh(id, vertexBuffer, indexBuffers);
 
-        //for (auto& vertex : mesh.vertices) {
-        //    vertex.Pos.x = (vertex.Pos.x - center.x) * scaleFactor;
-        //    vertex.Pos.y = (vertex.Pos.y - center.y) * scaleFactor;
-        //    vertex.Pos.z = ((vertex.Pos.z - center.z) * scaleFactor);
-        //}
+    if (instanceBytes > 0) {
+        D3D11_BOX box = { 0, 0, 0, static_cast<UINT>(instanceBytes), 1, 1 };
+        _context->UpdateSubresource(instanceBuffer, 0, &box, instances.data(), 0, 0);
+    }
 
-        mesh.numberOfVertices = mesh.vertices.size();
-        mesh.numberOfIndices = mesh.indices.size() * 3;
+    pipeline::GeometryStats stats = _geometry.Stats(uses);
+    std::cout << std::fixed << std::setprecision(1) << "scene: " << stats.uses << " mesh instances of " << stats.meshes
+        << " meshes, gpu " << stats.gpuBytes / 1024.0 << " KB (" << stats.gpuBytesSaved / 1024.0 << " KB saved), system "
+        << stats.cpuBytes / 1024.0 << " KB (" << stats.cpuBytesSaved / 1024.0 << " KB saved), " << draws.size()
+        << " instanced draws, uploaded " << added.size()
+        << " meshes, " << uploaded / 1024.0 << " KB" << (rebuild ? " (rebuilt)" : "") << std::defaultfloat << std::endl;
+
+    // the context holds its own references to what is bound, so the old buffers can go now
+    if (vertexLayout) {
+        if (_vertexLayout)
+            _vertexLayout->Release();
+        _vertexLayout = vertexLayout;
+        _context->IASetInputLayout(_vertexLayout);
+    }
+    if (_vertexBuffer && vertexBuffer != _vertexBuffer)
+        _vertexBuffer->Release();
+    for (size_t i = 0; i < IndexFormatCount; i++) {
+        if (_indexBuffers[i] && indexBuffers[i] != _indexBuffers[i])
+            _indexBuffers[i]->Release();
+        _indexBuffers[i] = indexBuffers[i];
+        _indexCapacities[i] = indexCapacities[i];
+    }
+    if (_instanceBuffer && instanceBuffer != _instanceBuffer)
+        _instanceBuffer->Release();
+
+    _vertexBuffer = vertexBuffer;
+    _instanceBuffer = instanceBuffer;
+    _vertexCapacity = vertexCapacity;
+    _instanceCapacity = instanceCapacity;
+    _vertexFormat = format;
+    _stride = stride;
+    _draws = std::move(draws);
+    return S_OK;
+}
+
+// leaves buffer alone when it already holds bytes, otherwise points it at a new one with room
+// to spare, so appends don't replace it every time. With keep the old contents are copied
+// over on the gpu. The old buffer is the caller's to release.
+HRESULT Dx11App::growBuffer(UINT bindFlags, UINT64 bytes, bool keep, ID3D11Buffer*& buffer, UINT& capacity) {
+    if (buffer && bytes <= capacity)
+        return S_OK;
+
+    if (bytes > UINT_MAX)
+        return E_OUTOFMEMORY;
+    UINT64 grown = std::min<UINT64>(std::max<UINT64>(bytes + bytes / 2, 4096), UINT_MAX);
+
+    D3D11_BUFFER_DESC bufferDesc;
+    ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+    bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+    bufferDesc.ByteWidth = static_cast<UINT>(grown);
+    bufferDesc.BindFlags = bindFlags;
+
+    ID3D11Buffer* created = nullptr;
+    HRESULT hr = _device->CreateBuffer(&bufferDesc, nullptr, &created);
+    if (FAILED(hr))
+        return hr;
+
+    if (buffer && keep) {
+        D3D11_BOX box = { 0, 0, 0, capacity, 1, 1 };
+        _context->CopySubresourceRegion(created, 0, 0, 0, 0, buffer, 0, &box);
+    }
+
+    buffer = created;
+    capacity = static_cast<UINT>(grown);
+    return S_OK;
+}
+
+// writes one mesh into its ranges of the scene buffers, its indices as they are into the index
+// buffer of their format. Returns the bytes written.
+UINT64 Dx11App::uploadMesh(pipeline::GeometryLibrary::MeshId id, ID3D11Buffer* vertexBuffer, ID3D11Buffer* const* indexBuffers) {
+    const MeshView& mesh = _geometry.View(id);
+    const pipeline::SubmeshRange& range = _geometry.Range(id);
+    UINT stride = pipeline::VertexStride(mesh.format);
+    UINT indexSize = pipeline::IndexSize(range.indexFormat);
+    UINT64 written = 0;
+
+    if (mesh.numberOfVertices > 0) {
+        UINT first = static_cast<UINT>(range.baseVertex) * stride;
+        D3D11_BOX box = { first, 0, 0, first + mesh.numberOfVertices * stride, 1, 1 };
+        _context->UpdateSubresource(vertexBuffer, 0, &box, mesh.vertices, 0, 0);
+        written += box.right - box.left;
+    }
 
-        _meshes.push_back(mesh);
+    if (mesh.numberOfIndices > 0) {
+        UINT first = range.firstIndex * indexSize;
+        D3D11_BOX box = { first, 0, 0, first + mesh.numberOfIndices * indexSize, 1, 1 };
+        _context->UpdateSubresource(indexBuffers[size_t(range.indexFormat)], 0, &box, mesh.indices, 0, 0);
+        written += box.right - box.left;
     }
 
-    return true;
+    return written;
 }
\ No newline at end of file
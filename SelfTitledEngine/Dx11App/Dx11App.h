@@ -4,10 +4,15 @@
 
 #include <d3d11.h>
 
+#include <chrono>
 #include <string>
 #include <vector>
 
+#include "MaterialTable.h"
 #include "types.h"
+#include "../pipeline/AssetLoader.h"
+#include "../pipeline/FileWatcher.h"
+#include "../pipeline/GeometryLibrary.h"
 
 class Dx11App {
 public:
@@ -18,10 +23,19 @@ public:
         _renderTarget(nullptr),
         _vertexShader(nullptr),
         _pixelShader(nullptr),
-        _vertexBuffer(nullptr),
-        _indexBuffer(nullptr),
         _cameraBuffer(nullptr),
-        _vertexLayout(nullptr) {}
+        _meshBuffer(nullptr),
+        _vertexLayout(nullptr),
+        _vertexBuffer(nullptr),
+        _indexBuffers{},
+        _instanceBuffer(nullptr),
+        _stride(0),
+        _vertexCapacity(0),
+        _indexCapacities{},
+        _instanceCapacity(0),
+        _cameraPosition(0.0f, 0.0f, 0.0f),
+        _pixelsPerUnit(0.0f),
+        _material(MaterialTable::InvalidMaterial) {}
 
     ~Dx11App();
     HRESULT Init(HWND hWnd);
@@ -30,13 +44,54 @@ public:
 
 private:
     // update this to return bool
-    std::vector<char> loadCompiledShader(const std::wstring& filePath);
-    bool loadModel(const std::string& filePath);
+    std::vector<char> loadCompiledShader(const std::string& filePath);
+    void pollAssets();
+    void pollChanges();
+    HRESULT updateSceneBuffers();
+    HRESULT growBuffer(UINT bindFlags, UINT64 bytes, bool keep, ID3D11Buffer*& buffer, UINT& capacity);
+    UINT64 uploadMesh(pipeline::GeometryLibrary::MeshId id, ID3D11Buffer* vertexBuffer, ID3D11Buffer* const* indexBuffers);
+    HRESULT createInputLayout(const VertexFormat& format, const std::vector<char>& shaderCode, ID3D11InputLayout** layout);
+    HRESULT reloadShader(const std::string& filePath, bool vertexShader);
 
 
 private:
-    std::vector<Mesh> _meshes;
+    // a file the scene places, loaded once however many times it is placed
+    struct SceneModel {
+        std::string filePath;
+        pipeline::AssetHandle handle;
+        // its meshes in the geometry library, empty until it loads
+        std::vector<pipeline::GeometryLibrary::MeshId> meshes;
+    };
+
+    // one use of a scene model, its meshes drawn moved by position
+    struct Placement {
+        size_t model;
+        DirectX::XMFLOAT3 position;
+    };
+
+    // every placement that draws the same range of the shared buffers, one instanced draw
+    struct Draw {
+        // which of the shared index buffers the mesh sits in
+        IndexFormat indexFormat;
+        // the level of detail picked for the camera, into that index buffer
+        UINT firstIndex;
+        UINT numberOfIndices;
+        // where the mesh's vertices start in the shared vertex buffer
+        INT baseVertex;
+        // the placements' positions in the instance buffer
+        UINT firstInstance;
+        UINT numberOfInstances;
+        MeshConstants constants;
+    };
+
+    // a changed file on its way to the screen, logged once the first frame with it is out
+    struct Reload {
+        std::string filePath;
+        std::chrono::steady_clock::time_point firstSeen;
+        bool swapped;
+    };
 
+private:
     ID3D11Device* _device;
     ID3D11DeviceContext* _context;
     IDXGISwapChain* _swapChain;
@@ -44,8 +99,37 @@ private:
 
     ID3D11VertexShader* _vertexShader;
     ID3D11PixelShader* _pixelShader;
-    ID3D11Buffer* _vertexBuffer;
-    ID3D11Buffer* _indexBuffer;
     ID3D11Buffer* _cameraBuffer;
+    ID3D11Buffer* _meshBuffer;
     ID3D11InputLayout* _vertexLayout;
+    // every distinct mesh of the scene, the vertices bound once per frame and the indices in
+    // one buffer per IndexFormat, each mesh in the one it was packed for
+    ID3D11Buffer* _vertexBuffer;
+    ID3D11Buffer* _indexBuffers[IndexFormatCount];
+    // where every placement is, one float3 per instance in vertex buffer slot 1
+    ID3D11Buffer* _instanceBuffer;
+    UINT _stride;
+    // bytes the buffers were created with, the library's extents fit in them
+    UINT _vertexCapacity;
+    UINT _indexCapacities[IndexFormatCount];
+    UINT _instanceCapacity;
+    // what the input layout was built for, rebuilt against a reloaded vertex shader
+    VertexFormat _vertexFormat;
+    std::vector<char> _vertexShaderCode;
+    // what picking a level of detail needs to know about the camera
+    DirectX::XMFLOAT3 _cameraPosition;
+    float _pixelsPerUnit;
+    MaterialTable _materials;
+
+    pipeline::AssetLoader _assetLoader;
+    std::vector<SceneModel> _sceneModels;
+    std::vector<Placement> _placements;
+    // the meshes of every loaded scene model, the same geometry from any file stored once
+    pipeline::GeometryLibrary _geometry;
+    UINT _material;
+    // nothing is drawn while this is empty, i.e. until a model is loaded
+    std::vector<Draw> _draws;
+
+    pipeline::FileWatcher _watcher;
+    std::vector<Reload> _reloads;
 };
\ No newline at end of file
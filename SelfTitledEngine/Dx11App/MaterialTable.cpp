@@ -0,0 +1,90 @@
+#include "MaterialTable.h"
+
+namespace {
+
+const UINT MaterialSize = sizeof(Material);
+
+}
+
+MaterialTable::~MaterialTable() {
+    Release();
+}
+
+HRESULT MaterialTable::Init(ID3D11Device* device, UINT capacity) {
+    HRESULT hr = S_OK;
+
+    // a typed buffer rather than a constant buffer, so single entries can be updated
+    D3D11_BUFFER_DESC bufferDesc;
+    ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+    bufferDesc.ByteWidth = MaterialSize * capacity;
+    bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+    bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+    hr = device->CreateBuffer(&bufferDesc, nullptr, &_buffer);
+
+    if (FAILED(hr))
+        return hr;
+
+    // Material is a single float4 for now, widen the format along with it
+    D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
+    ZeroMemory(&viewDesc, sizeof(viewDesc));
+    viewDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+    viewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+    viewDesc.Buffer.FirstElement = 0;
+    viewDesc.Buffer.NumElements = capacity;
+
+    hr = device->CreateShaderResourceView(_buffer, &viewDesc, &_view);
+
+    if (FAILED(hr))
+        return hr;
+
+    _capacity = capacity;
+    _materials.reserve(capacity);
+    return S_OK;
+}
+
+void MaterialTable::Release() {
+    if (_view)
+        _view->Release();
+
+    if (_buffer)
+        _buffer->Release();
+
+    _view = nullptr;
+    _buffer = nullptr;
+    _capacity = 0;
+    _uploaded = 0;
+    _materials.clear();
+}
+
+UINT MaterialTable::Add(const Material& material) {
+    if (_materials.size() >= _capacity)
+        return InvalidMaterial;
+
+    _materials.push_back(material);
+    return static_cast<UINT>(_materials.size() - 1);
+}
+
+void MaterialTable::Upload(ID3D11DeviceContext* context) {
+    UINT count = static_cast<UINT>(_materials.size());
+    if (_uploaded == count)
+        return;
+
+    D3D11_BOX box = { _uploaded * MaterialSize, 0, 0, count * MaterialSize, 1, 1 };
+    context->UpdateSubresource(_buffer, 0, &box, &_materials[_uploaded], 0, 0);
+    _uploaded = count;
+}
+
+void MaterialTable::Update(ID3D11DeviceContext* context, UINT index, const Material& material) {
+    if (index >= _materials.size())
+        return;
+
+    _materials[index] = material;
+
+    // not uploaded yet, goes up with the rest
+    if (index >= _uploaded)
+        return;
+
+    D3D11_BOX box = { index * MaterialSize, 0, 0, (index + 1) * MaterialSize, 1, 1 };
+    context->UpdateSubresource(_buffer, 0, &box, &material, 0, 0);
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#define NOMINMAX
+
+#include <d3d11.h>
+
+#include <vector>
+
+#include "types.h"
+
+// every material in one typed buffer the pixel shader indexes by the draw's material
+// number. The table goes up once, after that an update rewrites just the changed entry.
+class MaterialTable {
+public:
+    MaterialTable() :
+        _buffer(nullptr),
+        _view(nullptr),
+        _capacity(0),
+        _uploaded(0) {}
+
+    ~MaterialTable();
+
+    MaterialTable(const MaterialTable&) = delete;
+    MaterialTable& operator=(const MaterialTable&) = delete;
+
+    HRESULT Init(ID3D11Device* device, UINT capacity);
+    void Release();
+
+    // returns the new material's index, or InvalidMaterial once the table is full
+    UINT Add(const Material& material);
+    // copies the materials added since the last upload in one go
+    void Upload(ID3D11DeviceContext* context);
+    // rewrites a single entry, sizeof(Material) bytes
+    void Update(ID3D11DeviceContext* context, UINT index, const Material& material);
+
+    ID3D11ShaderResourceView* View() const { return _view; }
+    UINT Count() const { return static_cast<UINT>(_materials.size()); }
+
+    static const UINT InvalidMaterial = UINT(-1);
+
+private:
+    ID3D11Buffer* _buffer;
+    ID3D11ShaderResourceView* _view;
+    UINT _capacity;
+    // materials before this one are on the gpu already
+    UINT _uploaded;
+    std::vector<Material> _materials;
+};
\ No newline at end of file
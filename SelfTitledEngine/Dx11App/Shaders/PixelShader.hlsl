@@ -1,10 +1,19 @@
+// same per draw constants the vertex shader reads
+cbuffer MeshBuffer : register(b1) {
+    float4 positionOffset;
+    float4 positionScale;
+    uint material;
+};
+
+// one float4 color per material
+Buffer<float4> materials : register(t0);
+
 struct PS_INPUT
 {
     float4 Pos : SV_POSITION;
-    float4 Color : COLOR;
 };
 
 float4 main(PS_INPUT input) : SV_Target
 {
-    return input.Color;
+    return materials.Load(material);
 }
\ No newline at end of file
@@ -3,15 +3,24 @@ cbuffer CameraBuffer : register(b0) {
     matrix projectionMatrix;
 };
 
+// positions may come in normalized to the mesh bounds, the input layout does the unorm
+// decode and this maps them back. Identity for float positions. Per mesh, shared by every
+// instance of it.
+cbuffer MeshBuffer : register(b1) {
+    float4 positionOffset;
+    float4 positionScale;
+    uint material;
+};
+
 
 struct VS_INPUT {
     float3 Pos : POSITION;
-    float4 Color : COLOR;
+    // where this instance is placed, from the per instance buffer
+    float3 Placement : PLACEMENT;
 };
 
 struct PS_INPUT {
     float4 Pos : SV_POSITION;
-    float4 Color : COLOR;
 };
 
 PS_INPUT main(VS_INPUT input) {
@@ -23,12 +32,9 @@ PS_INPUT main(VS_INPUT input) {
                                 0, 0, 0, 1);
 
     // Transform the vertex position by the view and projection matrices.
-    float4 position = float4(input.Pos, 1.0f);
+    float4 position = float4(positionOffset.xyz + input.Pos * positionScale.xyz + input.Placement, 1.0f);
     matrix viewProjectionMatrix = mul(viewMatrix, projectionMatrix);
     output.Pos = mul(position, viewProjectionMatrix);
 
-    // set the color
-    output.Color = input.Color;
-
     return output;
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 #include <DirectXMath.h>
@@ -9,16 +10,127 @@ struct Camera {
     DirectX::XMMATRIX projectionMatrix;
 };
 
+// per draw constants, maps stored positions back to model space and picks the material
+struct MeshConstants {
+    DirectX::XMFLOAT4 positionOffset;
+    DirectX::XMFLOAT4 positionScale;
+    uint32_t material;
+    uint32_t padding[3];
+};
+
+// surface constants shared by every draw that references them, one entry in the material table
+struct Material {
+    DirectX::XMFLOAT4 color;
+};
+
 struct Vertex {
     DirectX::XMFLOAT3 Pos;
-    DirectX::XMFLOAT4 Color;
     //DirectX::XMFLOAT3 Normal;
 };
 
+struct Bounds {
+    DirectX::XMFLOAT3 minCoord;
+    DirectX::XMFLOAT3 maxCoord;
+    // bounding sphere, see pipeline::ComputeBounds
+    DirectX::XMFLOAT3 center;
+    float radius;
+};
+
+// how a mesh's vertices are stored once packed, picked per import
+enum class PositionFormat : uint8_t {
+    Float32,
+    // normalized to the mesh bounds
+    Unorm16
+};
+
+struct VertexFormat {
+    PositionFormat position = PositionFormat::Float32;
+};
+
+// width of a mesh's indices once packed, the smallest one that addresses all its vertices
+enum class IndexFormat : uint8_t {
+    Uint16,
+    Uint32
+};
+// for tables with an entry per index format
+constexpr size_t IndexFormatCount = 2;
+
+// model space position = offset + position as the shader reads it * scale. Identity for
+// float positions, the bounds for normalized ones.
+struct Dequantization {
+    DirectX::XMFLOAT3 offset;
+    DirectX::XMFLOAT3 scale;
+};
+
+// one level of detail, a range of the mesh's indices drawn against the shared vertices
+struct MeshLod {
+    uint32_t firstIndex;
+    uint32_t numberOfIndices;
+    // how far the simplified surface may stray from the full one, in model units
+    float error;
+};
+
+// a cluster of nearby triangles, a contiguous range of the mesh's full level indices
+// that is culled as a whole before it is submitted
+struct Meshlet {
+    uint32_t firstIndex;
+    uint32_t numberOfIndices;
+    uint32_t numberOfVertices;
+    // bounding sphere
+    DirectX::XMFLOAT3 center;
+    float radius;
+    // every triangle faces away from eyes inside the cone with this apex and axis, opening
+    // acos(coneCutoff) around -coneAxis. A cutoff above 1 never culls.
+    DirectX::XMFLOAT3 coneApex;
+    DirectX::XMFLOAT3 coneAxis;
+    float coneCutoff;
+};
+
+// non-owning view of mesh data, backed either by a Mesh or by a mapped cooked file
+struct MeshView {
+    // packed in format
+    const uint8_t* vertices;
+    // packed in indexFormat
+    const uint8_t* indices;
+    Bounds bounds;
+    VertexFormat format;
+    IndexFormat indexFormat;
+    Dequantization dequantization;
+    // finest first, empty when the mesh has a single level
+    const MeshLod* lods;
+    // empty unless the mesh was clustered
+    const Meshlet* meshlets;
+
+    unsigned int numberOfVertices;
+    unsigned int numberOfIndices;
+    unsigned int numberOfLods;
+    unsigned int numberOfMeshlets;
+};
+
 struct Mesh {
+    // full precision, what the import passes work on
     std::vector<Vertex> vertices;
+    // every level of detail back to back, see lods
     std::vector<DirectX::XMUINT3> indices;
+    Bounds bounds;
+    // filled in by pipeline::GenerateLods, level 0 is the full mesh
+    std::vector<MeshLod> lods;
+    // filled in by pipeline::BuildMeshlets, covering the full level
+    std::vector<Meshlet> meshlets;
+
+    // vertices in format and indices in indexFormat, filled in last by
+    // pipeline::PackVertices and pipeline::PackIndices
+    std::vector<uint8_t> packedVertices;
+    std::vector<uint8_t> packedIndices;
+    VertexFormat format;
+    IndexFormat indexFormat = IndexFormat::Uint32;
+    Dequantization dequantization;
 
     unsigned int numberOfVertices;
     unsigned int numberOfIndices;
+
+    MeshView View() const {
+        return MeshView{ packedVertices.data(), packedIndices.data(), bounds, format, indexFormat, dequantization, lods.data(), meshlets.data(),
+            numberOfVertices, numberOfIndices, static_cast<unsigned int>(lods.size()), static_cast<unsigned int>(meshlets.size()) };
+    }
 };
\ No newline at end of file
@@ -3,6 +3,9 @@
 
 #include "Dx11App/Dx11App.h"
 #include "helpers/helpers.h"
+#include "pipeline/Benchmarks.h"
+#include "pipeline/PackFile.h"
+#include "pipeline/TextureCache.h"
 
 // disable SAL anotation warning
 #pragma warning(disable: 28251)
@@ -34,9 +37,47 @@ void OpenConsoleWindow() {
 }
 
 // Entry point
-int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR, int nCmdShow) {
+int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR lpCmdLine, int nCmdShow) {
     OpenConsoleWindow();
 
+    // run the asset pipeline benchmarks headless instead of opening the window
+    if (wcsstr(lpCmdLine, L"-bench")) {
+        pipeline::RunBenchmarks();
+
+        std::cout << "\nPress enter to exit" << std::endl;
+        std::cin.get();
+        return 0;
+    }
+
+    // compress every texture under Assets into the cache ahead of time, instead of on first load
+    if (wcsstr(lpCmdLine, L"-cooktextures")) {
+        std::string error;
+        if (!pipeline::CookTextures("Assets", error))
+            std::cout << error << std::flush;
+
+        std::cout << "\nPress enter to exit" << std::endl;
+        std::cin.get();
+        return 0;
+    }
+
+    // bundle the content into one pack, the next start reads everything from it
+    if (wcsstr(lpCmdLine, L"-pack")) {
+        std::string error;
+        if (pipeline::WritePackFile(pipeline::ContentPack, { "Assets", "VertexShader.hlsl.cso", "PixelShader.hlsl.cso" }, error))
+            std::cout << "Wrote " << pipeline::ContentPack << std::endl;
+        else
+            std::cout << error << std::endl;
+
+        std::cout << "\nPress enter to exit" << std::endl;
+        std::cin.get();
+        return 0;
+    }
+
+    // a content pack in the working directory takes the place of the loose files
+    std::string packError;
+    if (GetFileAttributesA(pipeline::ContentPack) != INVALID_FILE_ATTRIBUTES && !pipeline::MountPack(pipeline::ContentPack, packError))
+        std::cout << packError << std::endl;
+
     HWND hWnd = nullptr;
     HRESULT hr = S_OK;
 
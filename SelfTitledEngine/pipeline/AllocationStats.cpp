@@ -0,0 +1,159 @@
+#include "AllocationStats.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <malloc.h>
+
+// the global operator new and delete are replaced so every allocation is counted. It costs
+// a few relaxed atomics per call, and block sizes come from the heap so nothing is stored
+// next to the blocks.
+
+namespace pipeline {
+
+// atomic because a ParallelFor's workers add to the counters of the thread that started it
+struct ThreadAllocationCounters {
+    std::atomic<uint64_t> allocations{ 0 };
+    std::atomic<int64_t> liveBytes{ 0 };
+    std::atomic<int64_t> peakBytes{ 0 };
+};
+
+namespace {
+
+std::atomic<uint64_t> Allocations{ 0 };
+std::atomic<uint64_t> LiveBytes{ 0 };
+std::atomic<uint64_t> PeakBytes{ 0 };
+
+// trivially destructible, so allocations while a thread shuts down still find them
+thread_local ThreadAllocationCounters OwnCounters;
+thread_local ThreadAllocationCounters* LentCounters = nullptr;
+
+ThreadAllocationCounters& Counters() {
+    return LentCounters ? *LentCounters : OwnCounters;
+}
+
+size_t BlockSize(void* block) {
+#ifdef _WIN32
+    return _msize(block);
+#else
+    return malloc_usable_size(block);
+#endif
+}
+
+void* CountedAlloc(size_t bytes) {
+    void* block = std::malloc(bytes ? bytes : 1);
+    if (!block)
+        return nullptr;
+
+    uint64_t size = BlockSize(block);
+    uint64_t live = LiveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    Allocations.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t peak = PeakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !PeakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+
+    ThreadAllocationCounters& counters = Counters();
+    int64_t threadLive = counters.liveBytes.fetch_add(int64_t(size), std::memory_order_relaxed) + int64_t(size);
+    counters.allocations.fetch_add(1, std::memory_order_relaxed);
+
+    int64_t threadPeak = counters.peakBytes.load(std::memory_order_relaxed);
+    while (threadLive > threadPeak && !counters.peakBytes.compare_exchange_weak(threadPeak, threadLive, std::memory_order_relaxed)) {}
+    return block;
+}
+
+void CountedFree(void* block) {
+    if (!block)
+        return;
+
+    size_t size = BlockSize(block);
+    LiveBytes.fetch_sub(size, std::memory_order_relaxed);
+    Counters().liveBytes.fetch_sub(int64_t(size), std::memory_order_relaxed);
+    std::free(block);
+}
+
+}
+
+AllocationStats GetAllocationStats() {
+    return AllocationStats{
+        Allocations.load(std::memory_order_relaxed),
+        LiveBytes.load(std::memory_order_relaxed),
+        PeakBytes.load(std::memory_order_relaxed)
+    };
+}
+
+void ResetAllocationPeak() {
+    PeakBytes.store(LiveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+ThreadAllocationStats GetThreadAllocationStats() {
+    ThreadAllocationCounters& counters = Counters();
+    return ThreadAllocationStats{
+        counters.allocations.load(std::memory_order_relaxed),
+        counters.liveBytes.load(std::memory_order_relaxed),
+        counters.peakBytes.load(std::memory_order_relaxed)
+    };
+}
+
+void ResetThreadAllocationPeak() {
+    ThreadAllocationCounters& counters = Counters();
+    counters.peakBytes.store(counters.liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+ThreadAllocationCounters* CurrentAllocationCounters() {
+    return &Counters();
+}
+
+AllocationCountersScope::AllocationCountersScope(ThreadAllocationCounters* counters) :
+    _previous(LentCounters) {
+    LentCounters = counters;
+}
+
+AllocationCountersScope::~AllocationCountersScope() {
+    LentCounters = _previous;
+}
+
+}
+
+void* operator new(size_t size) {
+    void* block = pipeline::CountedAlloc(size);
+    if (!block)
+        throw std::bad_alloc();
+    return block;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return pipeline::CountedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return pipeline::CountedAlloc(size);
+}
+
+void operator delete(void* block) noexcept {
+    pipeline::CountedFree(block);
+}
+
+void operator delete[](void* block) noexcept {
+    pipeline::CountedFree(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+    pipeline::CountedFree(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+    pipeline::CountedFree(block);
+}
+
+void operator delete(void* block, const std::nothrow_t&) noexcept {
+    pipeline::CountedFree(block);
+}
+
+void operator delete[](void* block, const std::nothrow_t&) noexcept {
+    pipeline::CountedFree(block);
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+namespace pipeline {
+
+// process wide counts of everything that goes through operator new, for measuring what
+// a stage allocates. Memory the libraries get from malloc directly isn't seen.
+struct AllocationStats {
+    uint64_t allocations;
+    uint64_t liveBytes;
+    // most bytes live at once since the last ResetAllocationPeak
+    uint64_t peakBytes;
+};
+
+AllocationStats GetAllocationStats();
+// starts a new peak from what is live now
+void ResetAllocationPeak();
+
+// the same, counted only for what one thread allocates and frees, so a load's stages aren't
+// mixed up with the loads running next to it. Threads a ParallelFor lends out count for the
+// thread that started it. A block counts against the thread that frees it, so live bytes can
+// drop below where they started.
+struct ThreadAllocationStats {
+    uint64_t allocations;
+    int64_t liveBytes;
+    int64_t peakBytes;
+};
+
+struct ThreadAllocationCounters;
+
+ThreadAllocationStats GetThreadAllocationStats();
+void ResetThreadAllocationPeak();
+
+// whose counters the calling thread adds to, its own unless it's working for another one
+ThreadAllocationCounters* CurrentAllocationCounters();
+
+// while alive, allocations on the calling thread count for counters
+class AllocationCountersScope {
+public:
+    explicit AllocationCountersScope(ThreadAllocationCounters* counters);
+    ~AllocationCountersScope();
+    AllocationCountersScope(const AllocationCountersScope&) = delete;
+    AllocationCountersScope& operator=(const AllocationCountersScope&) = delete;
+
+private:
+    ThreadAllocationCounters* _previous;
+};
+
+}
\ No newline at end of file
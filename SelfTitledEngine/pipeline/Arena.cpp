@@ -0,0 +1,72 @@
+#include "Arena.h"
+
+#include <algorithm>
+
+namespace pipeline {
+
+namespace {
+
+// blocks come from new[], which only promises max_align_t, so they are over-allocated
+// by this much and aligned by hand
+constexpr size_t MaxAlignment = 64;
+
+size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+}
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+    if (!_blocks.empty()) {
+        Block& block = _blocks.back();
+        size_t base = reinterpret_cast<uintptr_t>(block.data.get());
+        size_t offset = AlignUp(base + block.offset, alignment) - base;
+        if (offset + size <= block.size) {
+            block.offset = offset + size;
+            _used += size;
+            return block.data.get() + offset;
+        }
+    }
+
+    Block block;
+    block.size = std::max(_blockSize, size) + MaxAlignment;
+    block.data.reset(new uint8_t[block.size]);
+    size_t base = reinterpret_cast<uintptr_t>(block.data.get());
+    size_t offset = AlignUp(base, alignment) - base;
+    block.offset = offset + size;
+    _reserved += block.size;
+    _used += size;
+
+    // a block made for one large request goes behind the current one so the current
+    // one keeps taking small requests
+    uint8_t* result = block.data.get() + offset;
+    if (!_blocks.empty() && size > _blockSize)
+        _blocks.insert(_blocks.end() - 1, std::move(block));
+    else
+        _blocks.push_back(std::move(block));
+    return result;
+}
+
+void Arena::Reset() {
+    if (_blocks.empty())
+        return;
+
+    auto largest = std::max_element(_blocks.begin(), _blocks.end(), [](const Block& a, const Block& b) {
+        return a.size < b.size;
+    });
+    Block kept = std::move(*largest);
+    kept.offset = 0;
+
+    _blocks.clear();
+    _reserved = kept.size;
+    _used = 0;
+    _blocks.push_back(std::move(kept));
+}
+
+void Arena::Release() {
+    _blocks.clear();
+    _used = 0;
+    _reserved = 0;
+}
+
+}
\ No newline at end of file
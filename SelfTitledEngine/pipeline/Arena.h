@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace pipeline {
+
+// bump allocator for memory that dies all at once, like a model's upload staging. Nothing
+// is freed on its own, Reset and the destructor give everything back in bulk.
+class Arena {
+public:
+    // blocks are at least this big, larger requests get a block of their own
+    explicit Arena(size_t blockSize = 1 << 20) : _blockSize(blockSize), _used(0), _reserved(0) {}
+
+    Arena(Arena&&) = default;
+    Arena& operator=(Arena&&) = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // uninitialized, aligned to alignment which must be a power of two up to 64
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T>
+    T* Allocate(size_t count) {
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // keeps the largest block for reuse, frees the rest
+    void Reset();
+    void Release();
+
+    size_t BytesUsed() const { return _used; }
+    size_t BytesReserved() const { return _reserved; }
+
+private:
+    struct Block {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size;
+        size_t offset;
+    };
+
+    std::vector<Block> _blocks;
+    size_t _blockSize;
+    size_t _used;
+    size_t _reserved;
+};
+
+}
\ No newline at end of file
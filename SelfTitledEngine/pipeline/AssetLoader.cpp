@@ -0,0 +1,274 @@
+#include "AssetLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "GeometryLibrary.h"
+#include "ImportProfile.h"
+#include "IndexBuffer.h"
+#include "MeshOptimizer.h"
+#include "MeshBounds.h"
+#include "Meshlets.h"
+#include "ModelImporter.h"
+#include "PackFile.h"
+#include "Parallel.h"
+#include "Simplifier.h"
+#include "VertexFormat.h"
+
+namespace pipeline {
+
+namespace {
+
+double MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// one line per lookup plus the running totals, built up front so lines from different
+// workers don't interleave
+void PrintCacheResult(const std::string& filePath, bool hit, bool rehashed, double ms, double savedMs) {
+    CacheStats stats = GetCacheStats();
+
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(2)
+        << "cache " << (hit ? "hit " : "miss ") << filePath
+        << (rehashed ? " (content hashed)" : " (stamp)")
+        << ", " << ms << " ms";
+    if (hit)
+        line << ", saved " << savedMs << " ms";
+    line << " | " << stats.hits << " hits, " << stats.misses << " misses, "
+        << stats.contentHashes << " hashed, " << stats.savedMs << " ms saved\n";
+
+    std::cout << line.str() << std::flush;
+}
+
+// what the vertex and index blocks of cooked meshes take
+uint64_t ViewBytes(const std::vector<MeshView>& views) {
+    uint64_t bytes = 0;
+    for (const MeshView& view : views)
+        bytes += uint64_t(view.numberOfVertices) * VertexStride(view.format) + uint64_t(view.numberOfIndices) * IndexSize(view.indexFormat);
+    return bytes;
+}
+
+void HashViews(ModelData& model, ImportProfile& profile) {
+    profile.Begin("hash meshes");
+    model.hashes.clear();
+    model.hashes.reserve(model.views.size());
+    for (const MeshView& view : model.views)
+        model.hashes.push_back(MeshContentHash(view));
+    profile.End(model.scene.vertexBytes + model.scene.IndexBytes());
+}
+
+}
+
+bool LoadModel(const std::string& filePath, const ImportOptions& options, ModelData& model) {
+    model.filePath = filePath;
+    model.options = options;
+    auto start = std::chrono::steady_clock::now();
+
+    // every stage below is timed, the report goes out however the load ends
+    ImportProfile profile;
+    auto finish = [&](const char* result, bool loaded) {
+        std::string profilePath = ProfilePathFor(filePath);
+        std::string report = profile.Report(filePath, result);
+        if (!WriteProfile(profilePath, profile.Json(filePath, result)))
+            report += "Failed to write profile " + profilePath + "\n";
+        std::cout << report << std::flush;
+        return loaded;
+    };
+
+    CacheKey key;
+    bool rehashed = false;
+    profile.Begin("content hash");
+    if (!GetContentHash(filePath, key.contentHash, rehashed)) {
+        model.error = "Failed to open model file " + filePath;
+        profile.End();
+        return finish("failed", false);
+    }
+    key.settingsHash = ImportSettingsHash(options);
+    SourceStamp stamp;
+    profile.End(rehashed && GetSourceStamp(filePath, stamp) ? stamp.size : 0);
+
+    // a hit hands its mapping over as the staging block, imported meshes only live until
+    // they are packed into it
+    CookedModel cooked;
+    std::vector<Mesh> meshes;
+
+    std::string cookedPath = CookedPathFor(key);
+    profile.Begin("cooked load");
+    bool hit = cooked.Load(cookedPath, key);
+    profile.End(hit ? ViewBytes(cooked.Meshes()) : 0);
+
+    if (hit) {
+        // the mapping becomes the staging block, nothing is copied
+        profile.Begin("stage buffers");
+        bool staged = cooked.Stage(model.views, model.scene, model.error);
+        profile.End(model.scene.vertexBytes + model.scene.IndexBytes());
+        if (!staged)
+            return finish("failed", false);
+        HashViews(model, profile);
+
+        double ms = MsSince(start);
+        double savedMs = std::max(0.0, cooked.ImportMs() - ms);
+        RecordCacheHit(savedMs);
+        PrintCacheResult(filePath, true, rehashed, ms, savedMs);
+        return finish("hit", true);
+    }
+
+    auto importStart = std::chrono::steady_clock::now();
+    if (!ImportModel(filePath, meshes, model.error, &profile))
+        return finish("failed", false);
+
+    // the passes report their own results, these only time them. Once packed, the meshes'
+    // vertices and indices live in the staging block.
+    auto stage = [&](const char* name, auto&& pass) {
+        profile.Begin(name);
+        pass();
+        profile.End(MeshBytes(meshes) + model.scene.vertexBytes + model.scene.IndexBytes());
+    };
+    if (options.normalizeToUnitCube)
+        stage("normalize", [&] { NormalizeMeshes(filePath, meshes); });
+    stage("optimize", [&] { OptimizeMeshes(filePath, options, meshes); });
+    if (options.splitLargeMeshes)
+        stage("split large meshes", [&] { SplitLargeMeshes(filePath, meshes); });
+    if (options.buildMeshlets)
+        stage("meshlets", [&] { BuildMeshlets(filePath, meshes); });
+    if (options.generateLods)
+        stage("lods", [&] { GenerateLods(filePath, meshes); });
+
+    // the staging block is laid out from the formats the meshes are about to be packed in,
+    // and the packing passes write straight into it
+    model.views.clear();
+    model.views.reserve(meshes.size());
+    for (const Mesh& mesh : meshes) {
+        MeshView view = mesh.View();
+        view.format = options.vertexFormat;
+        view.indexFormat = ChooseIndexFormat(mesh.vertices.size());
+        model.views.push_back(view);
+    }
+    std::vector<uint8_t*> vertexSlots, indexSlots;
+    profile.Begin("stage buffers");
+    bool staged = ReserveSceneBuffers(model.views, model.scene, vertexSlots, indexSlots, model.error);
+    profile.End(model.scene.vertexBytes + model.scene.IndexBytes());
+    if (!staged)
+        return finish("failed", false);
+
+    stage("pack indices", [&] { PackIndexBuffers(filePath, meshes, indexSlots); });
+    stage("pack vertices", [&] { PackMeshes(filePath, options.vertexFormat, meshes, vertexSlots); });
+    for (size_t i = 0; i < meshes.size(); i++)
+        model.views[i].dequantization = meshes[i].dequantization;
+    double importMs = MsSince(importStart);
+
+    profile.Begin("write cooked");
+    if (!WriteCookedModel(cookedPath, key, importMs, model.views, options.compressGeometry))
+        std::cout << "Failed to write cooked model " << cookedPath << std::endl;
+    SourceStamp cookedStamp;
+    profile.End(GetSourceStamp(cookedPath, cookedStamp) ? cookedStamp.size : 0);
+
+    HashViews(model, profile);
+
+    RecordCacheMiss(importMs);
+    PrintCacheResult(filePath, false, rehashed, MsSince(start), 0.0);
+    return finish("miss", true);
+}
+
+AssetLoader::AssetLoader(unsigned int workerCount) :
+    _stopping(false) {
+    // leave a core for the render thread, the importers fan out on their own
+    if (workerCount == 0)
+        workerCount = std::max(1u, std::min(DefaultThreadCount() - 1, 4u));
+
+    for (unsigned int i = 0; i < workerCount; i++)
+        _workers.emplace_back(&AssetLoader::workerLoop, this);
+}
+
+AssetLoader::~AssetLoader() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+        _jobs.clear();
+    }
+    _wake.notify_all();
+
+    for (std::thread& worker : _workers)
+        worker.join();
+}
+
+AssetHandle AssetLoader::RequestModel(const std::string& filePath, const ImportOptions& options) {
+    AssetHandle handle;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        handle = static_cast<AssetHandle>(_states.size());
+        _states.push_back(AssetState::Loading);
+        _requests.push_back({ filePath, options, 0 });
+        _jobs.push_back({ handle, filePath, options, 0 });
+    }
+    _wake.notify_one();
+    return handle;
+}
+
+AssetState AssetLoader::State(AssetHandle handle) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (handle >= _states.size())
+        return AssetState::Failed;
+    return _states[handle];
+}
+
+size_t AssetLoader::ReloadChanged(const std::string& filePath) {
+    std::string changed = NormalizePackPath(filePath);
+    size_t queued = 0;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (AssetHandle handle = 0; handle < _requests.size(); handle++) {
+            Request& request = _requests[handle];
+            if (NormalizePackPath(request.filePath) != changed)
+                continue;
+
+            request.generation++;
+            _jobs.push_back({ handle, request.filePath, request.options, request.generation });
+            queued++;
+        }
+    }
+
+    if (queued > 0)
+        _wake.notify_all();
+    return queued;
+}
+
+std::vector<AssetLoader::Completed> AssetLoader::TakeCompleted() {
+    std::vector<Completed> completed;
+    std::lock_guard<std::mutex> lock(_mutex);
+    completed.swap(_completed);
+    return completed;
+}
+
+void AssetLoader::workerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [this] { return _stopping || !_jobs.empty(); });
+            if (_stopping)
+                return;
+
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+
+        // the slow part runs without the lock held
+        std::unique_ptr<ModelData> model(new ModelData());
+        bool loaded = LoadModel(job.filePath, job.options, *model);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        // a newer load of the same model is queued or running, it completes in this one's place
+        if (job.generation != _requests[job.handle].generation)
+            continue;
+
+        _states[job.handle] = loaded ? AssetState::Ready : AssetState::Failed;
+        _completed.push_back({ job.handle, std::move(model) });
+    }
+}
+
+}
\ No newline at end of file
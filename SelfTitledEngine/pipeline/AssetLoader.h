@@ -0,0 +1,99 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Dx11App/types.h"
+#include "MeshCache.h"
+#include "ModelImporter.h"
+#include "SceneBuffers.h"
+
+namespace pipeline {
+
+using AssetHandle = uint32_t;
+const AssetHandle InvalidAsset = UINT32_MAX;
+
+enum class AssetState {
+    Loading,
+    Ready,
+    Failed
+};
+
+// cpu side copy of a model, served from the cooked cache or freshly imported. Everything
+// the renderer needs sits in scene's staging block, the views point into it too.
+struct ModelData {
+    std::string filePath;
+    ImportOptions options;
+    std::vector<MeshView> views;
+    // MeshContentHash of every view, worked out here so the render thread doesn't read the
+    // geometry to find out what it already has
+    std::vector<uint64_t> hashes;
+    SceneBuffers scene;
+    std::string error;
+};
+
+// loads through the cooked cache, importing and recooking when the cache is stale
+bool LoadModel(const std::string& filePath, const ImportOptions& options, ModelData& model);
+
+// loads models on background worker threads. Requests return right away; whoever owns
+// the device polls TakeCompleted once a frame and creates the gpu buffers from the results.
+class AssetLoader {
+public:
+    struct Completed {
+        AssetHandle handle;
+        std::unique_ptr<ModelData> model;
+    };
+
+    // 0 workers picks one per spare core
+    explicit AssetLoader(unsigned int workerCount = 0);
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    AssetHandle RequestModel(const std::string& filePath, const ImportOptions& options = ImportOptions());
+    AssetState State(AssetHandle handle) const;
+
+    // loads every model requested from filePath again, for when the source changed. The
+    // handles keep their state until the new load completes; a model changed again before
+    // then only completes once, with the newest load. Returns how many were queued.
+    size_t ReloadChanged(const std::string& filePath);
+
+    // models that finished loading since the last call, failed ones included
+    std::vector<Completed> TakeCompleted();
+
+private:
+    struct Job {
+        AssetHandle handle;
+        std::string filePath;
+        ImportOptions options;
+        // loads of a handle are numbered, only the newest one completes
+        uint32_t generation;
+    };
+
+    struct Request {
+        std::string filePath;
+        ImportOptions options;
+        uint32_t generation;
+    };
+
+    void workerLoop();
+
+private:
+    mutable std::mutex _mutex;
+    std::condition_variable _wake;
+    std::deque<Job> _jobs;
+    std::vector<AssetState> _states;
+    std::vector<Request> _requests;
+    std::vector<Completed> _completed;
+    std::vector<std::thread> _workers;
+    bool _stopping;
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,2108 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <assimp/fast_atof.h>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "AllocationStats.h"
+#include "AssetLoader.h"
+#include "BlockCompression.h"
+#include "CpuFeatures.h"
+#include "GeometryCodec.h"
+#include "GeometryLibrary.h"
+#include "Hash.h"
+#include "Image.h"
+#include "ImportProfile.h"
+#include "IndexBuffer.h"
+#include "MeshBounds.h"
+#include "MeshCache.h"
+#include "Meshlets.h"
+#include "Mipmaps.h"
+#include "ModelImporter.h"
+#include "ObjParser.h"
+#include "Overdraw.h"
+#include "PackFile.h"
+#include "Parallel.h"
+#include "Simplifier.h"
+#include "TangentSpace.h"
+#include "TextureCache.h"
+#include "VertexCache.h"
+#include "VertexFetch.h"
+#include "VertexFormat.h"
+#include "VertexWeld.h"
+
+namespace pipeline {
+
+namespace {
+
+const char* BenchmarkAssets[] = {
+    "Assets/teapot.obj",
+    "Assets/teapot_normals.obj",
+    "Assets/teapot_normals_uv.obj",
+};
+
+constexpr int Iterations = 10;
+
+// average wall time of fn in milliseconds
+template <typename Fn>
+double TimeMs(Fn&& fn, int iterations = Iterations) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        fn();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+// OBJ text for a side x side vertex grid with a bumpy height field, standing in for
+// a large scanned mesh
+std::string MakeGridObj(unsigned int side) {
+    std::string text;
+    text.reserve(size_t(side) * side * 80);
+
+    char line[96];
+    for (unsigned int y = 0; y < side; y++) {
+        for (unsigned int x = 0; x < side; x++) {
+            float height = 0.05f * static_cast<float>((x * 7 + y * 13) % 17);
+            int length = std::snprintf(line, sizeof(line), "v %f %f %f\n", x * 0.01f, height, y * 0.01f);
+            text.append(line, length);
+        }
+    }
+
+    for (unsigned int y = 0; y + 1 < side; y++) {
+        for (unsigned int x = 0; x + 1 < side; x++) {
+            unsigned int a = y * side + x + 1;
+            unsigned int b = a + 1;
+            unsigned int c = a + side;
+            unsigned int d = c + 1;
+            int length = std::snprintf(line, sizeof(line), "f %u %u %u\nf %u %u %u\n", a, b, d, a, d, c);
+            text.append(line, length);
+        }
+    }
+
+    return text;
+}
+
+// reads every byte buffer creation would, so page faults of the mapping get counted
+float TouchMesh(const MeshView& mesh) {
+    float sum = 0.0f;
+    size_t vertexBytes = size_t(mesh.numberOfVertices) * VertexStride(mesh.format);
+    for (size_t i = 0; i < vertexBytes; i += 4)
+        sum += mesh.vertices[i];
+    size_t indexBytes = size_t(mesh.numberOfIndices) * IndexSize(mesh.indexFormat);
+    for (size_t i = 0; i < indexBytes; i += 4)
+        sum += mesh.indices[i];
+    return sum;
+}
+
+void BenchmarkCookedLoad() {
+    std::printf("\n-- cooked mesh load --\n");
+    std::printf("%-32s %12s %12s %10s %16s %12s\n", "asset", "import ms", "cooked ms", "speedup", "KB raw/compressed", "decoded ms");
+
+    for (const char* asset : BenchmarkAssets) {
+        CacheKey key;
+        bool rehashed;
+        if (!GetContentHash(asset, key.contentHash, rehashed)) {
+            std::printf("%-32s missing\n", asset);
+            continue;
+        }
+        key.settingsHash = ImportSettingsHash(ImportOptions());
+
+        std::vector<Mesh> meshes;
+        std::string error;
+        double importMs = TimeMs([&] {
+            meshes.clear();
+            ImportModel(asset, meshes, error);
+        });
+
+        for (Mesh& mesh : meshes) {
+            PackVertices(mesh, VertexFormat());
+            PackIndices(mesh);
+        }
+
+        // kept apart from the real entry, these meshes skipped the optimization passes
+        std::string cookedPath = CookedPathFor(key) + ".bench";
+        std::string compressedPath = cookedPath + "z";
+        if (!WriteCookedModel(cookedPath, key, importMs, meshes) ||
+            !WriteCookedModel(compressedPath, key, importMs, meshes, true)) {
+            std::printf("%-32s failed to write %s\n", asset, cookedPath.c_str());
+            continue;
+        }
+
+        volatile float sink = 0.0f;
+        auto loadMs = [&](const std::string& path) {
+            return TimeMs([&] {
+                CookedModel cooked;
+                cooked.Load(path, key);
+                for (const MeshView& mesh : cooked.Meshes())
+                    sink = sink + TouchMesh(mesh);
+            });
+        };
+        double cookedMs = loadMs(cookedPath);
+        double decodedMs = loadMs(compressedPath);
+
+        std::error_code ec;
+        double rawKb = std::filesystem::file_size(cookedPath, ec) / 1024.0;
+        double compressedKb = std::filesystem::file_size(compressedPath, ec) / 1024.0;
+        std::printf("%-32s %12.3f %12.3f %9.1fx %7.1f/%-8.1f %12.3f\n", asset, importMs, cookedMs, importMs / cookedMs,
+            rawKb, compressedKb, decodedMs);
+
+        std::filesystem::remove(cookedPath, ec);
+        std::filesystem::remove(compressedPath, ec);
+    }
+}
+
+// what it costs to find the cooked entry of an unchanged file, against hashing it in full
+void BenchmarkCacheLookup() {
+    std::printf("\n-- cache key lookup --\n");
+    std::printf("%-32s %12s %12s %10s\n", "asset", "stamp ms", "hash ms", "hash GB/s");
+
+    for (const char* asset : BenchmarkAssets) {
+        uint64_t contentHash;
+        bool rehashed;
+        if (!GetContentHash(asset, contentHash, rehashed)) {
+            std::printf("%-32s missing\n", asset);
+            continue;
+        }
+
+        double stampMs = TimeMs([&] {
+            GetContentHash(asset, contentHash, rehashed);
+        });
+
+        MappedFile file;
+        file.Open(asset);
+        volatile uint64_t sink = 0;
+        double hashMs = TimeMs([&] {
+            sink = sink + Hash64(file.Data(), file.Size());
+        });
+
+        std::printf("%-32s %12.4f %12.4f %10.2f\n", asset, stampMs, hashMs, file.Size() / (hashMs * 1e6));
+    }
+}
+
+// same element counts and bit for bit the same vertices and indices
+bool SameMeshes(const std::vector<Mesh>& a, const std::vector<Mesh>& b, std::string& difference) {
+    if (a.size() != b.size()) {
+        difference = "mesh count " + std::to_string(a.size()) + " vs " + std::to_string(b.size());
+        return false;
+    }
+
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].vertices.size() != b[i].vertices.size() || a[i].indices.size() != b[i].indices.size()) {
+            difference = "mesh " + std::to_string(i) + " element counts differ";
+            return false;
+        }
+
+        if (std::memcmp(a[i].vertices.data(), b[i].vertices.data(), a[i].vertices.size() * sizeof(Vertex)) != 0) {
+            difference = "mesh " + std::to_string(i) + " vertices differ";
+            return false;
+        }
+
+        if (std::memcmp(a[i].indices.data(), b[i].indices.data(), a[i].indices.size() * sizeof(DirectX::XMUINT3)) != 0) {
+            difference = "mesh " + std::to_string(i) + " indices differ";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void BenchmarkObjParser() {
+    std::printf("\n-- native OBJ parser --\n");
+    std::printf("%-32s %12s %12s %10s\n", "asset", "assimp ms", "native ms", "MB/s");
+
+    for (const char* asset : BenchmarkAssets) {
+        MappedFile file;
+        if (!file.Open(asset)) {
+            std::printf("%-32s missing\n", asset);
+            continue;
+        }
+
+        std::vector<Mesh> reference;
+        std::vector<Mesh> meshes;
+        std::string error;
+
+        double assimpMs = TimeMs([&] {
+            reference.clear();
+            ImportModelAssimp(asset, reference, error);
+        });
+
+        double nativeMs = TimeMs([&] {
+            meshes.clear();
+            ParseObj(reinterpret_cast<const char*>(file.Data()), file.Size(), meshes, error);
+        });
+
+        double megabytesPerSecond = file.Size() / (nativeMs * 1000.0);
+        std::printf("%-32s %12.3f %12.3f %10.1f\n", asset, assimpMs, nativeMs, megabytesPerSecond);
+    }
+}
+
+void BenchmarkObjScaling() {
+    std::printf("\n-- chunked OBJ parse scaling --\n");
+
+    std::string text = MakeGridObj(1024);
+    std::printf("synthetic grid, %.1f MB\n", text.size() / (1024.0 * 1024.0));
+    std::printf("%8s %12s %10s %10s\n", "threads", "ms", "MB/s", "speedup");
+
+    // powers of two up to the core count, plus the core count itself
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < DefaultThreadCount(); threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(DefaultThreadCount());
+
+    double singleMs = 0.0;
+    for (unsigned int threads : threadCounts) {
+        std::vector<Mesh> meshes;
+        std::string error;
+
+        double ms = TimeMs([&] {
+            meshes.clear();
+            ParseObj(text.data(), text.size(), meshes, error, threads);
+        }, 3);
+
+        if (threads == 1)
+            singleMs = ms;
+
+        std::printf("%8u %12.3f %10.1f %9.2fx\n", threads, ms, text.size() / (ms * 1000.0), singleMs / ms);
+    }
+}
+
+void PrintCacheRow(const char* name, const Mesh& original) {
+    Mesh mesh = original;
+    const size_t triangles = mesh.indices.size();
+    const size_t vertices = mesh.vertices.size();
+
+    CacheStatistics fifoBefore = SimulateVertexCache(mesh.indices.data(), triangles, vertices, 16, CacheModel::Fifo);
+    CacheStatistics lruBefore = SimulateVertexCache(mesh.indices.data(), triangles, vertices, 32, CacheModel::Lru);
+
+    double ms = TimeMs([&] {
+        mesh.indices = original.indices;
+        OptimizeVertexCache(mesh.indices.data(), triangles, vertices);
+    }, 3);
+
+    CacheStatistics fifoAfter = SimulateVertexCache(mesh.indices.data(), triangles, vertices, 16, CacheModel::Fifo);
+    CacheStatistics lruAfter = SimulateVertexCache(mesh.indices.data(), triangles, vertices, 32, CacheModel::Lru);
+
+    std::printf("%-32s %9zu %6.3f %6.3f %6.3f %6.3f %6.3f %9.3f %8.2f\n", name, triangles,
+        fifoBefore.acmr, fifoAfter.acmr, lruBefore.acmr, lruAfter.acmr, fifoAfter.atvr, ms, triangles / (ms * 1000.0));
+}
+
+void BenchmarkVertexCache() {
+    std::printf("\n-- vertex cache optimization --\n");
+    std::printf("%-32s %9s %13s %13s %6s %9s %8s\n", "mesh", "tris", "FIFO16 ACMR", "LRU32 ACMR", "ATVR", "ms", "Mtris/s");
+
+    for (const char* asset : BenchmarkAssets) {
+        std::vector<Mesh> meshes;
+        std::string error;
+        if (!ImportModel(asset, meshes, error) || meshes.empty()) {
+            std::printf("%-32s missing\n", asset);
+            continue;
+        }
+        PrintCacheRow(asset, meshes[0]);
+    }
+
+    // scanned and CAD meshes often come in no useful order at all, a shuffled grid
+    // stands in for them
+    std::string text = MakeGridObj(256);
+    std::vector<Mesh> grid;
+    std::string error;
+    if (ParseObj(text.data(), text.size(), grid, error) && !grid.empty()) {
+        PrintCacheRow("grid 256x256", grid[0]);
+
+        std::mt19937 random(1234);
+        std::shuffle(grid[0].indices.begin(), grid[0].indices.end(), random);
+        PrintCacheRow("grid 256x256, shuffled", grid[0]);
+    }
+}
+
+void BenchmarkOverdraw() {
+    std::printf("\n-- overdraw clustering, %u views at %ux%u --\n", OverdrawViewCount, OverdrawResolution, OverdrawResolution);
+    std::printf("%-32s %9s %20s %22s %9s %11s\n", "asset", "threshold", "overdraw src/vc/cl", "ACMR vc/cl (FIFO16)", "ms", "measure ms");
+
+    for (const char* asset : BenchmarkAssets) {
+        std::vector<Mesh> meshes;
+        std::string error;
+        if (!ImportModel(asset, meshes, error) || meshes.empty()) {
+            std::printf("%-32s missing\n", asset);
+            continue;
+        }
+
+        Mesh& mesh = meshes[0];
+        const size_t triangles = mesh.indices.size();
+        const size_t vertices = mesh.vertices.size();
+
+        OverdrawStatistics source;
+        double measureMs = TimeMs([&] {
+            source = MeasureOverdraw(mesh.vertices.data(), vertices, mesh.indices.data(), triangles);
+        }, 3);
+
+        OptimizeVertexCache(mesh.indices.data(), triangles, vertices);
+        const std::vector<DirectX::XMUINT3> cacheOrder = mesh.indices;
+        OverdrawStatistics cached = MeasureOverdraw(mesh.vertices.data(), vertices, mesh.indices.data(), triangles);
+        CacheStatistics cachedAcmr = SimulateVertexCache(mesh.indices.data(), triangles, vertices, 16, CacheModel::Fifo);
+
+        for (float threshold : { 1.05f, 1.25f, 2.0f }) {
+            double ms = TimeMs([&] {
+                mesh.indices = cacheOrder;
+                OptimizeOverdraw(mesh.indices.data(), triangles, mesh.vertices.data(), vertices, 16, threshold);
+            }, 3);
+
+            OverdrawStatistics clustered = MeasureOverdraw(mesh.vertices.data(), vertices, mesh.indices.data(), triangles);
+            CacheStatistics clusteredAcmr = SimulateVertexCache(mesh.indices.data(), triangles, vertices, 16, CacheModel::Fifo);
+
+            std::printf("%-32s %9.2f %6.3f %6.3f %6.3f %10.3f %10.3f %9.3f %11.3f\n", asset, threshold,
+                source.overdraw, cached.overdraw, clustered.overdraw, cachedAcmr.acmr, clusteredAcmr.acmr, ms, measureMs);
+        }
+    }
+}
+
+void PrintFetchRow(const char* name, Mesh mesh) {
+    const size_t triangles = mesh.indices.size();
+
+    FetchStatistics source = AnalyzeVertexFetch(mesh.indices.data(), triangles, mesh.vertices.size(), sizeof(Vertex), 16);
+    OptimizeVertexCache(mesh.indices.data(), triangles, mesh.vertices.size());
+    FetchStatistics cached = AnalyzeVertexFetch(mesh.indices.data(), triangles, mesh.vertices.size(), sizeof(Vertex), 16);
+
+    const Mesh cacheOrder = mesh;
+    size_t used = 0;
+    double ms = TimeMs([&] {
+        mesh = cacheOrder;
+        used = OptimizeVertexFetch(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), triangles);
+    }, 3);
+    FetchStatistics remapped = AnalyzeVertexFetch(mesh.indices.data(), triangles, used, sizeof(Vertex), 16);
+
+    std::printf("%-32s %9zu %8.3f %8.3f %8.3f %9.3f\n", name, mesh.vertices.size(),
+        source.overfetch, cached.overfetch, remapped.overfetch, ms);
+}
+
+void BenchmarkVertexFetch() {
+    std::printf("\n-- vertex fetch remap, %zu byte lines, %zu KB direct mapped --\n", FetchCacheLine, FetchCacheSize / 1024);
+    std::printf("%-32s %9s %8s %8s %8s %9s\n", "mesh", "verts", "src", "vcache", "remap", "ms");
+
+    for (const char* asset : BenchmarkAssets) {
+        std::vector<Mesh> meshes;
+        std::string error;
+        if (!ImportModel(asset, meshes, error) || meshes.empty()) {
+            std::printf("%-32s missing\n", asset);
+            continue;
+        }
+        PrintFetchRow(asset, meshes[0]);
+    }
+
+    std::string text = MakeGridObj(256);
+    std::vector<Mesh> grid;
+    std::string error;
+    if (ParseObj(text.data(), text.size(), grid, error) && !grid.empty()) {
+        PrintFetchRow("grid 256x256", grid[0]);
+
+        // the importers number vertices by first use, so a shuffled file also scatters them
+        Mesh& shuffled = grid[0];
+        std::mt19937 random(1234);
+        std::shuffle(shuffled.indices.begin(), shuffled.indices.end(), random);
+        OptimizeVertexFetch(shuffled.vertices.data(), shuffled.vertices.size(), shuffled.indices.data(), shuffled.indices.size());
+        PrintFetchRow("grid 256x256, shuffled", shuffled);
+    }
+}
+
+// in double, float acos can't resolve the tiny angles of the 16 bit encodings
+double AngleBetween(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) {
+    double cross[3] = {
+        double(a.y) * b.z - double(a.z) * b.y,
+        double(a.z) * b.x - double(a.x) * b.z,
+        double(a.x) * b.y - double(a.y) * b.x
+    };
+    double sine = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+    double cosine = double(a.x) * b.x + double(a.y) * b.y + double(a.z) * b.z;
+    return std::atan2(sine, cosine);
+}
+
+// every half converts back exactly, normals stay within their encoding's precision
+void CheckVertexKernels() {
+    unsigned int halfMismatches = 0;
+    for (uint32_t bits = 0; bits < 0x10000; bits++) {
+        uint16_t half = static_cast<uint16_t>(bits);
+        float value = HalfToFloat(half);
+        if (value == value && FloatToHalf(value) != half)
+            halfMismatches++;
+    }
+
+    // directions spread over the sphere
+    const unsigned int directionCount = 100000;
+    double octError = 0.0;
+    double snormError = 0.0;
+    for (unsigned int i = 0; i < directionCount; i++) {
+        float y = 1.0f - (i + 0.5f) * 2.0f / directionCount;
+        float radius = std::sqrt(std::max(0.0f, 1.0f - y * y));
+        float phi = i * 2.39996323f;
+        DirectX::XMFLOAT3 normal(radius * std::cos(phi), y, radius * std::sin(phi));
+
+        int16_t oct[2];
+        EncodeOctahedral(normal, oct);
+        DirectX::XMFLOAT3 decoded = DecodeOctahedral(oct);
+        octError = std::max(octError, AngleBetween(normal, decoded));
+
+        int8_t snorm[3];
+        EncodeSnorm8(normal, snorm);
+        decoded = DecodeSnorm8(snorm);
+        snormError = std::max(snormError, AngleBetween(normal, decoded));
+    }
+
+    const double degrees = 180.0 / 3.14159265358979;
+    std::printf("half round trip: %s, max normal error oct16 %.4f deg, snorm8 %.4f deg\n",
+        halfMismatches == 0 ? "exact" : ("MISMATCH " + std::to_string(halfMismatches)).c_str(),
+        octError * degrees, snormError * degrees);
+}
+
+void BenchmarkVertexFormats() {
+    std::printf("\n-- packed vertex formats --\n");
+    CheckVertexKernels();
+
+    const struct {
+        const char* name;
+        VertexFormat format;
+    } formats[] = {
+        { "float32", { PositionFormat::Float32 } },
+        { "unorm16", { PositionFormat::Unorm16 } },
+    };
+
+    std::printf("%-32s %-10s %7s %10s %12s %9s\n", "asset", "position", "stride", "KB", "pos error", "ms");
+    for (const char* asset : BenchmarkAssets) {
+        std::vector<Mesh> meshes;
+        std::string error;
+        if (!ImportModel(asset, meshes, error) || meshes.empty()) {
+            std::printf("%-32s missing\n", asset);
+            continue;
+        }
+
+        Mesh& mesh = meshes[0];
+        for (const auto& entry : formats) {
+            PackReport report;
+            double ms = TimeMs([&] {
+                report = PackVertices(mesh, entry.format);
+            }, 3);
+
+            std::printf("%-32s %-10s %7u %10.1f %12.2e %9.3f\n", asset, entry.name, report.strideAfter,
+                mesh.packedVertices.size() / 1024.0, report.maxPositionError, ms);
+        }
+    }
+}
+
+void PrintSplitRow(const char* name, const Mesh& mesh) {
+    std::vector<Mesh> submeshes;
+    double ms = TimeMs([&] {
+        submeshes = SplitMesh(mesh, ShortIndexVertexLimit);
+    }, 3);
+
+    // transforms summed over the submeshes, the cuts are the only place locality can get lost
+    CacheStatistics whole = SimulateVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), 16, CacheModel::Fifo);
+    double transforms = 0.0;
+    size_t vertices = 0;
+    size_t packedBytes = 0;
+    for (Mesh& submesh : submeshes) {
+        transforms += SimulateVertexCache(submesh.indices.data(), submesh.indices.size(), submesh.vertices.size(), 16, CacheModel::Fifo).transforms;
+        vertices += submesh.vertices.size();
+        PackIndices(submesh);
+        packedBytes += submesh.packedIndices.size();
+    }
+
+    double duplicated = mesh.vertices.empty() ? 0.0 : 100.0 * (vertices - mesh.vertices.size()) / mesh.vertices.size();
+    std::printf("%-32s %9zu %5zu %7.2f%% %7.3f -> %5.3f %9.1f -> %7.1f %9.3f\n", name, mesh.vertices.size(), submeshes.size(), duplicated,
+        whole.acmr, transforms / mesh.indices.size(), mesh.indices.size() * sizeof(DirectX::XMUINT3) / 1024.0, packedBytes / 1024.0, ms);
+}
+
+void BenchmarkIndexFormats() {
+    std::printf("\n-- 16 bit index splitting, ACMR FIFO16 --\n");
+    std::printf("%-32s %9s %5s %8s %16s %20s %9s\n", "mesh", "vertices", "parts", "dupes", "ACMR whole/split", "index KB 32 -> packed", "ms");
+
+    for (const char* asset : BenchmarkAssets) {
+        std::vector<Mesh> meshes;
+        std::string error;
+        if (!ImportModel(asset, meshes, error) || meshes.empty()) {
+            std::printf("%-32s missing\n", asset);
+            continue;
+        }
+        PrintSplitRow(asset, meshes[0]);
+    }
+
+    // big enough to need several submeshes, in the order the importer would leave it
+    std::string text = MakeGridObj(512);
+    std::vector<Mesh> grid;
+    std::string error;
+    if (ParseObj(text.data(), text.size(), grid, error) && !grid.empty()) {
+        Mesh& mesh = grid[0];
+        OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+        size_t used = OptimizeVertexFetch(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size());
+        mesh.vertices.resize(used);
+        PrintSplitRow("grid 512x512, optimized", mesh);
+    }
+}
+
+void PrintLodRow(const char* name, const Mesh& mesh) {
+    std::vector<SimplifiedLevel> levels;
+    double ms = TimeMs([&] {
+        levels = SimplifyLevels(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size(), LodRatios, LodCount);
+    }, 3);
+
+    std::string triangles;
+    std::string errors;
+    char cell[32];
+    for (const SimplifiedLevel& level : levels) {
+        std::snprintf(cell, sizeof(cell), " %zu", level.triangles.size());
+        triangles += cell;
+        std::snprintf(cell, sizeof(cell), " %.2e", level.error);
+        errors += cell;
+    }
+
+    std::printf("%-32s %9zu %-28s %-40s %9.2f %8.2f\n", name, mesh.indices.size(), triangles.c_str(), errors.c_str(),
+        ms, mesh.indices.size() / (ms * 1000.0));
+}
+
+void BenchmarkSimplifier() {
+    std::printf("\n-- quadric simplification, levels at 50/25/12.5/6.25%% --\n");
+    std::printf("%-32s %9s %-28s %-40s %9s %8s\n", "mesh", "tris", "level tris", "level error", "ms", "Mtris/s");
+
+    for (const char* asset : BenchmarkAssets) {
+        std::vector<Mesh> meshes;
+        std::string error;
+        if (!ImportModel(asset, meshes, error) || meshes.empty()) {
+            std::printf("%-32s missing\n", asset);
+            continue;
+        }
+        PrintLodRow(asset, meshes[0]);
+    }
+
+    std::string text = MakeGridObj(256);
+    std::vector<Mesh> grid;
+    std::string error;
+    if (ParseObj(text.data(), text.size(), grid, error) && !grid.empty())
+        PrintLodRow("grid 256x256", grid[0]);
+}
+
+// fraction of triangles facing away from the eye, what per triangle culling would remove
+double BackfacingRatio(const Mesh& mesh, const DirectX::XMFLOAT3& eye) {
+    size_t backfacing = 0;
+    for (const DirectX::XMUINT3& t : mesh.indices) {
+        const DirectX::XMFLOAT3& a = mesh.vertices[t.x].Pos;
+        const DirectX::XMFLOAT3& b = mesh.vertices[t.y].Pos;
+        const DirectX::XMFLOAT3& c = mesh.vertices[t.z].Pos;
+        float ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+        float vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+        float nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+        if (nx * (eye.x - a.x) + ny * (eye.y - a.y) + nz * (eye.z - a.z) <= 0.0f)
+            backfacing++;
+    }
+    return double(backfacing) / mesh.indices.size();
+}
+
+void BenchmarkMeshlets() {
+    std::printf("\n-- meshlet culling, %zu vertices / %zu triangles, orbits of 16 views --\n", MaxMeshletVertices, MaxMeshletTriangles);
+    std::printf("%-32s %9s %9s %10s %10s %10s %12s %12s\n", "orbit", "meshlets", "build ms", "frustum %", "cone %", "culled %", "per-tri bf %", "ns/meshlet");
+
+    for (const char* asset : BenchmarkAssets) {
+        std::vector<Mesh> meshes;
+        std::string error;
+        if (!ImportModel(asset, meshes, error) || meshes.empty()) {
+            std::printf("%-32s missing\n", asset);
+            continue;
+        }
+
+        Mesh& mesh = meshes[0];
+        OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+        std::vector<DirectX::XMUINT3> cacheOrder = mesh.indices;
+        std::vector<Meshlet> meshlets;
+        double buildMs = TimeMs([&] {
+            mesh.indices = cacheOrder;
+            meshlets = BuildMeshlets(mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), mesh.vertices.size());
+        }, 3);
+
+        const Bounds& bounds = mesh.bounds;
+        DirectX::XMFLOAT3 center((bounds.minCoord.x + bounds.maxCoord.x) * 0.5f, (bounds.minCoord.y + bounds.maxCoord.y) * 0.5f,
+            (bounds.minCoord.z + bounds.maxCoord.z) * 0.5f);
+        float dx = bounds.maxCoord.x - bounds.minCoord.x;
+        float dy = bounds.maxCoord.y - bounds.minCoord.y;
+        float dz = bounds.maxCoord.z - bounds.minCoord.z;
+        float radius = 0.5f * std::sqrt(dx * dx + dy * dy + dz * dz);
+
+        // distant orbits that see the whole model, and close ones that only see part of it.
+        // Distances are in bounding radii.
+        const struct {
+            const char* name;
+            float distance;
+            float elevation;
+        } orbits[] = {
+            { "far, level", 3.0f, 0.0f },
+            { "far, 45 deg up", 3.0f, 0.785f },
+            { "close, 45 deg up", 0.75f, 0.785f },
+            { "close, 80 deg up", 0.75f, 1.4f },
+        };
+
+        // the same meshlets without cones, to tell the two tests apart
+        std::vector<Meshlet> withoutCones = meshlets;
+        for (Meshlet& meshlet : withoutCones)
+            meshlet.coneCutoff = 2.0f;
+
+        std::printf("%s\n", asset);
+        std::vector<uint32_t> visible(meshlets.size());
+        for (const auto& orbit : orbits) {
+            size_t totalTriangles = 0;
+            size_t frustumCulled = 0;
+            size_t coneCulled = 0;
+            size_t culled = 0;
+            double backfacing = 0.0;
+            double cullMs = 0.0;
+
+            const int views = 16;
+            for (int i = 0; i < views; i++) {
+                float azimuth = i * 2.0f * 3.14159265f / views;
+                float distance = orbit.distance * radius;
+                DirectX::XMFLOAT3 eye(center.x + distance * std::cos(orbit.elevation) * std::cos(azimuth),
+                    center.y + distance * std::sin(orbit.elevation),
+                    center.z + distance * std::cos(orbit.elevation) * std::sin(azimuth));
+                CullView view = MakeCullView(eye, center, DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f), 0.785f, 16.0f / 9.0f, 0.1f, 1000.0f);
+
+                // a frustum that takes in everything leaves just the cones
+                CullView coneOnly = view;
+                for (DirectX::XMFLOAT4& plane : coneOnly.planes)
+                    plane = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+
+                size_t visibleCount = 0;
+                cullMs += TimeMs([&] {
+                    visibleCount = CullMeshlets(meshlets.data(), meshlets.size(), view, visible.data());
+                }, 100);
+
+                auto culledTriangles = [&](const std::vector<Meshlet>& tested, const CullView& test) {
+                    size_t count = CullMeshlets(tested.data(), tested.size(), test, visible.data());
+                    size_t kept = 0;
+                    for (size_t k = 0; k < count; k++)
+                        kept += meshlets[visible[k]].numberOfIndices / 3;
+                    return mesh.indices.size() - kept;
+                };
+
+                frustumCulled += culledTriangles(withoutCones, view);
+                coneCulled += culledTriangles(meshlets, coneOnly);
+                culled += culledTriangles(meshlets, view);
+                totalTriangles += mesh.indices.size();
+                backfacing += BackfacingRatio(mesh, eye);
+            }
+
+            std::printf("  %-30s %9zu %9.3f %10.1f %10.1f %10.1f %12.1f %12.2f\n", orbit.name, meshlets.size(), buildMs,
+                100.0 * frustumCulled / totalTriangles, 100.0 * coneCulled / totalTriangles, 100.0 * culled / totalTriangles,
+                100.0 * backfacing / views, cullMs * 1e6 / views / meshlets.size());
+        }
+    }
+}
+
+// the importer's order and packing, which is what the codec sees when cooking
+void PrepareForCooking(Mesh& mesh) {
+    OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+    size_t used = OptimizeVertexFetch(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size());
+    mesh.vertices.resize(used);
+    mesh.numberOfVertices = static_cast<unsigned int>(used);
+    mesh.numberOfIndices = static_cast<unsigned int>(mesh.indices.size() * 3);
+    PackIndices(mesh);
+}
+
+bool SameMesh(const Mesh& a, const Mesh& b) {
+    return a.vertices.size() == b.vertices.size() && a.indices.size() == b.indices.size() &&
+        std::memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(Vertex)) == 0 &&
+        std::memcmp(a.indices.data(), b.indices.data(), a.indices.size() * sizeof(DirectX::XMUINT3)) == 0 &&
+        a.packedVertices == b.packedVertices && a.packedIndices == b.packedIndices &&
+        a.format.position == b.format.position && a.indexFormat == b.indexFormat &&
+        a.numberOfVertices == b.numberOfVertices && a.numberOfIndices == b.numberOfIndices &&
+        std::memcmp(&a.bounds, &b.bounds, sizeof(Bounds)) == 0 &&
+        std::memcmp(&a.dequantization, &b.dequantization, sizeof(Dequantization)) == 0;
+}
+
+void PrintCodecRow(const char* name, const char* format, const Mesh& mesh) {
+    uint32_t stride = VertexStride(mesh.format);
+    std::vector<uint8_t> vertexStream = EncodeVertexBuffer(mesh.packedVertices.data(), mesh.vertices.size(), stride);
+    std::vector<uint8_t> indexStream;
+    double encodeMs = TimeMs([&] {
+        indexStream = EncodeIndexBuffer(mesh.indices.data(), mesh.indices.size());
+    }, 1);
+
+    // decoded into fresh buffers every time, the way a cooked load would
+    std::vector<uint8_t> vertices(mesh.packedVertices.size());
+    std::vector<uint8_t> indices(mesh.packedIndices.size());
+    bool exact = true;
+    double vertexMs = TimeMs([&] {
+        exact &= DecodeVertexBuffer(vertices.data(), mesh.vertices.size(), stride, vertexStream.data(), vertexStream.size());
+    });
+    double indexMs = TimeMs([&] {
+        exact &= DecodeIndexBuffer(indices.data(), mesh.indices.size(), mesh.indexFormat, mesh.vertices.size(), indexStream.data(), indexStream.size());
+    });
+    exact = exact && vertices == mesh.packedVertices && indices == mesh.packedIndices;
+
+    // and the whole mesh, full precision vertices and all
+    Mesh decoded;
+    std::vector<uint8_t> encoded = EncodeMesh(mesh);
+    exact = exact && DecodeMesh(encoded.data(), encoded.size(), decoded) && SameMesh(mesh, decoded);
+
+    std::printf("%-32s %-8s %8.1f %6.2fx %7.2f %8.1f %6.2fx %7.2f %6.2f %9.1f %6s\n", name, format,
+        mesh.packedVertices.size() / 1024.0, double(mesh.packedVertices.size()) / vertexStream.size(),
+        mesh.packedVertices.size() / (vertexMs * 1e6),
+        mesh.packedIndices.size() / 1024.0, double(mesh.packedIndices.size()) / indexStream.size(),
+        mesh.packedIndices.size() / (indexMs * 1e6),
+        double(indexStream.size()) / mesh.indices.size(), mesh.indices.size() / (encodeMs * 1000.0),
+        exact ? "yes" : "NO");
+}
+
+void BenchmarkGeometryCodec() {
+    std::printf("\n-- geometry codec, ratio and decode GB/s of the packed buffers --\n");
+    std::printf("%-32s %-8s %8s %7s %7s %8s %7s %7s %6s %9s %6s\n", "mesh", "position", "vert KB", "ratio", "GB/s",
+        "index KB", "ratio", "GB/s", "B/tri", "enc Mt/s", "exact");
+
+    const struct {
+        const char* name;
+        VertexFormat format;
+    } formats[] = {
+        { "float32", { PositionFormat::Float32 } },
+        { "unorm16", { PositionFormat::Unorm16 } },
+    };
+
+    for (const char* asset : BenchmarkAssets) {
+        std::vector<Mesh> meshes;
+        std::string error;
+        if (!ImportModel(asset, meshes, error) || meshes.empty()) {
+            std::printf("%-32s missing\n", asset);
+            continue;
+        }
+        Mesh& mesh = meshes[0];
+        PrepareForCooking(mesh);
+        for (const auto& entry : formats) {
+            PackVertices(mesh, entry.format);
+            PrintCodecRow(asset, entry.name, mesh);
+        }
+    }
+
+    // a million vertices, past what 16 bit indices address
+    std::string text = MakeGridObj(1024);
+    std::vector<Mesh> grid;
+    std::string error;
+    if (ParseObj(text.data(), text.size(), grid, error) && !grid.empty()) {
+        Mesh& mesh = grid[0];
+        PrepareForCooking(mesh);
+        for (const auto& entry : formats) {
+            PackVertices(mesh, entry.format);
+            PrintCodecRow("grid 1024x1024", entry.name, mesh);
+        }
+    }
+}
+
+// heap traffic of a whole LoadModel, first importing and cooking, then served from the
+// cooked cache. Retained is what the model holds on to when it's handed to the renderer.
+// Rows are appended to table, LoadModel prints its own reports along the way.
+void MeasureImportMemory(const char* name, const std::string& filePath, const ImportOptions& options, std::string& table) {
+    for (int pass = 0; pass < 2; pass++) {
+        ResetAllocationPeak();
+        AllocationStats before = GetAllocationStats();
+        AllocationStats loaded;
+
+        auto start = std::chrono::steady_clock::now();
+        {
+            ModelData model;
+            if (!LoadModel(filePath, options, model)) {
+                table += std::string(name) + " failed: " + model.error + "\n";
+                return;
+            }
+            loaded = GetAllocationStats();
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        AllocationStats after = GetAllocationStats();
+
+        const double megabyte = 1024.0 * 1024.0;
+        char row[160];
+        std::snprintf(row, sizeof(row), "%-24s %-8s %12llu %12.2f %12.2f %10.2f\n", name, pass == 0 ? "import" : "cooked",
+            static_cast<unsigned long long>(after.allocations - before.allocations),
+            (after.peakBytes - before.liveBytes) / megabyte, (loaded.liveBytes - before.liveBytes) / megabyte,
+            elapsed.count());
+        table += row;
+    }
+}
+
+void BenchmarkImportMemory() {
+    // what the viewer asks for
+    ImportOptions options;
+    options.optimizeOverdraw = true;
+    options.generateLods = true;
+    options.compressGeometry = true;
+    options.vertexFormat.position = PositionFormat::Unorm16;
+
+    std::error_code ec;
+    std::string gridPath = (std::filesystem::temp_directory_path(ec) / "stengine_grid_1024.obj").string();
+    {
+        std::string text = MakeGridObj(1024);
+        std::FILE* file = std::fopen(gridPath.c_str(), "wb");
+        if (file) {
+            std::fwrite(text.data(), 1, text.size(), file);
+            std::fclose(file);
+        }
+    }
+
+    // start from a cold cache so the first pass imports
+    std::vector<std::pair<const char*, std::string>> assets = { { "teapot", BenchmarkAssets[0] }, { "grid 1024", gridPath } };
+    for (const auto& asset : assets) {
+        CacheKey key;
+        bool rehashed;
+        if (GetContentHash(asset.second, key.contentHash, rehashed)) {
+            key.settingsHash = ImportSettingsHash(options);
+            std::filesystem::remove(CookedPathFor(key), ec);
+        }
+    }
+
+    std::string table;
+    for (const auto& asset : assets)
+        MeasureImportMemory(asset.first, asset.second, options, table);
+    std::filesystem::remove(gridPath, ec);
+
+    std::printf("\n-- import memory --\n");
+    std::printf("%-24s %-8s %12s %12s %12s %10s\n", "asset", "path", "allocations", "peak MB", "retained MB", "ms");
+    std::printf("%s", table.c_str());
+}
+
+// an OBJ file's records as written, faces fanned into triangles, for checks that need the
+// per corner normals and texcoords the importers weld away
+struct ObjCorners {
+    std::vector<DirectX::XMFLOAT3> positions;
+    std::vector<DirectX::XMFLOAT2> texcoords;
+    std::vector<DirectX::XMFLOAT3> normals;
+    std::vector<DirectX::XMUINT3> positionTriangles;
+    std::vector<DirectX::XMUINT3> texcoordTriangles;
+    std::vector<DirectX::XMUINT3> normalTriangles;
+};
+
+// parsed with the same routine as Assimp's OBJ loader, so the values round the same
+bool ReadFloats(const char* cursor, float* values, int count) {
+    for (int i = 0; i < count; i++) {
+        while (*cursor == ' ' || *cursor == '\t')
+            cursor++;
+        if (!(*cursor == '-' || *cursor == '+' || *cursor == '.' || (*cursor >= '0' && *cursor <= '9')))
+            return false;
+        cursor = Assimp::fast_atoreal_move<float>(cursor, values[i]);
+    }
+    return true;
+}
+
+bool ReadObjCorners(const char* filePath, ObjCorners& obj) {
+    std::FILE* file = std::fopen(filePath, "rb");
+    if (!file)
+        return false;
+
+    char line[1024];
+    while (std::fgets(line, sizeof(line), file)) {
+        float v[3];
+        if (line[0] == 'v' && line[1] == ' ' && ReadFloats(line + 2, v, 3)) {
+            obj.positions.push_back(DirectX::XMFLOAT3(v[0], v[1], v[2]));
+        }
+        else if (line[0] == 'v' && line[1] == 't' && ReadFloats(line + 3, v, 2)) {
+            obj.texcoords.push_back(DirectX::XMFLOAT2(v[0], v[1]));
+        }
+        else if (line[0] == 'v' && line[1] == 'n' && ReadFloats(line + 3, v, 3)) {
+            obj.normals.push_back(DirectX::XMFLOAT3(v[0], v[1], v[2]));
+        }
+        else if (line[0] == 'f' && line[1] == ' ') {
+            // p, p/t, p//n or p/t/n, 1 based
+            uint32_t corners[64][3];
+            size_t count = 0;
+            for (char* token = std::strtok(line + 2, " \t\r\n"); token && count < 64; token = std::strtok(nullptr, " \t\r\n")) {
+                uint32_t* corner = corners[count++];
+                corner[0] = corner[1] = corner[2] = 0;
+                char* cursor = token;
+                for (int element = 0; element < 3 && *cursor; element++) {
+                    corner[element] = static_cast<uint32_t>(std::strtoul(cursor, &cursor, 10));
+                    if (*cursor != '/')
+                        break;
+                    cursor++;
+                }
+            }
+
+            for (size_t i = 2; i < count; i++) {
+                const uint32_t* a = corners[0];
+                const uint32_t* b = corners[i - 1];
+                const uint32_t* c = corners[i];
+                obj.positionTriangles.push_back(DirectX::XMUINT3(a[0] - 1, b[0] - 1, c[0] - 1));
+                obj.texcoordTriangles.push_back(DirectX::XMUINT3(a[1] - 1, b[1] - 1, c[1] - 1));
+                obj.normalTriangles.push_back(DirectX::XMUINT3(a[2] - 1, b[2] - 1, c[2] - 1));
+            }
+        }
+    }
+
+    std::fclose(file);
+    return true;
+}
+
+// how far generated per corner normals are from the ones written in the file
+void PrintNormalRow(const char* name, const ObjCorners& obj, const NormalOptions& options) {
+    size_t triangleCount = obj.positionTriangles.size();
+    std::vector<DirectX::XMFLOAT3> normals(triangleCount * 3);
+    GenerateNormals(obj.positions.data(), obj.positions.size(), obj.positionTriangles.data(), triangleCount, options, normals.data());
+
+    const double degrees = 180.0 / 3.14159265358979;
+    double sum = 0.0;
+    double worst = 0.0;
+    for (size_t i = 0; i < triangleCount; i++) {
+        const DirectX::XMUINT3& reference = obj.normalTriangles[i];
+        uint32_t indices[3] = { reference.x, reference.y, reference.z };
+        for (int corner = 0; corner < 3; corner++) {
+            double error = AngleBetween(normals[i * 3 + corner], obj.normals[indices[corner]]) * degrees;
+            sum += error;
+            worst = std::max(worst, error);
+        }
+    }
+
+    // the acos approximation in the angle weights is good to 7e-5 radians
+    const double toleranceDegrees = 0.05;
+    std::printf("%-16s %8.1f %12.4f %12.4f  %s\n", name, options.smoothingAngle, sum / (triangleCount * 3), worst,
+        worst < toleranceDegrees ? "matches" : "differs");
+}
+
+// MikkTSpace's rules spelled out per corner in double with the exact acos, to check the
+// lane kernels and the acos approximation against
+std::vector<DirectX::XMFLOAT4> ReferenceTangents(const TangentInput& input) {
+    struct Double3 {
+        double x, y, z;
+    };
+    auto load = [](const DirectX::XMFLOAT3& v) { return Double3{ v.x, v.y, v.z }; };
+    auto sub = [](const Double3& a, const Double3& b) { return Double3{ a.x - b.x, a.y - b.y, a.z - b.z }; };
+    auto scale = [](const Double3& a, double s) { return Double3{ a.x * s, a.y * s, a.z * s }; };
+    auto dot = [](const Double3& a, const Double3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; };
+    auto normalize = [&](const Double3& a) {
+        double length = std::sqrt(dot(a, a));
+        return length > 0.0 ? scale(a, 1.0 / length) : a;
+    };
+    auto reject = [&](const Double3& a, const Double3& n) { return sub(a, scale(n, dot(n, a))); };
+
+    std::vector<Double3> sums(input.vertexCount * 2, Double3{ 0.0, 0.0, 0.0 });
+    std::vector<int> orientations(input.triangleCount * 3);
+
+    for (size_t i = 0; i < input.triangleCount; i++) {
+        const DirectX::XMUINT3& pt = input.positionTriangles[i];
+        const DirectX::XMUINT3& tt = input.texcoordTriangles[i];
+        const DirectX::XMUINT3& vt = input.vertexTriangles[i];
+        Double3 p[3] = { load(input.positions[pt.x]), load(input.positions[pt.y]), load(input.positions[pt.z]) };
+        DirectX::XMFLOAT2 t[3] = { input.texcoords[tt.x], input.texcoords[tt.y], input.texcoords[tt.z] };
+        uint32_t vertices[3] = { vt.x, vt.y, vt.z };
+
+        double t21x = t[1].x - t[0].x, t21y = t[1].y - t[0].y;
+        double t31x = t[2].x - t[0].x, t31y = t[2].y - t[0].y;
+        double area = t21x * t31y - t21y * t31x;
+        int orientation = area > 0.0 ? 1 : area < 0.0 ? -1 : 0;
+        Double3 s = scale(normalize(sub(scale(sub(p[1], p[0]), t31y), scale(sub(p[2], p[0]), t21y))), area > 0.0 ? 1.0 : -1.0);
+
+        for (int corner = 0; corner < 3; corner++) {
+            orientations[i * 3 + corner] = orientation;
+            if (orientation == 0)
+                continue;
+
+            Double3 n = load(input.normals[i * 3 + corner]);
+            Double3 edge1 = normalize(reject(sub(p[(corner + 2) % 3], p[corner]), n));
+            Double3 edge2 = normalize(reject(sub(p[(corner + 1) % 3], p[corner]), n));
+            double angle = std::acos(std::max(-1.0, std::min(1.0, dot(edge1, edge2))));
+            Double3 tangent = scale(normalize(reject(s, n)), angle);
+
+            Double3& sum = sums[vertices[corner] * 2 + (orientation > 0 ? 1 : 0)];
+            sum = Double3{ sum.x + tangent.x, sum.y + tangent.y, sum.z + tangent.z };
+        }
+    }
+
+    std::vector<DirectX::XMFLOAT4> tangents(input.triangleCount * 3);
+    for (size_t i = 0; i < input.triangleCount; i++) {
+        const DirectX::XMUINT3& vt = input.vertexTriangles[i];
+        uint32_t vertices[3] = { vt.x, vt.y, vt.z };
+        for (int corner = 0; corner < 3; corner++) {
+            int orientation = orientations[i * 3 + corner];
+            int group = orientation > 0 ? 1 : orientation < 0 ? 0 : dot(sums[vertices[corner] * 2 + 1], sums[vertices[corner] * 2 + 1]) > 0.0 ? 1 : 0;
+            Double3 tangent = normalize(sums[vertices[corner] * 2 + group]);
+            tangents[i * 3 + corner] = DirectX::XMFLOAT4(float(tangent.x), float(tangent.y), float(tangent.z), group ? 1.0f : -1.0f);
+        }
+    }
+    return tangents;
+}
+
+// the corners of one vertex share position, texcoord and normal record
+std::vector<DirectX::XMUINT3> WeldObjCorners(const ObjCorners& obj, size_t& vertexCount) {
+    std::unordered_map<uint64_t, uint32_t> ids;
+    std::vector<DirectX::XMUINT3> vertexTriangles(obj.positionTriangles.size());
+    auto weld = [&](uint32_t position, uint32_t texcoord, uint32_t normal) {
+        uint64_t key = (uint64_t(position) << 42) ^ (uint64_t(texcoord) << 21) ^ normal;
+        return ids.emplace(key, static_cast<uint32_t>(ids.size())).first->second;
+    };
+
+    for (size_t i = 0; i < obj.positionTriangles.size(); i++) {
+        const DirectX::XMUINT3& p = obj.positionTriangles[i];
+        const DirectX::XMUINT3& t = obj.texcoordTriangles[i];
+        const DirectX::XMUINT3& n = obj.normalTriangles[i];
+        vertexTriangles[i] = DirectX::XMUINT3(weld(p.x, t.x, n.x), weld(p.y, t.y, n.y), weld(p.z, t.z, n.z));
+    }
+
+    vertexCount = ids.size();
+    return vertexTriangles;
+}
+
+void CheckTangents(const char* filePath) {
+    ObjCorners obj;
+    if (!ReadObjCorners(filePath, obj) || obj.texcoords.empty() || obj.normals.empty()) {
+        std::printf("%s missing\n", filePath);
+        return;
+    }
+
+    size_t triangleCount = obj.positionTriangles.size();
+    std::vector<DirectX::XMFLOAT3> normals(triangleCount * 3);
+    for (size_t i = 0; i < triangleCount; i++) {
+        normals[i * 3 + 0] = obj.normals[obj.normalTriangles[i].x];
+        normals[i * 3 + 1] = obj.normals[obj.normalTriangles[i].y];
+        normals[i * 3 + 2] = obj.normals[obj.normalTriangles[i].z];
+    }
+
+    size_t vertexCount;
+    std::vector<DirectX::XMUINT3> vertexTriangles = WeldObjCorners(obj, vertexCount);
+    TangentInput input = { obj.positions.data(), obj.positionTriangles.data(), obj.texcoords.data(), obj.texcoordTriangles.data(),
+        normals.data(), vertexTriangles.data(), vertexCount, triangleCount };
+
+    std::vector<DirectX::XMFLOAT4> tangents(triangleCount * 3);
+    GenerateTangents(input, tangents.data());
+    std::vector<DirectX::XMFLOAT4> reference = ReferenceTangents(input);
+
+    const double degrees = 180.0 / 3.14159265358979;
+    double worst = 0.0;
+    double worstSkew = 0.0;
+    size_t flipped = 0;
+    size_t mirrored = 0;
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        DirectX::XMFLOAT3 t(tangents[i].x, tangents[i].y, tangents[i].z);
+        DirectX::XMFLOAT3 r(reference[i].x, reference[i].y, reference[i].z);
+        worst = std::max(worst, AngleBetween(t, r) * degrees);
+        worstSkew = std::max(worstSkew, std::fabs(AngleBetween(t, normals[i]) * degrees - 90.0));
+        if (tangents[i].w != reference[i].w)
+            flipped++;
+        if (tangents[i].w < 0.0f)
+            mirrored++;
+    }
+
+    std::printf("tangents %s: %zu vertices, max %.4f deg from the double reference, %zu signs differ, "
+        "max %.4f deg off perpendicular, %zu mirrored corners\n",
+        filePath, vertexCount, worst, flipped, worstSkew, mirrored);
+}
+
+// side x side grid with texcoords across it, as corners
+void MakeGridCorners(unsigned int side, ObjCorners& grid) {
+    for (unsigned int y = 0; y < side; y++) {
+        for (unsigned int x = 0; x < side; x++) {
+            float height = 0.05f * static_cast<float>((x * 7 + y * 13) % 17);
+            grid.positions.push_back(DirectX::XMFLOAT3(x * 0.01f, height, y * 0.01f));
+            grid.texcoords.push_back(DirectX::XMFLOAT2(float(x) / side, float(y) / side));
+        }
+    }
+
+    for (unsigned int y = 0; y + 1 < side; y++) {
+        for (unsigned int x = 0; x + 1 < side; x++) {
+            uint32_t a = y * side + x;
+            uint32_t b = a + 1;
+            uint32_t c = a + side;
+            uint32_t d = c + 1;
+            grid.positionTriangles.push_back(DirectX::XMUINT3(a, b, d));
+            grid.positionTriangles.push_back(DirectX::XMUINT3(a, d, c));
+        }
+    }
+    grid.texcoordTriangles = grid.positionTriangles;
+}
+
+void BenchmarkTangentSpace() {
+    std::printf("\n-- normal and tangent generation --\n");
+
+    ObjCorners teapot;
+    if (!ReadObjCorners("Assets/teapot_normals.obj", teapot) || teapot.normals.empty()) {
+        std::printf("Assets/teapot_normals.obj missing\n");
+        return;
+    }
+
+    std::printf("against the normals in teapot_normals.obj, %zu corners\n", teapot.positionTriangles.size() * 3);
+    std::printf("%-16s %8s %12s %12s\n", "weighting", "smooth", "mean deg", "max deg");
+    const NormalWeighting weightings[] = { NormalWeighting::Area, NormalWeighting::Angle, NormalWeighting::AreaAngle };
+    const char* weightingNames[] = { "area", "angle", "area x angle" };
+    for (int i = 0; i < 3; i++) {
+        NormalOptions options;
+        options.weighting = weightings[i];
+        PrintNormalRow(weightingNames[i], teapot, options);
+    }
+    NormalOptions creased;
+    creased.smoothingAngle = 60.0f;
+    PrintNormalRow("angle", teapot, creased);
+
+    CheckTangents("Assets/teapot_normals_uv.obj");
+
+    ObjCorners grid;
+    MakeGridCorners(1024, grid);
+    size_t triangleCount = grid.positionTriangles.size();
+    std::vector<DirectX::XMFLOAT3> normals(triangleCount * 3);
+    std::vector<DirectX::XMFLOAT3> singleNormals(triangleCount * 3);
+    std::vector<DirectX::XMFLOAT4> tangents(triangleCount * 3);
+    std::vector<DirectX::XMFLOAT4> singleTangents(triangleCount * 3);
+
+    NormalOptions options;
+    options.smoothingAngle = 60.0f;
+    TangentInput input = { grid.positions.data(), grid.positionTriangles.data(), grid.texcoords.data(), grid.texcoordTriangles.data(),
+        normals.data(), grid.positionTriangles.data(), grid.positions.size(), triangleCount };
+
+    std::printf("grid 1024x1024, %zu triangles, smoothing angle %.0f\n", triangleCount, options.smoothingAngle);
+    std::printf("%8s %14s %14s\n", "threads", "normals Mtri/s", "tangents Mtri/s");
+    for (int pass = 0; pass < 2; pass++) {
+        unsigned int threads = pass == 0 ? 1 : DefaultThreadCount();
+        std::vector<DirectX::XMFLOAT3>& normalsOut = pass == 0 ? singleNormals : normals;
+        std::vector<DirectX::XMFLOAT4>& tangentsOut = pass == 0 ? singleTangents : tangents;
+
+        double normalMs = TimeMs([&] {
+            GenerateNormals(grid.positions.data(), grid.positions.size(), grid.positionTriangles.data(), triangleCount, options,
+                normalsOut.data(), threads);
+        }, 3);
+        input.normals = normalsOut.data();
+        double tangentMs = TimeMs([&] {
+            GenerateTangents(input, tangentsOut.data(), threads);
+        }, 3);
+
+        std::printf("%8u %14.1f %14.1f\n", threads, triangleCount / (normalMs * 1000.0), triangleCount / (tangentMs * 1000.0));
+    }
+
+    bool deterministic = std::memcmp(normals.data(), singleNormals.data(), normals.size() * sizeof(DirectX::XMFLOAT3)) == 0 &&
+        std::memcmp(tangents.data(), singleTangents.data(), tangents.size() * sizeof(DirectX::XMFLOAT4)) == 0;
+    std::printf("threaded output %s single threaded\n", deterministic ? "identical to" : "DIFFERS from");
+}
+
+// reads every cache line, so the pages of a mapping or a pack get faulted in like a copy would
+uint64_t TouchBytes(const uint8_t* data, size_t size) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < size; i += 64)
+        sum += data[i];
+    return sum;
+}
+
+// startup reads thousands of small files, loose through one open each against views into a
+// single mapped pack. The OS file cache is warm for both, so this is the syscall overhead.
+void BenchmarkPackFile() {
+    std::printf("\n-- pack file --\n");
+
+    const std::filesystem::path looseDirectory = std::filesystem::path(CacheDirectory) / "packbench";
+    const std::string packPath = (std::filesystem::path(CacheDirectory) / "packbench.pack").string();
+    constexpr int FileCount = 2000;
+
+    // stand-ins for shaders, materials and small meshes, 0.5 to 16 KB each
+    std::error_code ec;
+    std::filesystem::create_directories(looseDirectory, ec);
+    std::mt19937 random(7);
+    std::vector<std::string> paths;
+    size_t totalBytes = 0;
+    for (int i = 0; i < FileCount; i++) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "file%04d.bin", i);
+        paths.push_back((looseDirectory / name).generic_string());
+
+        std::vector<char> bytes(512 + random() % (16 * 1024 - 512));
+        for (char& byte : bytes)
+            byte = static_cast<char>(random());
+        std::ofstream(paths.back(), std::ios::binary).write(bytes.data(), bytes.size());
+        totalBytes += bytes.size();
+    }
+
+    std::vector<std::string> inputs = { looseDirectory.generic_string() };
+    inputs.insert(inputs.end(), std::begin(BenchmarkAssets), std::end(BenchmarkAssets));
+
+    std::string error;
+    double writeMs = TimeMs([&] {
+        WritePackFile(packPath, inputs, error);
+    }, 1);
+    PackFile pack;
+    if (!pack.Open(packPath, error)) {
+        std::printf("%s\n", error.c_str());
+        return;
+    }
+    std::printf("%d files, %.1f MB, packed in %.1f ms\n", FileCount, totalBytes / (1024.0 * 1024.0), writeMs);
+    pack.Close();
+
+    volatile uint64_t sink = 0;
+    // what loadCompiledShader used to do
+    double streamMs = TimeMs([&] {
+        for (const std::string& path : paths) {
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            std::vector<uint8_t> buffer(static_cast<size_t>(file.tellg()));
+            file.seekg(0, std::ios::beg);
+            file.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+            sink = sink + TouchBytes(buffer.data(), buffer.size());
+        }
+    }, 3);
+
+    double mappedMs = TimeMs([&] {
+        for (const std::string& path : paths) {
+            MappedFile file;
+            file.Open(path);
+            sink = sink + TouchBytes(file.Data(), file.Size());
+        }
+    }, 3);
+
+    // mounting is part of the startup it replaces
+    size_t found = 0;
+    double packedMs = TimeMs([&] {
+        UnmountPacks();
+        MountPack(packPath, error);
+        found = 0;
+        for (const std::string& path : paths) {
+            AssetFile file;
+            found += file.Open(path) && file.IsPacked();
+            sink = sink + TouchBytes(file.Data(), file.Size());
+        }
+    }, 3);
+    UnmountPacks();
+
+    std::printf("%-24s %10s %12s\n", "reads", "ms", "us/file");
+    std::printf("%-24s %10.2f %12.2f\n", "loose ifstream", streamMs, streamMs * 1000.0 / FileCount);
+    std::printf("%-24s %10.2f %12.2f\n", "loose mapped", mappedMs, mappedMs * 1000.0 / FileCount);
+    std::printf("%-24s %10.2f %12.2f  %zu/%d from the pack\n", "packed", packedMs, packedMs * 1000.0 / FileCount, found, FileCount);
+
+    // the importers and the cache key lookup through the pack, Assimp through PackIOSystem
+    std::printf("%-32s %12s %12s %12s %12s %s\n", "asset", "loose ms", "packed ms", "key loose", "key packed", "assimp");
+    for (const char* asset : BenchmarkAssets) {
+        std::vector<Mesh> loose, packed, assimpPacked;
+        uint64_t looseHash = 0, packedHash = 0;
+        bool rehashed;
+
+        double looseMs = TimeMs([&] {
+            loose.clear();
+            ImportModel(asset, loose, error);
+        });
+        double looseKeyMs = TimeMs([&] {
+            GetContentHash(asset, looseHash, rehashed);
+        });
+
+        MountPack(packPath, error);
+        double packedMs = TimeMs([&] {
+            packed.clear();
+            ImportModel(asset, packed, error);
+        });
+        double packedKeyMs = TimeMs([&] {
+            GetContentHash(asset, packedHash, rehashed);
+        });
+        bool assimpLoaded = ImportModelAssimp(asset, assimpPacked, error);
+        UnmountPacks();
+
+        std::string difference;
+        bool same = SameMeshes(loose, packed, difference) && looseHash == packedHash;
+        bool assimpSame = assimpLoaded && SameMeshes(loose, assimpPacked, difference);
+        std::printf("%-32s %12.3f %12.3f %12.4f %12.4f %s%s\n", asset, looseMs, packedMs, looseKeyMs, packedKeyMs,
+            assimpSame ? "identical" : "DIFFERS", same ? "" : ", native import DIFFERS");
+    }
+
+    std::filesystem::remove_all(looseDirectory, ec);
+    std::filesystem::remove(packPath, ec);
+}
+}
+
+// an OBJ file as Assimp's loader hands it to post processing, a vertex per corner
+struct CornerVertices {
+    std::vector<DirectX::XMFLOAT3> positions;
+    std::vector<DirectX::XMFLOAT3> normals;
+    std::vector<DirectX::XMFLOAT2> texcoords;
+};
+
+void ExpandCorners(const ObjCorners& obj, CornerVertices& corners) {
+    for (size_t i = 0; i < obj.positionTriangles.size(); i++) {
+        const DirectX::XMUINT3& p = obj.positionTriangles[i];
+        corners.positions.insert(corners.positions.end(), { obj.positions[p.x], obj.positions[p.y], obj.positions[p.z] });
+        if (!obj.texcoords.empty()) {
+            const DirectX::XMUINT3& t = obj.texcoordTriangles[i];
+            corners.texcoords.insert(corners.texcoords.end(), { obj.texcoords[t.x], obj.texcoords[t.y], obj.texcoords[t.z] });
+        }
+        if (!obj.normals.empty()) {
+            const DirectX::XMUINT3& n = obj.normalTriangles[i];
+            corners.normals.insert(corners.normals.end(), { obj.normals[n.x], obj.normals[n.y], obj.normals[n.z] });
+        }
+    }
+}
+
+// welded the way the Assimp import welds with an epsilon of 0
+size_t WeldCorners(const CornerVertices& corners, unsigned int threadCount, std::vector<uint32_t>& remap, float epsilon = 0.0f) {
+    std::vector<WeldAttribute> attributes;
+    attributes.push_back({ &corners.positions[0].x, sizeof(DirectX::XMFLOAT3), 3, epsilon });
+    if (!corners.normals.empty())
+        attributes.push_back({ &corners.normals[0].x, sizeof(DirectX::XMFLOAT3), 3, epsilon });
+    if (!corners.texcoords.empty())
+        attributes.push_back({ &corners.texcoords[0].x, sizeof(DirectX::XMFLOAT2), 2, epsilon });
+
+    remap.resize(corners.positions.size());
+    return WeldVertices(attributes.data(), attributes.size(), corners.positions.size(), remap.data(), threadCount);
+}
+
+// the native parser keeps the first record holding a value and the weld the first corner, so
+// a -0 may come out as +0. Positions are compared as values, indices bit for bit.
+bool SameWeld(const Mesh& native, const Mesh& welded) {
+    if (native.vertices.size() != welded.vertices.size() || native.indices.size() != welded.indices.size())
+        return false;
+
+    for (size_t i = 0; i < native.vertices.size(); i++) {
+        const DirectX::XMFLOAT3& a = native.vertices[i].Pos;
+        const DirectX::XMFLOAT3& b = welded.vertices[i].Pos;
+        if (a.x != b.x || a.y != b.y || a.z != b.z)
+            return false;
+    }
+    return std::memcmp(native.indices.data(), welded.indices.data(), native.indices.size() * sizeof(DirectX::XMUINT3)) == 0;
+}
+
+Mesh WeldedMesh(const CornerVertices& corners, const std::vector<uint32_t>& remap, size_t vertexCount) {
+    Mesh mesh;
+    mesh.vertices.resize(vertexCount);
+    for (size_t i = 0; i < remap.size(); i++)
+        mesh.vertices[remap[i]].Pos = corners.positions[i];
+    for (size_t i = 0; i + 2 < remap.size(); i += 3)
+        mesh.indices.push_back(DirectX::XMUINT3(remap[i], remap[i + 1], remap[i + 2]));
+    return mesh;
+}
+
+// Assimp's own JoinIdenticalVertices against the weld stage of ImportModelAssimp, on the
+// same file. Assimp reads it once per pass, only the two weld steps are timed. That both
+// weld the same is checked by pipeline_tests.
+void CompareAssimpJoin(const char* name, const std::string& filePath) {
+    double joinMs = 0.0;
+    for (int pass = 0; pass < 3; pass++) {
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(filePath, aiProcess_Triangulate);
+        if (!scene) {
+            std::printf("%-24s Assimp failed to read it\n", name);
+            return;
+        }
+
+        joinMs += TimeMs([&] { importer.ApplyPostProcessing(aiProcess_JoinIdenticalVertices); }, 1) / 3.0;
+    }
+
+    std::vector<Mesh> meshes;
+    std::string error;
+    double weldMs = 0.0;
+    for (int pass = 0; pass < 3; pass++) {
+        meshes.clear();
+        ImportProfile profile;
+        ImportModelAssimp(filePath, meshes, error, &profile);
+        for (const StageTiming& stage : profile.Stages()) {
+            if (stage.name == "weld vertices")
+                weldMs += stage.ms / 3.0;
+        }
+    }
+
+    std::printf("%-24s %14.3f %12.3f %9.2fx\n", name, joinMs, weldMs, joinMs / weldMs);
+}
+
+void BenchmarkVertexWeld() {
+    std::printf("\n-- vertex weld --\n");
+    // the native parser matches Assimp's JoinIdenticalVertices bit for bit, see the OBJ table
+    std::printf("%-32s %10s %10s %10s  %s\n", "asset", "corners", "welded", "ms", "output");
+
+    for (const char* asset : BenchmarkAssets) {
+        ObjCorners obj;
+        MappedFile file;
+        if (!ReadObjCorners(asset, obj) || !file.Open(asset)) {
+            std::printf("%-32s missing\n", asset);
+            continue;
+        }
+
+        CornerVertices corners;
+        ExpandCorners(obj, corners);
+        std::vector<uint32_t> remap;
+        size_t welded = 0;
+        double ms = TimeMs([&] { welded = WeldCorners(corners, 0, remap); });
+
+        std::vector<Mesh> native;
+        std::string error;
+        ParseObj(reinterpret_cast<const char*>(file.Data()), file.Size(), native, error);
+
+        bool same = native.size() == 1 && SameWeld(native[0], WeldedMesh(corners, remap, welded));
+        std::printf("%-32s %10zu %10zu %10.3f  %s\n", asset, corners.positions.size(), welded, ms,
+            same ? "matches Assimp" : "MISMATCH");
+    }
+
+    const unsigned int side = 1024;
+    ObjCorners grid;
+    MakeGridCorners(side, grid);
+    CornerVertices corners;
+    ExpandCorners(grid, corners);
+    std::printf("\nsynthetic grid, %zu corners with texcoords onto %u vertices\n", corners.positions.size(), side * side);
+    std::printf("%-10s %8s %12s %12s %10s  %s\n", "epsilon", "threads", "ms", "Mcorners/s", "speedup", "output");
+
+    // every corner nudged by less than the epsilon, which has to weld them back together
+    CornerVertices jittered = corners;
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> jitter(-2e-6f, 2e-6f);
+    for (DirectX::XMFLOAT3& position : jittered.positions)
+        position = DirectX::XMFLOAT3(position.x + jitter(random), position.y + jitter(random), position.z + jitter(random));
+    for (DirectX::XMFLOAT2& texcoord : jittered.texcoords)
+        texcoord = DirectX::XMFLOAT2(texcoord.x + jitter(random), texcoord.y + jitter(random));
+
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < DefaultThreadCount(); threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(DefaultThreadCount());
+
+    for (float epsilon : { 0.0f, 1e-5f }) {
+        const CornerVertices& input = epsilon > 0.0f ? jittered : corners;
+        std::vector<uint32_t> single;
+        double singleMs = 0.0;
+        for (unsigned int threads : threadCounts) {
+            std::vector<uint32_t> remap;
+            size_t welded = 0;
+            double ms = TimeMs([&] { welded = WeldCorners(input, threads, remap, epsilon); }, 3);
+            if (threads == 1) {
+                single = remap;
+                singleMs = ms;
+            }
+
+            const char* output = welded != size_t(side) * side ? "WRONG COUNT" : remap != single ? "DIFFERS" : "same as 1 thread";
+            std::printf("%-10g %8u %12.3f %12.1f %9.2fx  %s\n", epsilon, threads, ms, input.positions.size() / (ms * 1000.0),
+                singleMs / ms, output);
+        }
+    }
+
+    std::error_code ec;
+    std::string gridPath = (std::filesystem::temp_directory_path(ec) / "stengine_weld_grid.obj").string();
+    {
+        std::string text = MakeGridObj(side);
+        std::FILE* file = std::fopen(gridPath.c_str(), "wb");
+        if (file) {
+            std::fwrite(text.data(), 1, text.size(), file);
+            std::fclose(file);
+        }
+    }
+
+    std::printf("\n%-24s %14s %12s %10s\n", "asset", "assimp join ms", "weld ms", "speedup");
+    for (const char* asset : BenchmarkAssets)
+        CompareAssimpJoin(asset, asset);
+    CompareAssimpJoin("grid 1024", gridPath);
+    std::filesystem::remove(gridPath, ec);
+}
+
+// the box one vertex at a time, what ComputeBounds did before the kernel
+Bounds ScalarBox(const std::vector<Vertex>& vertices) {
+    Bounds bounds = {};
+    bounds.minCoord = vertices[0].Pos;
+    bounds.maxCoord = vertices[0].Pos;
+    for (const Vertex& vertex : vertices) {
+        bounds.minCoord = DirectX::XMFLOAT3(std::min(bounds.minCoord.x, vertex.Pos.x), std::min(bounds.minCoord.y, vertex.Pos.y),
+            std::min(bounds.minCoord.z, vertex.Pos.z));
+        bounds.maxCoord = DirectX::XMFLOAT3(std::max(bounds.maxCoord.x, vertex.Pos.x), std::max(bounds.maxCoord.y, vertex.Pos.y),
+            std::max(bounds.maxCoord.z, vertex.Pos.z));
+    }
+    return bounds;
+}
+
+// one pass of Ritter's from the furthest point of the furthest point, the way meshlets get theirs
+float RitterRadius(const std::vector<Vertex>& vertices) {
+    auto furthest = [&](const DirectX::XMFLOAT3& from) {
+        DirectX::XMFLOAT3 best = from;
+        float bestDistance = -1.0f;
+        for (const Vertex& vertex : vertices) {
+            float dx = vertex.Pos.x - from.x, dy = vertex.Pos.y - from.y, dz = vertex.Pos.z - from.z;
+            float distance = dx * dx + dy * dy + dz * dz;
+            if (distance > bestDistance) {
+                bestDistance = distance;
+                best = vertex.Pos;
+            }
+        }
+        return best;
+    };
+
+    DirectX::XMFLOAT3 a = furthest(vertices[0].Pos);
+    DirectX::XMFLOAT3 b = furthest(a);
+    DirectX::XMFLOAT3 center((a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f, (a.z + b.z) * 0.5f);
+    float radius = 0.5f * std::sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y) + (b.z - a.z) * (b.z - a.z));
+    for (const Vertex& vertex : vertices) {
+        float dx = vertex.Pos.x - center.x, dy = vertex.Pos.y - center.y, dz = vertex.Pos.z - center.z;
+        float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+        if (distance <= radius)
+            continue;
+
+        float grown = (radius + distance) * 0.5f;
+        float shift = (grown - radius) / distance;
+        center = DirectX::XMFLOAT3(center.x + dx * shift, center.y + dy * shift, center.z + dz * shift);
+        radius = grown;
+    }
+    return radius;
+}
+
+void PrintBoundsRow(const char* name, const std::vector<Vertex>& vertices) {
+    Bounds scalar = {};
+    Bounds bounds = {};
+    double scalarMs = TimeMs([&] { scalar = ScalarBox(vertices); });
+    double boundsMs = TimeMs([&] { bounds = ComputeBounds(vertices.data(), vertices.size()); });
+
+    bool contained = true;
+    for (const Vertex& vertex : vertices) {
+        float dx = vertex.Pos.x - bounds.center.x, dy = vertex.Pos.y - bounds.center.y, dz = vertex.Pos.z - bounds.center.z;
+        contained = contained && std::sqrt(dx * dx + dy * dy + dz * dz) <= bounds.radius;
+    }
+    bool sameBox = std::memcmp(&scalar.minCoord, &bounds.minCoord, sizeof(DirectX::XMFLOAT3)) == 0 &&
+        std::memcmp(&scalar.maxCoord, &bounds.maxCoord, sizeof(DirectX::XMFLOAT3)) == 0;
+
+    DirectX::XMFLOAT3 size(bounds.maxCoord.x - bounds.minCoord.x, bounds.maxCoord.y - bounds.minCoord.y, bounds.maxCoord.z - bounds.minCoord.z);
+    float halfDiagonal = 0.5f * std::sqrt(size.x * size.x + size.y * size.y + size.z * size.z);
+    std::printf("%-32s %10zu %10.3f %10.3f %10.4g %9.1f%% %9.1f%%  %s\n", name, vertices.size(), scalarMs, boundsMs, bounds.radius,
+        100.0 * (RitterRadius(vertices) / bounds.radius - 1.0), 100.0 * (halfDiagonal / bounds.radius - 1.0),
+        !sameBox ? "BOX DIFFERS" : !contained ? "VERTEX OUTSIDE" : "ok");
+}
+
+void BenchmarkBounds() {
+    std::printf("\n-- mesh bounds --\n");
+    // how much larger the single pass Ritter sphere and the sphere around the box are
+    std::printf("%-32s %10s %10s %10s %10s %10s %10s  %s\n", "mesh", "vertices", "scalar ms", "bounds ms", "radius", "ritter", "box",
+        "output");
+
+    std::vector<Mesh> models;
+    for (const char* asset : BenchmarkAssets) {
+        std::vector<Mesh> meshes;
+        std::string error;
+        if (!ImportModel(asset, meshes, error) || meshes.empty()) {
+            std::printf("%-32s missing\n", asset);
+            continue;
+        }
+        PrintBoundsRow(asset, meshes[0].vertices);
+        models.insert(models.end(), meshes.begin(), meshes.end());
+    }
+
+    ObjCorners grid;
+    MakeGridCorners(1024, grid);
+    std::vector<Vertex> gridVertices;
+    for (const DirectX::XMFLOAT3& position : grid.positions)
+        gridVertices.push_back({ position });
+    PrintBoundsRow("grid 1024", gridVertices);
+
+    // points on a sphere, where picking two far apart points and growing does worst
+    std::vector<Vertex> shell(1 << 20);
+    std::mt19937 random(11);
+    std::normal_distribution<float> normal;
+    for (Vertex& vertex : shell) {
+        DirectX::XMFLOAT3 direction(normal(random), normal(random), normal(random));
+        float length = std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+        vertex.Pos = DirectX::XMFLOAT3(4.0f + direction.x / length, direction.y / length, direction.z / length);
+    }
+    PrintBoundsRow("sphere shell 1M", shell);
+
+    std::printf("\nnormalize to the unit cube\n");
+    DirectX::XMFLOAT3 center(0.5f, 0.25f, 5.12f);
+    std::vector<Vertex> scalarVertices = gridVertices;
+    double scalarMs = TimeMs([&] {
+        for (Vertex& vertex : scalarVertices)
+            vertex.Pos = DirectX::XMFLOAT3((vertex.Pos.x - center.x) * 0.5f, (vertex.Pos.y - center.y) * 0.5f, (vertex.Pos.z - center.z) * 0.5f);
+    }, 1);
+    std::vector<Vertex> kernelVertices = gridVertices;
+    double kernelMs = TimeMs([&] { TransformVertices(kernelVertices.data(), kernelVertices.size(), center, 0.5f); }, 1);
+    bool same = std::memcmp(scalarVertices.data(), kernelVertices.data(), scalarVertices.size() * sizeof(Vertex)) == 0;
+    std::printf("grid 1024 transform: scalar %.3f ms, kernel %.3f ms, %.2fx, output %s\n", scalarMs, kernelMs, scalarMs / kernelMs,
+        same ? "identical" : "DIFFERS");
+
+    if (models.empty())
+        return;
+
+    // the teapots side by side as one model, shifted apart so the union is larger than any of them
+    for (size_t i = 0; i < models.size(); i++) {
+        TransformVertices(models[i].vertices.data(), models[i].vertices.size(), DirectX::XMFLOAT3(-8.0f * i, 0.0f, 0.0f), 1.0f);
+        models[i].bounds = ComputeBounds(models[i].vertices.data(), models[i].vertices.size());
+    }
+    NormalizeMeshes("teapots", models);
+
+    Bounds model = models[0].bounds;
+    for (const Mesh& mesh : models) {
+        model.minCoord = DirectX::XMFLOAT3(std::min(model.minCoord.x, mesh.bounds.minCoord.x), std::min(model.minCoord.y, mesh.bounds.minCoord.y),
+            std::min(model.minCoord.z, mesh.bounds.minCoord.z));
+        model.maxCoord = DirectX::XMFLOAT3(std::max(model.maxCoord.x, mesh.bounds.maxCoord.x), std::max(model.maxCoord.y, mesh.bounds.maxCoord.y),
+            std::max(model.maxCoord.z, mesh.bounds.maxCoord.z));
+    }
+    std::printf("teapots normalized: min (%.4f, %.4f, %.4f) max (%.4f, %.4f, %.4f)\n", model.minCoord.x, model.minCoord.y, model.minCoord.z,
+        model.maxCoord.x, model.maxCoord.y, model.maxCoord.z);
+}
+
+void WriteTextFile(const std::string& filePath, const std::string& text) {
+    std::FILE* file = std::fopen(filePath.c_str(), "wb");
+    if (file) {
+        std::fwrite(text.data(), 1, text.size(), file);
+        std::fclose(file);
+    }
+}
+
+void BenchmarkGeometryDedup() {
+    // what the viewer asks for
+    ImportOptions options;
+    options.optimizeOverdraw = true;
+    options.generateLods = true;
+    options.compressGeometry = true;
+    options.vertexFormat.position = PositionFormat::Unorm16;
+
+    std::string teapot;
+    {
+        MappedFile file;
+        if (!file.Open(BenchmarkAssets[0])) {
+            std::printf("\n-- geometry dedup --\n%s missing\n", BenchmarkAssets[0]);
+            return;
+        }
+        teapot.assign(reinterpret_cast<const char*>(file.Data()), file.Size());
+    }
+
+    // a level's props: the same teapot saved under three names, one of them exported again
+    // with different bytes, and a terrain tile saved twice. Every file is placed a few times.
+    std::error_code ec;
+    std::filesystem::path directory = std::filesystem::temp_directory_path(ec);
+    struct SceneFile {
+        std::string filePath;
+        std::string text;
+        int placements;
+    };
+    std::vector<SceneFile> files = {
+        { (directory / "stengine_prop_a.obj").string(), teapot, 4 },
+        { (directory / "stengine_prop_b.obj").string(), teapot, 3 },
+        { (directory / "stengine_prop_c.obj").string(), "# exported again\n" + teapot, 2 },
+        { (directory / "stengine_tile_a.obj").string(), MakeGridObj(256), 2 },
+        { (directory / "stengine_tile_b.obj").string(), MakeGridObj(256), 1 },
+        { BenchmarkAssets[2], std::string(), 1 },
+    };
+
+    GeometryLibrary library;
+    std::vector<GeometryLibrary::MeshId> uses;
+    uint64_t comparedBytes = 0;
+    double addMs = 0.0;
+    bool same = true;
+    for (SceneFile& file : files) {
+        if (!file.text.empty())
+            WriteTextFile(file.filePath, file.text);
+
+        ModelData model;
+        if (!LoadModel(file.filePath, options, model)) {
+            std::printf("%s failed: %s\n", file.filePath.c_str(), model.error.c_str());
+            continue;
+        }
+
+        std::vector<GeometryLibrary::MeshId> ids;
+        std::string error;
+        auto start = std::chrono::steady_clock::now();
+        if (!library.Add(model, ids, error)) {
+            std::printf("%s failed: %s\n", file.filePath.c_str(), error.c_str());
+            continue;
+        }
+        addMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        for (size_t i = 0; i < ids.size(); i++) {
+            const MeshView& view = model.views[i];
+            comparedBytes += uint64_t(view.numberOfVertices) * VertexStride(view.format) + uint64_t(view.numberOfIndices) * IndexSize(view.indexFormat);
+            same = same && SameContent(library.View(ids[i]), view);
+        }
+        for (int placement = 0; placement < file.placements; placement++)
+            uses.insert(uses.end(), ids.begin(), ids.end());
+
+        if (!file.text.empty())
+            std::filesystem::remove(file.filePath, ec);
+    }
+
+    GeometryStats stats = library.Stats(uses);
+    const double kilobyte = 1024.0;
+    std::printf("\n-- geometry dedup --\n");
+    std::printf("%zu files, %zu mesh instances of %zu distinct meshes, output %s\n", files.size(), stats.uses, stats.meshes,
+        same ? "identical to the loaded meshes" : "DIFFERS");
+    std::printf("%-8s %14s %14s %14s\n", "memory", "stored KB", "saved KB", "unshared KB");
+    std::printf("%-8s %14.1f %14.1f %14.1f\n", "gpu", stats.gpuBytes / kilobyte, stats.gpuBytesSaved / kilobyte,
+        (stats.gpuBytes + stats.gpuBytesSaved) / kilobyte);
+    std::printf("%-8s %14.1f %14.1f %14.1f\n", "system", stats.cpuBytes / kilobyte, stats.cpuBytesSaved / kilobyte,
+        (stats.cpuBytes + stats.cpuBytesSaved) / kilobyte);
+    // the hashes come with the loads, adding only looks them up and compares the matches
+    std::printf("adding the files compared %.1f KB in %.3f ms, shared buffers %u vertices, %u 16 bit and %u 32 bit indices\n",
+        comparedBytes / kilobyte, addMs, library.VertexExtent(), library.IndexExtent(IndexFormat::Uint16), library.IndexExtent(IndexFormat::Uint32));
+
+    std::vector<GeometryLibrary::MeshId> live = library.LiveMeshes();
+    volatile uint64_t sink = 0;
+    double hashMs = TimeMs([&] {
+        for (GeometryLibrary::MeshId id : live)
+            sink = sink + MeshContentHash(library.View(id));
+    });
+    std::printf("content hash of the distinct meshes: %.3f ms, %.0f MB/s\n", hashMs, stats.gpuBytes / (hashMs * 1000.0));
+}
+
+// smooth noise in [0, 1], octaves of bilinearly blended lattice values
+float FractalNoise(float x, float y, int octaves, uint32_t seed) {
+    auto lattice = [seed](int32_t i, int32_t j) {
+        uint32_t h = static_cast<uint32_t>(i) * 0x8da6b343u ^ static_cast<uint32_t>(j) * 0xd8163841u ^ seed * 0xcb1ab31fu;
+        h = (h ^ (h >> 13)) * 0x5bd1e995u;
+        return float((h ^ (h >> 15)) & 0xffff) / 65535.0f;
+    };
+
+    float sum = 0.0f, amplitude = 0.5f, total = 0.0f;
+    for (int octave = 0; octave < octaves; octave++) {
+        int32_t i = static_cast<int32_t>(std::floor(x)), j = static_cast<int32_t>(std::floor(y));
+        float fx = x - i, fy = y - j;
+        fx = fx * fx * (3.0f - 2.0f * fx);
+        fy = fy * fy * (3.0f - 2.0f * fy);
+        float top = lattice(i, j) + (lattice(i + 1, j) - lattice(i, j)) * fx;
+        float bottom = lattice(i, j + 1) + (lattice(i + 1, j + 1) - lattice(i, j + 1)) * fx;
+        sum += amplitude * (top + (bottom - top) * fy);
+        total += amplitude;
+        amplitude *= 0.5f;
+        x *= 2.0f;
+        y *= 2.0f;
+    }
+    return sum / total;
+}
+
+uint8_t ToByte(float value) {
+    return static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, value * 255.0f + 0.5f)));
+}
+
+// the reference set: no textures ship with the repo, so these stand in for the usual kinds
+enum class ReferenceImage {
+    Photo,
+    Gradient,
+    Checker,
+    NormalMap,
+    Decal
+};
+
+Image MakeReferenceImage(ReferenceImage kind, uint32_t width, uint32_t height) {
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.rgba.resize(size_t(width) * height * 4);
+
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            float u = float(x) / width, v = float(y) / height;
+            uint8_t* texel = image.rgba.data() + (size_t(y) * width + x) * 4;
+            float r = 0.0f, g = 0.0f, b = 0.0f, a = 1.0f;
+
+            switch (kind) {
+            case ReferenceImage::Photo: {
+                // broad color regions with fine detail on top, roughly what a photo's spectrum looks like
+                float base = FractalNoise(u * 8.0f, v * 8.0f, 6, 1);
+                float detail = FractalNoise(u * 64.0f, v * 64.0f, 3, 2);
+                r = base * 0.8f + detail * 0.2f;
+                g = FractalNoise(u * 6.0f, v * 6.0f, 6, 3) * 0.7f + detail * 0.3f;
+                b = 0.3f + 0.5f * FractalNoise(u * 4.0f, v * 4.0f, 5, 4);
+                break;
+            }
+            case ReferenceImage::Gradient:
+                r = u;
+                g = v;
+                b = 0.5f + 0.5f * std::sin((u + v) * 6.2831853f);
+                a = 1.0f - u * 0.5f;
+                break;
+            case ReferenceImage::Checker: {
+                bool odd = ((x / 8) + (y / 8)) & 1;
+                r = odd ? 0.9f : 0.1f;
+                g = odd ? 0.2f : 0.7f;
+                b = odd ? 0.1f : 0.9f;
+                a = odd ? 1.0f : 0.0f;
+                break;
+            }
+            case ReferenceImage::NormalMap: {
+                // normals of a bumpy height field, in [0, 1]
+                const float step = 1.0f / 256.0f;
+                float dx = (FractalNoise((u + step) * 16.0f, v * 16.0f, 4, 5) - FractalNoise((u - step) * 16.0f, v * 16.0f, 4, 5)) * 4.0f;
+                float dy = (FractalNoise(u * 16.0f, (v + step) * 16.0f, 4, 5) - FractalNoise(u * 16.0f, (v - step) * 16.0f, 4, 5)) * 4.0f;
+                float length = std::sqrt(dx * dx + dy * dy + 1.0f);
+                r = 0.5f - 0.5f * dx / length;
+                g = 0.5f - 0.5f * dy / length;
+                b = 0.5f + 0.5f / length;
+                break;
+            }
+            case ReferenceImage::Decal: {
+                // a soft edged disc over transparent black
+                float distance = std::sqrt((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f));
+                a = std::min(1.0f, std::max(0.0f, (0.4f - distance) * 20.0f));
+                r = a * 0.9f;
+                g = a * (0.4f + 0.4f * FractalNoise(u * 16.0f, v * 16.0f, 3, 6));
+                b = a * 0.2f;
+                break;
+            }
+            }
+
+            texel[0] = ToByte(r);
+            texel[1] = ToByte(g);
+            texel[2] = ToByte(b);
+            texel[3] = ToByte(a);
+        }
+    }
+    return image;
+}
+
+// over the channels a format keeps, infinite for an exact match
+double Psnr(const Image& image, const std::vector<uint8_t>& decoded, int firstChannel, int channelCount) {
+    double sum = 0.0;
+    size_t texels = size_t(image.width) * image.height;
+    for (size_t i = 0; i < texels; i++) {
+        for (int c = firstChannel; c < firstChannel + channelCount; c++) {
+            double d = double(image.rgba[i * 4 + c]) - decoded[i * 4 + c];
+            sum += d * d;
+        }
+    }
+    double mse = sum / (double(texels) * channelCount);
+    return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : INFINITY;
+}
+
+void WriteTga(const std::string& filePath, const Image& image) {
+    uint8_t header[18] = {};
+    header[2] = 2;
+    header[12] = static_cast<uint8_t>(image.width);
+    header[13] = static_cast<uint8_t>(image.width >> 8);
+    header[14] = static_cast<uint8_t>(image.height);
+    header[15] = static_cast<uint8_t>(image.height >> 8);
+    header[16] = 32;
+    // top down, 8 alpha bits
+    header[17] = 0x28;
+
+    std::string bytes(reinterpret_cast<const char*>(header), sizeof(header));
+    for (size_t i = 0; i < image.rgba.size(); i += 4) {
+        const uint8_t bgra[4] = { image.rgba[i + 2], image.rgba[i + 1], image.rgba[i], image.rgba[i + 3] };
+        bytes.append(reinterpret_cast<const char*>(bgra), 4);
+    }
+    WriteTextFile(filePath, bytes);
+}
+
+void BenchmarkTextureCooker() {
+    std::printf("\n-- texture cooker --\n");
+
+    struct Reference {
+        const char* name;
+        ReferenceImage kind;
+    };
+    const Reference references[] = {
+        { "photo", ReferenceImage::Photo },
+        { "gradient", ReferenceImage::Gradient },
+        { "checker", ReferenceImage::Checker },
+        { "normal map", ReferenceImage::NormalMap },
+        { "decal", ReferenceImage::Decal },
+    };
+    const BlockFormat formats[] = { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC5, BlockFormat::BC7 };
+    const uint32_t size = 512;
+    unsigned int threads = DefaultThreadCount();
+
+    // PSNR over what each format keeps: rgb for BC1, rgba for BC3 and BC7, red and green for BC5
+    std::printf("%ux%u, %u threads\n", size, size, threads);
+    std::printf("%-12s %-5s %12s %12s %12s %10s\n", "image", "format", "1 thread", "threads", "speedup", "psnr dB");
+
+    for (const Reference& reference : references) {
+        Image image = MakeReferenceImage(reference.kind, size, size);
+        for (BlockFormat format : formats) {
+            std::vector<uint8_t> blocks(CompressedSize(format, size, size));
+            double singleMs = TimeMs([&] { CompressImage(image.rgba.data(), size, size, format, blocks.data(), 1); }, 2);
+            double threadedMs = TimeMs([&] { CompressImage(image.rgba.data(), size, size, format, blocks.data(), threads); }, 2);
+
+            std::vector<uint8_t> decoded(image.rgba.size());
+            DecompressImage(blocks.data(), size, size, format, decoded.data());
+            double psnr = format == BlockFormat::BC1 ? Psnr(image, decoded, 0, 3) :
+                format == BlockFormat::BC5 ? Psnr(image, decoded, 0, 2) : Psnr(image, decoded, 0, 4);
+
+            double megapixels = double(size) * size / 1e6;
+            std::printf("%-12s %-5s %7.1f Mpx/s %7.1f Mpx/s %11.2fx %10.2f\n", reference.name, BlockFormatName(format),
+                megapixels / (singleMs / 1000.0), megapixels / (threadedMs / 1000.0), singleMs / threadedMs, psnr);
+        }
+    }
+
+    // an odd size so the edge blocks and the mip chain's odd levels are covered too
+    Image photo = MakeReferenceImage(ReferenceImage::Photo, 1000, 600);
+    uint64_t rawBytes = 0;
+    std::vector<Image> mips;
+    double mipMs = TimeMs([&] { GenerateMips(photo, MipOptions(), mips); }, 2);
+    rawBytes = photo.rgba.size();
+    for (const Image& mip : mips)
+        rawBytes += mip.rgba.size();
+    std::printf("\n1000x600 photo: %zu levels, kaiser mips %.2f ms, rgba8 chain %.1f KB\n", mips.size() + 1, mipMs, rawBytes / 1024.0);
+
+    for (BlockFormat format : formats) {
+        TextureOptions options;
+        options.format = format;
+        options.srgb = format != BlockFormat::BC5;
+        CompressedTexture texture;
+        double ms = TimeMs([&] { CompressTexture(photo, options, texture); }, 1);
+        uint64_t bytes = 0;
+        for (const std::vector<uint8_t>& level : texture.levels)
+            bytes += level.size();
+        std::printf("%-5s chain %8.1f KB, %.1fx smaller, cooked in %.2f ms\n", BlockFormatName(format), bytes / 1024.0,
+            double(rawBytes) / bytes, ms);
+    }
+
+    // through the cache from a TGA, once cooking and once mapping what was cooked
+    std::string sourcePath = std::string(CacheDirectory) + "/texture_bench.tga";
+    std::error_code ec;
+    std::filesystem::create_directories(CacheDirectory, ec);
+    WriteTga(sourcePath, photo);
+
+    TextureOptions options;
+    CacheKey key;
+    bool rehashed = false;
+    if (GetContentHash(sourcePath, key.contentHash, rehashed)) {
+        key.settingsHash = TextureSettingsHash(options);
+        std::filesystem::remove(CookedTexturePathFor(key), ec);
+    }
+
+    CookedTexture miss, hit;
+    std::string error;
+    auto missStart = std::chrono::steady_clock::now();
+    bool cooked = LoadTexture(sourcePath, options, miss, error);
+    double missMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - missStart).count();
+    auto hitStart = std::chrono::steady_clock::now();
+    bool mapped = cooked && LoadTexture(sourcePath, options, hit, error);
+    double hitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - hitStart).count();
+
+    if (!mapped)
+        std::printf("texture cache: %s\n", error.c_str());
+    else {
+        bool same = miss.Levels().size() == hit.Levels().size();
+        for (size_t i = 0; same && i < hit.Levels().size(); i++)
+            same = std::memcmp(miss.Levels()[i].blocks, hit.Levels()[i].blocks, hit.Levels()[i].bytes) == 0;
+        std::printf("texture cache: cook %.2f ms, mapped load %.3f ms, %zu levels %s\n", missMs, hitMs, hit.Levels().size(),
+            same ? "identical" : "DIFFER");
+    }
+
+    miss.Unload();
+    hit.Unload();
+    std::filesystem::remove(sourcePath, ec);
+    std::filesystem::remove(CookedTexturePathFor(key), ec);
+}
+
+// the chain the way it is often done: 2x2 averages of the stored bytes, gamma ignored and the
+// last row or column of an odd size dropped
+void NaiveMips(const Image& image, std::vector<Image>& mips) {
+    mips.resize(MipCount(image.width, image.height) - 1);
+    const Image* above = &image;
+    for (Image& mip : mips) {
+        mip.width = std::max(1u, above->width / 2);
+        mip.height = std::max(1u, above->height / 2);
+        mip.rgba.resize(size_t(mip.width) * mip.height * 4);
+        for (uint32_t y = 0; y < mip.height; y++) {
+            const uint8_t* top = above->rgba.data() + size_t(std::min(y * 2, above->height - 1)) * above->width * 4;
+            const uint8_t* bottom = above->rgba.data() + size_t(std::min(y * 2 + 1, above->height - 1)) * above->width * 4;
+            for (uint32_t x = 0; x < mip.width; x++) {
+                uint32_t left = std::min(x * 2, above->width - 1) * 4, right = std::min(x * 2 + 1, above->width - 1) * 4;
+                for (int c = 0; c < 4; c++)
+                    mip.rgba[(size_t(y) * mip.width + x) * 4 + c] =
+                        static_cast<uint8_t>((top[left + c] + top[right + c] + bottom[left + c] + bottom[right + c] + 2) / 4);
+            }
+        }
+        above = &mip;
+    }
+}
+
+// average linear light over the color channels, what a level should keep of the one above
+double MeanLinear(const Image& image) {
+    double sum = 0.0;
+    for (size_t i = 0; i < image.rgba.size(); i += 4) {
+        for (int c = 0; c < 3; c++) {
+            double value = image.rgba[i + c] / 255.0;
+            sum += value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+        }
+    }
+    return sum / (image.rgba.size() / 4 * 3);
+}
+
+// how far the mean brightness of any level strays from the full size one, in percent
+double MaxBrightnessDrift(const Image& image, const std::vector<Image>& mips) {
+    double reference = MeanLinear(image), drift = 0.0;
+    for (const Image& mip : mips)
+        drift = std::max(drift, std::fabs(MeanLinear(mip) / reference - 1.0) * 100.0);
+    return drift;
+}
+
+void BenchmarkMipmaps() {
+    std::printf("\n-- mipmaps --\n");
+    const MipFilter filters[] = { MipFilter::Box, MipFilter::Kaiser, MipFilter::Lanczos };
+
+    // black and white texels alternating are half as bright as white, 188 once encoded
+    Image checker;
+    checker.width = checker.height = 256;
+    checker.rgba.resize(256 * 256 * 4);
+    for (uint32_t i = 0; i < 256 * 256; i++) {
+        uint8_t value = ((i % 256) + (i / 256)) & 1 ? 255 : 0;
+        checker.rgba[i * 4] = checker.rgba[i * 4 + 1] = checker.rgba[i * 4 + 2] = value;
+        checker.rgba[i * 4 + 3] = 255;
+    }
+
+    std::vector<Image> mips;
+    NaiveMips(checker, mips);
+    std::printf("1 texel checker, level 1 and 1x1 gray (188 is right): naive %u %u", mips[0].rgba[0], mips.back().rgba[0]);
+    for (MipFilter filter : filters) {
+        MipOptions options;
+        options.filter = filter;
+        GenerateMips(checker, options, mips);
+        std::printf(", %s %u %u", MipFilterName(filter), mips[0].rgba[0], mips.back().rgba[0]);
+    }
+    std::printf("\n");
+
+    // odd sizes all the way down, where dropping rows and columns shows
+    Image photo = MakeReferenceImage(ReferenceImage::Photo, 1000, 600);
+    NaiveMips(photo, mips);
+    std::printf("1000x600 photo, brightness drift over the chain: naive %.2f%%", MaxBrightnessDrift(photo, mips));
+    for (MipFilter filter : filters) {
+        MipOptions options;
+        options.filter = filter;
+        GenerateMips(photo, options, mips);
+        std::printf(", %s %.2f%%", MipFilterName(filter), MaxBrightnessDrift(photo, mips));
+    }
+    std::printf("\n");
+
+    // 4K, tiled from a smaller photo since the noise is slow to make
+    Image tile = MakeReferenceImage(ReferenceImage::Photo, 1024, 1024);
+    Image large;
+    large.width = large.height = 4096;
+    large.rgba.resize(size_t(4096) * 4096 * 4);
+    for (uint32_t y = 0; y < 4096; y++) {
+        for (uint32_t x = 0; x < 4096; x += 1024)
+            std::memcpy(large.rgba.data() + (size_t(y) * 4096 + x) * 4, tile.rgba.data() + size_t(y % 1024) * 1024 * 4, 1024 * 4);
+    }
+
+    // powers of two up to the core count, plus the core count itself
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < DefaultThreadCount(); threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(DefaultThreadCount());
+
+    std::printf("\n4096x4096 full chain, %s filters\n", HasAvx2() ? "AVX2" : "SSE2");
+    std::printf("%-10s %8s %12s %10s\n", "filter", "threads", "ms", "speedup");
+    double naiveMs = TimeMs([&] { NaiveMips(large, mips); }, 2);
+    std::printf("%-10s %8u %12.2f %10s\n", "naive", 1u, naiveMs, "-");
+    for (MipFilter filter : filters) {
+        double singleMs = 0.0;
+        for (unsigned int threads : threadCounts) {
+            MipOptions options;
+            options.filter = filter;
+            options.threadCount = threads;
+            double ms = TimeMs([&] { GenerateMips(large, options, mips); }, 2);
+            if (threads == 1)
+                singleMs = ms;
+            std::printf("%-10s %8u %12.2f %9.2fx\n", MipFilterName(filter), threads, ms, singleMs / ms);
+        }
+    }
+}
+
+void RunBenchmarks() {
+    BenchmarkCookedLoad();
+    BenchmarkCacheLookup();
+    BenchmarkObjParser();
+    BenchmarkObjScaling();
+    BenchmarkVertexCache();
+    BenchmarkOverdraw();
+    BenchmarkVertexFetch();
+    BenchmarkVertexFormats();
+    BenchmarkIndexFormats();
+    BenchmarkSimplifier();
+    BenchmarkMeshlets();
+    BenchmarkGeometryCodec();
+    BenchmarkImportMemory();
+    BenchmarkTangentSpace();
+    BenchmarkPackFile();
+    BenchmarkVertexWeld();
+    BenchmarkBounds();
+    BenchmarkGeometryDedup();
+    BenchmarkTextureCooker();
+    BenchmarkMipmaps();
+}
+
+}
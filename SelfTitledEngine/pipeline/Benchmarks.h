@@ -0,0 +1,8 @@
+#pragma once
+
+namespace pipeline {
+
+// headless timing runs over the shipped assets, results go to the console
+void RunBenchmarks();
+
+}
@@ -0,0 +1,702 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "Parallel.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define PIPELINE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace pipeline {
+
+namespace {
+
+// one 4x4 block, channel after channel so four texels fill a register
+struct alignas(16) Texels {
+    float c[4][16];
+};
+
+// the interpolated entries of a block's palette as the decoder computes them
+struct alignas(16) Palette {
+    float c[16][4];
+    int count;
+};
+
+// 128 bit block filled from the least significant bit up
+struct BlockBits {
+    uint64_t word[2] = {};
+    int position = 0;
+
+    void Put(uint32_t value, int count) {
+        for (int i = 0; i < count; i++, position++)
+            word[position >> 6] |= uint64_t((value >> i) & 1) << (position & 63);
+    }
+
+    uint32_t Get(int count) {
+        uint32_t value = 0;
+        for (int i = 0; i < count; i++, position++)
+            value |= uint32_t((word[position >> 6] >> (position & 63)) & 1) << i;
+        return value;
+    }
+};
+
+// BC7 mode 6 index weights, out of 64
+constexpr int Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+void LoadBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, uint8_t* texels) {
+    for (uint32_t y = 0; y < 4; y++) {
+        uint32_t row = std::min(blockY * 4 + y, height - 1);
+        for (uint32_t x = 0; x < 4; x++) {
+            uint32_t column = std::min(blockX * 4 + x, width - 1);
+            std::memcpy(texels + (y * 4 + x) * 4, rgba + (size_t(row) * width + column) * 4, 4);
+        }
+    }
+}
+
+void ToTexels(const uint8_t* rgba, Texels& texels) {
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++)
+            texels.c[c][i] = rgba[i * 4 + c];
+    }
+}
+
+// nearest palette entry of every texel over the first channels channels, summed squared error
+float PickIndices(const Texels& texels, const Palette& palette, int channels, uint8_t* indices) {
+    float error = 0.0f;
+    int i = 0;
+#ifdef PIPELINE_SSE2
+    for (; i + 4 <= 16; i += 4) {
+        __m128 values[4];
+        for (int c = 0; c < channels; c++)
+            values[c] = _mm_load_ps(texels.c[c] + i);
+
+        __m128 best = _mm_set1_ps(1e30f);
+        __m128i bestIndex = _mm_setzero_si128();
+        for (int p = 0; p < palette.count; p++) {
+            __m128 d = _mm_sub_ps(values[0], _mm_set1_ps(palette.c[p][0]));
+            __m128 distance = _mm_mul_ps(d, d);
+            for (int c = 1; c < channels; c++) {
+                d = _mm_sub_ps(values[c], _mm_set1_ps(palette.c[p][c]));
+                distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+            }
+
+            __m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+            best = _mm_min_ps(distance, best);
+            bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, bestIndex));
+        }
+
+        alignas(16) int32_t picked[4];
+        alignas(16) float distances[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(picked), bestIndex);
+        _mm_store_ps(distances, best);
+        for (int k = 0; k < 4; k++) {
+            indices[i + k] = static_cast<uint8_t>(picked[k]);
+            error += distances[k];
+        }
+    }
+#endif
+    for (; i < 16; i++) {
+        float best = 1e30f;
+        for (int p = 0; p < palette.count; p++) {
+            float distance = 0.0f;
+            for (int c = 0; c < channels; c++) {
+                float d = texels.c[c][i] - palette.c[p][c];
+                distance += d * d;
+            }
+            if (distance < best) {
+                best = distance;
+                indices[i] = static_cast<uint8_t>(p);
+            }
+        }
+        error += best;
+    }
+    return error;
+}
+
+// mean and the direction of greatest spread, by power iteration on the covariance. The axis
+// stays zero for a flat block.
+void PrincipalAxis(const Texels& texels, int channels, float* mean, float* axis) {
+    for (int c = 0; c < channels; c++) {
+        float sum = 0.0f;
+        for (int i = 0; i < 16; i++)
+            sum += texels.c[c][i];
+        mean[c] = sum / 16.0f;
+    }
+
+    float covariance[4][4] = {};
+    for (int a = 0; a < channels; a++) {
+        for (int b = a; b < channels; b++) {
+            float sum = 0.0f;
+            for (int i = 0; i < 16; i++)
+                sum += (texels.c[a][i] - mean[a]) * (texels.c[b][i] - mean[b]);
+            covariance[a][b] = covariance[b][a] = sum;
+        }
+    }
+
+    // start from the diagonal's largest entry so a single varying channel converges at once
+    int largest = 0;
+    for (int c = 1; c < channels; c++) {
+        if (covariance[c][c] > covariance[largest][largest])
+            largest = c;
+    }
+    for (int c = 0; c < channels; c++)
+        axis[c] = covariance[largest][c];
+
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {};
+        float length = 0.0f;
+        for (int a = 0; a < channels; a++) {
+            for (int b = 0; b < channels; b++)
+                next[a] += covariance[a][b] * axis[b];
+            length = std::max(length, std::fabs(next[a]));
+        }
+        if (length < 1e-6f) {
+            std::fill(axis, axis + channels, 0.0f);
+            return;
+        }
+        for (int c = 0; c < channels; c++)
+            axis[c] = next[c] / length;
+    }
+
+    float length = 0.0f;
+    for (int c = 0; c < channels; c++)
+        length += axis[c] * axis[c];
+    length = std::sqrt(length);
+    for (int c = 0; c < channels; c++)
+        axis[c] /= length;
+}
+
+// ends of the texels projected onto the principal axis, clamped to the byte range
+void AxisEndpoints(const Texels& texels, int channels, float* low, float* high) {
+    float mean[4], axis[4];
+    PrincipalAxis(texels, channels, mean, axis);
+
+    float minimum = 0.0f, maximum = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float t = 0.0f;
+        for (int c = 0; c < channels; c++)
+            t += (texels.c[c][i] - mean[c]) * axis[c];
+        minimum = std::min(minimum, t);
+        maximum = std::max(maximum, t);
+    }
+
+    for (int c = 0; c < channels; c++) {
+        low[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * minimum));
+        high[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * maximum));
+    }
+}
+
+// endpoints that best fit the texels with their indices fixed, each texel weighing the second
+// endpoint by weights[index]. False when every texel sits on the same weight.
+bool LeastSquaresEndpoints(const Texels& texels, int channels, const uint8_t* indices, const float* weights, float* low, float* high) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4] = {}, bx[4] = {};
+    for (int i = 0; i < 16; i++) {
+        float b = weights[indices[i]];
+        float a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < channels; c++) {
+            ax[c] += a * texels.c[c][i];
+            bx[c] += b * texels.c[c][i];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) < 1e-6f)
+        return false;
+
+    for (int c = 0; c < channels; c++) {
+        low[c] = std::min(255.0f, std::max(0.0f, (ax[c] * bb - bx[c] * ab) / determinant));
+        high[c] = std::min(255.0f, std::max(0.0f, (bx[c] * aa - ax[c] * ab) / determinant));
+    }
+    return true;
+}
+
+// BC1 color
+
+uint16_t To565(const float* color) {
+    int r = static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f);
+    int g = static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f);
+    int b = static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void From565(uint16_t color, int* rgb) {
+    int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// the four colors of a block in four color mode, or three and black when color0 <= color1
+// and the block isn't BC3's, which always decodes four
+void ColorPalette(uint16_t color0, uint16_t color1, bool fourColors, int (*palette)[4]) {
+    From565(color0, palette[0]);
+    From565(color1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        if (fourColors || color0 > color1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+        }
+        else {
+            palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    for (int i = 0; i < 4; i++)
+        palette[i][3] = (!fourColors && color0 <= color1 && i == 3) ? 0 : 255;
+}
+
+float EvaluateColor(const Texels& texels, uint16_t color0, uint16_t color1, uint8_t* indices) {
+    int colors[4][4];
+    ColorPalette(color0, color1, true, colors);
+
+    Palette palette;
+    palette.count = 4;
+    for (int p = 0; p < 4; p++) {
+        for (int c = 0; c < 3; c++)
+            palette.c[p][c] = static_cast<float>(colors[p][c]);
+    }
+    return PickIndices(texels, palette, 3, indices);
+}
+
+void EncodeColor(const Texels& texels, uint8_t* block) {
+    // weight of color1 behind each index
+    static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+    float low[4], high[4];
+    AxisEndpoints(texels, 3, low, high);
+
+    uint16_t color0 = To565(high), color1 = To565(low);
+    uint8_t indices[16];
+    float error = EvaluateColor(texels, color0, color1, indices);
+
+    // refit to the indices picked, kept while it helps
+    for (int iteration = 0; iteration < 2 && error > 0.0f; iteration++) {
+        if (!LeastSquaresEndpoints(texels, 3, indices, weights, high, low))
+            break;
+
+        uint16_t refit0 = To565(high), refit1 = To565(low);
+        uint8_t refitIndices[16];
+        float refitError = EvaluateColor(texels, refit0, refit1, refitIndices);
+        if (refitError >= error)
+            break;
+
+        color0 = refit0;
+        color1 = refit1;
+        error = refitError;
+        std::memcpy(indices, refitIndices, sizeof(indices));
+    }
+
+    // four color mode needs color0 above color1, swapping the ends swaps 0 with 1 and 2 with 3
+    if (color0 < color1) {
+        std::swap(color0, color1);
+        for (uint8_t& index : indices)
+            index ^= 1;
+    }
+    else if (color0 == color1)
+        std::fill(indices, indices + 16, 0);
+
+    uint32_t packed = 0;
+    for (int i = 0; i < 16; i++)
+        packed |= uint32_t(indices[i]) << (i * 2);
+
+    std::memcpy(block, &color0, 2);
+    std::memcpy(block + 2, &color1, 2);
+    std::memcpy(block + 4, &packed, 4);
+}
+
+void DecodeColor(const uint8_t* block, bool fourColors, uint8_t* rgba) {
+    uint16_t color0, color1;
+    uint32_t packed;
+    std::memcpy(&color0, block, 2);
+    std::memcpy(&color1, block + 2, 2);
+    std::memcpy(&packed, block + 4, 4);
+
+    int palette[4][4];
+    ColorPalette(color0, color1, fourColors, palette);
+    for (int i = 0; i < 16; i++) {
+        const int* color = palette[(packed >> (i * 2)) & 3];
+        for (int c = 0; c < 4; c++)
+            rgba[i * 4 + c] = static_cast<uint8_t>(color[c]);
+    }
+}
+
+// BC4 channel, also BC3's alpha and both halves of BC5
+
+// eight values with end0 > end1, otherwise six and the two extremes
+void ChannelPalette(int end0, int end1, uint8_t* palette) {
+    palette[0] = static_cast<uint8_t>(end0);
+    palette[1] = static_cast<uint8_t>(end1);
+    if (end0 > end1) {
+        for (int i = 1; i < 7; i++)
+            palette[i + 1] = static_cast<uint8_t>(((7 - i) * end0 + i * end1 + 3) / 7);
+    }
+    else {
+        for (int i = 1; i < 5; i++)
+            palette[i + 1] = static_cast<uint8_t>(((5 - i) * end0 + i * end1 + 2) / 5);
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+uint32_t EvaluateChannel(const uint8_t* values, int end0, int end1, uint8_t* indices) {
+    uint8_t palette[8];
+    ChannelPalette(end0, end1, palette);
+
+#ifdef PIPELINE_SSE2
+    __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values));
+    __m128i best = _mm_set1_epi8(-1);
+    __m128i bestIndex = _mm_setzero_si128();
+    for (int p = 0; p < 8; p++) {
+        __m128i entry = _mm_set1_epi8(static_cast<char>(palette[p]));
+        __m128i distance = _mm_or_si128(_mm_subs_epu8(texels, entry), _mm_subs_epu8(entry, texels));
+        __m128i nearer = _mm_min_epu8(distance, best);
+        // unchanged minimum means not strictly closer
+        __m128i closer = _mm_andnot_si128(_mm_cmpeq_epi8(nearer, best), _mm_set1_epi8(-1));
+        best = nearer;
+        bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi8(static_cast<char>(p))), _mm_andnot_si128(closer, bestIndex));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(indices), bestIndex);
+
+    __m128i zero = _mm_setzero_si128();
+    __m128i low = _mm_unpacklo_epi8(best, zero), high = _mm_unpackhi_epi8(best, zero);
+    __m128i squares = _mm_add_epi32(_mm_madd_epi16(low, low), _mm_madd_epi16(high, high));
+    alignas(16) uint32_t sums[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(sums), squares);
+    return sums[0] + sums[1] + sums[2] + sums[3];
+#else
+    uint32_t error = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = 256;
+        for (int p = 0; p < 8; p++) {
+            int distance = std::abs(int(values[i]) - int(palette[p]));
+            if (distance < best) {
+                best = distance;
+                indices[i] = static_cast<uint8_t>(p);
+            }
+        }
+        error += uint32_t(best * best);
+    }
+    return error;
+#endif
+}
+
+void EncodeChannel(const uint8_t* values, uint8_t* block) {
+    int minimum = 255, maximum = 0;
+    // the range without the exact 0 and 255 the six value mode stores for free
+    int innerMinimum = 255, innerMaximum = 0;
+    for (int i = 0; i < 16; i++) {
+        minimum = std::min<int>(minimum, values[i]);
+        maximum = std::max<int>(maximum, values[i]);
+        if (values[i] != 0 && values[i] != 255) {
+            innerMinimum = std::min<int>(innerMinimum, values[i]);
+            innerMaximum = std::max<int>(innerMaximum, values[i]);
+        }
+    }
+
+    int end0 = maximum, end1 = minimum;
+    uint8_t indices[16];
+    uint32_t error = EvaluateChannel(values, end0, end1, indices);
+
+    // refit the eight value ends to the indices picked
+    if (error > 0 && end0 > end1) {
+        static const float weights[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+        Texels texels;
+        for (int i = 0; i < 16; i++)
+            texels.c[0][i] = values[i];
+
+        float low, high;
+        if (LeastSquaresEndpoints(texels, 1, indices, weights, &high, &low)) {
+            int refit0 = static_cast<int>(high + 0.5f), refit1 = static_cast<int>(low + 0.5f);
+            uint8_t refitIndices[16];
+            if (refit0 > refit1) {
+                uint32_t refitError = EvaluateChannel(values, refit0, refit1, refitIndices);
+                if (refitError < error) {
+                    end0 = refit0;
+                    end1 = refit1;
+                    error = refitError;
+                    std::memcpy(indices, refitIndices, sizeof(indices));
+                }
+            }
+        }
+    }
+
+    if (error > 0 && (minimum == 0 || maximum == 255)) {
+        if (innerMinimum > innerMaximum) {
+            innerMinimum = 0;
+            innerMaximum = 255;
+        }
+        uint8_t sixIndices[16];
+        uint32_t sixError = EvaluateChannel(values, innerMinimum, innerMaximum, sixIndices);
+        if (sixError < error) {
+            end0 = innerMinimum;
+            end1 = innerMaximum;
+            std::memcpy(indices, sixIndices, sizeof(indices));
+        }
+    }
+
+    uint64_t packed = 0;
+    for (int i = 0; i < 16; i++)
+        packed |= uint64_t(indices[i]) << (i * 3);
+
+    block[0] = static_cast<uint8_t>(end0);
+    block[1] = static_cast<uint8_t>(end1);
+    for (int i = 0; i < 6; i++)
+        block[2 + i] = static_cast<uint8_t>(packed >> (i * 8));
+}
+
+void DecodeChannel(const uint8_t* block, uint8_t* values, size_t stride) {
+    uint8_t palette[8];
+    ChannelPalette(block[0], block[1], palette);
+
+    uint64_t packed = 0;
+    for (int i = 0; i < 6; i++)
+        packed |= uint64_t(block[2 + i]) << (i * 8);
+    for (int i = 0; i < 16; i++)
+        values[i * stride] = palette[(packed >> (i * 3)) & 7];
+}
+
+// BC7 mode 6
+
+// 7 bit endpoint plus the p bit nearest to color, the shared bit tried both ways
+void QuantizeBc7(const float* color, uint8_t* endpoint, uint8_t& pBit) {
+    float bestError = 1e30f;
+    for (int p = 0; p < 2; p++) {
+        uint8_t candidate[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; c++) {
+            int value = static_cast<int>((color[c] - p) / 2.0f + 0.5f);
+            value = std::min(127, std::max(0, value));
+            candidate[c] = static_cast<uint8_t>(value);
+            float d = float(value * 2 + p) - color[c];
+            error += d * d;
+        }
+        if (error < bestError) {
+            bestError = error;
+            std::memcpy(endpoint, candidate, 4);
+            pBit = static_cast<uint8_t>(p);
+        }
+    }
+}
+
+void Bc7Palette(const uint8_t* endpoint0, uint8_t p0, const uint8_t* endpoint1, uint8_t p1, int (*palette)[4]) {
+    for (int c = 0; c < 4; c++) {
+        int low = endpoint0[c] * 2 + p0, high = endpoint1[c] * 2 + p1;
+        for (int i = 0; i < 16; i++)
+            palette[i][c] = ((64 - Bc7Weights[i]) * low + Bc7Weights[i] * high + 32) >> 6;
+    }
+}
+
+float EvaluateBc7(const Texels& texels, const uint8_t* endpoint0, uint8_t p0, const uint8_t* endpoint1, uint8_t p1, uint8_t* indices) {
+    int colors[16][4];
+    Bc7Palette(endpoint0, p0, endpoint1, p1, colors);
+
+    Palette palette;
+    palette.count = 16;
+    for (int p = 0; p < 16; p++) {
+        for (int c = 0; c < 4; c++)
+            palette.c[p][c] = static_cast<float>(colors[p][c]);
+    }
+    return PickIndices(texels, palette, 4, indices);
+}
+
+void EncodeBc7(const Texels& texels, uint8_t* block) {
+    static const float weights[16] = {
+        0 / 64.0f, 4 / 64.0f, 9 / 64.0f, 13 / 64.0f, 17 / 64.0f, 21 / 64.0f, 26 / 64.0f, 30 / 64.0f,
+        34 / 64.0f, 38 / 64.0f, 43 / 64.0f, 47 / 64.0f, 51 / 64.0f, 55 / 64.0f, 60 / 64.0f, 64 / 64.0f };
+
+    float low[4], high[4];
+    AxisEndpoints(texels, 4, low, high);
+
+    uint8_t endpoint0[4], endpoint1[4], p0, p1;
+    QuantizeBc7(low, endpoint0, p0);
+    QuantizeBc7(high, endpoint1, p1);
+    uint8_t indices[16];
+    float error = EvaluateBc7(texels, endpoint0, p0, endpoint1, p1, indices);
+
+    for (int iteration = 0; iteration < 2 && error > 0.0f; iteration++) {
+        if (!LeastSquaresEndpoints(texels, 4, indices, weights, low, high))
+            break;
+
+        uint8_t refit0[4], refit1[4], refitP0, refitP1;
+        QuantizeBc7(low, refit0, refitP0);
+        QuantizeBc7(high, refit1, refitP1);
+        uint8_t refitIndices[16];
+        float refitError = EvaluateBc7(texels, refit0, refitP0, refit1, refitP1, refitIndices);
+        if (refitError >= error)
+            break;
+
+        std::memcpy(endpoint0, refit0, 4);
+        std::memcpy(endpoint1, refit1, 4);
+        p0 = refitP0;
+        p1 = refitP1;
+        error = refitError;
+        std::memcpy(indices, refitIndices, sizeof(indices));
+    }
+
+    // the first texel's index drops its top bit, so it has to be below 8
+    if (indices[0] & 8) {
+        for (int c = 0; c < 4; c++)
+            std::swap(endpoint0[c], endpoint1[c]);
+        std::swap(p0, p1);
+        for (uint8_t& index : indices)
+            index = static_cast<uint8_t>(15 - index);
+    }
+
+    BlockBits bits;
+    bits.Put(1 << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        bits.Put(endpoint0[c], 7);
+        bits.Put(endpoint1[c], 7);
+    }
+    bits.Put(p0, 1);
+    bits.Put(p1, 1);
+    bits.Put(indices[0], 3);
+    for (int i = 1; i < 16; i++)
+        bits.Put(indices[i], 4);
+
+    std::memcpy(block, bits.word, 16);
+}
+
+void DecodeBc7(const uint8_t* block, uint8_t* rgba) {
+    BlockBits bits;
+    std::memcpy(bits.word, block, 16);
+
+    // anything but mode 6 is never written, decoded the way the spec has reserved modes read
+    if (bits.Get(7) != (1 << 6)) {
+        std::memset(rgba, 0, 64);
+        return;
+    }
+
+    uint8_t endpoint0[4], endpoint1[4];
+    for (int c = 0; c < 4; c++) {
+        endpoint0[c] = static_cast<uint8_t>(bits.Get(7));
+        endpoint1[c] = static_cast<uint8_t>(bits.Get(7));
+    }
+    uint8_t p0 = static_cast<uint8_t>(bits.Get(1)), p1 = static_cast<uint8_t>(bits.Get(1));
+
+    int palette[16][4];
+    Bc7Palette(endpoint0, p0, endpoint1, p1, palette);
+    for (int i = 0; i < 16; i++) {
+        const int* color = palette[bits.Get(i == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; c++)
+            rgba[i * 4 + c] = static_cast<uint8_t>(color[c]);
+    }
+}
+
+void EncodeBlock(const uint8_t* texels, BlockFormat format, uint8_t* block) {
+    uint8_t channel[16];
+    auto gather = [&](int c) {
+        for (int i = 0; i < 16; i++)
+            channel[i] = texels[i * 4 + c];
+        return channel;
+    };
+
+    Texels values;
+    switch (format) {
+    case BlockFormat::BC1:
+        ToTexels(texels, values);
+        EncodeColor(values, block);
+        break;
+    case BlockFormat::BC3:
+        EncodeChannel(gather(3), block);
+        ToTexels(texels, values);
+        EncodeColor(values, block + 8);
+        break;
+    case BlockFormat::BC5:
+        EncodeChannel(gather(0), block);
+        EncodeChannel(gather(1), block + 8);
+        break;
+    case BlockFormat::BC7:
+        ToTexels(texels, values);
+        EncodeBc7(values, block);
+        break;
+    }
+}
+
+void DecodeBlock(const uint8_t* block, BlockFormat format, uint8_t* texels) {
+    switch (format) {
+    case BlockFormat::BC1:
+        DecodeColor(block, false, texels);
+        break;
+    case BlockFormat::BC3:
+        DecodeColor(block + 8, true, texels);
+        DecodeChannel(block, texels + 3, 4);
+        break;
+    case BlockFormat::BC5:
+        for (int i = 0; i < 16; i++) {
+            texels[i * 4 + 2] = 0;
+            texels[i * 4 + 3] = 255;
+        }
+        DecodeChannel(block, texels, 4);
+        DecodeChannel(block + 8, texels + 1, 4);
+        break;
+    case BlockFormat::BC7:
+        DecodeBc7(block, texels);
+        break;
+    }
+}
+
+}
+
+bool IsValidBlockFormat(BlockFormat format) {
+    return format == BlockFormat::BC1 || format == BlockFormat::BC3 || format == BlockFormat::BC5 || format == BlockFormat::BC7;
+}
+
+const char* BlockFormatName(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC1: return "BC1";
+    case BlockFormat::BC3: return "BC3";
+    case BlockFormat::BC5: return "BC5";
+    case BlockFormat::BC7: return "BC7";
+    }
+    return "unknown";
+}
+
+uint32_t BlockBytes(BlockFormat format) {
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t CompressedSize(BlockFormat format, uint32_t width, uint32_t height) {
+    return size_t(BlockCount(width)) * BlockCount(height) * BlockBytes(format);
+}
+
+void CompressImage(const uint8_t* rgba, uint32_t width, uint32_t height, BlockFormat format, uint8_t* blocks, unsigned int threadCount) {
+    uint32_t across = BlockCount(width);
+    size_t rowBytes = size_t(across) * BlockBytes(format);
+
+    ParallelFor(BlockCount(height), threadCount, [&](size_t row) {
+        uint8_t* block = blocks + row * rowBytes;
+        for (uint32_t column = 0; column < across; column++, block += BlockBytes(format)) {
+            uint8_t texels[64];
+            LoadBlock(rgba, width, height, column, static_cast<uint32_t>(row), texels);
+            EncodeBlock(texels, format, block);
+        }
+    });
+}
+
+void DecompressImage(const uint8_t* blocks, uint32_t width, uint32_t height, BlockFormat format, uint8_t* rgba) {
+    uint32_t across = BlockCount(width), down = BlockCount(height);
+    for (uint32_t row = 0; row < down; row++) {
+        for (uint32_t column = 0; column < across; column++, blocks += BlockBytes(format)) {
+            uint8_t texels[64];
+            DecodeBlock(blocks, format, texels);
+
+            // edge blocks only write the texels inside the image
+            for (uint32_t y = 0; y < 4 && row * 4 + y < height; y++) {
+                for (uint32_t x = 0; x < 4 && column * 4 + x < width; x++)
+                    std::memcpy(rgba + ((size_t(row) * 4 + y) * width + column * 4 + x) * 4, texels + (y * 4 + x) * 4, 4);
+            }
+        }
+    }
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pipeline {
+
+// gpu block compressed formats, each stores 4x4 texels in a fixed size block
+enum class BlockFormat : uint8_t {
+    // rgb at 4 bits per texel, 565 endpoints and 2 bit indices, alpha dropped
+    BC1,
+    // BC1 color plus an alpha channel stored like BC4, 8 bits per texel
+    BC3,
+    // two BC4 channels, red and green, for tangent space normal maps
+    BC5,
+    // rgba at 8 bits per texel. Only mode 6 is written: 7777 endpoints with a p bit each
+    // and 4 bit indices, one subset
+    BC7
+};
+
+bool IsValidBlockFormat(BlockFormat format);
+const char* BlockFormatName(BlockFormat format);
+// 8 or 16
+uint32_t BlockBytes(BlockFormat format);
+
+// blocks needed to cover pixels texels, a partial block at the edge counted
+inline uint32_t BlockCount(uint32_t pixels) {
+    return (pixels + 3) / 4;
+}
+
+// bytes of a compressed width x height image, also what a row of blocks times its
+// BlockCount rows takes
+size_t CompressedSize(BlockFormat format, uint32_t width, uint32_t height);
+
+// compresses a tightly packed rgba8 image into CompressedSize bytes of blocks, row of blocks
+// after row of blocks. Edge blocks repeat the last row and column to fill up. Rows of blocks
+// are spread over threadCount threads, 0 for one per core.
+void CompressImage(const uint8_t* rgba, uint32_t width, uint32_t height, BlockFormat format, uint8_t* blocks,
+    unsigned int threadCount = 0);
+
+// back to rgba8 the way the gpu samples it. Channels the format lacks read as 0, alpha as 255.
+void DecompressImage(const uint8_t* blocks, uint32_t width, uint32_t height, BlockFormat format, uint8_t* rgba);
+
+}
\ No newline at end of file
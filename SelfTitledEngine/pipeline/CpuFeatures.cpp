@@ -0,0 +1,83 @@
+#include "CpuFeatures.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define PIPELINE_CPUID
+#include <intrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PIPELINE_CPUID
+#include <cpuid.h>
+#endif
+
+namespace pipeline {
+
+namespace {
+
+struct CpuFeatures {
+    bool ssse3 = false;
+    bool avx2 = false;
+
+    CpuFeatures() {
+#ifdef PIPELINE_CPUID
+        unsigned int leaf1[4];
+        unsigned int leaf7[4] = {};
+        Cpuid(1, leaf1);
+        if (MaxLeaf() >= 7)
+            Cpuid(7, leaf7);
+
+        ssse3 = (leaf1[2] & (1u << 9)) != 0;
+
+        // the cpu has to support AVX2, and the OS has to have turned on saving xmm and ymm
+        // state through xsave
+        bool osxsave = (leaf1[2] & (1u << 27)) != 0;
+        bool avx = (leaf1[2] & (1u << 28)) != 0;
+        avx2 = osxsave && avx && (leaf7[1] & (1u << 5)) != 0 && (EnabledState() & 6) == 6;
+#endif
+    }
+
+#ifdef PIPELINE_CPUID
+    static void Cpuid(unsigned int leaf, unsigned int registers[4]) {
+#ifdef _MSC_VER
+        int values[4];
+        __cpuidex(values, static_cast<int>(leaf), 0);
+        for (int i = 0; i < 4; i++)
+            registers[i] = static_cast<unsigned int>(values[i]);
+#else
+        __cpuid_count(leaf, 0, registers[0], registers[1], registers[2], registers[3]);
+#endif
+    }
+
+    static unsigned int MaxLeaf() {
+        unsigned int registers[4];
+        Cpuid(0, registers);
+        return registers[0];
+    }
+
+    // xcr0, only valid to read once osxsave is known to be set
+    static unsigned long long EnabledState() {
+#ifdef _MSC_VER
+        return _xgetbv(0);
+#else
+        unsigned int low, high;
+        __asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+        return (static_cast<unsigned long long>(high) << 32) | low;
+#endif
+    }
+#endif
+};
+
+const CpuFeatures& Features() {
+    static const CpuFeatures features;
+    return features;
+}
+
+}
+
+bool HasSsse3() {
+    return Features().ssse3;
+}
+
+bool HasAvx2() {
+    return Features().avx2;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+
+namespace pipeline {
+
+// instruction sets past the SSE2 every x64 cpu has, looked up with cpuid once. False on
+// other architectures.
+bool HasSsse3();
+// AVX2 and an OS that saves the ymm registers
+bool HasAvx2();
+
+}
+
+// compiles one function for an instruction set the rest of the build doesn't assume, so it
+// must only be called after the matching check above. MSVC compiles any intrinsic anywhere.
+#if defined(__GNUC__) || defined(__clang__)
+#define PIPELINE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PIPELINE_TARGET(isa)
+#endif
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include "FileWatcher.h"
+
+#include <cstdint>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace pipeline {
+
+#ifdef _WIN32
+
+namespace {
+
+// one overlapped ReadDirectoryChangesW kept in flight per directory
+struct WatchedDirectory {
+    std::string path;
+    HANDLE handle = INVALID_HANDLE_VALUE;
+    OVERLAPPED overlapped = {};
+    alignas(DWORD) uint8_t buffer[16 * 1024];
+};
+
+const DWORD NotifyFilter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME;
+
+bool Issue(WatchedDirectory& directory) {
+    return ReadDirectoryChangesW(directory.handle, directory.buffer, sizeof(directory.buffer), FALSE, NotifyFilter,
+        nullptr, &directory.overlapped, nullptr) != 0;
+}
+
+std::string ToUtf8(const wchar_t* text, int length) {
+    int size = WideCharToMultiByte(CP_UTF8, 0, text, length, nullptr, 0, nullptr, nullptr);
+    std::string utf8(size, '\0');
+    WideCharToMultiByte(CP_UTF8, 0, text, length, &utf8[0], size, nullptr, nullptr);
+    return utf8;
+}
+
+}
+
+struct FileWatcher::Platform {
+    std::vector<std::unique_ptr<WatchedDirectory>> directories;
+    HANDLE stop = nullptr;
+
+    ~Platform() {
+        for (std::unique_ptr<WatchedDirectory>& directory : directories) {
+            if (directory->handle != INVALID_HANDLE_VALUE) {
+                // the read still owns the buffer until the cancel goes through
+                DWORD bytes;
+                if (CancelIoEx(directory->handle, &directory->overlapped))
+                    GetOverlappedResult(directory->handle, &directory->overlapped, &bytes, TRUE);
+                CloseHandle(directory->handle);
+            }
+            if (directory->overlapped.hEvent)
+                CloseHandle(directory->overlapped.hEvent);
+        }
+
+        if (stop)
+            CloseHandle(stop);
+    }
+};
+
+bool FileWatcher::Start(const std::vector<std::string>& directories, std::string& error) {
+    Stop();
+
+    std::unique_ptr<Platform> platform(new Platform());
+    platform->stop = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!platform->stop) {
+        error = "Failed to create the watcher's stop event";
+        return false;
+    }
+
+    for (const std::string& path : directories) {
+        std::unique_ptr<WatchedDirectory> directory(new WatchedDirectory());
+        directory->path = path;
+        directory->handle = CreateFileA(path.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+        directory->overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+
+        bool issued = directory->handle != INVALID_HANDLE_VALUE && directory->overlapped.hEvent && Issue(*directory);
+        platform->directories.push_back(std::move(directory));
+        if (!issued) {
+            error = "Failed to watch " + path;
+            return false;
+        }
+    }
+
+    _platform = std::move(platform);
+    _thread = std::thread(&FileWatcher::watchLoop, this);
+    return true;
+}
+
+void FileWatcher::Stop() {
+    if (_thread.joinable()) {
+        SetEvent(_platform->stop);
+        _thread.join();
+    }
+    _platform.reset();
+}
+
+void FileWatcher::watchLoop() {
+    std::vector<HANDLE> events;
+    for (std::unique_ptr<WatchedDirectory>& directory : _platform->directories)
+        events.push_back(directory->overlapped.hEvent);
+    events.push_back(_platform->stop);
+
+    for (;;) {
+        DWORD result = WaitForMultipleObjects(static_cast<DWORD>(events.size()), events.data(), FALSE, INFINITE);
+        size_t index = result - WAIT_OBJECT_0;
+        if (index >= _platform->directories.size())
+            return;
+
+        WatchedDirectory& directory = *_platform->directories[index];
+        DWORD bytes = 0;
+        // no bytes means the buffer overflowed and this batch is lost, saving again recovers it
+        if (GetOverlappedResult(directory.handle, &directory.overlapped, &bytes, FALSE) && bytes > 0) {
+            const uint8_t* entry = directory.buffer;
+            for (;;) {
+                const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry);
+                if (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_MODIFIED || info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+                    record(directory.path, ToUtf8(info->FileName, static_cast<int>(info->FileNameLength / sizeof(wchar_t))));
+
+                if (info->NextEntryOffset == 0)
+                    break;
+                entry += info->NextEntryOffset;
+            }
+        }
+
+        if (!Issue(directory))
+            return;
+    }
+}
+
+#else
+
+struct FileWatcher::Platform {
+    int notify = -1;
+    // written to wake the thread up for Stop
+    int stop[2] = { -1, -1 };
+    std::map<int, std::string> directories;
+
+    ~Platform() {
+        if (notify >= 0)
+            close(notify);
+        if (stop[0] >= 0)
+            close(stop[0]);
+        if (stop[1] >= 0)
+            close(stop[1]);
+    }
+};
+
+bool FileWatcher::Start(const std::vector<std::string>& directories, std::string& error) {
+    Stop();
+
+    std::unique_ptr<Platform> platform(new Platform());
+    platform->notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (platform->notify < 0 || pipe2(platform->stop, O_CLOEXEC) != 0) {
+        error = "Failed to set up inotify";
+        return false;
+    }
+
+    for (const std::string& path : directories) {
+        // written in place or saved aside and moved over the old file
+        int watch = inotify_add_watch(platform->notify, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (watch < 0) {
+            error = "Failed to watch " + path;
+            return false;
+        }
+        platform->directories[watch] = path;
+    }
+
+    _platform = std::move(platform);
+    _thread = std::thread(&FileWatcher::watchLoop, this);
+    return true;
+}
+
+void FileWatcher::Stop() {
+    if (_thread.joinable()) {
+        char wake = 0;
+        ssize_t written = write(_platform->stop[1], &wake, 1);
+        (void)written;
+        _thread.join();
+    }
+    _platform.reset();
+}
+
+void FileWatcher::watchLoop() {
+    alignas(inotify_event) char buffer[16 * 1024];
+
+    for (;;) {
+        pollfd fds[2] = { { _platform->notify, POLLIN, 0 }, { _platform->stop[0], POLLIN, 0 } };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        if (fds[1].revents)
+            return;
+
+        for (;;) {
+            ssize_t length = read(_platform->notify, buffer, sizeof(buffer));
+            if (length <= 0)
+                break;
+
+            for (ssize_t offset = 0; offset < length;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                auto directory = _platform->directories.find(event->wd);
+                if (event->len > 0 && directory != _platform->directories.end())
+                    record(directory->second, event->name);
+                offset += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+}
+
+#endif
+
+FileWatcher::FileWatcher() = default;
+
+FileWatcher::~FileWatcher() {
+    Stop();
+}
+
+void FileWatcher::record(const std::string& directory, const std::string& name) {
+    auto now = std::chrono::steady_clock::now();
+    std::string filePath = directory + "/" + name;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto pending = _pending.find(filePath);
+    if (pending == _pending.end())
+        _pending[filePath] = { now, now };
+    else
+        pending->second.lastSeen = now;
+}
+
+std::vector<FileWatcher::Change> FileWatcher::TakeChanges() {
+    auto now = std::chrono::steady_clock::now();
+    std::vector<Change> changes;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto pending = _pending.begin(); pending != _pending.end();) {
+        if (std::chrono::duration<double, std::milli>(now - pending->second.lastSeen).count() < QuietMs) {
+            ++pending;
+            continue;
+        }
+
+        changes.push_back({ pending->first, pending->second.firstSeen });
+        pending = _pending.erase(pending);
+    }
+    return changes;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pipeline {
+
+// reports files written in a set of directories, from a thread of its own that sleeps until
+// the OS has something. ReadDirectoryChangesW on Windows, inotify elsewhere. Subdirectories
+// aren't watched.
+class FileWatcher {
+public:
+    struct Change {
+        // the directory as given to Start, a slash and the file name
+        std::string filePath;
+        // first write of the burst, roughly when the file was saved
+        std::chrono::steady_clock::time_point firstSeen;
+    };
+
+    // editors and compilers write a file in several goes, a change is only reported once
+    // the file has been left alone this long
+    static constexpr double QuietMs = 50.0;
+
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    bool Start(const std::vector<std::string>& directories, std::string& error);
+    void Stop();
+    bool IsRunning() const { return _thread.joinable(); }
+
+    // changes that have settled since the last call, one per file
+    std::vector<Change> TakeChanges();
+
+private:
+    struct Platform;
+    struct Pending {
+        std::chrono::steady_clock::time_point firstSeen;
+        std::chrono::steady_clock::time_point lastSeen;
+    };
+
+    void watchLoop();
+    void record(const std::string& directory, const std::string& name);
+
+private:
+    std::unique_ptr<Platform> _platform;
+    std::thread _thread;
+    std::mutex _mutex;
+    std::map<std::string, Pending> _pending;
+};
+
+}
\ No newline at end of file
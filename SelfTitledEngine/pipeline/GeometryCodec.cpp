@@ -0,0 +1,1031 @@
+#include "GeometryCodec.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define PIPELINE_SSE2
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#endif
+
+#include "CpuFeatures.h"
+#include "IndexBuffer.h"
+#include "VertexFormat.h"
+
+namespace pipeline {
+
+namespace {
+
+constexpr uint8_t VertexCodecVersion = 0xA1;
+constexpr uint8_t IndexCodecVersion = 0xB1;
+constexpr uint32_t MeshCodecMagic = 0x4D475453; // "STGM"
+constexpr uint32_t MeshCodecVersion = 3;
+
+// bits per delta of each lane mode, kept in 2 bits of the group header, and what is added
+// to the deltas to make them unsigned. A bias costs the decoder one subtract where a
+// zigzag would cost five.
+constexpr unsigned int LaneBits[4] = { 0, 2, 4, 8 };
+constexpr uint8_t LaneBias[4] = { 0, 2, 8, 0 };
+
+inline uint32_t ZigZag32(uint32_t delta) {
+    return (delta << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(delta) >> 31);
+}
+
+inline uint32_t UnZigZag32(uint32_t value) {
+    return (value >> 1) ^ (0u - (value & 1));
+}
+
+inline size_t GroupHeaderSize(size_t vertexSize) {
+    return (vertexSize + 3) / 4;
+}
+
+// group holds a full group of vertices, previous the one before them
+void EncodeVertexGroup(const uint8_t* group, const uint8_t* previous, size_t vertexSize, std::vector<uint8_t>& out) {
+    size_t header = out.size();
+    out.resize(out.size() + GroupHeaderSize(vertexSize), 0);
+
+    for (size_t lane = 0; lane < vertexSize; lane++) {
+        uint8_t deltas[VertexCodecGroupSize];
+        uint8_t last = previous[lane];
+        int low = 0, high = 0;
+        for (size_t i = 0; i < VertexCodecGroupSize; i++) {
+            uint8_t value = group[i * vertexSize + lane];
+            deltas[i] = static_cast<uint8_t>(value - last);
+            low = std::min(low, int(static_cast<int8_t>(deltas[i])));
+            high = std::max(high, int(static_cast<int8_t>(deltas[i])));
+            last = value;
+        }
+
+        unsigned int mode = 3;
+        if (low == 0 && high == 0)
+            mode = 0;
+        else if (low >= -2 && high <= 1)
+            mode = 1;
+        else if (low >= -8 && high <= 7)
+            mode = 2;
+        out[header + lane / 4] |= static_cast<uint8_t>(mode << ((lane % 4) * 2));
+
+        // first delta in the highest bits of each byte
+        unsigned int bits = LaneBits[mode];
+        if (bits == 8) {
+            out.insert(out.end(), deltas, deltas + VertexCodecGroupSize);
+        }
+        else if (bits != 0) {
+            unsigned int perByte = 8 / bits;
+            for (size_t i = 0; i < VertexCodecGroupSize; i += perByte) {
+                uint8_t packed = 0;
+                for (unsigned int k = 0; k < perByte; k++)
+                    packed |= static_cast<uint8_t>(static_cast<uint8_t>(deltas[i + k] + LaneBias[mode]) << (8 - bits * (k + 1)));
+                out.push_back(packed);
+            }
+        }
+    }
+}
+
+#ifdef PIPELINE_SSE2
+
+// the kernels below decode a lane as two registers
+static_assert(VertexCodecGroupSize == 32, "vertex codec kernels assume groups of 32");
+
+// spreads 2 and 4 bit deltas out to a byte each, 16 per call
+inline void Unpack2(__m128i packed, __m128i& first, __m128i& second) {
+    const __m128i mask = _mm_set1_epi8(3);
+    __m128i a = _mm_and_si128(_mm_srli_epi16(packed, 6), mask);
+    __m128i b = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+    __m128i c = _mm_and_si128(_mm_srli_epi16(packed, 2), mask);
+    __m128i d = _mm_and_si128(packed, mask);
+    __m128i ab = _mm_unpacklo_epi8(a, b);
+    __m128i cd = _mm_unpacklo_epi8(c, d);
+    first = _mm_unpacklo_epi16(ab, cd);
+    second = _mm_unpackhi_epi16(ab, cd);
+}
+
+inline void Unpack4(__m128i packed, __m128i& first, __m128i& second) {
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    __m128i high = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+    __m128i low = _mm_and_si128(packed, mask);
+    first = _mm_unpacklo_epi8(high, low);
+    second = _mm_unpackhi_epi8(high, low);
+}
+
+// the 32 deltas of a lane in two registers, reading only the bytes the mode stores
+inline void UnpackLane(const uint8_t* data, unsigned int mode, __m128i& first, __m128i& second) {
+    switch (mode) {
+    case 0:
+        first = second = _mm_setzero_si128();
+        return;
+    case 1:
+        Unpack2(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data)), first, second);
+        break;
+    case 2:
+        Unpack4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), first, second);
+        break;
+    default:
+        first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+        return;
+    }
+
+    __m128i bias = _mm_set1_epi8(static_cast<char>(LaneBias[mode]));
+    first = _mm_sub_epi8(first, bias);
+    second = _mm_sub_epi8(second, bias);
+}
+
+// sums up 16 deltas onto carry, which holds the previous value in every byte
+inline __m128i SumDeltas(__m128i value, __m128i carry) {
+    value = _mm_add_epi8(value, _mm_slli_si128(value, 1));
+    value = _mm_add_epi8(value, _mm_slli_si128(value, 2));
+    value = _mm_add_epi8(value, _mm_slli_si128(value, 4));
+    value = _mm_add_epi8(value, _mm_slli_si128(value, 8));
+    return _mm_add_epi8(value, carry);
+}
+
+// the last byte in every byte
+inline __m128i BroadcastLast(__m128i value) {
+    __m128i last = _mm_unpackhi_epi8(value, value);
+    last = _mm_shufflehi_epi16(last, 0xFF);
+    return _mm_unpackhi_epi64(last, last);
+}
+
+inline void DecodeLane(const uint8_t* data, unsigned int mode, __m128i& carry, uint8_t* lane) {
+    __m128i first, second;
+    UnpackLane(data, mode, first, second);
+
+    first = SumDeltas(first, carry);
+    second = SumDeltas(second, BroadcastLast(first));
+    carry = BroadcastLast(second);
+
+    _mm_store_si128(reinterpret_cast<__m128i*>(lane), first);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lane + 16), second);
+}
+
+// four bytes of each of 16 vertices, four vertices to a register
+inline void InterleaveLanes4(const uint8_t* r0, const uint8_t* r1, const uint8_t* r2, const uint8_t* r3, __m128i quads[4]) {
+    __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(r0));
+    __m128i b = _mm_load_si128(reinterpret_cast<const __m128i*>(r1));
+    __m128i c = _mm_load_si128(reinterpret_cast<const __m128i*>(r2));
+    __m128i d = _mm_load_si128(reinterpret_cast<const __m128i*>(r3));
+
+    __m128i abLow = _mm_unpacklo_epi8(a, b);
+    __m128i abHigh = _mm_unpackhi_epi8(a, b);
+    __m128i cdLow = _mm_unpacklo_epi8(c, d);
+    __m128i cdHigh = _mm_unpackhi_epi8(c, d);
+
+    quads[0] = _mm_unpacklo_epi16(abLow, cdLow);
+    quads[1] = _mm_unpackhi_epi16(abLow, cdLow);
+    quads[2] = _mm_unpacklo_epi16(abHigh, cdHigh);
+    quads[3] = _mm_unpackhi_epi16(abHigh, cdHigh);
+}
+
+inline void Store4(uint8_t* target, __m128i value) {
+    int32_t word = _mm_cvtsi128_si32(value);
+    std::memcpy(target, &word, sizeof(word));
+}
+
+// writes bytes lane..lane+3 of 16 vertices from lanes starting at vertex first
+inline void TransposeLanes4(const uint8_t (*lanes)[VertexCodecGroupSize], size_t lane, size_t first, size_t vertexSize, uint8_t* vertices) {
+    __m128i quads[4];
+    InterleaveLanes4(lanes[lane] + first, lanes[lane + 1] + first, lanes[lane + 2] + first, lanes[lane + 3] + first, quads);
+
+    uint8_t* target = vertices + lane;
+    for (int q = 0; q < 4; q++) {
+        Store4(target, quads[q]);
+        Store4(target + vertexSize, _mm_srli_si128(quads[q], 4));
+        Store4(target + vertexSize * 2, _mm_srli_si128(quads[q], 8));
+        Store4(target + vertexSize * 3, _mm_srli_si128(quads[q], 12));
+        target += vertexSize * 4;
+    }
+}
+
+// the same for bytes lane..lane+7, in half as many stores
+inline void TransposeLanes8(const uint8_t (*lanes)[VertexCodecGroupSize], size_t lane, size_t first, size_t vertexSize, uint8_t* vertices) {
+    __m128i low[4], high[4];
+    InterleaveLanes4(lanes[lane] + first, lanes[lane + 1] + first, lanes[lane + 2] + first, lanes[lane + 3] + first, low);
+    InterleaveLanes4(lanes[lane + 4] + first, lanes[lane + 5] + first, lanes[lane + 6] + first, lanes[lane + 7] + first, high);
+
+    uint8_t* target = vertices + lane;
+    for (int q = 0; q < 4; q++) {
+        __m128i pairLow = _mm_unpacklo_epi32(low[q], high[q]);
+        __m128i pairHigh = _mm_unpackhi_epi32(low[q], high[q]);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(target), pairLow);
+        _mm_storeh_pd(reinterpret_cast<double*>(target + vertexSize), _mm_castsi128_pd(pairLow));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(target + vertexSize * 2), pairHigh);
+        _mm_storeh_pd(reinterpret_cast<double*>(target + vertexSize * 3), _mm_castsi128_pd(pairHigh));
+        target += vertexSize * 4;
+    }
+}
+
+#else
+
+void DecodeLaneScalar(const uint8_t* data, unsigned int mode, uint8_t& previous, uint8_t* lane) {
+    unsigned int bits = LaneBits[mode];
+    uint8_t value = previous;
+    for (size_t i = 0; i < VertexCodecGroupSize; i++) {
+        uint8_t delta = 0;
+        if (bits == 8) {
+            delta = data[i];
+        }
+        else if (bits != 0) {
+            unsigned int perByte = 8 / bits;
+            unsigned int shift = 8 - bits * (static_cast<unsigned int>(i % perByte) + 1);
+            delta = static_cast<uint8_t>(((data[i / perByte] >> shift) & ((1u << bits) - 1)) - LaneBias[mode]);
+        }
+        value = static_cast<uint8_t>(value + delta);
+        lane[i] = value;
+    }
+    previous = value;
+}
+
+#endif
+
+void TransposeLanes(const uint8_t (*lanes)[VertexCodecGroupSize], size_t vertexSize, uint8_t* vertices) {
+    size_t lane = 0;
+#ifdef PIPELINE_SSE2
+    uint8_t* second = vertices + 16 * vertexSize;
+    for (; lane + 8 <= vertexSize; lane += 8) {
+        TransposeLanes8(lanes, lane, 0, vertexSize, vertices);
+        TransposeLanes8(lanes, lane, 16, vertexSize, second);
+    }
+    for (; lane + 4 <= vertexSize; lane += 4) {
+        TransposeLanes4(lanes, lane, 0, vertexSize, vertices);
+        TransposeLanes4(lanes, lane, 16, vertexSize, second);
+    }
+#endif
+    for (; lane < vertexSize; lane++) {
+        for (size_t i = 0; i < VertexCodecGroupSize; i++)
+            vertices[i * vertexSize + lane] = lanes[lane][i];
+    }
+}
+
+// rings of recently coded edges and vertices, entry 0 being the newest. Only the first
+// Searched entries can be named, the rest of the 4 bit code space is taken by escapes.
+class EdgeFifo {
+public:
+    static constexpr unsigned int Searched = 15;
+
+    EdgeFifo() {
+        std::fill(_from, _from + Size, UINT32_MAX);
+        std::fill(_to, _to + Size, UINT32_MAX);
+    }
+
+    void Push(uint32_t from, uint32_t to) {
+        _from[_offset] = from;
+        _to[_offset] = to;
+        _offset = (_offset + 1) & (Size - 1);
+    }
+
+    int Find(uint32_t from, uint32_t to) const {
+        for (unsigned int i = 0; i < Searched; i++) {
+            unsigned int slot = (_offset - 1 - i) & (Size - 1);
+            if (_from[slot] == from && _to[slot] == to)
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    void Get(unsigned int index, uint32_t& from, uint32_t& to) const {
+        unsigned int slot = (_offset - 1 - index) & (Size - 1);
+        from = _from[slot];
+        to = _to[slot];
+    }
+
+private:
+    static constexpr unsigned int Size = 16;
+
+    uint32_t _from[Size];
+    uint32_t _to[Size];
+    unsigned int _offset = 0;
+};
+
+class VertexFifo {
+public:
+    static constexpr unsigned int Searched = 14;
+
+    VertexFifo() {
+        std::fill(_vertices, _vertices + Size, UINT32_MAX);
+    }
+
+    void Push(uint32_t vertex) {
+        _vertices[_offset] = vertex;
+        _offset = (_offset + 1) & (Size - 1);
+    }
+
+    int Find(uint32_t vertex) const {
+        for (unsigned int i = 0; i < Searched; i++) {
+            if (_vertices[(_offset - 1 - i) & (Size - 1)] == vertex)
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    uint32_t Get(unsigned int index) const {
+        return _vertices[(_offset - 1 - index) & (Size - 1)];
+    }
+
+private:
+    static constexpr unsigned int Size = 16;
+
+    uint32_t _vertices[Size];
+    unsigned int _offset = 0;
+};
+
+// the index stream is a version byte, the rotation of every triangle in 2 bits, a code byte
+// per triangle, then the extra bytes of every triangle in order. A triangle that shares an
+// edge codes it as edge fifo index << 4 | third vertex code, one that doesn't as NoEdge << 4
+// | first vertex code, with a byte holding the other two codes in the extra bytes. Explicit
+// vertices add a varint to the extra bytes after the byte holding their code. Keeping the
+// codes apart means the decoder knows where every one is without decoding the triangles
+// before it.
+constexpr unsigned int NoEdge = 15;
+
+// vertex codes, anything below is a vertex fifo index
+constexpr unsigned int VertexNext = 14;
+constexpr unsigned int VertexExplicit = 15;
+
+inline size_t RotationBytes(size_t triangleCount) {
+    return (triangleCount + 3) / 4;
+}
+
+void WriteVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+inline bool ReadVarint(const uint8_t*& p, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (unsigned int shift = 0; shift < 35; shift += 7) {
+        if (p == end)
+            return false;
+        uint8_t byte = *p++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (byte < 0x80)
+            return true;
+    }
+    return false;
+}
+
+// what the encoder and decoder both track while walking the triangles
+struct IndexCoder {
+    EdgeFifo edges;
+    VertexFifo vertices;
+    // the lowest vertex not referenced yet when triangles are in first-use order
+    uint32_t next = 0;
+    // the last vertex coded, explicit vertices are deltas against it
+    uint32_t last = 0;
+
+    void PushTriangle(uint32_t a, uint32_t b, uint32_t c) {
+        // a neighbour walks the shared edge the other way round
+        edges.Push(b, a);
+        edges.Push(c, b);
+        edges.Push(a, c);
+    }
+};
+
+struct VertexCode {
+    unsigned int code;
+    // zigzagged delta that follows explicit vertices
+    uint32_t delta;
+};
+
+VertexCode EncodeVertex(IndexCoder& coder, uint32_t vertex) {
+    VertexCode result = { VertexNext, 0 };
+    int fifo = coder.vertices.Find(vertex);
+    if (vertex == coder.next) {
+        coder.next++;
+        coder.vertices.Push(vertex);
+    }
+    else if (fifo >= 0) {
+        result.code = static_cast<unsigned int>(fifo);
+    }
+    else {
+        result.code = VertexExplicit;
+        result.delta = ZigZag32(vertex - coder.last);
+        coder.vertices.Push(vertex);
+    }
+    coder.last = vertex;
+    return result;
+}
+
+inline void WriteDelta(std::vector<uint8_t>& out, const VertexCode& vertex) {
+    if (vertex.code == VertexExplicit)
+        WriteVarint(out, vertex.delta);
+}
+
+// the decoder keeps the same fifos as IndexCoder, laid out so that a triangle sharing an
+// edge decodes without a data dependent branch. Every triangle pushes exactly three edges,
+// so edge e is corner pair e % 3 of the triangle e / 3 back and the edge fifo is just the
+// last few triangles.
+constexpr unsigned int TriangleRing = 8;
+static_assert(TriangleRing * 3 > EdgeFifo::Searched, "the triangle ring has to cover the edge fifo");
+
+// where each output corner of a triangle is found, per edge code and rotation. Lanes 0 to 2
+// are the corners of the triangle that pushed the edge, lane 3 the third vertex.
+struct EdgeDecode {
+    uint8_t back;
+    uint8_t lanes[3];
+};
+
+struct EdgeDecodeTable {
+    EdgeDecode entries[16][4];
+
+    EdgeDecodeTable() : entries() {
+        // PushTriangle pushes (b, a), (c, b), (a, c), the newest first here
+        const uint8_t from[3] = { 0, 2, 1 };
+        const uint8_t to[3] = { 2, 1, 0 };
+        for (unsigned int edge = 0; edge < EdgeFifo::Searched; edge++) {
+            for (unsigned int rotation = 0; rotation < 3; rotation++) {
+                EdgeDecode& entry = entries[edge][rotation];
+                entry.back = static_cast<uint8_t>(edge / 3);
+                entry.lanes[rotation] = from[edge % 3];
+                entry.lanes[(rotation + 1) % 3] = to[edge % 3];
+                entry.lanes[(rotation + 2) % 3] = 3;
+            }
+        }
+    }
+};
+
+const EdgeDecodeTable& EdgeDecodes() {
+    static const EdgeDecodeTable table;
+    return table;
+}
+
+// the vertex fifo of IndexCoder with head the next slot to fill
+struct DecodedVertices {
+    uint32_t fifo[16];
+    unsigned int head;
+    uint32_t next;
+    uint32_t last;
+};
+
+// explicit deltas come out of the extra bytes, so only they move the extra pointer
+inline bool DecodeVertex(DecodedVertices& state, unsigned int code, const uint8_t*& extra, const uint8_t* end, uint32_t& vertex) {
+    uint32_t value;
+    if (code < VertexNext) {
+        value = state.fifo[(state.head - 1 - code) & 15];
+    }
+    else {
+        if (code == VertexNext) {
+            value = state.next++;
+        }
+        else {
+            uint32_t delta;
+            if (!ReadVarint(extra, end, delta))
+                return false;
+            value = state.last + UnZigZag32(delta);
+        }
+        state.fifo[state.head & 15] = value;
+        state.head++;
+    }
+
+    state.last = value;
+    vertex = value;
+    return true;
+}
+
+inline void ResetDecodedVertices(DecodedVertices& state) {
+    std::fill(state.fifo, state.fifo + 16, UINT32_MAX);
+    state.head = 0;
+    state.next = 0;
+    state.last = 0;
+}
+
+// a rotation of 3 names no corner, it's the one with both of its bits set. Checked over the
+// whole array up front so the decoders don't spend instructions on it for every triangle.
+bool ValidRotations(const uint8_t* rotations, size_t triangleCount) {
+    unsigned int bad = 0;
+    size_t full = triangleCount / 4;
+    for (size_t i = 0; i < full; i++)
+        bad |= rotations[i] & (rotations[i] >> 1);
+    if (triangleCount % 4)
+        bad |= rotations[full] & (rotations[full] >> 1) & ((1u << (triangleCount % 4 * 2)) - 1);
+    return (bad & 0x55) == 0;
+}
+
+template <typename Index>
+bool DecodeTrianglesScalar(Index* indices, size_t triangleCount, uint32_t vertexLimit, const uint8_t* rotations,
+    const uint8_t* codes, const uint8_t* extra, const uint8_t* end) {
+    const EdgeDecodeTable& table = EdgeDecodes();
+    DecodedVertices state;
+    ResetDecodedVertices(state);
+
+    // the last TriangleRing triangles, lane 3 of each is scratch for the third vertex
+    uint32_t ring[TriangleRing][4];
+    std::fill(&ring[0][0], &ring[0][0] + TriangleRing * 4, UINT32_MAX);
+
+    // every vertex written goes through this, checked once at the end. Unused fifo entries
+    // are all ones, so naming one fails the check too.
+    uint32_t highest = 0;
+
+    for (size_t t = 0; t < triangleCount; t++) {
+        unsigned int code = codes[t];
+        unsigned int rotation = (rotations[t / 4] >> ((t % 4) * 2)) & 3;
+
+        uint32_t v0, v1, v2;
+        if ((code >> 4) != NoEdge) {
+            uint32_t third;
+            if (!DecodeVertex(state, code & 15, extra, end, third))
+                return false;
+
+            const EdgeDecode& edge = table.entries[code >> 4][rotation];
+            uint32_t* source = ring[(t - 1 - edge.back) % TriangleRing];
+            source[3] = third;
+            v0 = source[edge.lanes[0]];
+            v1 = source[edge.lanes[1]];
+            v2 = source[edge.lanes[2]];
+        }
+        else {
+            if (extra == end)
+                return false;
+            unsigned int others = *extra++;
+            if (!DecodeVertex(state, code & 15, extra, end, v0) || !DecodeVertex(state, others >> 4, extra, end, v1) ||
+                !DecodeVertex(state, others & 15, extra, end, v2))
+                return false;
+        }
+
+        highest = std::max(highest, std::max(v0, std::max(v1, v2)));
+        uint32_t* triangle = ring[t % TriangleRing];
+        triangle[0] = v0;
+        triangle[1] = v1;
+        triangle[2] = v2;
+
+        indices[t * 3 + 0] = static_cast<Index>(v0);
+        indices[t * 3 + 1] = static_cast<Index>(v1);
+        indices[t * 3 + 2] = static_cast<Index>(v2);
+    }
+
+    return extra == end && highest < vertexLimit;
+}
+
+#ifdef PIPELINE_SSE2
+
+// the edge table as byte shuffles: one picks the corners of the triangle that pushed the
+// edge, the other moves the third vertex from lane 0 into its corner. The result's lane 3
+// repeats corner 0 so every lane holds a real vertex. Per edge there's also the mask that
+// picks the triangle just decoded and how far back in the ring to look otherwise, so the
+// decoder doesn't work them out for every triangle.
+struct EdgeShuffleTable {
+    __m128i corners[16][4];
+    __m128i third[16][4];
+    __m128i newest[16];
+    uint32_t older[16];
+
+    EdgeShuffleTable() {
+        const EdgeDecodeTable& table = EdgeDecodes();
+        for (unsigned int edge = 0; edge < 16; edge++) {
+            unsigned int back = table.entries[edge][0].back;
+            newest[edge] = _mm_set1_epi32(-static_cast<int>(back == 0));
+            older[edge] = 1 + back + (back == 0);
+            for (unsigned int rotation = 0; rotation < 4; rotation++) {
+                const EdgeDecode& entry = table.entries[edge][rotation];
+                alignas(16) int8_t cornerBytes[16];
+                alignas(16) int8_t thirdBytes[16];
+                for (unsigned int lane = 0; lane < 4; lane++) {
+                    unsigned int source = entry.lanes[lane % 3];
+                    for (unsigned int b = 0; b < 4; b++) {
+                        // a set top bit zeroes the byte
+                        cornerBytes[lane * 4 + b] = static_cast<int8_t>(source == 3 ? -1 : source * 4 + b);
+                        thirdBytes[lane * 4 + b] = static_cast<int8_t>(source == 3 ? b : -1);
+                    }
+                }
+                corners[edge][rotation] = _mm_load_si128(reinterpret_cast<const __m128i*>(cornerBytes));
+                third[edge][rotation] = _mm_load_si128(reinterpret_cast<const __m128i*>(thirdBytes));
+            }
+        }
+    }
+};
+
+const EdgeShuffleTable& EdgeShuffles() {
+    static const EdgeShuffleTable table;
+    return table;
+}
+
+// corners 0 to 2 of triangle, the register stores write a fourth index past them that the
+// next triangle overwrites, so the last one goes out through here
+template <typename Index>
+inline void StoreTriangle(Index* target, __m128i triangle) {
+    alignas(16) uint32_t corners[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(corners), triangle);
+    target[0] = static_cast<Index>(corners[0]);
+    target[1] = static_cast<Index>(corners[1]);
+    target[2] = static_cast<Index>(corners[2]);
+}
+
+// the same walk with the triangle ring in registers: a triangle sharing an edge is one
+// shuffle of the triangle that pushed it, with the third vertex inserted, and the bounds of
+// every vertex are checked four lanes at a time
+template <typename Index>
+PIPELINE_TARGET("ssse3")
+bool DecodeTrianglesSsse3(Index* indices, size_t triangleCount, uint32_t vertexLimit, const uint8_t* rotations,
+    const uint8_t* codes, const uint8_t* extra, const uint8_t* end) {
+    if (vertexLimit == 0)
+        return triangleCount == 0 && extra == end;
+
+    const EdgeShuffleTable& table = EdgeShuffles();
+    DecodedVertices state;
+    ResetDecodedVertices(state);
+
+    __m128i ring[TriangleRing];
+    for (unsigned int i = 0; i < TriangleRing; i++)
+        ring[i] = _mm_set1_epi32(-1);
+
+    // unsigned compares as signed ones with the top bit flipped
+    const __m128i sign = _mm_set1_epi32(INT32_MIN);
+    const __m128i limit = _mm_set1_epi32(static_cast<int>((vertexLimit - 1) ^ 0x80000000u));
+    const __m128i pack16 = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+    __m128i outside = _mm_setzero_si128();
+    __m128i triangle = _mm_set1_epi32(-1);
+
+    for (size_t t = 0; t < triangleCount; t++) {
+        unsigned int code = codes[t];
+        unsigned int rotation = (rotations[t / 4] >> ((t % 4) * 2)) & 3;
+
+        if ((code >> 4) != NoEdge) {
+            uint32_t third;
+            if (!DecodeVertex(state, code & 15, extra, end, third))
+                return false;
+
+            // most edges come from the triangle just decoded, which is taken from its
+            // register rather than waiting for it to be stored and read back
+            __m128i older = ring[(t - table.older[code >> 4]) % TriangleRing];
+            __m128i newest = table.newest[code >> 4];
+            __m128i source = _mm_or_si128(_mm_and_si128(newest, triangle), _mm_andnot_si128(newest, older));
+
+            triangle = _mm_or_si128(_mm_shuffle_epi8(source, table.corners[code >> 4][rotation]),
+                _mm_shuffle_epi8(_mm_cvtsi32_si128(static_cast<int>(third)), table.third[code >> 4][rotation]));
+        }
+        else {
+            uint32_t v0, v1, v2;
+            if (extra == end)
+                return false;
+            unsigned int others = *extra++;
+            if (!DecodeVertex(state, code & 15, extra, end, v0) || !DecodeVertex(state, others >> 4, extra, end, v1) ||
+                !DecodeVertex(state, others & 15, extra, end, v2))
+                return false;
+            triangle = _mm_setr_epi32(static_cast<int>(v0), static_cast<int>(v1), static_cast<int>(v2), static_cast<int>(v0));
+        }
+
+        ring[t % TriangleRing] = triangle;
+        outside = _mm_or_si128(outside, _mm_cmpgt_epi32(_mm_xor_si128(triangle, sign), limit));
+
+        Index* target = indices + t * 3;
+        if (t + 1 == triangleCount)
+            StoreTriangle(target, triangle);
+        else if (sizeof(Index) == 2)
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(target), _mm_shuffle_epi8(triangle, pack16));
+        else
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(target), triangle);
+    }
+
+    return extra == end && _mm_movemask_epi8(outside) == 0;
+}
+
+#endif
+
+template <typename Index>
+bool DecodeTriangles(Index* indices, size_t triangleCount, uint32_t vertexLimit, const uint8_t* p, const uint8_t* end) {
+    if (static_cast<size_t>(end - p) < RotationBytes(triangleCount) + triangleCount)
+        return false;
+    const uint8_t* rotations = p;
+    const uint8_t* codes = rotations + RotationBytes(triangleCount);
+    const uint8_t* extra = codes + triangleCount;
+    if (!ValidRotations(rotations, triangleCount))
+        return false;
+
+#ifdef PIPELINE_SSE2
+    static const bool ssse3 = HasSsse3();
+    if (ssse3)
+        return DecodeTrianglesSsse3(indices, triangleCount, vertexLimit, rotations, codes, extra, end);
+#endif
+    return DecodeTrianglesScalar(indices, triangleCount, vertexLimit, rotations, codes, extra, end);
+}
+
+template <typename T>
+void Append(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void AppendBlock(std::vector<uint8_t>& out, const void* data, size_t size) {
+    Append(out, static_cast<uint64_t>(size));
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+class Reader {
+public:
+    Reader(const uint8_t* data, size_t size) : _p(data), _end(data + size) {}
+
+    template <typename T>
+    bool Read(T& value) {
+        if (static_cast<size_t>(_end - _p) < sizeof(T))
+            return false;
+        std::memcpy(&value, _p, sizeof(T));
+        _p += sizeof(T);
+        return true;
+    }
+
+    bool ReadBlock(const uint8_t*& data, size_t& size) {
+        uint64_t blockSize;
+        if (!Read(blockSize) || blockSize > static_cast<uint64_t>(_end - _p))
+            return false;
+        data = _p;
+        size = static_cast<size_t>(blockSize);
+        _p += size;
+        return true;
+    }
+
+    bool AtEnd() const { return _p == _end; }
+
+private:
+    const uint8_t* _p;
+    const uint8_t* _end;
+};
+
+// how a mesh's packed indices are stored
+enum class PackedIndices : uint8_t {
+    None,
+    // decoded from the index stream in indexFormat
+    Coded,
+    Raw
+};
+
+struct MeshHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numberOfVertices;
+    uint32_t numberOfIndices;
+    uint64_t vertexCount;
+    uint64_t triangleCount;
+    uint64_t lodCount;
+    uint64_t meshletCount;
+    uint64_t packedVertexBytes;
+    uint32_t packedVertexSize;
+    VertexFormat format;
+    IndexFormat indexFormat;
+    PackedIndices packedIndices;
+    Bounds bounds;
+    Dequantization dequantization;
+};
+
+}
+
+std::vector<uint8_t> EncodeVertexBuffer(const uint8_t* vertices, size_t vertexCount, size_t vertexSize) {
+    std::vector<uint8_t> out;
+    if (vertexSize == 0 || vertexSize > MaxCodecVertexSize)
+        return out;
+
+    size_t groups = (vertexCount + VertexCodecGroupSize - 1) / VertexCodecGroupSize;
+    out.reserve(1 + groups * (GroupHeaderSize(vertexSize) + vertexSize * VertexCodecGroupSize / 2));
+    out.push_back(VertexCodecVersion);
+
+    uint8_t previous[MaxCodecVertexSize] = {};
+    uint8_t group[MaxCodecVertexSize * VertexCodecGroupSize];
+
+    for (size_t first = 0; first < vertexCount; first += VertexCodecGroupSize) {
+        size_t count = std::min(VertexCodecGroupSize, vertexCount - first);
+        std::memcpy(group, vertices + first * vertexSize, count * vertexSize);
+
+        // pad the last group with copies of its last vertex, which cost nothing to store
+        for (size_t i = count; i < VertexCodecGroupSize; i++)
+            std::memcpy(group + i * vertexSize, group + (count - 1) * vertexSize, vertexSize);
+
+        EncodeVertexGroup(group, previous, vertexSize, out);
+        std::memcpy(previous, group + (VertexCodecGroupSize - 1) * vertexSize, vertexSize);
+    }
+
+    return out;
+}
+
+bool DecodeVertexBuffer(uint8_t* vertices, size_t vertexCount, size_t vertexSize, const uint8_t* data, size_t size) {
+    if (vertexSize == 0 || vertexSize > MaxCodecVertexSize || size == 0 || data[0] != VertexCodecVersion)
+        return false;
+
+    const uint8_t* p = data + 1;
+    const uint8_t* end = data + size;
+    size_t headerSize = GroupHeaderSize(vertexSize);
+
+    alignas(16) uint8_t lanes[MaxCodecVertexSize][VertexCodecGroupSize];
+#ifdef PIPELINE_SSE2
+    __m128i carries[MaxCodecVertexSize];
+    for (size_t lane = 0; lane < vertexSize; lane++)
+        carries[lane] = _mm_setzero_si128();
+#else
+    uint8_t previous[MaxCodecVertexSize] = {};
+#endif
+    uint8_t tail[MaxCodecVertexSize * VertexCodecGroupSize];
+
+    for (size_t first = 0; first < vertexCount; first += VertexCodecGroupSize) {
+        if (static_cast<size_t>(end - p) < headerSize)
+            return false;
+        const uint8_t* header = p;
+        p += headerSize;
+
+        for (size_t lane = 0; lane < vertexSize; lane++) {
+            unsigned int mode = (header[lane / 4] >> ((lane % 4) * 2)) & 3;
+            size_t bytes = LaneBits[mode] * VertexCodecGroupSize / 8;
+            if (static_cast<size_t>(end - p) < bytes)
+                return false;
+
+#ifdef PIPELINE_SSE2
+            DecodeLane(p, mode, carries[lane], lanes[lane]);
+#else
+            DecodeLaneScalar(p, mode, previous[lane], lanes[lane]);
+#endif
+            p += bytes;
+        }
+
+        size_t count = std::min(VertexCodecGroupSize, vertexCount - first);
+        if (count == VertexCodecGroupSize) {
+            TransposeLanes(lanes, vertexSize, vertices + first * vertexSize);
+        }
+        else {
+            TransposeLanes(lanes, vertexSize, tail);
+            std::memcpy(vertices + first * vertexSize, tail, count * vertexSize);
+        }
+    }
+
+    return p == end;
+}
+
+std::vector<uint8_t> EncodeIndexBuffer(const DirectX::XMUINT3* triangles, size_t triangleCount) {
+    size_t codes = 1 + RotationBytes(triangleCount);
+    std::vector<uint8_t> out(codes + triangleCount, 0);
+    out[0] = IndexCodecVersion;
+
+    std::vector<uint8_t> extra;
+    extra.reserve(triangleCount / 2);
+
+    IndexCoder coder;
+    for (size_t t = 0; t < triangleCount; t++) {
+        const uint32_t v[3] = { triangles[t].x, triangles[t].y, triangles[t].z };
+
+        // the most recent shared edge over all three rotations
+        int edge = -1;
+        unsigned int rotation = 0;
+        for (unsigned int r = 0; r < 3; r++) {
+            int found = coder.edges.Find(v[r], v[(r + 1) % 3]);
+            if (found >= 0 && (edge < 0 || found < edge)) {
+                edge = found;
+                rotation = r;
+            }
+        }
+        out[1 + t / 4] |= static_cast<uint8_t>(rotation << ((t % 4) * 2));
+
+        if (edge < 0) {
+            VertexCode a = EncodeVertex(coder, v[0]);
+            VertexCode b = EncodeVertex(coder, v[1]);
+            VertexCode c = EncodeVertex(coder, v[2]);
+            out[codes + t] = static_cast<uint8_t>((NoEdge << 4) | a.code);
+            extra.push_back(static_cast<uint8_t>((b.code << 4) | c.code));
+            WriteDelta(extra, a);
+            WriteDelta(extra, b);
+            WriteDelta(extra, c);
+        }
+        else {
+            VertexCode third = EncodeVertex(coder, v[(rotation + 2) % 3]);
+            out[codes + t] = static_cast<uint8_t>((edge << 4) | third.code);
+            WriteDelta(extra, third);
+        }
+
+        coder.PushTriangle(v[0], v[1], v[2]);
+    }
+
+    out.insert(out.end(), extra.begin(), extra.end());
+    return out;
+}
+
+bool DecodeIndexBuffer(uint8_t* indices, size_t triangleCount, IndexFormat format, size_t vertexCount,
+    const uint8_t* data, size_t size) {
+    if (!IsValidIndexFormat(format) || size == 0 || data[0] != IndexCodecVersion)
+        return false;
+
+    uint64_t formatLimit = format == IndexFormat::Uint16 ? ShortIndexVertexLimit : UINT32_MAX;
+    uint32_t vertexLimit = static_cast<uint32_t>(std::min<uint64_t>(vertexCount, formatLimit));
+
+    const uint8_t* p = data + 1;
+    const uint8_t* end = data + size;
+    if (format == IndexFormat::Uint16)
+        return DecodeTriangles(reinterpret_cast<uint16_t*>(indices), triangleCount, vertexLimit, p, end);
+    return DecodeTriangles(reinterpret_cast<uint32_t*>(indices), triangleCount, vertexLimit, p, end);
+}
+
+std::vector<uint8_t> EncodeMesh(const Mesh& mesh) {
+    MeshHeader header = {};
+    header.magic = MeshCodecMagic;
+    header.version = MeshCodecVersion;
+    header.numberOfVertices = mesh.numberOfVertices;
+    header.numberOfIndices = mesh.numberOfIndices;
+    header.vertexCount = mesh.vertices.size();
+    header.triangleCount = mesh.indices.size();
+    header.lodCount = mesh.lods.size();
+    header.meshletCount = mesh.meshlets.size();
+    header.packedVertexBytes = mesh.packedVertices.size();
+    header.format = mesh.format;
+    header.indexFormat = mesh.indexFormat;
+    header.bounds = mesh.bounds;
+    header.dequantization = mesh.dequantization;
+
+    // packed vertices transpose best at their real stride, anything odd goes byte by byte
+    header.packedVertexSize = 1;
+    if (IsValidFormat(mesh.format) && mesh.packedVertices.size() % VertexStride(mesh.format) == 0)
+        header.packedVertexSize = VertexStride(mesh.format);
+
+    // packed indices are the index stream again in a smaller format, unless they are
+    // something PackIndices wouldn't have written
+    header.packedIndices = mesh.packedIndices.empty() ? PackedIndices::None : PackedIndices::Raw;
+    if (IsValidIndexFormat(mesh.indexFormat) && !mesh.packedIndices.empty() &&
+        mesh.packedIndices.size() == mesh.indices.size() * 3 * IndexSize(mesh.indexFormat) &&
+        (mesh.indexFormat == IndexFormat::Uint32 || mesh.vertices.size() <= ShortIndexVertexLimit))
+        header.packedIndices = PackedIndices::Coded;
+
+    std::vector<uint8_t> out;
+    Append(out, header);
+
+    std::vector<uint8_t> block = EncodeVertexBuffer(reinterpret_cast<const uint8_t*>(mesh.vertices.data()), mesh.vertices.size(), sizeof(Vertex));
+    AppendBlock(out, block.data(), block.size());
+    block = EncodeIndexBuffer(mesh.indices.data(), mesh.indices.size());
+    AppendBlock(out, block.data(), block.size());
+    block = EncodeVertexBuffer(mesh.packedVertices.data(), mesh.packedVertices.size() / header.packedVertexSize, header.packedVertexSize);
+    AppendBlock(out, block.data(), block.size());
+    if (header.packedIndices == PackedIndices::Raw)
+        AppendBlock(out, mesh.packedIndices.data(), mesh.packedIndices.size());
+    AppendBlock(out, mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod));
+    AppendBlock(out, mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet));
+    return out;
+}
+
+bool DecodeMesh(const uint8_t* data, size_t size, Mesh& mesh) {
+    Reader reader(data, size);
+    MeshHeader header;
+    if (!reader.Read(header) || header.magic != MeshCodecMagic || header.version != MeshCodecVersion ||
+        header.packedVertexSize == 0 || header.packedVertexBytes % header.packedVertexSize != 0)
+        return false;
+
+    const uint8_t* vertexBlock;
+    const uint8_t* indexBlock;
+    const uint8_t* packedVertexBlock;
+    const uint8_t* packedIndexBlock = nullptr;
+    const uint8_t* lodBlock;
+    const uint8_t* meshletBlock;
+    size_t vertexSize, indexSize, packedVertexSize, packedIndexSize = 0, lodSize, meshletSize;
+
+    if (!reader.ReadBlock(vertexBlock, vertexSize) ||
+        !reader.ReadBlock(indexBlock, indexSize) ||
+        !reader.ReadBlock(packedVertexBlock, packedVertexSize) ||
+        (header.packedIndices == PackedIndices::Raw && !reader.ReadBlock(packedIndexBlock, packedIndexSize)) ||
+        !reader.ReadBlock(lodBlock, lodSize) ||
+        !reader.ReadBlock(meshletBlock, meshletSize) ||
+        !reader.AtEnd())
+        return false;
+
+    // coded streams take at least a byte per group of vertices or per triangle, which
+    // bounds the allocations below by the size of the data
+    if (header.vertexCount > vertexSize * VertexCodecGroupSize || header.triangleCount > indexSize ||
+        header.packedVertexBytes / header.packedVertexSize > packedVertexSize * VertexCodecGroupSize ||
+        lodSize != header.lodCount * sizeof(MeshLod) || meshletSize != header.meshletCount * sizeof(Meshlet))
+        return false;
+
+    Mesh decoded;
+    decoded.vertices.resize(static_cast<size_t>(header.vertexCount));
+    decoded.indices.resize(static_cast<size_t>(header.triangleCount));
+    decoded.packedVertices.resize(static_cast<size_t>(header.packedVertexBytes));
+
+    if (!DecodeVertexBuffer(reinterpret_cast<uint8_t*>(decoded.vertices.data()), decoded.vertices.size(), sizeof(Vertex), vertexBlock, vertexSize) ||
+        !DecodeIndexBuffer(reinterpret_cast<uint8_t*>(decoded.indices.data()), decoded.indices.size(), IndexFormat::Uint32, decoded.vertices.size(), indexBlock, indexSize) ||
+        !DecodeVertexBuffer(decoded.packedVertices.data(), decoded.packedVertices.size() / header.packedVertexSize, header.packedVertexSize, packedVertexBlock, packedVertexSize))
+        return false;
+
+    if (header.packedIndices == PackedIndices::Coded) {
+        if (!IsValidIndexFormat(header.indexFormat))
+            return false;
+        decoded.packedIndices.resize(decoded.indices.size() * 3 * IndexSize(header.indexFormat));
+        if (!DecodeIndexBuffer(decoded.packedIndices.data(), decoded.indices.size(), header.indexFormat, decoded.vertices.size(), indexBlock, indexSize))
+            return false;
+    }
+    else if (header.packedIndices == PackedIndices::Raw) {
+        decoded.packedIndices.assign(packedIndexBlock, packedIndexBlock + packedIndexSize);
+    }
+
+    decoded.lods.resize(static_cast<size_t>(header.lodCount));
+    if (lodSize)
+        std::memcpy(decoded.lods.data(), lodBlock, lodSize);
+    decoded.meshlets.resize(static_cast<size_t>(header.meshletCount));
+    if (meshletSize)
+        std::memcpy(decoded.meshlets.data(), meshletBlock, meshletSize);
+
+    decoded.bounds = header.bounds;
+    decoded.format = header.format;
+    decoded.indexFormat = header.indexFormat;
+    decoded.dequantization = header.dequantization;
+    decoded.numberOfVertices = header.numberOfVertices;
+    decoded.numberOfIndices = header.numberOfIndices;
+
+    mesh = std::move(decoded);
+    return true;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "../Dx11App/types.h"
+
+namespace pipeline {
+
+// vertex streams are split into groups of 32 vertices. Within a group every byte of the
+// vertex becomes its own lane of 32 deltas against the previous vertex, biased and stored
+// in 0, 2, 4 or 8 bits each, whichever is the smallest that fits the lane.
+constexpr size_t VertexCodecGroupSize = 32;
+constexpr size_t MaxCodecVertexSize = 256;
+
+std::vector<uint8_t> EncodeVertexBuffer(const uint8_t* vertices, size_t vertexCount, size_t vertexSize);
+// fails on data that doesn't decode to exactly vertexCount vertices
+bool DecodeVertexBuffer(uint8_t* vertices, size_t vertexCount, size_t vertexSize, const uint8_t* data, size_t size);
+
+// triangles are coded against a fifo of recent edges: one that shares an edge with an earlier
+// triangle costs a byte naming the edge and the rotation, plus however the third vertex is
+// coded, which in vertex cache order is mostly the next unused vertex or a recent one.
+std::vector<uint8_t> EncodeIndexBuffer(const DirectX::XMUINT3* triangles, size_t triangleCount);
+// writes triangleCount * 3 indices in format, failing on data that doesn't decode exactly or
+// references a vertex past vertexCount
+bool DecodeIndexBuffer(uint8_t* indices, size_t triangleCount, IndexFormat format, size_t vertexCount,
+    const uint8_t* data, size_t size);
+
+// the whole mesh, full precision vertices and packed buffers included, such that DecodeMesh
+// gives back an identical Mesh
+std::vector<uint8_t> EncodeMesh(const Mesh& mesh);
+bool DecodeMesh(const uint8_t* data, size_t size, Mesh& mesh);
+
+}
\ No newline at end of file
@@ -0,0 +1,284 @@
+#include "GeometryLibrary.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "AssetLoader.h"
+#include "Hash.h"
+#include "IndexBuffer.h"
+#include "VertexFormat.h"
+
+namespace pipeline {
+
+namespace {
+
+// indices are hashed this many at a time, widened to 32 bit when stored narrower
+constexpr size_t IndexChunk = 4096;
+
+uint32_t IndexAt(const MeshView& mesh, size_t i) {
+    if (mesh.indexFormat == IndexFormat::Uint16)
+        return reinterpret_cast<const uint16_t*>(mesh.indices)[i];
+    return reinterpret_cast<const uint32_t*>(mesh.indices)[i];
+}
+
+size_t VertexBytes(const MeshView& mesh) {
+    return size_t(mesh.numberOfVertices) * VertexStride(mesh.format);
+}
+
+size_t IndexBytes(const MeshView& mesh) {
+    return size_t(mesh.numberOfIndices) * IndexSize(mesh.indexFormat);
+}
+
+}
+
+uint64_t MeshContentHash(const MeshView& mesh) {
+    uint64_t hash = Hash64(mesh.vertices, VertexBytes(mesh));
+
+    // chained chunk by chunk so both widths of the same indices hash the same
+    uint32_t widened[IndexChunk];
+    for (size_t first = 0; first < mesh.numberOfIndices; first += IndexChunk) {
+        size_t count = std::min<size_t>(IndexChunk, mesh.numberOfIndices - first);
+        const uint32_t* chunk = widened;
+        if (mesh.indexFormat == IndexFormat::Uint32)
+            chunk = reinterpret_cast<const uint32_t*>(mesh.indices) + first;
+        else {
+            for (size_t i = 0; i < count; i++)
+                widened[i] = IndexAt(mesh, first + i);
+        }
+        hash = Hash64(chunk, count * sizeof(uint32_t), hash);
+    }
+
+    hash = HashCombine(hash, static_cast<uint64_t>(mesh.format.position));
+    hash = HashCombine(hash, mesh.numberOfVertices);
+    hash = HashCombine(hash, mesh.numberOfIndices);
+    hash = Hash64(&mesh.bounds, sizeof(mesh.bounds), hash);
+    hash = Hash64(&mesh.dequantization, sizeof(mesh.dequantization), hash);
+    hash = Hash64(mesh.lods, mesh.numberOfLods * sizeof(MeshLod), hash);
+    hash = Hash64(mesh.meshlets, mesh.numberOfMeshlets * sizeof(Meshlet), hash);
+    return hash;
+}
+
+bool SameContent(const MeshView& a, const MeshView& b) {
+    if (a.format.position != b.format.position || a.numberOfVertices != b.numberOfVertices || a.numberOfIndices != b.numberOfIndices ||
+        a.numberOfLods != b.numberOfLods || a.numberOfMeshlets != b.numberOfMeshlets)
+        return false;
+
+    if (std::memcmp(&a.bounds, &b.bounds, sizeof(a.bounds)) != 0 ||
+        std::memcmp(&a.dequantization, &b.dequantization, sizeof(a.dequantization)) != 0 ||
+        std::memcmp(a.vertices, b.vertices, VertexBytes(a)) != 0)
+        return false;
+
+    if (a.numberOfLods > 0 && std::memcmp(a.lods, b.lods, a.numberOfLods * sizeof(MeshLod)) != 0)
+        return false;
+    if (a.numberOfMeshlets > 0 && std::memcmp(a.meshlets, b.meshlets, a.numberOfMeshlets * sizeof(Meshlet)) != 0)
+        return false;
+
+    if (a.indexFormat == b.indexFormat)
+        return std::memcmp(a.indices, b.indices, IndexBytes(a)) == 0;
+
+    for (size_t i = 0; i < a.numberOfIndices; i++) {
+        if (IndexAt(a, i) != IndexAt(b, i))
+            return false;
+    }
+    return true;
+}
+
+bool GeometryLibrary::Add(ModelData& model, std::vector<MeshId>& ids, std::string& error) {
+    ids.clear();
+    ids.reserve(model.views.size());
+
+    // the staging block goes to the library only if some mesh of it is new, and back to the
+    // model if a later one fails
+    std::shared_ptr<SceneBuffers> storage;
+    auto fail = [&](const char* message) {
+        error = message;
+        Release(ids);
+        ids.clear();
+        if (storage)
+            model.scene = std::move(*storage);
+        return false;
+    };
+
+    for (size_t i = 0; i < model.views.size(); i++) {
+        const MeshView& view = model.views[i];
+        // worked out on the loader's thread, older callers leave it to here
+        uint64_t hash = model.hashes.size() == model.views.size() ? model.hashes[i] : MeshContentHash(view);
+
+        MeshId id = InvalidMesh;
+        auto range = _byHash.equal_range(hash);
+        for (auto it = range.first; it != range.second && id == InvalidMesh; ++it) {
+            if (SameContent(_entries[it->second].view, view))
+                id = it->second;
+        }
+
+        if (id == InvalidMesh) {
+            if (_live > 0 && view.format.position != _format.position)
+                return fail("Meshes of a scene must share a vertex format");
+
+            // baseVertex is signed, indices are counted in 32 bits
+            SubmeshRange placed = { 0, view.numberOfIndices, 0, view.indexFormat };
+            size_t format = size_t(view.indexFormat);
+            uint32_t baseVertex = 0;
+            if (!allocateSpan(_vertexHoles, _vertexEnd, std::numeric_limits<int32_t>::max(), view.numberOfVertices, baseVertex))
+                return fail("Scene is too large for one vertex buffer");
+            if (!allocateSpan(_indexHoles[format], _indexEnd[format], std::numeric_limits<uint32_t>::max(), view.numberOfIndices,
+                placed.firstIndex)) {
+                releaseSpan(_vertexHoles, _vertexEnd, { baseVertex, view.numberOfVertices });
+                return fail("Scene is too large for one index buffer");
+            }
+            placed.baseVertex = static_cast<int32_t>(baseVertex);
+
+            if (!storage)
+                storage = std::make_shared<SceneBuffers>(std::move(model.scene));
+
+            if (_free.empty()) {
+                id = static_cast<MeshId>(_entries.size());
+                _entries.emplace_back();
+            }
+            else {
+                id = _free.back();
+                _free.pop_back();
+            }
+
+            if (_live++ == 0)
+                _format = view.format;
+
+            Entry& entry = _entries[id];
+            entry.hash = hash;
+            entry.view = view;
+            entry.range = placed;
+            entry.storage = storage;
+            _byHash.emplace(hash, id);
+            _added.push_back(id);
+        }
+
+        _entries[id].uses++;
+        ids.push_back(id);
+    }
+
+    model.scene = SceneBuffers();
+    return true;
+}
+
+void GeometryLibrary::Release(const std::vector<MeshId>& ids) {
+    for (MeshId id : ids) {
+        Entry& entry = _entries[id];
+        if (--entry.uses > 0)
+            continue;
+
+        auto range = _byHash.equal_range(entry.hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == id) {
+                _byHash.erase(it);
+                break;
+            }
+        }
+
+        releaseSpan(_vertexHoles, _vertexEnd, { static_cast<uint32_t>(entry.range.baseVertex), entry.view.numberOfVertices });
+        size_t format = size_t(entry.range.indexFormat);
+        releaseSpan(_indexHoles[format], _indexEnd[format], { entry.range.firstIndex, entry.range.numberOfIndices });
+        _live--;
+
+        entry = Entry();
+        _free.push_back(id);
+    }
+}
+
+std::vector<GeometryLibrary::MeshId> GeometryLibrary::LiveMeshes() const {
+    std::vector<MeshId> live;
+    for (size_t id = 0; id < _entries.size(); id++) {
+        if (_entries[id].uses > 0)
+            live.push_back(static_cast<MeshId>(id));
+    }
+    return live;
+}
+
+std::vector<GeometryLibrary::MeshId> GeometryLibrary::TakeAdded() {
+    std::vector<MeshId> added;
+    added.swap(_added);
+
+    // released again before anyone asked, or released and handed out to another mesh, which
+    // is then listed twice
+    std::sort(added.begin(), added.end());
+    added.erase(std::unique(added.begin(), added.end()), added.end());
+    added.erase(std::remove_if(added.begin(), added.end(), [this](MeshId id) { return _entries[id].uses == 0; }), added.end());
+    return added;
+}
+
+GeometryStats GeometryLibrary::Stats(const std::vector<MeshId>& uses) const {
+    std::vector<uint32_t> counts(_entries.size(), 0);
+    for (MeshId id : uses)
+        counts[id]++;
+
+    GeometryStats stats;
+    for (size_t id = 0; id < _entries.size(); id++) {
+        if (counts[id] == 0)
+            continue;
+
+        const MeshView& view = _entries[id].view;
+        uint64_t gpuBytes = VertexBytes(view) + IndexBytes(view);
+        uint64_t cpuBytes = gpuBytes + view.numberOfLods * sizeof(MeshLod) + view.numberOfMeshlets * sizeof(Meshlet);
+
+        stats.uses += counts[id];
+        stats.meshes++;
+        stats.gpuBytes += gpuBytes;
+        stats.gpuBytesSaved += gpuBytes * (counts[id] - 1);
+        stats.cpuBytes += cpuBytes;
+        stats.cpuBytesSaved += cpuBytes * (counts[id] - 1);
+    }
+    return stats;
+}
+
+bool GeometryLibrary::allocateSpan(std::vector<Span>& holes, uint32_t& end, uint64_t limit, uint32_t count, uint32_t& first) {
+    if (count == 0) {
+        first = 0;
+        return true;
+    }
+
+    for (auto hole = holes.begin(); hole != holes.end(); ++hole) {
+        if (hole->count < count)
+            continue;
+
+        first = hole->first;
+        hole->first += count;
+        hole->count -= count;
+        if (hole->count == 0)
+            holes.erase(hole);
+        return true;
+    }
+
+    if (uint64_t(end) + count > limit)
+        return false;
+    first = end;
+    end += count;
+    return true;
+}
+
+void GeometryLibrary::releaseSpan(std::vector<Span>& holes, uint32_t& end, Span span) {
+    if (span.count == 0)
+        return;
+
+    auto next = std::lower_bound(holes.begin(), holes.end(), span.first, [](const Span& hole, uint32_t first) {
+        return hole.first < first;
+    });
+    if (next != holes.end() && span.first + span.count == next->first) {
+        span.count += next->count;
+        next = holes.erase(next);
+    }
+    if (next != holes.begin() && (next - 1)->first + (next - 1)->count == span.first) {
+        --next;
+        span.first = next->first;
+        span.count += next->count;
+        next = holes.erase(next);
+    }
+
+    // the last range in use shrinks the buffers back rather than leaving a hole at the end
+    if (span.first + span.count == end) {
+        end = span.first;
+        return;
+    }
+    holes.insert(next, span);
+}
+
+}
\ No newline at end of file
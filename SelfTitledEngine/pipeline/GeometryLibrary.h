@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../Dx11App/types.h"
+#include "SceneBuffers.h"
+
+namespace pipeline {
+
+struct ModelData;
+
+// hash of a mesh as it is drawn: packed vertices, indices read as 32 bit whatever width they
+// are stored at, formats, dequantization, lods and meshlets
+uint64_t MeshContentHash(const MeshView& mesh);
+
+// whether two meshes draw the same, the byte compare behind a content hash match
+bool SameContent(const MeshView& a, const MeshView& b);
+
+// what the geometry of a scene takes with every distinct mesh stored once, and what storing
+// every use on its own would have taken on top. gpu bytes are packed vertices and indices,
+// cpu bytes add the lods and meshlets.
+struct GeometryStats {
+    size_t uses = 0;
+    size_t meshes = 0;
+    uint64_t gpuBytes = 0;
+    uint64_t gpuBytesSaved = 0;
+    uint64_t cpuBytes = 0;
+    uint64_t cpuBytesSaved = 0;
+};
+
+// the meshes of every model in a scene, identical geometry kept once whichever file it came
+// from. A mesh whose content hash and bytes match one already here becomes another use of
+// it, so it is uploaded once and drawn as an instance. Ids stay valid until the last use of
+// a mesh is released.
+//
+// Every mesh also gets a range of the scene's shared vertex buffer, and of the shared index
+// buffer of its own index format, that stays put while it lives, so a load or reload only
+// uploads the meshes it added. A released mesh's ranges go to the next ones that fit.
+class GeometryLibrary {
+public:
+    using MeshId = uint32_t;
+    static const MeshId InvalidMesh = UINT32_MAX;
+
+    GeometryLibrary() = default;
+    GeometryLibrary(const GeometryLibrary&) = delete;
+    GeometryLibrary& operator=(const GeometryLibrary&) = delete;
+
+    // adds the meshes of model not here yet. ids gets the library mesh of every mesh of the
+    // model, in order; each counts as one use. The meshes added keep pointing into the
+    // model's staging block, which the library takes over, leaving model.scene empty; it is
+    // freed with the last of them. Adds nothing when it fails.
+    bool Add(ModelData& model, std::vector<MeshId>& ids, std::string& error);
+    // one use of each, what Add handed out
+    void Release(const std::vector<MeshId>& ids);
+
+    // points into the staging block of the model the mesh came from
+    const MeshView& View(MeshId id) const { return _entries[id].view; }
+    // where the mesh sits in the shared buffers, baseVertex in elements of Format and
+    // firstIndex in elements of the range's indexFormat
+    const SubmeshRange& Range(MeshId id) const { return _entries[id].range; }
+    // meshes with uses left, by id
+    std::vector<MeshId> LiveMeshes() const;
+    // meshes added since the last call that still have uses, the ranges to upload
+    std::vector<MeshId> TakeAdded();
+    // drawing every mesh in uses, ids repeating for every instance
+    GeometryStats Stats(const std::vector<MeshId>& uses) const;
+
+    // the format every mesh here shares
+    const VertexFormat& Format() const { return _format; }
+    // what the shared buffers need room for, in vertices and indices of format, holes included
+    uint32_t VertexExtent() const { return _vertexEnd; }
+    uint32_t IndexExtent(IndexFormat format) const { return _indexEnd[size_t(format)]; }
+
+private:
+    // a run of vertices or indices in the shared buffers
+    struct Span {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    struct Entry {
+        uint64_t hash = 0;
+        uint32_t uses = 0;
+        MeshView view = {};
+        SubmeshRange range = {};
+        // what view points into, shared with the other meshes of the same load
+        std::shared_ptr<const SceneBuffers> storage;
+    };
+
+private:
+    // first fit among the holes, else past end as long as it stays under limit
+    static bool allocateSpan(std::vector<Span>& holes, uint32_t& end, uint64_t limit, uint32_t count, uint32_t& first);
+    // back into the holes, merged with its neighbours, or off end if it was last
+    static void releaseSpan(std::vector<Span>& holes, uint32_t& end, Span span);
+
+private:
+    std::vector<Entry> _entries;
+    std::unordered_multimap<uint64_t, MeshId> _byHash;
+    // released entries, reused before the vector grows
+    std::vector<MeshId> _free;
+    std::vector<MeshId> _added;
+    size_t _live = 0;
+
+    VertexFormat _format;
+    // ranges released meshes left, sorted by first, and where the used part ends. One index
+    // buffer per format.
+    std::vector<Span> _vertexHoles;
+    std::vector<Span> _indexHoles[IndexFormatCount];
+    uint32_t _vertexEnd = 0;
+    uint32_t _indexEnd[IndexFormatCount] = {};
+};
+
+}
\ No newline at end of file
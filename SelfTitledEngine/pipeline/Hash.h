@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pipeline {
+
+// XXH64 of the bytes, fast enough to hash whole source assets at memory bandwidth
+uint64_t Hash64(const void* data, size_t size, uint64_t seed = 0);
+
+// folds value into an existing hash, for keys built out of several parts
+uint64_t HashCombine(uint64_t hash, uint64_t value);
+
+}
\ No newline at end of file
@@ -0,0 +1,161 @@
+#include "Image.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "PackFile.h"
+
+namespace pipeline {
+
+namespace {
+
+// the TGA header, read field by field since it isn't aligned
+struct TgaHeader {
+    uint8_t idLength;
+    uint8_t colorMapType;
+    uint8_t imageType;
+    uint16_t colorMapLength;
+    uint8_t colorMapEntryBits;
+    uint16_t width;
+    uint16_t height;
+    uint8_t bitsPerPixel;
+    uint8_t descriptor;
+};
+
+constexpr size_t TgaHeaderSize = 18;
+
+uint16_t ReadUint16(const uint8_t* data) {
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+// one TGA pixel, stored bgr(a) or gray, as rgba
+void ToRgba(const uint8_t* pixel, uint32_t bytesPerPixel, uint8_t* rgba) {
+    if (bytesPerPixel == 1) {
+        rgba[0] = rgba[1] = rgba[2] = pixel[0];
+        rgba[3] = 255;
+        return;
+    }
+
+    rgba[0] = pixel[2];
+    rgba[1] = pixel[1];
+    rgba[2] = pixel[0];
+    rgba[3] = bytesPerPixel == 4 ? pixel[3] : 255;
+}
+
+bool ReadTga(const uint8_t* data, size_t size, Image& image, std::string& error) {
+    if (size < TgaHeaderSize) {
+        error = "file is too small to be a TGA";
+        return false;
+    }
+
+    TgaHeader header;
+    header.idLength = data[0];
+    header.colorMapType = data[1];
+    header.imageType = data[2];
+    header.colorMapLength = ReadUint16(data + 5);
+    header.colorMapEntryBits = data[7];
+    header.width = ReadUint16(data + 12);
+    header.height = ReadUint16(data + 14);
+    header.bitsPerPixel = data[16];
+    header.descriptor = data[17];
+
+    // 2 true color, 3 grayscale, 10 and 11 the same run length encoded
+    bool encoded = header.imageType == 10 || header.imageType == 11;
+    bool gray = header.imageType == 3 || header.imageType == 11;
+    if (header.imageType != 2 && header.imageType != 3 && !encoded) {
+        error = "unsupported TGA type " + std::to_string(header.imageType) + ", only true color and grayscale are read";
+        return false;
+    }
+    if ((gray && header.bitsPerPixel != 8) || (!gray && header.bitsPerPixel != 24 && header.bitsPerPixel != 32)) {
+        error = "unsupported TGA depth of " + std::to_string(header.bitsPerPixel) + " bits";
+        return false;
+    }
+    if (header.width == 0 || header.height == 0) {
+        error = "TGA has no pixels";
+        return false;
+    }
+
+    size_t offset = TgaHeaderSize + header.idLength;
+    if (header.colorMapType == 1)
+        offset += size_t(header.colorMapLength) * ((header.colorMapEntryBits + 7) / 8);
+
+    uint32_t bytesPerPixel = header.bitsPerPixel / 8;
+    size_t pixelCount = size_t(header.width) * header.height;
+    image.width = header.width;
+    image.height = header.height;
+    image.rgba.resize(pixelCount * 4);
+
+    // decoded in file order, flipped to top down below
+    size_t pixel = 0;
+    while (pixel < pixelCount) {
+        size_t count = 1;
+        bool repeat = false;
+        if (encoded) {
+            if (offset >= size)
+                break;
+            uint8_t packet = data[offset++];
+            count = (packet & 0x7f) + 1;
+            repeat = (packet & 0x80) != 0;
+        }
+        else
+            count = pixelCount;
+
+        size_t stored = repeat ? 1 : count;
+        if (pixel + count > pixelCount || offset > size || stored * bytesPerPixel > size - offset)
+            break;
+
+        for (size_t i = 0; i < count; i++)
+            ToRgba(data + offset + (repeat ? 0 : i * bytesPerPixel), bytesPerPixel, image.rgba.data() + (pixel + i) * 4);
+
+        offset += stored * bytesPerPixel;
+        pixel += count;
+    }
+    if (pixel < pixelCount) {
+        error = "TGA pixel data is truncated";
+        return false;
+    }
+
+    // bit 5 set means the first row is the top, bit 4 the first column the right
+    bool bottomUp = (header.descriptor & 0x20) == 0;
+    bool rightToLeft = (header.descriptor & 0x10) != 0;
+    size_t rowBytes = size_t(image.width) * 4;
+    if (bottomUp) {
+        std::vector<uint8_t> row(rowBytes);
+        for (uint32_t y = 0; y < image.height / 2; y++) {
+            uint8_t* top = image.rgba.data() + y * rowBytes;
+            uint8_t* bottom = image.rgba.data() + (image.height - 1 - y) * rowBytes;
+            std::memcpy(row.data(), top, rowBytes);
+            std::memcpy(top, bottom, rowBytes);
+            std::memcpy(bottom, row.data(), rowBytes);
+        }
+    }
+    if (rightToLeft) {
+        for (uint32_t y = 0; y < image.height; y++) {
+            uint32_t* row = reinterpret_cast<uint32_t*>(image.rgba.data() + y * rowBytes);
+            for (uint32_t x = 0; x < image.width / 2; x++)
+                std::swap(row[x], row[image.width - 1 - x]);
+        }
+    }
+
+    return true;
+}
+
+}
+
+bool ReadImage(const std::string& filePath, Image& image, std::string& error) {
+    AssetFile file;
+    if (!file.Open(filePath)) {
+        error = "Failed to open image file " + filePath;
+        return false;
+    }
+
+    std::string reason;
+    if (!ReadTga(file.Data(), file.Size(), image, reason)) {
+        error = "Failed to read " + filePath + ": " + reason;
+        image = Image();
+        return false;
+    }
+    return true;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pipeline {
+
+// uncompressed texels, rgba8 rows top to bottom with no padding
+struct Image {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> rgba;
+};
+
+// reads a TGA, true color, grayscale or their run length encoded forms at 8, 24 or 32 bits.
+// Files in a mounted pack are read from the pack. Missing channels fill in as gray and opaque.
+bool ReadImage(const std::string& filePath, Image& image, std::string& error);
+
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include "ImportProfile.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <system_error>
+
+#include "MeshCache.h"
+#include "PackFile.h"
+
+namespace pipeline {
+
+namespace {
+
+double Megabytes(uint64_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+// paths are the only strings that go in, quotes and backslashes are all they need
+std::string JsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+}
+
+void ImportProfile::Begin(const char* stage) {
+    if (_running)
+        End();
+
+    _stages.push_back({ stage, 0.0, 0, 0, 0, 0 });
+    _running = true;
+
+    ResetThreadAllocationPeak();
+    _startStats = GetThreadAllocationStats();
+    _start = std::chrono::steady_clock::now();
+}
+
+void ImportProfile::End(uint64_t bytes) {
+    if (!_running)
+        return;
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - _start;
+    ThreadAllocationStats stats = GetThreadAllocationStats();
+
+    StageTiming& stage = _stages.back();
+    stage.ms = elapsed.count();
+    stage.bytes = bytes;
+    stage.allocations = stats.allocations - _startStats.allocations;
+    stage.peakBytes = stats.peakBytes > _startStats.liveBytes ? uint64_t(stats.peakBytes - _startStats.liveBytes) : 0;
+    stage.deltaBytes = stats.liveBytes - _startStats.liveBytes;
+    _running = false;
+}
+
+void ImportProfile::Rename(const std::string& stage) {
+    if (_running)
+        _stages.back().name = stage;
+}
+
+void ImportProfile::Discard() {
+    if (!_running)
+        return;
+
+    _stages.pop_back();
+    _running = false;
+}
+
+double ImportProfile::TotalMs() const {
+    double ms = 0.0;
+    for (const StageTiming& stage : _stages)
+        ms += stage.ms;
+    return ms;
+}
+
+std::string ImportProfile::Report(const std::string& filePath, const char* result) const {
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(3)
+        << "profile " << filePath << " (" << result << "), " << TotalMs() << " ms\n";
+
+    for (const StageTiming& stage : _stages) {
+        report << "  " << std::left << std::setw(28) << stage.name << std::right
+            << std::setw(10) << stage.ms << " ms"
+            << std::setw(10) << Megabytes(stage.bytes) << " MB"
+            << ", peak " << std::setw(8) << Megabytes(stage.peakBytes) << " MB"
+            << ", delta " << std::setw(8) << stage.deltaBytes / (1024.0 * 1024.0) << " MB"
+            << ", " << stage.allocations << " allocations\n";
+    }
+    return report.str();
+}
+
+std::string ImportProfile::Json(const std::string& filePath, const char* result) const {
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(3)
+        << "{\n"
+        << "  \"asset\": " << JsonString(filePath) << ",\n"
+        << "  \"result\": " << JsonString(result) << ",\n"
+        << "  \"totalMs\": " << TotalMs() << ",\n"
+        << "  \"stages\": [";
+
+    for (size_t i = 0; i < _stages.size(); i++) {
+        const StageTiming& stage = _stages[i];
+        json << (i ? ",\n" : "\n")
+            << "    { \"name\": " << JsonString(stage.name)
+            << ", \"ms\": " << stage.ms
+            << ", \"bytes\": " << stage.bytes
+            << ", \"peakBytes\": " << stage.peakBytes
+            << ", \"deltaBytes\": " << stage.deltaBytes
+            << ", \"allocations\": " << stage.allocations << " }";
+    }
+
+    json << "\n  ]\n}\n";
+    return json.str();
+}
+
+std::string ProfilePathFor(const std::string& filePath) {
+    // readable over unique, a profile is looked at by hand
+    std::string name = NormalizePackPath(filePath);
+    for (char& c : name) {
+        if (c == '/' || c == ':')
+            c = '_';
+    }
+
+    return (std::filesystem::path(CacheDirectory) / "profiles" / (name + ".json")).string();
+}
+
+bool WriteProfile(const std::string& profilePath, const std::string& json) {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(profilePath).parent_path(), ec);
+
+    std::ofstream file(profilePath, std::ios::binary | std::ios::trunc);
+    file << json;
+    return file.good();
+}
+
+uint64_t MeshBytes(const std::vector<Mesh>& meshes) {
+    uint64_t bytes = 0;
+    for (const Mesh& mesh : meshes) {
+        bytes += mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(DirectX::XMUINT3) +
+            mesh.lods.size() * sizeof(MeshLod) + mesh.meshlets.size() * sizeof(Meshlet) +
+            mesh.packedVertices.size() + mesh.packedIndices.size();
+    }
+    return bytes;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../Dx11App/types.h"
+#include "AllocationStats.h"
+
+namespace pipeline {
+
+// one timed stage of a load
+struct StageTiming {
+    std::string name;
+    double ms;
+    // what the stage hashed or read, or what the meshes hold after it
+    uint64_t bytes;
+    // operator new traffic of the loading thread during the stage, the peak counted above
+    // what was live when it began and the delta what is still live after it
+    uint64_t allocations;
+    uint64_t peakBytes;
+    int64_t deltaBytes;
+};
+
+// wall time, bytes and memory of every stage of one load, from the content hash through
+// Assimp's post process steps to staging. Memory is counted for the loading thread alone,
+// see GetThreadAllocationStats, so loads running at the same time stay apart.
+class ImportProfile {
+public:
+    // starts timing a stage, ending the one still running
+    void Begin(const char* stage);
+    void End(uint64_t bytes = 0);
+    // for a stage whose name is only known once it runs
+    void Rename(const std::string& stage);
+    // drops the running stage, for one that turned out not to happen
+    void Discard();
+
+    const std::vector<StageTiming>& Stages() const { return _stages; }
+    double TotalMs() const;
+
+    // a block for the console, and the same numbers as a JSON object
+    std::string Report(const std::string& filePath, const char* result) const;
+    std::string Json(const std::string& filePath, const char* result) const;
+
+private:
+    std::vector<StageTiming> _stages;
+    std::chrono::steady_clock::time_point _start;
+    ThreadAllocationStats _startStats = {};
+    bool _running = false;
+};
+
+// where the JSON profile of a source asset goes, one file per asset under CacheDirectory
+std::string ProfilePathFor(const std::string& filePath);
+bool WriteProfile(const std::string& profilePath, const std::string& json);
+
+// bytes the meshes hold in every array, source and packed
+uint64_t MeshBytes(const std::vector<Mesh>& meshes);
+
+}
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include "IndexBuffer.h"
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "MeshBounds.h"
+#include "Parallel.h"
+
+namespace pipeline {
+
+namespace {
+
+const uint32_t Unassigned = UINT32_MAX;
+
+Mesh FinishSubmesh(Mesh& submesh) {
+    submesh.bounds = ComputeBounds(submesh.vertices.data(), submesh.vertices.size());
+    submesh.numberOfVertices = static_cast<unsigned int>(submesh.vertices.size());
+    submesh.numberOfIndices = static_cast<unsigned int>(submesh.indices.size() * 3);
+    return std::move(submesh);
+}
+
+}
+
+bool IsValidIndexFormat(IndexFormat format) {
+    return format == IndexFormat::Uint16 || format == IndexFormat::Uint32;
+}
+
+uint32_t IndexSize(IndexFormat format) {
+    return format == IndexFormat::Uint16 ? 2 : 4;
+}
+
+IndexFormat ChooseIndexFormat(size_t vertexCount) {
+    return vertexCount <= ShortIndexVertexLimit ? IndexFormat::Uint16 : IndexFormat::Uint32;
+}
+
+std::vector<Mesh> SplitMesh(const Mesh& mesh, size_t maxVertices) {
+    std::vector<Mesh> submeshes;
+
+    // a triangle needs up to three vertices, any less and it could never fit
+    if (maxVertices < 3)
+        maxVertices = 3;
+
+    // index of each source vertex in the current submesh, tagged with the submesh it was
+    // assigned in so nothing has to be cleared between submeshes
+    std::vector<uint32_t> remap(mesh.vertices.size(), Unassigned);
+    std::vector<uint32_t> owner(mesh.vertices.size(), Unassigned);
+
+    Mesh submesh;
+    uint32_t current = 0;
+
+    for (const DirectX::XMUINT3& triangle : mesh.indices) {
+        const uint32_t corners[3] = { triangle.x, triangle.y, triangle.z };
+
+        size_t added = 0;
+        for (int i = 0; i < 3; i++) {
+            bool repeated = (i > 0 && corners[i] == corners[0]) || (i > 1 && corners[i] == corners[1]);
+            if (owner[corners[i]] != current && !repeated)
+                added++;
+        }
+
+        if (submesh.vertices.size() + added > maxVertices) {
+            submeshes.push_back(FinishSubmesh(submesh));
+            submesh = Mesh();
+            current++;
+        }
+
+        uint32_t local[3];
+        for (int i = 0; i < 3; i++) {
+            uint32_t vertex = corners[i];
+            if (owner[vertex] != current) {
+                owner[vertex] = current;
+                remap[vertex] = static_cast<uint32_t>(submesh.vertices.size());
+                submesh.vertices.push_back(mesh.vertices[vertex]);
+            }
+            local[i] = remap[vertex];
+        }
+        submesh.indices.push_back(DirectX::XMUINT3(local[0], local[1], local[2]));
+    }
+
+    if (!submesh.indices.empty() || submeshes.empty())
+        submeshes.push_back(FinishSubmesh(submesh));
+
+    return submeshes;
+}
+
+void PackIndices(Mesh& mesh) {
+    mesh.packedIndices.resize(mesh.indices.size() * 3 * IndexSize(ChooseIndexFormat(mesh.vertices.size())));
+    PackIndices(mesh, mesh.packedIndices.data());
+}
+
+void PackIndices(Mesh& mesh, uint8_t* target) {
+    mesh.indexFormat = ChooseIndexFormat(mesh.vertices.size());
+
+    const size_t count = mesh.indices.size() * 3;
+    if (mesh.indexFormat == IndexFormat::Uint32) {
+        std::memcpy(target, mesh.indices.data(), count * sizeof(uint32_t));
+        return;
+    }
+
+    const uint32_t* source = &mesh.indices.data()->x;
+    uint16_t* out = reinterpret_cast<uint16_t*>(target);
+    for (size_t i = 0; i < count; i++)
+        out[i] = static_cast<uint16_t>(source[i]);
+}
+
+void SplitLargeMeshes(const std::string& name, std::vector<Mesh>& meshes) {
+    size_t sourceMeshes = meshes.size();
+    size_t splitMeshes = 0;
+    size_t duplicated = 0;
+
+    std::vector<Mesh> result;
+    result.reserve(meshes.size());
+
+    for (Mesh& mesh : meshes) {
+        if (mesh.vertices.size() <= ShortIndexVertexLimit) {
+            result.push_back(std::move(mesh));
+            continue;
+        }
+
+        size_t vertices = mesh.vertices.size();
+        std::vector<Mesh> submeshes = SplitMesh(mesh, ShortIndexVertexLimit);
+        splitMeshes++;
+
+        for (Mesh& submesh : submeshes) {
+            duplicated += submesh.vertices.size();
+            result.push_back(std::move(submesh));
+        }
+        duplicated -= vertices;
+    }
+
+    meshes = std::move(result);
+
+    if (splitMeshes == 0)
+        return;
+
+    std::ostringstream report;
+    report << "split " << name << ": " << splitMeshes << " of " << sourceMeshes << " meshes into "
+        << meshes.size() - (sourceMeshes - splitMeshes) << " submeshes, " << duplicated << " vertices duplicated\n";
+    std::cout << report.str() << std::flush;
+}
+
+void PackIndexBuffers(const std::string& name, std::vector<Mesh>& meshes, const std::vector<uint8_t*>& targets) {
+    ParallelFor(meshes.size(), 0, [&](size_t i) {
+        if (targets.empty())
+            PackIndices(meshes[i]);
+        else
+            PackIndices(meshes[i], targets[i]);
+    });
+
+    size_t wideBytes = 0;
+    size_t packedBytes = 0;
+    size_t shortMeshes = 0;
+    for (const Mesh& mesh : meshes) {
+        wideBytes += mesh.indices.size() * sizeof(DirectX::XMUINT3);
+        packedBytes += mesh.indices.size() * 3 * IndexSize(mesh.indexFormat);
+        if (mesh.indexFormat == IndexFormat::Uint16)
+            shortMeshes++;
+    }
+
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(1)
+        << "indices " << name << ": " << shortMeshes << " of " << meshes.size() << " meshes 16 bit, "
+        << wideBytes / 1024.0 << " -> " << packedBytes / 1024.0 << " KB, saved " << (wideBytes - packedBytes) / 1024.0 << " KB\n";
+    std::cout << report.str() << std::flush;
+}
+
+}
\ No newline at end of file
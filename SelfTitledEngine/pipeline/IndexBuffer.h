@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../Dx11App/types.h"
+
+namespace pipeline {
+
+// 16 bit indices address this many vertices
+constexpr size_t ShortIndexVertexLimit = 65536;
+
+bool IsValidIndexFormat(IndexFormat format);
+uint32_t IndexSize(IndexFormat format);
+// smallest format that addresses vertexCount vertices
+IndexFormat ChooseIndexFormat(size_t vertexCount);
+
+// cuts mesh into runs of consecutive triangles that use at most maxVertices vertices each.
+// Runs keep the triangle order, and with it the locality the optimization passes built up.
+// Each submesh renumbers its vertices in first-use order, vertices on a cut are duplicated.
+// Runs before GenerateLods, only the full level is split.
+std::vector<Mesh> SplitMesh(const Mesh& mesh, size_t maxVertices);
+
+// replaces every mesh 16 bit indices can't address with its SplitMesh pieces, printing
+// what was split tagged with name
+void SplitLargeMeshes(const std::string& name, std::vector<Mesh>& meshes);
+
+// writes mesh.indices into mesh.packedIndices in the smallest format that fits
+void PackIndices(Mesh& mesh);
+// the same into target, sized for ChooseIndexFormat of the mesh, leaving packedIndices alone
+void PackIndices(Mesh& mesh, uint8_t* target);
+
+// packs every mesh's indices and prints the index memory saved for the asset, tagged with name.
+// Given targets, one per mesh, each packs into its target instead.
+void PackIndexBuffers(const std::string& name, std::vector<Mesh>& meshes, const std::vector<uint8_t*>& targets = {});
+
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace pipeline {
+
+// read-only mapping of a whole file into memory
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    bool Open(const std::string& filePath);
+    void Close();
+
+    const uint8_t* Data() const { return _data; }
+    size_t Size() const { return _size; }
+    bool IsOpen() const { return _data != nullptr; }
+
+private:
+    const uint8_t* _data = nullptr;
+    size_t _size = 0;
+
+#ifdef _WIN32
+    // HANDLEs, kept as void* so this header doesn't drag in Windows.h
+    void* _file = nullptr;
+    void* _mapping = nullptr;
+#endif
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,363 @@
+#include "MeshBounds.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define PIPELINE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "Parallel.h"
+
+namespace pipeline {
+
+namespace {
+
+static_assert(sizeof(Vertex) == 3 * sizeof(float), "the kernels read vertices as packed floats");
+
+// regrowths from a shrunk copy of the best sphere so far, each starting further along. The
+// shrink halves whenever a regrowth comes out no smaller.
+constexpr int RefinePasses = 4;
+constexpr float RefineShrink = 0.02f;
+
+struct Sphere {
+    DirectX::XMFLOAT3 center;
+    float radius;
+};
+
+#ifdef PIPELINE_SSE2
+// four packed vertices are three registers, x y z x | y z x y | z x y z. Lane i of register
+// r always holds component (r * 4 + i) % 3.
+inline void LoadPacked(const float* p, __m128& a, __m128& b, __m128& c) {
+    a = _mm_loadu_ps(p);
+    b = _mm_loadu_ps(p + 4);
+    c = _mm_loadu_ps(p + 8);
+}
+
+// the same four vertices as one register per component
+inline void LoadTransposed(const float* p, __m128& x, __m128& y, __m128& z) {
+    __m128 a, b, c;
+    LoadPacked(p, a, b, c);
+
+    __m128 b2c1 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+    x = _mm_shuffle_ps(a, b2c1, _MM_SHUFFLE(2, 0, 3, 0));
+    __m128 a1b0 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+    __m128 b3c2 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+    y = _mm_shuffle_ps(a1b0, b3c2, _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 a2b1 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+    z = _mm_shuffle_ps(a2b1, c, _MM_SHUFFLE(3, 0, 2, 0));
+}
+
+inline __m128 DistanceSquared(const float* p, const __m128& cx, const __m128& cy, const __m128& cz) {
+    __m128 x, y, z;
+    LoadTransposed(p, x, y, z);
+    __m128 dx = _mm_sub_ps(x, cx);
+    __m128 dy = _mm_sub_ps(y, cy);
+    __m128 dz = _mm_sub_ps(z, cz);
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+}
+#endif
+
+// rounds the same way as the lanes above
+inline float DistanceSquared(const float* p, const DirectX::XMFLOAT3& center) {
+    float dx = p[0] - center.x;
+    float dy = p[1] - center.y;
+    float dz = p[2] - center.z;
+    return dx * dx + dy * dy + dz * dz;
+}
+
+void Box(const float* data, size_t count, DirectX::XMFLOAT3& minCoord, DirectX::XMFLOAT3& maxCoord) {
+    float low[3] = { data[0], data[1], data[2] };
+    float high[3] = { data[0], data[1], data[2] };
+    size_t i = 0;
+
+#ifdef PIPELINE_SSE2
+    if (count >= 4) {
+        __m128 low0, low1, low2;
+        LoadPacked(data, low0, low1, low2);
+        __m128 high0 = low0, high1 = low1, high2 = low2;
+
+        for (i = 4; i + 4 <= count; i += 4) {
+            __m128 a, b, c;
+            LoadPacked(data + i * 3, a, b, c);
+            low0 = _mm_min_ps(low0, a);
+            low1 = _mm_min_ps(low1, b);
+            low2 = _mm_min_ps(low2, c);
+            high0 = _mm_max_ps(high0, a);
+            high1 = _mm_max_ps(high1, b);
+            high2 = _mm_max_ps(high2, c);
+        }
+
+        float lows[12];
+        float highs[12];
+        _mm_storeu_ps(lows, low0);
+        _mm_storeu_ps(lows + 4, low1);
+        _mm_storeu_ps(lows + 8, low2);
+        _mm_storeu_ps(highs, high0);
+        _mm_storeu_ps(highs + 4, high1);
+        _mm_storeu_ps(highs + 8, high2);
+        for (int lane = 0; lane < 12; lane++) {
+            low[lane % 3] = std::min(low[lane % 3], lows[lane]);
+            high[lane % 3] = std::max(high[lane % 3], highs[lane]);
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        const float* p = data + i * 3;
+        for (int c = 0; c < 3; c++) {
+            low[c] = std::min(low[c], p[c]);
+            high[c] = std::max(high[c], p[c]);
+        }
+    }
+
+    minCoord = DirectX::XMFLOAT3(low[0], low[1], low[2]);
+    maxCoord = DirectX::XMFLOAT3(high[0], high[1], high[2]);
+}
+
+float MaxDistanceSquared(const float* data, size_t count, const DirectX::XMFLOAT3& center) {
+    float furthest = 0.0f;
+    size_t i = 0;
+
+#ifdef PIPELINE_SSE2
+    __m128 cx = _mm_set1_ps(center.x);
+    __m128 cy = _mm_set1_ps(center.y);
+    __m128 cz = _mm_set1_ps(center.z);
+    __m128 furthest4 = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4)
+        furthest4 = _mm_max_ps(furthest4, DistanceSquared(data + i * 3, cx, cy, cz));
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, furthest4);
+    furthest = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+
+    for (; i < count; i++)
+        furthest = std::max(furthest, DistanceSquared(data + i * 3, center));
+    return furthest;
+}
+
+// Ritter's step, just big enough to take p in with the far side staying where it is
+inline void Take(const float* p, Sphere& sphere) {
+    float distanceSquared = DistanceSquared(p, sphere.center);
+    if (distanceSquared <= sphere.radius * sphere.radius)
+        return;
+
+    float distance = std::sqrt(distanceSquared);
+    float grown = (sphere.radius + distance) * 0.5f;
+    float shift = (grown - sphere.radius) / distance;
+    sphere.center.x += (p[0] - sphere.center.x) * shift;
+    sphere.center.y += (p[1] - sphere.center.y) * shift;
+    sphere.center.z += (p[2] - sphere.center.z) * shift;
+    sphere.radius = grown;
+}
+
+// takes in every vertex in order. Four at a time are checked in lanes, only groups with
+// one outside go through Take, so the result is the same as the plain loop.
+void GrowRange(const float* data, size_t count, Sphere& sphere) {
+    size_t i = 0;
+
+#ifdef PIPELINE_SSE2
+    for (; i + 4 <= count; i += 4) {
+        const float* p = data + i * 3;
+        __m128 distance = DistanceSquared(p, _mm_set1_ps(sphere.center.x), _mm_set1_ps(sphere.center.y), _mm_set1_ps(sphere.center.z));
+        if (!_mm_movemask_ps(_mm_cmpgt_ps(distance, _mm_set1_ps(sphere.radius * sphere.radius))))
+            continue;
+
+        for (int vertex = 0; vertex < 4; vertex++)
+            Take(p + vertex * 3, sphere);
+    }
+#endif
+
+    for (; i < count; i++)
+        Take(data + i * 3, sphere);
+}
+
+// the vertices from start to the end, then the ones before it
+void Grow(const float* data, size_t count, size_t start, Sphere& sphere) {
+    GrowRange(data + start * 3, count - start, sphere);
+    GrowRange(data, start, sphere);
+}
+
+// the first vertex on each side of the box, min x max x min y and so on. Groups of four
+// are compared against the box in lanes and only ones touching it are looked at.
+void Extremes(const float* data, size_t count, const Bounds& box, const float* extremes[6]) {
+    const float low[3] = { box.minCoord.x, box.minCoord.y, box.minCoord.z };
+    const float high[3] = { box.maxCoord.x, box.maxCoord.y, box.maxCoord.z };
+    for (int side = 0; side < 6; side++)
+        extremes[side] = nullptr;
+
+    auto check = [&](const float* p) {
+        for (int c = 0; c < 3; c++) {
+            if (!extremes[c * 2] && p[c] == low[c])
+                extremes[c * 2] = p;
+            if (!extremes[c * 2 + 1] && p[c] == high[c])
+                extremes[c * 2 + 1] = p;
+        }
+    };
+
+    size_t i = 0;
+
+#ifdef PIPELINE_SSE2
+    __m128 low0 = _mm_setr_ps(low[0], low[1], low[2], low[0]);
+    __m128 low1 = _mm_setr_ps(low[1], low[2], low[0], low[1]);
+    __m128 low2 = _mm_setr_ps(low[2], low[0], low[1], low[2]);
+    __m128 high0 = _mm_setr_ps(high[0], high[1], high[2], high[0]);
+    __m128 high1 = _mm_setr_ps(high[1], high[2], high[0], high[1]);
+    __m128 high2 = _mm_setr_ps(high[2], high[0], high[1], high[2]);
+
+    for (; i + 4 <= count; i += 4) {
+        const float* p = data + i * 3;
+        __m128 a, b, c;
+        LoadPacked(p, a, b, c);
+        __m128 touching = _mm_or_ps(_mm_or_ps(_mm_cmpeq_ps(a, low0), _mm_cmpeq_ps(a, high0)),
+            _mm_or_ps(_mm_or_ps(_mm_cmpeq_ps(b, low1), _mm_cmpeq_ps(b, high1)), _mm_or_ps(_mm_cmpeq_ps(c, low2), _mm_cmpeq_ps(c, high2))));
+        if (!_mm_movemask_ps(touching))
+            continue;
+
+        for (int vertex = 0; vertex < 4; vertex++)
+            check(p + vertex * 3);
+    }
+#endif
+
+    for (; i < count; i++)
+        check(data + i * 3);
+
+    // only with NaNs in the positions
+    for (int side = 0; side < 6; side++) {
+        if (!extremes[side])
+            extremes[side] = data;
+    }
+}
+
+Sphere BoundingSphere(const float* data, size_t count, const Bounds& box) {
+    // the pair of extremes furthest apart seeds Ritter's sphere
+    const float* extremes[6];
+    Extremes(data, count, box, extremes);
+
+    int axis = 0;
+    float widest = -1.0f;
+    for (int c = 0; c < 3; c++) {
+        DirectX::XMFLOAT3 low(extremes[c * 2][0], extremes[c * 2][1], extremes[c * 2][2]);
+        float span = DistanceSquared(extremes[c * 2 + 1], low);
+        if (span > widest) {
+            widest = span;
+            axis = c;
+        }
+    }
+
+    const float* a = extremes[axis * 2];
+    const float* b = extremes[axis * 2 + 1];
+    Sphere best = { DirectX::XMFLOAT3((a[0] + b[0]) * 0.5f, (a[1] + b[1]) * 0.5f, (a[2] + b[2]) * 0.5f), std::sqrt(widest) * 0.5f };
+    Grow(data, count, 0, best);
+
+    // flat and boxy meshes do better around the box center
+    DirectX::XMFLOAT3 boxCenter((box.minCoord.x + box.maxCoord.x) * 0.5f, (box.minCoord.y + box.maxCoord.y) * 0.5f,
+        (box.minCoord.z + box.maxCoord.z) * 0.5f);
+    float boxRadius = std::sqrt(MaxDistanceSquared(data, count, boxCenter));
+    if (boxRadius < best.radius)
+        best = { boxCenter, boxRadius };
+
+    float shrink = RefineShrink;
+    for (int pass = 1; pass <= RefinePasses; pass++) {
+        Sphere trial = { best.center, best.radius * (1.0f - shrink) };
+        Grow(data, count, count * pass / (RefinePasses + 1), trial);
+        if (trial.radius < best.radius)
+            best = trial;
+        else
+            shrink *= 0.5f;
+    }
+
+    // growing rounds and so do float distances, a few roundings of slack keeps every point
+    // inside however it's measured
+    best.radius = std::max(best.radius, std::sqrt(MaxDistanceSquared(data, count, best.center))) * (1.0f + 4.0f * FLT_EPSILON);
+    return best;
+}
+
+}
+
+Bounds ComputeBounds(const Vertex* vertices, size_t count) {
+    Bounds bounds = {};
+    if (count == 0)
+        return bounds;
+
+    const float* data = &vertices[0].Pos.x;
+    Box(data, count, bounds.minCoord, bounds.maxCoord);
+
+    Sphere sphere = BoundingSphere(data, count, bounds);
+    bounds.center = sphere.center;
+    bounds.radius = sphere.radius;
+    return bounds;
+}
+
+void TransformVertices(Vertex* vertices, size_t count, const DirectX::XMFLOAT3& center, float scale) {
+    if (count == 0)
+        return;
+
+    float* data = &vertices[0].Pos.x;
+    size_t i = 0;
+
+#ifdef PIPELINE_SSE2
+    __m128 center0 = _mm_setr_ps(center.x, center.y, center.z, center.x);
+    __m128 center1 = _mm_setr_ps(center.y, center.z, center.x, center.y);
+    __m128 center2 = _mm_setr_ps(center.z, center.x, center.y, center.z);
+    __m128 scale4 = _mm_set1_ps(scale);
+
+    for (; i + 4 <= count; i += 4) {
+        float* p = data + i * 3;
+        __m128 a, b, c;
+        LoadPacked(p, a, b, c);
+        _mm_storeu_ps(p, _mm_mul_ps(_mm_sub_ps(a, center0), scale4));
+        _mm_storeu_ps(p + 4, _mm_mul_ps(_mm_sub_ps(b, center1), scale4));
+        _mm_storeu_ps(p + 8, _mm_mul_ps(_mm_sub_ps(c, center2), scale4));
+    }
+#endif
+
+    for (; i < count; i++) {
+        DirectX::XMFLOAT3& pos = vertices[i].Pos;
+        pos = DirectX::XMFLOAT3((pos.x - center.x) * scale, (pos.y - center.y) * scale, (pos.z - center.z) * scale);
+    }
+}
+
+void NormalizeMeshes(const std::string& name, std::vector<Mesh>& meshes) {
+    // the box around the whole model, from the boxes the importers left
+    Bounds model = {};
+    bool first = true;
+    for (const Mesh& mesh : meshes) {
+        if (mesh.vertices.empty())
+            continue;
+
+        const Bounds& bounds = mesh.bounds;
+        model.minCoord = first ? bounds.minCoord : DirectX::XMFLOAT3(std::min(model.minCoord.x, bounds.minCoord.x),
+            std::min(model.minCoord.y, bounds.minCoord.y), std::min(model.minCoord.z, bounds.minCoord.z));
+        model.maxCoord = first ? bounds.maxCoord : DirectX::XMFLOAT3(std::max(model.maxCoord.x, bounds.maxCoord.x),
+            std::max(model.maxCoord.y, bounds.maxCoord.y), std::max(model.maxCoord.z, bounds.maxCoord.z));
+        first = false;
+    }
+
+    if (first)
+        return;
+
+    DirectX::XMFLOAT3 center((model.minCoord.x + model.maxCoord.x) * 0.5f, (model.minCoord.y + model.maxCoord.y) * 0.5f,
+        (model.minCoord.z + model.maxCoord.z) * 0.5f);
+    float range = std::max({ model.maxCoord.x - model.minCoord.x, model.maxCoord.y - model.minCoord.y, model.maxCoord.z - model.minCoord.z });
+    float scale = range > 0.0f ? 2.0f / range : 1.0f;
+
+    ParallelFor(meshes.size(), 0, [&](size_t i) {
+        Mesh& mesh = meshes[i];
+        TransformVertices(mesh.vertices.data(), mesh.vertices.size(), center, scale);
+        mesh.bounds = ComputeBounds(mesh.vertices.data(), mesh.vertices.size());
+    });
+
+    std::ostringstream report;
+    report << "normalize " << name << ": center (" << center.x << ", " << center.y << ", " << center.z
+        << "), scale " << scale << "\n";
+    std::cout << report.str() << std::flush;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "../Dx11App/types.h"
+
+namespace pipeline {
+
+// box and sphere around the vertices, all zeros for none. The box runs through an SSE2
+// kernel four vertices at a time. The sphere is Ritter's grown from the pair of axis
+// extremes furthest apart, or the box's own when that is smaller, then regrown a few times
+// from a shrunk copy in a different vertex order keeping the smallest, which lands within
+// a few percent of the minimal sphere.
+Bounds ComputeBounds(const Vertex* vertices, size_t count);
+
+// (position - center) * scale for every vertex, four at a time with SSE2
+void TransformVertices(Vertex* vertices, size_t count, const DirectX::XMFLOAT3& center, float scale);
+
+// centers the whole model on the origin and scales it so the longest side of its box spans
+// -1 to 1, the same transform for every mesh so they stay in place around each other.
+// Recomputes the bounds and prints the transform tagged with name.
+void NormalizeMeshes(const std::string& name, std::vector<Mesh>& meshes);
+
+}
\ No newline at end of file
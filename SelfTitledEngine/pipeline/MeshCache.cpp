@@ -0,0 +1,547 @@
+#include "MeshCache.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <system_error>
+#include <utility>
+
+#include "GeometryCodec.h"
+#include "Hash.h"
+#include "IndexBuffer.h"
+#include "PackFile.h"
+#include "Parallel.h"
+#include "VertexFormat.h"
+
+namespace pipeline {
+
+namespace {
+
+// layout: FileHeader, one MeshRecord per mesh, then the vertex blocks of every mesh back to back,
+// then the index blocks of every 16 bit mesh and of every 32 bit mesh the same way, so an
+// uncompressed file maps exactly as SceneBuffers lays a model out. The lod and meshlet blocks of
+// each mesh follow. Runs and those blocks start on a BlockAlignment boundary. Compressed meshes
+// store their vertex and index blocks as GeometryCodec streams, each one aligned.
+constexpr uint32_t CookedMagic = 0x434D5453; // "STMC"
+constexpr uint32_t CookedVersion = 12;
+constexpr uint64_t BlockAlignment = 16;
+
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t meshCount;
+    uint32_t reserved;
+    uint64_t contentHash;
+    uint64_t settingsHash;
+    double importMs;
+};
+
+struct MeshRecord {
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint32_t numberOfVertices;
+    uint32_t numberOfTriangles;
+    Bounds bounds;
+    VertexFormat format;
+    IndexFormat indexFormat;
+    uint8_t compressed;
+    uint8_t reserved;
+    uint32_t vertexStride;
+    Dequantization dequantization;
+    uint64_t lodOffset;
+    uint32_t numberOfLods;
+    uint32_t numberOfMeshlets;
+    uint64_t meshletOffset;
+    // stored size of the vertex and index blocks
+    uint64_t vertexBytes;
+    uint64_t indexBytes;
+};
+
+uint64_t AlignUp(uint64_t value) {
+    return (value + BlockAlignment - 1) & ~(BlockAlignment - 1);
+}
+
+void WritePadding(std::ofstream& file, uint64_t& position, uint64_t target) {
+    static const char zeros[BlockAlignment] = {};
+    file.write(zeros, static_cast<std::streamsize>(target - position));
+    position = target;
+}
+
+// remembers the content hash of a source path as of the given size and write time, so
+// unchanged files never have to be read to find their cooked entry
+constexpr uint32_t StampMagic = 0x504D5453; // "STMP"
+
+struct StampRecord {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;
+    int64_t writeTime;
+    uint64_t contentHash;
+};
+
+std::string CachePath(uint64_t hash, const char* extension) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx%s", static_cast<unsigned long long>(hash), extension);
+    return (std::filesystem::path(CacheDirectory) / name).string();
+}
+
+std::string StampPathFor(const std::string& filePath) {
+    std::error_code ec;
+    std::string normalized = std::filesystem::absolute(filePath, ec).lexically_normal().generic_string();
+    if (ec)
+        normalized = filePath;
+
+    return CachePath(Hash64(normalized.data(), normalized.size()), ".stamp");
+}
+
+bool ReadStamp(const std::string& stampPath, StampRecord& record) {
+    std::ifstream file(stampPath, std::ios::binary);
+    if (!file.read(reinterpret_cast<char*>(&record), sizeof(record)))
+        return false;
+
+    return record.magic == StampMagic && record.version == CookedVersion;
+}
+
+bool WriteStamp(const std::string& stampPath, const StampRecord& record) {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(stampPath).parent_path(), ec);
+
+    std::ofstream file(stampPath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    return file.good();
+}
+
+std::mutex StatsMutex;
+CacheStats Stats = {};
+
+}
+
+bool GetSourceStamp(const std::string& filePath, SourceStamp& stamp) {
+    std::error_code ec;
+    uint64_t size = std::filesystem::file_size(filePath, ec);
+    if (ec)
+        return false;
+
+    auto writeTime = std::filesystem::last_write_time(filePath, ec);
+    if (ec)
+        return false;
+
+    stamp.size = size;
+    stamp.writeTime = static_cast<int64_t>(writeTime.time_since_epoch().count());
+    return true;
+}
+
+bool GetContentHash(const std::string& filePath, uint64_t& contentHash, bool& rehashed) {
+    // packed files carry their hash in the table of contents
+    AssetFile packed;
+    if (packed.OpenPacked(filePath)) {
+        contentHash = packed.ContentHash();
+        rehashed = false;
+        return true;
+    }
+
+    SourceStamp stamp;
+    if (!GetSourceStamp(filePath, stamp))
+        return false;
+
+    std::string stampPath = StampPathFor(filePath);
+    StampRecord record;
+    if (ReadStamp(stampPath, record) && record.size == stamp.size && record.writeTime == stamp.writeTime) {
+        contentHash = record.contentHash;
+        rehashed = false;
+        return true;
+    }
+
+    // empty files can't be mapped, but they still have a hash
+    if (stamp.size == 0) {
+        contentHash = Hash64(nullptr, 0);
+    }
+    else {
+        MappedFile file;
+        if (!file.Open(filePath))
+            return false;
+        contentHash = Hash64(file.Data(), file.Size());
+    }
+    rehashed = true;
+
+    {
+        std::lock_guard<std::mutex> lock(StatsMutex);
+        Stats.contentHashes++;
+    }
+
+    // failing to write only costs another hash next time
+    record.magic = StampMagic;
+    record.version = CookedVersion;
+    record.size = stamp.size;
+    record.writeTime = stamp.writeTime;
+    record.contentHash = contentHash;
+    WriteStamp(stampPath, record);
+
+    return true;
+}
+
+std::string CookedPathFor(const CacheKey& key) {
+    return CachePath(HashCombine(key.contentHash, key.settingsHash), ".stmesh");
+}
+
+std::string CookedTexturePathFor(const CacheKey& key) {
+    return CachePath(HashCombine(key.contentHash, key.settingsHash), ".sttex");
+}
+
+std::string UniqueTempPath(const std::string& path) {
+    static const uint64_t process = [] {
+        std::random_device device;
+        return uint64_t(device()) << 32 | device();
+    }();
+    static std::atomic<uint64_t> writers(0);
+
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%016llx.tmp", static_cast<unsigned long long>(HashCombine(process, writers++)));
+    return path + suffix;
+}
+
+bool ReplaceWithTemp(const std::string& tempPath, const std::string& path) {
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (!ec)
+        return true;
+
+    std::filesystem::remove(tempPath, ec);
+    return std::filesystem::exists(path, ec);
+}
+
+bool CookedModel::Load(const std::string& cookedPath, const CacheKey& key) {
+    Unload();
+
+    if (!_file.Open(cookedPath))
+        return false;
+
+    const uint8_t* base = _file.Data();
+    uint64_t size = _file.Size();
+
+    if (size < sizeof(FileHeader)) {
+        Unload();
+        return false;
+    }
+
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(base);
+
+    // anything that doesn't match exactly is stale and gets recooked
+    if (header->magic != CookedMagic ||
+        header->version != CookedVersion ||
+        header->contentHash != key.contentHash ||
+        header->settingsHash != key.settingsHash ||
+        sizeof(FileHeader) + uint64_t(header->meshCount) * sizeof(MeshRecord) > size) {
+        Unload();
+        return false;
+    }
+
+    const MeshRecord* records = reinterpret_cast<const MeshRecord*>(base + sizeof(FileHeader));
+    _meshes.reserve(header->meshCount);
+
+    // a file is compressed throughout or not at all, records are validated as they're read
+    bool compressed = header->meshCount > 0 && records[0].compressed;
+    uint64_t vertexTotal = 0;
+    uint64_t indexTotals[IndexFormatCount] = {};
+    for (uint32_t i = 0; i < header->meshCount; i++) {
+        const MeshRecord& record = records[i];
+        if (!IsValidFormat(record.format) || record.vertexStride != VertexStride(record.format) ||
+            !IsValidIndexFormat(record.indexFormat) || bool(record.compressed) != compressed) {
+            Unload();
+            return false;
+        }
+
+        vertexTotal += uint64_t(record.numberOfVertices) * record.vertexStride;
+        indexTotals[size_t(record.indexFormat)] += uint64_t(record.numberOfTriangles) * 3 * IndexSize(record.indexFormat);
+    }
+
+    // compressed meshes decode into one block laid out like an uncompressed file
+    uint8_t* decodedVertices = nullptr;
+    uint8_t* decodedIndices[IndexFormatCount] = {};
+    if (compressed) {
+        uint64_t decodedBytes = vertexTotal + indexTotals[0] + indexTotals[1];
+        if (decodedBytes > size * VertexCodecGroupSize) {
+            Unload();
+            return false;
+        }
+
+        _decoded = Arena(static_cast<size_t>(decodedBytes) + (1 + IndexFormatCount) * BlockAlignment);
+        decodedVertices = static_cast<uint8_t*>(_decoded.Allocate(static_cast<size_t>(vertexTotal), BlockAlignment));
+        for (size_t format = 0; format < IndexFormatCount; format++)
+            decodedIndices[format] = static_cast<uint8_t*>(_decoded.Allocate(static_cast<size_t>(indexTotals[format]), BlockAlignment));
+    }
+
+    // where the next mesh of each run has to start
+    const uint8_t* nextVertices = nullptr;
+    const uint8_t* nextIndices[IndexFormatCount] = {};
+
+    for (uint32_t i = 0; i < header->meshCount; i++) {
+        const MeshRecord& record = records[i];
+        size_t format = size_t(record.indexFormat);
+        uint64_t vertexBytes = uint64_t(record.numberOfVertices) * record.vertexStride;
+        uint64_t indexBytes = uint64_t(record.numberOfTriangles) * 3 * IndexSize(record.indexFormat);
+
+        // compressed blocks are checked as they decode
+        if (!record.compressed && (record.vertexBytes != vertexBytes || record.indexBytes != indexBytes)) {
+            Unload();
+            return false;
+        }
+
+        uint64_t lodBytes = uint64_t(record.numberOfLods) * sizeof(MeshLod);
+        uint64_t meshletBytes = uint64_t(record.numberOfMeshlets) * sizeof(Meshlet);
+
+        if (record.vertexOffset > size || record.vertexBytes > size - record.vertexOffset ||
+            record.indexOffset > size || record.indexBytes > size - record.indexOffset ||
+            record.lodOffset > size || lodBytes > size - record.lodOffset ||
+            record.meshletOffset > size || meshletBytes > size - record.meshletOffset) {
+            Unload();
+            return false;
+        }
+
+        const MeshLod* lods = reinterpret_cast<const MeshLod*>(base + record.lodOffset);
+        for (uint32_t lod = 0; lod < record.numberOfLods; lod++) {
+            if (lods[lod].firstIndex > uint64_t(record.numberOfTriangles) * 3 ||
+                lods[lod].numberOfIndices > uint64_t(record.numberOfTriangles) * 3 - lods[lod].firstIndex) {
+                Unload();
+                return false;
+            }
+        }
+
+        const Meshlet* meshlets = reinterpret_cast<const Meshlet*>(base + record.meshletOffset);
+        for (uint32_t meshlet = 0; meshlet < record.numberOfMeshlets; meshlet++) {
+            if (meshlets[meshlet].firstIndex > uint64_t(record.numberOfTriangles) * 3 ||
+                meshlets[meshlet].numberOfIndices > uint64_t(record.numberOfTriangles) * 3 - meshlets[meshlet].firstIndex) {
+                Unload();
+                return false;
+            }
+        }
+
+        MeshView view;
+        view.vertices = base + record.vertexOffset;
+        view.indices = base + record.indexOffset;
+
+        // the only copy a cache hit makes, and only for files cooked compressed
+        if (compressed) {
+            if (!DecodeVertexBuffer(decodedVertices, record.numberOfVertices, record.vertexStride,
+                    base + record.vertexOffset, static_cast<size_t>(record.vertexBytes)) ||
+                !DecodeIndexBuffer(decodedIndices[format], record.numberOfTriangles, record.indexFormat, record.numberOfVertices,
+                    base + record.indexOffset, static_cast<size_t>(record.indexBytes))) {
+                Unload();
+                return false;
+            }
+
+            view.vertices = decodedVertices;
+            view.indices = decodedIndices[format];
+            decodedVertices += vertexBytes;
+            decodedIndices[format] += indexBytes;
+        }
+        // the mapping stands in for the staging block, so each run has to be back to back
+        else if ((nextVertices && view.vertices != nextVertices) || (nextIndices[format] && view.indices != nextIndices[format])) {
+            Unload();
+            return false;
+        }
+        nextVertices = view.vertices + vertexBytes;
+        nextIndices[format] = view.indices + indexBytes;
+
+        view.bounds = record.bounds;
+        view.format = record.format;
+        view.indexFormat = record.indexFormat;
+        view.dequantization = record.dequantization;
+        view.lods = record.numberOfLods ? lods : nullptr;
+        view.numberOfLods = record.numberOfLods;
+        view.meshlets = record.numberOfMeshlets ? meshlets : nullptr;
+        view.numberOfMeshlets = record.numberOfMeshlets;
+        view.numberOfVertices = record.numberOfVertices;
+        view.numberOfIndices = record.numberOfTriangles * 3;
+        _meshes.push_back(view);
+    }
+
+    _importMs = header->importMs;
+    return true;
+}
+
+void CookedModel::Unload() {
+    _meshes.clear();
+    _decoded.Release();
+    _file.Close();
+    _importMs = 0.0;
+}
+
+bool CookedModel::Stage(std::vector<MeshView>& meshes, SceneBuffers& buffers, std::string& error) {
+    if (!AdoptSceneBuffers(_meshes, std::move(_file), std::move(_decoded), buffers, error))
+        return false;
+
+    meshes = std::move(_meshes);
+    _meshes.clear();
+    return true;
+}
+
+bool WriteCookedModel(const std::string& cookedPath, const CacheKey& key, double importMs, const std::vector<MeshView>& meshes, bool compress) {
+    FileHeader header;
+    header.magic = CookedMagic;
+    header.version = CookedVersion;
+    header.reserved = 0;
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    header.contentHash = key.contentHash;
+    header.settingsHash = key.settingsHash;
+    header.importMs = importMs;
+
+    // only packed meshes can be cooked
+    for (const MeshView& mesh : meshes) {
+        if (!IsValidFormat(mesh.format) || !IsValidIndexFormat(mesh.indexFormat) || mesh.numberOfIndices % 3 != 0 ||
+            (mesh.numberOfVertices > 0 && !mesh.vertices) || (mesh.numberOfIndices > 0 && !mesh.indices))
+            return false;
+    }
+
+    // the vertex and index block of each mesh as written, encoded up front when compressing
+    std::vector<std::vector<uint8_t>> streams(compress ? meshes.size() * 2 : 0);
+    if (compress) {
+        ParallelFor(meshes.size(), 0, [&](size_t i) {
+            const MeshView& mesh = meshes[i];
+            streams[i * 2] = EncodeVertexBuffer(mesh.vertices, mesh.numberOfVertices, VertexStride(mesh.format));
+
+            // the codec takes full width triangles
+            std::vector<DirectX::XMUINT3> triangles(mesh.numberOfIndices / 3);
+            if (mesh.indexFormat == IndexFormat::Uint32) {
+                std::memcpy(triangles.data(), mesh.indices, triangles.size() * sizeof(DirectX::XMUINT3));
+            }
+            else {
+                const uint16_t* indices = reinterpret_cast<const uint16_t*>(mesh.indices);
+                for (size_t triangle = 0; triangle < triangles.size(); triangle++)
+                    triangles[triangle] = DirectX::XMUINT3(indices[triangle * 3], indices[triangle * 3 + 1], indices[triangle * 3 + 2]);
+            }
+            streams[i * 2 + 1] = EncodeIndexBuffer(triangles.data(), triangles.size());
+        });
+    }
+
+    std::vector<MeshRecord> records(meshes.size());
+    for (size_t i = 0; i < meshes.size(); i++) {
+        const MeshView& mesh = meshes[i];
+        MeshRecord& record = records[i];
+
+        record.numberOfVertices = mesh.numberOfVertices;
+        record.numberOfTriangles = mesh.numberOfIndices / 3;
+        record.bounds = mesh.bounds;
+        record.format = mesh.format;
+        record.indexFormat = mesh.indexFormat;
+        record.vertexStride = VertexStride(mesh.format);
+        record.dequantization = mesh.dequantization;
+        record.numberOfLods = mesh.numberOfLods;
+        record.numberOfMeshlets = mesh.numberOfMeshlets;
+        record.compressed = compress ? 1 : 0;
+        record.reserved = 0;
+        record.vertexBytes = compress ? streams[i * 2].size() : uint64_t(mesh.numberOfVertices) * record.vertexStride;
+        record.indexBytes = compress ? streams[i * 2 + 1].size() : uint64_t(mesh.numberOfIndices) * IndexSize(mesh.indexFormat);
+    }
+
+    // every block as it goes into the file, in order
+    struct Block {
+        uint64_t offset;
+        const void* data;
+        uint64_t bytes;
+    };
+    std::vector<Block> blocks;
+    blocks.reserve(meshes.size() * 4);
+    uint64_t offset = sizeof(FileHeader) + records.size() * sizeof(MeshRecord);
+
+    offset = AlignUp(offset);
+    for (size_t i = 0; i < meshes.size(); i++) {
+        MeshRecord& record = records[i];
+        record.vertexOffset = compress ? AlignUp(offset) : offset;
+        offset = record.vertexOffset + record.vertexBytes;
+        blocks.push_back({ record.vertexOffset, compress ? streams[i * 2].data() : meshes[i].vertices, record.vertexBytes });
+    }
+
+    for (size_t format = 0; format < IndexFormatCount; format++) {
+        offset = AlignUp(offset);
+        for (size_t i = 0; i < meshes.size(); i++) {
+            MeshRecord& record = records[i];
+            if (size_t(record.indexFormat) != format)
+                continue;
+
+            record.indexOffset = compress ? AlignUp(offset) : offset;
+            offset = record.indexOffset + record.indexBytes;
+            blocks.push_back({ record.indexOffset, compress ? streams[i * 2 + 1].data() : meshes[i].indices, record.indexBytes });
+        }
+    }
+
+    for (size_t i = 0; i < meshes.size(); i++) {
+        const MeshView& mesh = meshes[i];
+        MeshRecord& record = records[i];
+
+        record.lodOffset = AlignUp(offset);
+        offset = record.lodOffset + mesh.numberOfLods * sizeof(MeshLod);
+        blocks.push_back({ record.lodOffset, mesh.lods, mesh.numberOfLods * sizeof(MeshLod) });
+
+        record.meshletOffset = AlignUp(offset);
+        offset = record.meshletOffset + mesh.numberOfMeshlets * sizeof(Meshlet);
+        blocks.push_back({ record.meshletOffset, mesh.meshlets, mesh.numberOfMeshlets * sizeof(Meshlet) });
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(cookedPath).parent_path(), ec);
+
+    // write to a temporary of our own and swap it in, so neither a crash nor another writer of
+    // the same key ever leaves a torn cache behind
+    std::string tempPath = UniqueTempPath(cookedPath);
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(MeshRecord));
+        uint64_t position = sizeof(FileHeader) + records.size() * sizeof(MeshRecord);
+
+        for (const Block& block : blocks) {
+            WritePadding(file, position, block.offset);
+            if (block.bytes > 0)
+                file.write(static_cast<const char*>(block.data), static_cast<std::streamsize>(block.bytes));
+            position += block.bytes;
+        }
+
+        if (!file.good()) {
+            file.close();
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+    }
+
+    return ReplaceWithTemp(tempPath, cookedPath);
+}
+
+bool WriteCookedModel(const std::string& cookedPath, const CacheKey& key, double importMs, const std::vector<Mesh>& meshes, bool compress) {
+    std::vector<MeshView> views;
+    views.reserve(meshes.size());
+    for (const Mesh& mesh : meshes) {
+        if (mesh.packedVertices.size() != mesh.vertices.size() * VertexStride(mesh.format) ||
+            mesh.packedIndices.size() != mesh.indices.size() * 3 * IndexSize(mesh.indexFormat))
+            return false;
+        views.push_back(mesh.View());
+    }
+
+    return WriteCookedModel(cookedPath, key, importMs, views, compress);
+}
+
+void RecordCacheHit(double savedMs) {
+    std::lock_guard<std::mutex> lock(StatsMutex);
+    Stats.hits++;
+    Stats.savedMs += savedMs;
+}
+
+void RecordCacheMiss(double importMs) {
+    std::lock_guard<std::mutex> lock(StatsMutex);
+    Stats.misses++;
+    Stats.importMs += importMs;
+}
+
+CacheStats GetCacheStats() {
+    std::lock_guard<std::mutex> lock(StatsMutex);
+    return Stats;
+}
+
+}
\ No newline at end of file
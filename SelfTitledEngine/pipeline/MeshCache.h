@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../Dx11App/types.h"
+#include "Arena.h"
+#include "MappedFile.h"
+#include "SceneBuffers.h"
+
+namespace pipeline {
+
+// identifies the version of a source asset a cooked file was built from
+struct SourceStamp {
+    uint64_t size;
+    int64_t writeTime;
+};
+
+// cooked models and textures live in CacheDirectory, named by a hash of the source bytes and the import
+// settings. Identical files share one entry and any settings change is a miss.
+const char* const CacheDirectory = "Cache";
+
+struct CacheKey {
+    uint64_t contentHash;
+    uint64_t settingsHash;
+};
+
+bool GetSourceStamp(const std::string& filePath, SourceStamp& stamp);
+
+// hashes the source bytes, unless the stamp index remembers a hash for this exact path,
+// size and write time. rehashed tells which of the two happened. Files in a mounted pack
+// take the hash stored with them.
+bool GetContentHash(const std::string& filePath, uint64_t& contentHash, bool& rehashed);
+std::string CookedPathFor(const CacheKey& key);
+// where the cooked texture of the same key goes, see TextureCache.h
+std::string CookedTexturePathFor(const CacheKey& key);
+
+// cooked files are written to a temporary next to their path, named so no other writer, in
+// this process or another, picks the same one
+std::string UniqueTempPath(const std::string& path);
+// swaps a fully written temporary in over path. If that fails another writer of the same key
+// got there first, so the temporary is dropped and whatever is at path counts.
+bool ReplaceWithTemp(const std::string& tempPath, const std::string& path);
+
+// cooked meshes served straight out of a mapped file, valid while this object lives.
+// Compressed meshes are decoded into buffers owned here instead.
+class CookedModel {
+public:
+    bool Load(const std::string& cookedPath, const CacheKey& key);
+    void Unload();
+
+    const std::vector<MeshView>& Meshes() const { return _meshes; }
+    // hands the mapping and anything decoded over to buffers as their staging, the file being
+    // laid out like it already, and moves the views into meshes. Nothing is copied.
+    bool Stage(std::vector<MeshView>& meshes, SceneBuffers& buffers, std::string& error);
+    // how long the import this was cooked from took
+    double ImportMs() const { return _importMs; }
+
+private:
+    MappedFile _file;
+    // decoded compressed meshes
+    Arena _decoded;
+    std::vector<MeshView> _meshes;
+    double _importMs = 0.0;
+};
+
+// writes the packed vertices and indices, see PackVertices and PackIndices. With compress
+// they are stored as GeometryCodec streams, smaller on disk but decoded on every load.
+bool WriteCookedModel(const std::string& cookedPath, const CacheKey& key, double importMs, const std::vector<MeshView>& meshes,
+    bool compress = false);
+bool WriteCookedModel(const std::string& cookedPath, const CacheKey& key, double importMs, const std::vector<Mesh>& meshes,
+    bool compress = false);
+
+// running totals over every cache lookup this run, safe to update from any thread
+struct CacheStats {
+    uint32_t hits;
+    uint32_t misses;
+    // lookups whose stamp was stale, so the whole source had to be read and hashed
+    uint32_t contentHashes;
+    // import time the hits would otherwise have spent
+    double savedMs;
+    // import time spent on misses
+    double importMs;
+};
+
+void RecordCacheHit(double savedMs);
+void RecordCacheMiss(double importMs);
+CacheStats GetCacheStats();
+
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "MeshOptimizer.h"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+#include "MeshBounds.h"
+#include "Overdraw.h"
+#include "Parallel.h"
+#include "VertexCache.h"
+#include "VertexFetch.h"
+
+namespace pipeline {
+
+namespace {
+
+struct MeshReport {
+    CacheStatistics before;
+    CacheStatistics after;
+    // under the LRU cache the reordering targets, which decides whether it's kept
+    CacheStatistics targetBefore;
+    CacheStatistics targetAfter;
+    // only filled in when the overdraw stage ran
+    OverdrawStatistics overdrawBefore;
+    OverdrawStatistics overdrawAfter;
+    FetchStatistics fetchBefore;
+    FetchStatistics fetchAfter;
+};
+
+CacheStatistics Simulate(const Mesh& mesh) {
+    return SimulateVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), ReportCacheSize, CacheModel::Fifo);
+}
+
+CacheStatistics SimulateTarget(const Mesh& mesh) {
+    return SimulateVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), OptimizerCacheSize, CacheModel::Lru);
+}
+
+FetchStatistics Fetch(const std::vector<DirectX::XMUINT3>& indices, size_t vertexCount) {
+    return AnalyzeVertexFetch(indices.data(), indices.size(), vertexCount, sizeof(Vertex), ReportCacheSize);
+}
+
+OverdrawStatistics Overdraw(const Mesh& mesh) {
+    return MeasureOverdraw(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size());
+}
+
+void ClusterForOverdraw(Mesh& mesh, float threshold, MeshReport& report) {
+    report.overdrawBefore = Overdraw(mesh);
+
+    std::vector<DirectX::XMUINT3> cacheOrder = mesh.indices;
+    OptimizeOverdraw(mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), mesh.vertices.size(), ReportCacheSize, threshold);
+
+    CacheStatistics clustered = Simulate(mesh);
+    report.overdrawAfter = Overdraw(mesh);
+
+    // the clusters bound the loss, this makes sure the tail end of a run can't exceed it
+    if (clustered.acmr > threshold * report.after.acmr || report.overdrawAfter.shaded > report.overdrawBefore.shaded) {
+        mesh.indices = std::move(cacheOrder);
+        report.overdrawAfter = report.overdrawBefore;
+        return;
+    }
+
+    report.after = clustered;
+    report.targetAfter = SimulateTarget(mesh);
+}
+
+}
+
+void OptimizeMeshes(const std::string& name, const ImportOptions& options, std::vector<Mesh>& meshes) {
+    std::vector<MeshReport> reports(meshes.size());
+
+    ParallelFor(meshes.size(), 0, [&](size_t i) {
+        Mesh& mesh = meshes[i];
+        reports[i].before = Simulate(mesh);
+        reports[i].targetBefore = SimulateTarget(mesh);
+        reports[i].fetchBefore = Fetch(mesh.indices, mesh.vertices.size());
+
+        // some exporters already write a good order, keep it if the pass can't beat it under
+        // the cache it scores against. Scoped so the copy is gone before the passes below
+        // allocate theirs.
+        {
+            std::vector<DirectX::XMUINT3> original = mesh.indices;
+            OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+            reports[i].targetAfter = SimulateTarget(mesh);
+            reports[i].after = Simulate(mesh);
+
+            if (reports[i].targetAfter.transforms >= reports[i].targetBefore.transforms) {
+                mesh.indices = std::move(original);
+                reports[i].targetAfter = reports[i].targetBefore;
+                reports[i].after = reports[i].before;
+            }
+        }
+
+        if (options.optimizeOverdraw)
+            ClusterForOverdraw(mesh, options.overdrawThreshold, reports[i]);
+
+        // last, so the vertex buffer follows the final triangle order
+        // into scratch buffers, the mesh only takes them if they fetch less
+        FetchStatistics ordered = Fetch(mesh.indices, mesh.vertices.size());
+        std::vector<Vertex> vertices(mesh.vertices.size());
+        std::vector<DirectX::XMUINT3> indices(mesh.indices.size());
+        size_t used = OptimizeVertexFetch(vertices.data(), indices.data(), mesh.vertices.data(), mesh.vertices.size(),
+            mesh.indices.data(), mesh.indices.size());
+        vertices.resize(used);
+        reports[i].fetchAfter = Fetch(indices, used);
+
+        if (reports[i].fetchAfter.bytesFetched <= ordered.bytesFetched) {
+            mesh.vertices = std::move(vertices);
+            mesh.indices = std::move(indices);
+            mesh.numberOfVertices = static_cast<unsigned int>(used);
+            mesh.bounds = ComputeBounds(mesh.vertices.data(), mesh.vertices.size());
+        }
+        else {
+            reports[i].fetchAfter = ordered;
+        }
+    });
+
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < meshes.size(); i++) {
+        report << "optimize " << name << " mesh " << i
+            << ": ACMR " << reports[i].targetBefore.acmr << " -> " << reports[i].targetAfter.acmr << " (LRU " << OptimizerCacheSize << "), "
+            << reports[i].before.acmr << " -> " << reports[i].after.acmr
+            << ", ATVR " << reports[i].before.atvr << " -> " << reports[i].after.atvr
+            << " (FIFO " << ReportCacheSize << ")";
+        if (options.optimizeOverdraw)
+            report << ", overdraw " << reports[i].overdrawBefore.overdraw << " -> " << reports[i].overdrawAfter.overdraw;
+        report << ", overfetch " << reports[i].fetchBefore.overfetch << " -> " << reports[i].fetchAfter.overfetch;
+        report << "\n";
+    }
+    std::cout << report.str() << std::flush;
+}
+
+}
\ No newline at end of file
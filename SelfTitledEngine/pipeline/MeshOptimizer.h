@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../Dx11App/types.h"
+#include "ModelImporter.h"
+
+namespace pipeline {
+
+// cache model the import reports are given in, close to what current GPUs reuse per batch
+constexpr unsigned int ReportCacheSize = 16;
+
+// import time optimization passes, run on every mesh in parallel before the result is
+// cooked. Prints per mesh before/after statistics tagged with name.
+void OptimizeMeshes(const std::string& name, const ImportOptions& options, std::vector<Mesh>& meshes);
+
+}
\ No newline at end of file
@@ -0,0 +1,326 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "Parallel.h"
+
+namespace pipeline {
+
+namespace {
+
+const uint32_t NoTriangle = UINT32_MAX;
+
+// how much a neighbour facing away from the meshlet counts against it, in new vertices
+const float ConeWeight = 0.5f;
+
+// cones wider than this, i.e. triangles this far from the average, can't cull anything
+const float MinConeDot = 0.1f;
+
+inline DirectX::XMFLOAT3 Sub(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) {
+    return DirectX::XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+inline float Dot(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline DirectX::XMFLOAT3 Cross(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) {
+    return DirectX::XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+// zero stays zero
+inline DirectX::XMFLOAT3 Normalize(const DirectX::XMFLOAT3& v) {
+    float length = std::sqrt(Dot(v, v));
+    if (length == 0.0f)
+        return v;
+    return DirectX::XMFLOAT3(v.x / length, v.y / length, v.z / length);
+}
+
+DirectX::XMFLOAT4 MakePlane(const DirectX::XMFLOAT3& normal, const DirectX::XMFLOAT3& point) {
+    DirectX::XMFLOAT3 n = Normalize(normal);
+    return DirectX::XMFLOAT4(n.x, n.y, n.z, -Dot(n, point));
+}
+
+// Ritter's sphere: a guess from two far apart points, grown to cover every point
+void BoundingSphere(const Vertex* vertices, const uint32_t* indices, size_t count, DirectX::XMFLOAT3& center, float& radius) {
+    const DirectX::XMFLOAT3& first = vertices[indices[0]].Pos;
+
+    auto farthest = [&](const DirectX::XMFLOAT3& from) {
+        size_t best = 0;
+        float bestDistance = -1.0f;
+        for (size_t i = 0; i < count; i++) {
+            DirectX::XMFLOAT3 d = Sub(vertices[indices[i]].Pos, from);
+            float distance = Dot(d, d);
+            if (distance > bestDistance) {
+                bestDistance = distance;
+                best = i;
+            }
+        }
+        return vertices[indices[best]].Pos;
+    };
+
+    DirectX::XMFLOAT3 a = farthest(first);
+    DirectX::XMFLOAT3 b = farthest(a);
+    center = DirectX::XMFLOAT3((a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f, (a.z + b.z) * 0.5f);
+    DirectX::XMFLOAT3 ab = Sub(b, a);
+    radius = std::sqrt(Dot(ab, ab)) * 0.5f;
+
+    for (size_t i = 0; i < count; i++) {
+        DirectX::XMFLOAT3 d = Sub(vertices[indices[i]].Pos, center);
+        float distance = std::sqrt(Dot(d, d));
+        if (distance <= radius)
+            continue;
+
+        // move towards the point just far enough to take it in
+        float grown = (radius + distance) * 0.5f;
+        float shift = (grown - radius) / distance;
+        center = DirectX::XMFLOAT3(center.x + d.x * shift, center.y + d.y * shift, center.z + d.z * shift);
+        radius = grown;
+    }
+}
+
+// bounding sphere and normal cone of one finished meshlet
+void ComputeMeshletBounds(Meshlet& meshlet, const DirectX::XMUINT3* triangles, const DirectX::XMFLOAT3* normals,
+    const Vertex* vertices, const std::vector<uint32_t>& meshletVertices) {
+    BoundingSphere(vertices, meshletVertices.data(), meshletVertices.size(), meshlet.center, meshlet.radius);
+
+    const size_t first = meshlet.firstIndex / 3;
+    const size_t count = meshlet.numberOfIndices / 3;
+
+    DirectX::XMFLOAT3 sum(0.0f, 0.0f, 0.0f);
+    for (size_t i = first; i < first + count; i++) {
+        sum.x += normals[i].x;
+        sum.y += normals[i].y;
+        sum.z += normals[i].z;
+    }
+    DirectX::XMFLOAT3 axis = Normalize(sum);
+
+    float minDot = 1.0f;
+    for (size_t i = first; i < first + count; i++) {
+        if (Dot(normals[i], normals[i]) > 0.0f)
+            minDot = std::min(minDot, Dot(normals[i], axis));
+    }
+
+    meshlet.coneAxis = axis;
+    meshlet.coneApex = meshlet.center;
+    meshlet.coneCutoff = 2.0f;
+
+    if (Dot(axis, axis) == 0.0f || minDot <= MinConeDot)
+        return;
+
+    // slide the apex back along the axis until it is behind every triangle's plane, so the
+    // test holds for eyes close to the meshlet too
+    float maxT = 0.0f;
+    for (size_t i = first; i < first + count; i++) {
+        if (Dot(normals[i], normals[i]) == 0.0f)
+            continue;
+
+        float distance = Dot(Sub(meshlet.center, vertices[triangles[i].x].Pos), normals[i]);
+        maxT = std::max(maxT, distance / Dot(axis, normals[i]));
+    }
+
+    meshlet.coneApex = DirectX::XMFLOAT3(meshlet.center.x - axis.x * maxT, meshlet.center.y - axis.y * maxT, meshlet.center.z - axis.z * maxT);
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+}
+
+std::vector<Meshlet> BuildMeshlets(DirectX::XMUINT3* triangles, size_t triangleCount, const Vertex* vertices, size_t vertexCount) {
+    std::vector<Meshlet> meshlets;
+    if (triangleCount == 0)
+        return meshlets;
+
+    // triangles around each vertex
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount; i++) {
+        offsets[triangles[i].x + 1]++;
+        offsets[triangles[i].y + 1]++;
+        offsets[triangles[i].z + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] += offsets[v];
+
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < triangleCount; i++) {
+        adjacency[fill[triangles[i].x]++] = static_cast<uint32_t>(i);
+        adjacency[fill[triangles[i].y]++] = static_cast<uint32_t>(i);
+        adjacency[fill[triangles[i].z]++] = static_cast<uint32_t>(i);
+    }
+
+    std::vector<DirectX::XMFLOAT3> normals(triangleCount);
+    for (size_t i = 0; i < triangleCount; i++) {
+        const DirectX::XMFLOAT3& a = vertices[triangles[i].x].Pos;
+        normals[i] = Normalize(Cross(Sub(vertices[triangles[i].y].Pos, a), Sub(vertices[triangles[i].z].Pos, a)));
+    }
+
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    // meshlet each vertex was last added to
+    std::vector<uint32_t> owner(vertexCount, UINT32_MAX);
+    std::vector<uint32_t> order;
+    order.reserve(triangleCount);
+    std::vector<std::vector<uint32_t>> meshletVertices;
+
+    size_t cursor = 0;
+    while (order.size() < triangleCount) {
+        // seed with the first triangle left in input order, it's next to the previous meshlet
+        // more often than not after the vertex cache pass
+        while (emitted[cursor])
+            cursor++;
+
+        const uint32_t id = static_cast<uint32_t>(meshlets.size());
+        Meshlet meshlet = {};
+        meshlet.firstIndex = static_cast<uint32_t>(order.size() * 3);
+        meshletVertices.emplace_back();
+        std::vector<uint32_t>& used = meshletVertices.back();
+        DirectX::XMFLOAT3 normalSum(0.0f, 0.0f, 0.0f);
+
+        uint32_t next = static_cast<uint32_t>(cursor);
+        while (next != NoTriangle) {
+            emitted[next] = 1;
+            order.push_back(next);
+
+            const uint32_t corners[3] = { triangles[next].x, triangles[next].y, triangles[next].z };
+            for (uint32_t vertex : corners) {
+                if (owner[vertex] != id) {
+                    owner[vertex] = id;
+                    used.push_back(vertex);
+                }
+            }
+            normalSum.x += normals[next].x;
+            normalSum.y += normals[next].y;
+            normalSum.z += normals[next].z;
+
+            if (order.size() * 3 - meshlet.firstIndex >= MaxMeshletTriangles * 3)
+                break;
+
+            // the neighbour adding the fewest vertices, ties go to the one facing the same way
+            // and then to input order
+            DirectX::XMFLOAT3 axis = Normalize(normalSum);
+            next = NoTriangle;
+            float bestScore = 0.0f;
+
+            for (uint32_t vertex : used) {
+                for (uint32_t k = offsets[vertex]; k < offsets[vertex + 1]; k++) {
+                    uint32_t candidate = adjacency[k];
+                    if (emitted[candidate])
+                        continue;
+
+                    const DirectX::XMUINT3& t = triangles[candidate];
+                    size_t added = (owner[t.x] != id) + (owner[t.y] != id) + (owner[t.z] != id);
+                    if (used.size() + added > MaxMeshletVertices)
+                        continue;
+
+                    float score = added + ConeWeight * (1.0f - Dot(normals[candidate], axis));
+                    if (next == NoTriangle || score < bestScore || (score == bestScore && candidate < next)) {
+                        next = candidate;
+                        bestScore = score;
+                    }
+                }
+            }
+        }
+
+        meshlet.numberOfIndices = static_cast<uint32_t>(order.size() * 3 - meshlet.firstIndex);
+        meshlet.numberOfVertices = static_cast<uint32_t>(used.size());
+        meshlets.push_back(meshlet);
+    }
+
+    std::vector<DirectX::XMUINT3> reordered(triangleCount);
+    std::vector<DirectX::XMFLOAT3> reorderedNormals(triangleCount);
+    for (size_t i = 0; i < triangleCount; i++) {
+        reordered[i] = triangles[order[i]];
+        reorderedNormals[i] = normals[order[i]];
+    }
+    std::copy(reordered.begin(), reordered.end(), triangles);
+
+    ParallelFor(meshlets.size(), 0, [&](size_t i) {
+        ComputeMeshletBounds(meshlets[i], triangles, reorderedNormals.data(), vertices, meshletVertices[i]);
+    });
+
+    return meshlets;
+}
+
+void BuildMeshlets(const std::string& name, std::vector<Mesh>& meshes) {
+    ParallelFor(meshes.size(), 0, [&](size_t i) {
+        Mesh& mesh = meshes[i];
+        mesh.meshlets = BuildMeshlets(mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), mesh.vertices.size());
+    });
+
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < meshes.size(); i++) {
+        const Mesh& mesh = meshes[i];
+
+        size_t vertices = 0;
+        size_t cones = 0;
+        for (const Meshlet& meshlet : mesh.meshlets) {
+            vertices += meshlet.numberOfVertices;
+            if (meshlet.coneCutoff <= 1.0f)
+                cones++;
+        }
+
+        size_t count = std::max<size_t>(mesh.meshlets.size(), 1);
+        report << "meshlets " << name << " mesh " << i << ": " << mesh.meshlets.size() << " meshlets, "
+            << double(vertices) / count << " vertices and " << double(mesh.indices.size()) / count << " triangles each, "
+            << 100.0 * cones / count << "% with a usable cone\n";
+    }
+    std::cout << report.str() << std::flush;
+}
+
+CullView MakeCullView(const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& target, const DirectX::XMFLOAT3& up,
+    float fovAngleY, float aspectRatio, float nearZ, float farZ) {
+    // left handed, like XMMatrixLookAtLH
+    DirectX::XMFLOAT3 forward = Normalize(Sub(target, position));
+    DirectX::XMFLOAT3 right = Normalize(Cross(up, forward));
+    DirectX::XMFLOAT3 upward = Cross(forward, right);
+
+    float tanY = std::tan(fovAngleY * 0.5f);
+    float tanX = tanY * aspectRatio;
+
+    auto along = [&](const DirectX::XMFLOAT3& axis, float sign, float slope) {
+        return DirectX::XMFLOAT3(axis.x * sign + forward.x * slope, axis.y * sign + forward.y * slope, axis.z * sign + forward.z * slope);
+    };
+
+    CullView view;
+    view.position = position;
+    view.planes[0] = MakePlane(along(right, 1.0f, tanX), position);
+    view.planes[1] = MakePlane(along(right, -1.0f, tanX), position);
+    view.planes[2] = MakePlane(along(upward, 1.0f, tanY), position);
+    view.planes[3] = MakePlane(along(upward, -1.0f, tanY), position);
+
+    DirectX::XMFLOAT3 nearPoint(position.x + forward.x * nearZ, position.y + forward.y * nearZ, position.z + forward.z * nearZ);
+    DirectX::XMFLOAT3 farPoint(position.x + forward.x * farZ, position.y + forward.y * farZ, position.z + forward.z * farZ);
+    view.planes[4] = MakePlane(forward, nearPoint);
+    view.planes[5] = MakePlane(DirectX::XMFLOAT3(-forward.x, -forward.y, -forward.z), farPoint);
+    return view;
+}
+
+size_t CullMeshlets(const Meshlet* meshlets, size_t count, const CullView& view, uint32_t* visible) {
+    size_t visibleCount = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const Meshlet& meshlet = meshlets[i];
+
+        bool outside = false;
+        for (const DirectX::XMFLOAT4& plane : view.planes) {
+            float distance = plane.x * meshlet.center.x + plane.y * meshlet.center.y + plane.z * meshlet.center.z + plane.w;
+            outside |= distance < -meshlet.radius;
+        }
+
+        // the eye sits inside the cone behind every triangle
+        DirectX::XMFLOAT3 toApex = Sub(meshlet.coneApex, view.position);
+        float length = std::sqrt(Dot(toApex, toApex));
+        bool backfacing = Dot(toApex, meshlet.coneAxis) >= meshlet.coneCutoff * length;
+
+        visible[visibleCount] = static_cast<uint32_t>(i);
+        visibleCount += !(outside || backfacing);
+    }
+
+    return visibleCount;
+}
+
+}
\ No newline at end of file
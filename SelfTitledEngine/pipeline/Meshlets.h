@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "../Dx11App/types.h"
+
+namespace pipeline {
+
+// sized for mesh shader friendly clusters, 124 triangles leaves room for a header in 128
+constexpr size_t MaxMeshletVertices = 64;
+constexpr size_t MaxMeshletTriangles = 124;
+
+// reorders triangles in place so each meshlet is a contiguous run and returns the meshlets,
+// with firstIndex counted from triangles. Meshlets are grown greedily from a seed triangle,
+// preferring neighbours that add the fewest new vertices and face the same way.
+std::vector<Meshlet> BuildMeshlets(DirectX::XMUINT3* triangles, size_t triangleCount, const Vertex* vertices, size_t vertexCount);
+
+// clusters the full level of every mesh in parallel, before GenerateLods appends the other
+// levels. Prints per mesh meshlet counts tagged with name.
+void BuildMeshlets(const std::string& name, std::vector<Mesh>& meshes);
+
+// what culling needs from a camera, in model space
+struct CullView {
+    DirectX::XMFLOAT3 position;
+    // left, right, bottom, top, near, far; xyz points inside and w is the distance term
+    DirectX::XMFLOAT4 planes[6];
+};
+
+CullView MakeCullView(const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& target, const DirectX::XMFLOAT3& up,
+    float fovAngleY, float aspectRatio, float nearZ, float farZ);
+
+// writes the index of every meshlet that may be visible to visible, returns how many.
+// Rejects meshlets outside the frustum and ones whose normal cone faces away from the eye.
+size_t CullMeshlets(const Meshlet* meshlets, size_t count, const CullView& view, uint32_t* visible);
+
+}
\ No newline at end of file
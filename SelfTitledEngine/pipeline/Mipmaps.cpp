@@ -0,0 +1,531 @@
+#include "Mipmaps.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#include "CpuFeatures.h"
+#include "Parallel.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define PIPELINE_SSE2
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+namespace pipeline {
+
+namespace {
+
+constexpr float Pi = 3.14159265358979f;
+
+// target rows handed to a thread at a time. Each tile filters its source rows across once, the
+// rows it shares with the tile above are filtered again.
+constexpr uint32_t MinTileRows = 8;
+constexpr uint32_t MaxTileRows = 64;
+
+// linear values from 2^-13 up to 1 are encoded through a table indexed by their exponent and
+// top 10 mantissa bits. Anything smaller encodes to 0.
+constexpr uint32_t SmallestLinearBits = 114u << 23;
+constexpr uint32_t LinearBuckets = 13u << 10;
+
+struct ConversionTables {
+    float srgbToLinear[256];
+    float unormToFloat[256];
+    uint8_t linearToSrgb[LinearBuckets];
+};
+
+float ExactToLinear(float c) {
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+float ExactToSrgb(float linear) {
+    return linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+}
+
+const ConversionTables& Tables() {
+    static const ConversionTables tables = [] {
+        ConversionTables built;
+        for (int i = 0; i < 256; i++) {
+            built.srgbToLinear[i] = ExactToLinear(i / 255.0f);
+            built.unormToFloat[i] = i / 255.0f;
+        }
+        // each bucket encodes the value at its middle
+        for (uint32_t i = 0; i < LinearBuckets; i++) {
+            uint32_t bits = SmallestLinearBits + (i << 13) + (1u << 12);
+            float linear;
+            std::memcpy(&linear, &bits, sizeof(linear));
+            built.linearToSrgb[i] = static_cast<uint8_t>(std::min(255.0f, ExactToSrgb(linear) * 255.0f + 0.5f));
+        }
+        return built;
+    }();
+    return tables;
+}
+
+float Sinc(float x) {
+    if (std::fabs(x) < 1e-6f)
+        return 1.0f;
+    return std::sin(Pi * x) / (Pi * x);
+}
+
+// modified Bessel function of the first kind, order 0
+float BesselI0(float x) {
+    float sum = 1.0f, term = 1.0f;
+    for (int k = 1; k < 20; k++) {
+        term *= (x * 0.5f / k) * (x * 0.5f / k);
+        sum += term;
+    }
+    return sum;
+}
+
+float FilterRadius(MipFilter filter) {
+    switch (filter) {
+    case MipFilter::Box: return 0.5f;
+    case MipFilter::Kaiser: return 2.0f;
+    case MipFilter::Lanczos: return 3.0f;
+    }
+    return 0.5f;
+}
+
+// the windowed sincs at x target texels from the center
+float FilterWeight(MipFilter filter, float x) {
+    float radius = FilterRadius(filter);
+    if (std::fabs(x) >= radius)
+        return 0.0f;
+
+    if (filter == MipFilter::Kaiser) {
+        const float alpha = 4.0f;
+        float t = x / radius;
+        return Sinc(x) * BesselI0(alpha * std::sqrt(1.0f - t * t)) / BesselI0(alpha);
+    }
+    return Sinc(x) * Sinc(x / radius);
+}
+
+// the source texels one axis of every target texel reads, a contiguous run each, and how much
+// of each it takes. Weights are padded to taps per target texel.
+struct Axis {
+    uint32_t taps = 0;
+    std::vector<uint32_t> first;
+    std::vector<uint32_t> count;
+    std::vector<float> weights;
+    // halving an even size, target texels in [evenBegin, evenEnd) reach no edge, so they all
+    // read taps texels with the same weights, each run two texels on from the one before
+    uint32_t evenBegin = 0;
+    uint32_t evenEnd = 0;
+};
+
+Axis BuildAxis(uint32_t source, uint32_t target, MipFilter filter) {
+    float scale = float(source) / float(target);
+    float radius = FilterRadius(filter) * scale;
+
+    std::vector<std::vector<float>> runs(target);
+    Axis axis;
+    axis.first.resize(target);
+    axis.count.resize(target);
+
+    for (uint32_t x = 0; x < target; x++) {
+        float center = (x + 0.5f) * scale;
+        int low = static_cast<int>(std::floor(center - radius));
+        int high = static_cast<int>(std::ceil(center + radius)) - 1;
+
+        // past the edges folds onto the edge texels
+        int first = std::max(low, 0), last = std::min(high, int(source) - 1);
+        if (source == target * 2 && low >= 0 && high < int(source)) {
+            if (axis.evenEnd == 0)
+                axis.evenBegin = x;
+            axis.evenEnd = x + 1;
+        }
+        std::vector<float>& run = runs[x];
+        run.assign(last - first + 1, 0.0f);
+        for (int i = low; i <= high; i++) {
+            float weight;
+            if (filter == MipFilter::Box)
+                weight = std::max(0.0f, std::min(i + 1.0f, center + radius) - std::max(float(i), center - radius));
+            else
+                weight = FilterWeight(filter, (i + 0.5f - center) / scale);
+            run[std::min(std::max(i, first), last) - first] += weight;
+        }
+
+        // the box's exact 2:1 case and the kernels' zero crossings leave nothing at the ends
+        while (run.size() > 1 && std::fabs(run.back()) < 1e-6f)
+            run.pop_back();
+        while (run.size() > 1 && std::fabs(run.front()) < 1e-6f) {
+            run.erase(run.begin());
+            first++;
+        }
+
+        float sum = 0.0f;
+        for (float weight : run)
+            sum += weight;
+        for (float& weight : run)
+            weight /= sum;
+
+        axis.first[x] = static_cast<uint32_t>(first);
+        axis.count[x] = static_cast<uint32_t>(run.size());
+        axis.taps = std::max(axis.taps, axis.count[x]);
+    }
+
+    axis.weights.assign(size_t(target) * axis.taps, 0.0f);
+    for (uint32_t x = 0; x < target; x++)
+        std::copy(runs[x].begin(), runs[x].end(), axis.weights.begin() + size_t(x) * axis.taps);
+    return axis;
+}
+
+// a row of rgba8 texels to linear floats
+void LoadRow(const uint8_t* texels, uint32_t width, bool srgb, float* row) {
+    const ConversionTables& tables = Tables();
+#ifdef PIPELINE_SSE2
+    // the same divide the table was built with, so both round alike
+    if (!srgb) {
+        const __m128 scale = _mm_set1_ps(255.0f);
+        const __m128i zero = _mm_setzero_si128();
+        uint32_t x = 0;
+        for (; x + 4 <= width; x += 4, texels += 16, row += 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(texels));
+            __m128i low = _mm_unpacklo_epi8(bytes, zero), high = _mm_unpackhi_epi8(bytes, zero);
+            _mm_storeu_ps(row, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale));
+            _mm_storeu_ps(row + 4, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale));
+            _mm_storeu_ps(row + 8, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale));
+            _mm_storeu_ps(row + 12, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale));
+        }
+        width -= x;
+    }
+#endif
+    const float* color = srgb ? tables.srgbToLinear : tables.unormToFloat;
+    for (uint32_t x = 0; x < width; x++, texels += 4, row += 4) {
+        row[0] = color[texels[0]];
+        row[1] = color[texels[1]];
+        row[2] = color[texels[2]];
+        row[3] = tables.unormToFloat[texels[3]];
+    }
+}
+
+// and back, clamped since the sincs overshoot
+void StoreRow(const float* row, uint32_t width, bool srgb, uint8_t* texels) {
+    const uint8_t* encode = Tables().linearToSrgb;
+    for (uint32_t x = 0; x < width; x++, row += 4, texels += 4) {
+#ifdef PIPELINE_SSE2
+        __m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(row), _mm_setzero_ps()), _mm_set1_ps(0.99999994f));
+        __m128i scaled = _mm_cvtps_epi32(_mm_mul_ps(value, _mm_set1_ps(255.0f)));
+        uint32_t texel;
+        if (srgb) {
+            // below the smallest bucket clamps onto bucket 0, which encodes to 0 as well
+            __m128i bits = _mm_castps_si128(_mm_max_ps(value, _mm_castsi128_ps(_mm_set1_epi32(SmallestLinearBits))));
+            __m128i buckets = _mm_srli_epi32(_mm_sub_epi32(bits, _mm_set1_epi32(SmallestLinearBits)), 13);
+            texel = uint32_t(encode[_mm_cvtsi128_si32(buckets)]) |
+                uint32_t(encode[_mm_cvtsi128_si32(_mm_srli_si128(buckets, 4))]) << 8 |
+                uint32_t(encode[_mm_cvtsi128_si32(_mm_srli_si128(buckets, 8))]) << 16 |
+                uint32_t(_mm_cvtsi128_si32(_mm_srli_si128(scaled, 12))) << 24;
+        }
+        else {
+            __m128i packed = _mm_packs_epi32(scaled, scaled);
+            texel = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(packed, packed)));
+        }
+        std::memcpy(texels, &texel, sizeof(texel));
+#else
+        for (int c = 0; c < 4; c++) {
+            float value = std::min(std::max(row[c], 0.0f), 0.99999994f);
+            if (srgb && c < 3) {
+                uint32_t bits;
+                float clamped = std::max(value, 1.0f / 8192.0f);
+                std::memcpy(&bits, &clamped, sizeof(bits));
+                texels[c] = encode[(bits - SmallestLinearBits) >> 13];
+            }
+            else
+                texels[c] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+        }
+#endif
+    }
+}
+
+// target texels [begin, end) of one row filtered across, a texel being the four floats of
+// one register
+void FilterTexels(const float* row, const Axis& axis, uint32_t begin, uint32_t end, float* filtered) {
+    filtered += size_t(begin) * 4;
+    for (uint32_t x = begin; x < end; x++, filtered += 4) {
+        const float* weights = axis.weights.data() + size_t(x) * axis.taps;
+        const float* texel = row + size_t(axis.first[x]) * 4;
+        uint32_t count = axis.count[x];
+#ifdef PIPELINE_SSE2
+        __m128 sum = _mm_mul_ps(_mm_set1_ps(weights[0]), _mm_loadu_ps(texel));
+        for (uint32_t k = 1; k < count; k++)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(texel + k * 4)));
+        _mm_storeu_ps(filtered, sum);
+#else
+        for (int c = 0; c < 4; c++) {
+            float sum = 0.0f;
+            for (uint32_t k = 0; k < count; k++)
+                sum += weights[k] * texel[k * 4 + c];
+            filtered[c] = sum;
+        }
+#endif
+    }
+}
+
+#ifdef PIPELINE_SSE2
+// the even run of an axis, weights held in registers and the tap loop unrolled. The kernels
+// are symmetric, so texels the same distance either side share one multiply.
+template <uint32_t Taps>
+void FilterEven(const float* row, const Axis& axis, uint32_t begin, uint32_t end, float* filtered) {
+    __m128 weights[Taps / 2];
+    for (uint32_t k = 0; k < Taps / 2; k++)
+        weights[k] = _mm_set1_ps(axis.weights[size_t(axis.evenBegin) * axis.taps + k]);
+
+    const float* texel = row + size_t(axis.first[begin]) * 4;
+    filtered += size_t(begin) * 4;
+    for (uint32_t x = begin; x < end; x++, texel += 8, filtered += 4) {
+        __m128 sum = _mm_mul_ps(weights[0], _mm_add_ps(_mm_loadu_ps(texel), _mm_loadu_ps(texel + (Taps - 1) * 4)));
+        for (uint32_t k = 1; k < Taps / 2; k++) {
+            __m128 pair = _mm_add_ps(_mm_loadu_ps(texel + k * 4), _mm_loadu_ps(texel + (Taps - 1 - k) * 4));
+            sum = _mm_add_ps(sum, _mm_mul_ps(weights[k], pair));
+        }
+        _mm_storeu_ps(filtered, sum);
+    }
+}
+
+// two texels to a register, one per 128 bit lane
+PIPELINE_TARGET("avx2")
+inline __m256 LoadTexels(const float* low, const float* high) {
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(low)), _mm_loadu_ps(high), 1);
+}
+
+// FilterTexels two target texels to a register. The shorter run of a pair reads its last
+// texel again under the zero weights it's padded with.
+PIPELINE_TARGET("avx2")
+void FilterTexelsAvx2(const float* row, const Axis& axis, uint32_t begin, uint32_t end, float* filtered) {
+    uint32_t x = begin;
+    for (; x + 2 <= end; x += 2) {
+        const float* weights = axis.weights.data() + size_t(x) * axis.taps;
+        const float* low = row + size_t(axis.first[x]) * 4;
+        const float* high = row + size_t(axis.first[x + 1]) * 4;
+        uint32_t lowLast = axis.count[x] - 1, highLast = axis.count[x + 1] - 1;
+        uint32_t count = std::max(lowLast, highLast) + 1;
+
+        __m256 sum = _mm256_setzero_ps();
+        for (uint32_t k = 0; k < count; k++) {
+            __m256 weight = _mm256_insertf128_ps(_mm256_set1_ps(weights[k]), _mm_set1_ps(weights[axis.taps + k]), 1);
+            __m256 texels = LoadTexels(low + std::min(k, lowLast) * 4, high + std::min(k, highLast) * 4);
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(weight, texels));
+        }
+        _mm256_storeu_ps(filtered + size_t(x) * 4, sum);
+    }
+    FilterTexels(row, axis, x, end, filtered);
+}
+
+// FilterEven two target texels to a register, the run under x + 1 starting two texels after
+// the one under x
+template <uint32_t Taps>
+PIPELINE_TARGET("avx2")
+void FilterEvenAvx2(const float* row, const Axis& axis, uint32_t begin, uint32_t end, float* filtered) {
+    __m256 weights[Taps / 2];
+    for (uint32_t k = 0; k < Taps / 2; k++)
+        weights[k] = _mm256_set1_ps(axis.weights[size_t(axis.evenBegin) * axis.taps + k]);
+
+    const float* texel = row + size_t(axis.first[begin]) * 4;
+    uint32_t x = begin;
+    for (; x + 2 <= end; x += 2, texel += 16) {
+        __m256 sum = _mm256_mul_ps(weights[0], _mm256_add_ps(LoadTexels(texel, texel + 8),
+            LoadTexels(texel + (Taps - 1) * 4, texel + (Taps + 1) * 4)));
+        for (uint32_t k = 1; k < Taps / 2; k++) {
+            __m256 pair = _mm256_add_ps(LoadTexels(texel + k * 4, texel + (k + 2) * 4),
+                LoadTexels(texel + (Taps - 1 - k) * 4, texel + (Taps + 1 - k) * 4));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(weights[k], pair));
+        }
+        _mm256_storeu_ps(filtered + size_t(x) * 4, sum);
+    }
+    FilterEven<Taps>(row, axis, x, end, filtered);
+}
+#endif
+
+void FilterAcross(const float* row, const Axis& axis, uint32_t width, float* filtered) {
+#ifdef PIPELINE_SSE2
+    static const bool avx2 = HasAvx2();
+    auto filterTexels = avx2 ? FilterTexelsAvx2 : FilterTexels;
+
+    // what halving gives the three filters, 4 taps per texel of radius
+    if (axis.evenEnd > axis.evenBegin && (axis.taps == 2 || axis.taps == 8 || axis.taps == 12)) {
+        if (axis.taps == 2)
+            (avx2 ? FilterEvenAvx2<2> : FilterEven<2>)(row, axis, axis.evenBegin, axis.evenEnd, filtered);
+        else if (axis.taps == 8)
+            (avx2 ? FilterEvenAvx2<8> : FilterEven<8>)(row, axis, axis.evenBegin, axis.evenEnd, filtered);
+        else
+            (avx2 ? FilterEvenAvx2<12> : FilterEven<12>)(row, axis, axis.evenBegin, axis.evenEnd, filtered);
+        filterTexels(row, axis, 0, axis.evenBegin, filtered);
+        filterTexels(row, axis, axis.evenEnd, width, filtered);
+        return;
+    }
+    filterTexels(row, axis, 0, width, filtered);
+#else
+    FilterTexels(row, axis, 0, width, filtered);
+#endif
+}
+
+// floats [begin, stride) of one target row from count filtered rows
+void FilterDown(const float* const* rows, size_t stride, const float* weights, uint32_t count, float* out, size_t begin = 0) {
+    size_t i = begin;
+#ifdef PIPELINE_SSE2
+    for (; i + 4 <= stride; i += 4) {
+        __m128 sum = _mm_mul_ps(_mm_set1_ps(weights[0]), _mm_loadu_ps(rows[0] + i));
+        for (uint32_t k = 1; k < count; k++)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i)));
+        _mm_storeu_ps(out + i, sum);
+    }
+#endif
+    for (; i < stride; i++) {
+        float sum = 0.0f;
+        for (uint32_t k = 0; k < count; k++)
+            sum += weights[k] * rows[k][i];
+        out[i] = sum;
+    }
+}
+
+#ifdef PIPELINE_SSE2
+// FilterDown eight floats, two texels, at a time
+PIPELINE_TARGET("avx2")
+void FilterDownAvx2(const float* const* rows, size_t stride, const float* weights, uint32_t count, float* out) {
+    size_t i = 0;
+    for (; i + 8 <= stride; i += 8) {
+        __m256 sum = _mm256_mul_ps(_mm256_set1_ps(weights[0]), _mm256_loadu_ps(rows[0] + i));
+        for (uint32_t k = 1; k < count; k++)
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + i)));
+        _mm256_storeu_ps(out + i, sum);
+    }
+    FilterDown(rows, stride, weights, count, out, i);
+}
+#endif
+
+// one target row on the widest registers the cpu has
+void FilterRows(const float* const* rows, size_t stride, const float* weights, uint32_t count, float* out) {
+#ifdef PIPELINE_SSE2
+    static const bool avx2 = HasAvx2();
+    if (avx2) {
+        FilterDownAvx2(rows, stride, weights, count, out);
+        return;
+    }
+#endif
+    FilterDown(rows, stride, weights, count, out);
+}
+
+// clamped like the level stored from it, so the sincs' overshoot doesn't build up down the chain
+void ClampRow(float* row, size_t count) {
+    size_t i = 0;
+#ifdef PIPELINE_SSE2
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(row + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(row + i), _mm_setzero_ps()), _mm_set1_ps(1.0f)));
+#endif
+    for (; i < count; i++)
+        row[i] = std::min(std::max(row[i], 0.0f), 1.0f);
+}
+
+// source rows come from load(y, scratch), in linear light, converted into scratch where they
+// have to be. Target rows are stored as rgba8, and kept in linear, height * width * 4 floats,
+// when linear isn't null.
+template <typename Load>
+void Resample(uint32_t sourceWidth, uint32_t sourceHeight, const Load& load, uint32_t width, uint32_t height,
+    const MipOptions& options, Image& target, float* linear) {
+    target.width = width;
+    target.height = height;
+    target.rgba.resize(size_t(width) * height * 4);
+    size_t stride = size_t(width) * 4;
+
+    // built once per level, every row and tile reads the same weights
+    Axis across = BuildAxis(sourceWidth, width, options.filter);
+    Axis down = BuildAxis(sourceHeight, height, options.filter);
+
+    // a few tiles per thread so uneven ones balance, as tall as that allows
+    unsigned int threads = options.threadCount ? options.threadCount : DefaultThreadCount();
+    uint32_t tileRows = std::max(MinTileRows, std::min(MaxTileRows, height / (threads * 4)));
+
+    ParallelFor((height + tileRows - 1) / tileRows, options.threadCount, [&](size_t tile) {
+        uint32_t firstRow = static_cast<uint32_t>(tile) * tileRows;
+        uint32_t endRow = std::min(height, firstRow + tileRows);
+
+        // the source rows under one target row, filtered across, in a ring. A run is at most
+        // taps rows long, so a row's slot is free again by the time the row taps on needs it.
+        std::unique_ptr<float[]> loaded(new float[size_t(sourceWidth) * 4]);
+        std::unique_ptr<float[]> ring(new float[size_t(down.taps) * stride]);
+        std::unique_ptr<float[]> out(new float[stride]);
+        std::vector<const float*> rows(down.taps);
+
+        // runs only move forward, so every source row is filtered across once per tile
+        uint32_t next = down.first[firstRow];
+        for (uint32_t y = firstRow; y < endRow; y++) {
+            next = std::max(next, down.first[y]);
+            for (; next < down.first[y] + down.count[y]; next++)
+                FilterAcross(load(next, loaded.get()), across, width, ring.get() + (next % down.taps) * stride);
+
+            for (uint32_t k = 0; k < down.count[y]; k++)
+                rows[k] = ring.get() + ((down.first[y] + k) % down.taps) * stride;
+
+            float* row = linear ? linear + y * stride : out.get();
+            FilterRows(rows.data(), stride, down.weights.data() + size_t(y) * down.taps, down.count[y], row);
+            if (linear)
+                ClampRow(row, stride);
+            StoreRow(row, width, options.srgb, target.rgba.data() + y * stride);
+        }
+    });
+}
+
+}
+
+uint32_t MipCount(uint32_t width, uint32_t height) {
+    uint32_t count = 1;
+    while (width > 1 || height > 1) {
+        width = MipSize(width, 1);
+        height = MipSize(height, 1);
+        count++;
+    }
+    return count;
+}
+
+const char* MipFilterName(MipFilter filter) {
+    switch (filter) {
+    case MipFilter::Box: return "box";
+    case MipFilter::Kaiser: return "kaiser";
+    case MipFilter::Lanczos: return "lanczos";
+    }
+    return "unknown";
+}
+
+void Downsample(const Image& source, uint32_t width, uint32_t height, const MipOptions& options, Image& target) {
+    if (width == source.width && height == source.height) {
+        target = source;
+        return;
+    }
+
+    auto load = [&](uint32_t y, float* scratch) -> const float* {
+        LoadRow(source.rgba.data() + size_t(y) * source.width * 4, source.width, options.srgb, scratch);
+        return scratch;
+    };
+    Resample(source.width, source.height, load, width, height, options, target, nullptr);
+}
+
+void GenerateMips(const Image& image, const MipOptions& options, std::vector<Image>& mips) {
+    uint32_t count = MipCount(image.width, image.height);
+    mips.resize(count - 1);
+    if (count == 1)
+        return;
+
+    // the first level is filtered from image, the rest from the linear floats of the level
+    // above, so only the stored levels get rounded to 8 bits. Two buffers sized for the first
+    // two levels take turns, left uninitialized since every float is written before it's read.
+    std::unique_ptr<float[]> above(new float[size_t(MipSize(image.width, 1)) * MipSize(image.height, 1) * 4]);
+    std::unique_ptr<float[]> below(new float[size_t(MipSize(image.width, 2)) * MipSize(image.height, 2) * 4]);
+    auto loadImage = [&](uint32_t y, float* scratch) -> const float* {
+        LoadRow(image.rgba.data() + size_t(y) * image.width * 4, image.width, options.srgb, scratch);
+        return scratch;
+    };
+    Resample(image.width, image.height, loadImage, MipSize(image.width, 1), MipSize(image.height, 1), options, mips[0], above.get());
+
+    for (uint32_t level = 2; level < count; level++) {
+        uint32_t aboveWidth = MipSize(image.width, level - 1);
+        const float* aboveRows = above.get();
+        auto loadAbove = [&](uint32_t y, float*) -> const float* { return aboveRows + size_t(y) * aboveWidth * 4; };
+        Resample(aboveWidth, MipSize(image.height, level - 1), loadAbove, MipSize(image.width, level), MipSize(image.height, level),
+            options, mips[level - 1], below.get());
+        above.swap(below);
+    }
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Image.h"
+
+namespace pipeline {
+
+// size of a mip level along one axis, halved per level and never below 1
+inline uint32_t MipSize(uint32_t size, uint32_t level) {
+    uint32_t scaled = size >> level;
+    return scaled > 0 ? scaled : 1;
+}
+
+// levels from the full size down to 1x1
+uint32_t MipCount(uint32_t width, uint32_t height);
+
+// how a level is filtered down from the one above. Widths are in texels of the smaller level.
+enum class MipFilter : uint8_t {
+    // the average of the texels each one covers, area weighted where a size is odd. Fastest
+    // and softest.
+    Box,
+    // sinc under a Kaiser window 2 texels wide each way, alpha 4. Keeps detail without
+    // ringing much, what the cooker uses by default.
+    Kaiser,
+    // Lanczos, sinc under a sinc 3 texels wide each way. Sharpest, rings most.
+    Lanczos
+};
+
+const char* MipFilterName(MipFilter filter);
+
+struct MipOptions {
+    MipFilter filter = MipFilter::Kaiser;
+    // color channels are sRGB encoded and get filtered in linear light, alpha is always
+    // filtered as stored
+    bool srgb = true;
+    // 0 for one per core
+    unsigned int threadCount = 0;
+};
+
+// resamples source to width x height, both no larger than source, with the filter stretched
+// over however many texels each target texel covers. Texels past the edges repeat the edge.
+void Downsample(const Image& source, uint32_t width, uint32_t height, const MipOptions& options, Image& target);
+
+// every level below image, down to 1x1, each filtered from the one above as linear floats so
+// only the stored levels are rounded to 8 bits. Odd sizes round down the way the gpu sizes
+// mips, every source texel still counted.
+void GenerateMips(const Image& image, const MipOptions& options, std::vector<Image>& mips);
+
+}
\ No newline at end of file
@@ -0,0 +1,330 @@
+#include "ModelImporter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <string>
+
+#include <assimp/DefaultLogger.hpp>
+#include <assimp/Importer.hpp>
+#include <assimp/Logger.hpp>
+#include <assimp/ProgressHandler.hpp>
+#include <assimp/config.h>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <assimp/version.h>
+
+#include "Hash.h"
+#include "ImportProfile.h"
+#include "MeshBounds.h"
+#include "ObjParser.h"
+#include "PackIOSystem.h"
+#include "VertexWeld.h"
+
+namespace pipeline {
+
+namespace {
+
+// the native OBJ parser reproduces exactly these steps and the weld after them.
+// JoinIdenticalVertices is replaced by WeldVertices, which does the same on every core.
+const unsigned int ImportFlags = aiProcess_Triangulate;
+
+bool HasExtension(const std::string& filePath, const char* extension) {
+    size_t length = std::strlen(extension);
+    if (filePath.size() < length)
+        return false;
+
+    return std::equal(filePath.end() - length, filePath.end(), extension, [](char a, char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == b;
+    });
+}
+
+// what the scene's meshes hold in positions and faces
+uint64_t SceneBytes(const aiScene* scene) {
+    uint64_t bytes = 0;
+    for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+        const aiMesh* mesh = scene->mMeshes[i];
+        bytes += uint64_t(mesh->mNumVertices) * sizeof(aiVector3D);
+        for (unsigned int face = 0; face < mesh->mNumFaces; face++)
+            bytes += mesh->mFaces[face].mNumIndices * sizeof(unsigned int);
+    }
+    return bytes;
+}
+
+// "JoinVerticesProcess" as "join vertices"
+std::string StepName(const std::string& process) {
+    std::string name;
+    size_t length = process.size();
+    if (length > 7 && process.compare(length - 7, 7, "Process") == 0)
+        length -= 7;
+
+    for (size_t i = 0; i < length; i++) {
+        char c = process[i];
+        if (std::isupper(static_cast<unsigned char>(c)) && i > 0)
+            name += ' ';
+        name += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return name;
+}
+
+// times the read, the preprocessing after it and every post process step of a single
+// ReadFile as stages of their own. Assimp's progress callbacks mark where each of them starts,
+// with AI_CONFIG_GLOB_MEASURE_TIME its profiler logs which steps actually run, and the steps
+// name themselves in their first log line.
+class StepProfiler : public Assimp::ProgressHandler {
+public:
+    StepProfiler(const Assimp::Importer& importer, ImportProfile& profile, bool seesLog) :
+        _importer(importer), _profile(profile), _seesLog(seesLog) {}
+
+    bool Update(float) override {
+        return true;
+    }
+
+    void UpdateFileRead(int currentStep, int numberOfSteps) override {
+        // the read was begun by the caller
+        if (currentStep > 0 && currentStep >= numberOfSteps) {
+            _profile.End();
+            _profile.Begin("assimp preprocess");
+        }
+    }
+
+    void UpdatePostProcess(int currentStep, int numberOfSteps) override {
+        Finish();
+        if (currentStep >= numberOfSteps)
+            return;
+
+        _profile.Begin(("assimp step " + std::to_string(currentStep)).c_str());
+        _inStep = true;
+        // without the log every step is kept, run or not
+        _ran = !_seesLog;
+        _named = false;
+    }
+
+    void Log(const char* message) {
+        if (!_inStep)
+            return;
+
+        std::string line = message;
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+            line.pop_back();
+
+        if (line.find("START `postprocess`") != std::string::npos) {
+            _ran = true;
+            return;
+        }
+
+        const char suffix[] = " begin";
+        size_t length = sizeof(suffix) - 1;
+        if (_ran && !_named && line.size() > length && line.compare(line.size() - length, length, suffix) == 0 &&
+            line.find(' ') == line.size() - length) {
+            _profile.Rename("assimp " + StepName(line.substr(0, line.size() - length)));
+            _named = true;
+        }
+    }
+
+    // ends whatever is running, dropping a step that didn't run
+    void Finish() {
+        if (_inStep && !_ran)
+            _profile.Discard();
+        else
+            _profile.End(_importer.GetScene() ? SceneBytes(_importer.GetScene()) : 0);
+        _inStep = false;
+    }
+
+private:
+    const Assimp::Importer& _importer;
+    ImportProfile& _profile;
+    bool _seesLog;
+    bool _inStep = false;
+    bool _ran = false;
+    bool _named = false;
+};
+
+// the step profiler of the import running on this thread, Assimp logs to one global logger
+thread_local StepProfiler* CurrentSteps = nullptr;
+
+// hands Assimp's debug lines to the step profiler of the thread that logs them. Nothing is
+// shared between threads, unlike in Assimp's own logger, and nothing else is kept.
+class StepLogger : public Assimp::Logger {
+public:
+    StepLogger() : Assimp::Logger(Assimp::Logger::DEBUGGING) {}
+
+    bool attachStream(Assimp::LogStream*, unsigned int) override {
+        return false;
+    }
+
+    bool detachStream(Assimp::LogStream*, unsigned int) override {
+        return false;
+    }
+
+protected:
+    void OnDebug(const char* message) override {
+        if (CurrentSteps)
+            CurrentSteps->Log(message);
+    }
+
+    void OnVerboseDebug(const char*) override {}
+    void OnInfo(const char*) override {}
+    void OnWarn(const char*) override {}
+    void OnError(const char*) override {}
+};
+
+// installs StepLogger once, unless the application has a logger of its own. Then steps can't
+// be told from the ones that don't run and all of them are profiled.
+bool InstallStepLogger() {
+    static const bool installed = [] {
+        if (!Assimp::DefaultLogger::isNullLogger())
+            return false;
+
+        // owned by Assimp from here on
+        Assimp::DefaultLogger::set(new StepLogger());
+        return true;
+    }();
+    return installed;
+}
+
+// what JoinIdenticalVertices compares, exactly like it does: positions, normals, tangent
+// frames, every color and texture coordinate channel. Bones and morph targets aren't imported
+// so they aren't compared.
+size_t WeldMesh(const aiMesh* mesh, std::vector<uint32_t>& remap) {
+    std::vector<WeldAttribute> attributes;
+    attributes.push_back({ &mesh->mVertices[0].x, sizeof(aiVector3D), 3, 0.0f });
+    if (mesh->mNormals)
+        attributes.push_back({ &mesh->mNormals[0].x, sizeof(aiVector3D), 3, 0.0f });
+    if (mesh->mTangents && mesh->mBitangents) {
+        attributes.push_back({ &mesh->mTangents[0].x, sizeof(aiVector3D), 3, 0.0f });
+        attributes.push_back({ &mesh->mBitangents[0].x, sizeof(aiVector3D), 3, 0.0f });
+    }
+    for (unsigned int channel = 0; mesh->HasVertexColors(channel); channel++)
+        attributes.push_back({ &mesh->mColors[channel][0].r, sizeof(aiColor4D), 4, 0.0f });
+    for (unsigned int channel = 0; mesh->HasTextureCoords(channel); channel++)
+        attributes.push_back({ &mesh->mTextureCoords[channel][0].x, sizeof(aiVector3D), mesh->mNumUVComponents[channel], 0.0f });
+
+    remap.resize(mesh->mNumVertices);
+    return WeldVertices(attributes.data(), attributes.size(), mesh->mNumVertices, remap.data());
+}
+
+}
+
+uint64_t ImportSettingsHash(const ImportOptions& options) {
+    uint64_t hash = Hash64(&ImportFlags, sizeof(ImportFlags));
+    hash = HashCombine(hash, ImporterVersion);
+    hash = HashCombine(hash, sizeof(Vertex));
+    hash = HashCombine(hash, aiGetVersionMajor());
+    hash = HashCombine(hash, aiGetVersionMinor());
+    hash = HashCombine(hash, aiGetVersionPatch());
+    hash = HashCombine(hash, aiGetVersionRevision());
+
+    uint32_t threshold;
+    std::memcpy(&threshold, &options.overdrawThreshold, sizeof(threshold));
+    hash = HashCombine(hash, options.optimizeOverdraw);
+    hash = HashCombine(hash, options.optimizeOverdraw ? threshold : 0);
+    hash = HashCombine(hash, static_cast<uint64_t>(options.vertexFormat.position));
+    hash = HashCombine(hash, options.splitLargeMeshes);
+    hash = HashCombine(hash, options.buildMeshlets);
+    hash = HashCombine(hash, options.generateLods);
+    hash = HashCombine(hash, options.compressGeometry);
+    hash = HashCombine(hash, options.normalizeToUnitCube);
+    return hash;
+}
+
+bool ImportModel(const std::string& filePath, std::vector<Mesh>& meshes, std::string& error, ImportProfile* profile) {
+    if (!HasExtension(filePath, ".obj"))
+        return ImportModelAssimp(filePath, meshes, error, profile);
+
+    uint64_t bytesBefore = profile ? MeshBytes(meshes) : 0;
+    if (profile)
+        profile->Begin("obj parse");
+    bool imported = ImportObj(filePath, meshes, error);
+    if (profile)
+        profile->End(MeshBytes(meshes) - bytesBefore);
+    return imported;
+}
+
+bool ImportModelAssimp(const std::string& filePath, std::vector<Mesh>& meshes, std::string& error, ImportProfile* profile) {
+    Assimp::Importer importer;
+    // owned by the importer from here on
+    importer.SetIOHandler(new PackIOSystem());
+
+    // every step runs inside the one ReadFile, timed through the importer's own hooks
+    StepProfiler* steps = nullptr;
+    if (profile) {
+        steps = new StepProfiler(importer, *profile, InstallStepLogger());
+        // owned by the importer from here on
+        importer.SetProgressHandler(steps);
+        importer.SetPropertyBool(AI_CONFIG_GLOB_MEASURE_TIME, true);
+        CurrentSteps = steps;
+        profile->Begin("assimp read");
+    }
+    const aiScene* scene = importer.ReadFile(filePath, ImportFlags);
+    if (steps) {
+        steps->Finish();
+        CurrentSteps = nullptr;
+    }
+
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        error = importer.GetErrorString();
+        return false;
+    }
+
+    if (profile)
+        profile->Begin("weld vertices");
+
+    std::vector<std::vector<uint32_t>> remaps(scene->mNumMeshes);
+    std::vector<size_t> weldedCounts(scene->mNumMeshes);
+    uint64_t weldedBytes = 0;
+    for (unsigned int meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++) {
+        weldedCounts[meshIndex] = WeldMesh(scene->mMeshes[meshIndex], remaps[meshIndex]);
+        weldedBytes += weldedCounts[meshIndex] * sizeof(aiVector3D);
+    }
+
+    if (profile)
+        profile->End(weldedBytes);
+
+    // meshes may already hold some, only the new ones count
+    uint64_t bytesBefore = profile ? MeshBytes(meshes) : 0;
+    if (profile)
+        profile->Begin("copy meshes");
+
+    // every array is sized from the aiMesh counts and written once, in place
+    meshes.reserve(meshes.size() + scene->mNumMeshes);
+
+    for (size_t meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++) {
+        aiMesh* aiMesh = scene->mMeshes[meshIndex];
+        const std::vector<uint32_t>& remap = remaps[meshIndex];
+        meshes.emplace_back();
+        Mesh& mesh = meshes.back();
+
+        // get the vertices, the first of every welded group is the one kept
+        mesh.vertices.resize(weldedCounts[meshIndex]);
+        uint32_t kept = 0;
+        for (size_t vertexIndex = 0; vertexIndex < aiMesh->mNumVertices; ++vertexIndex) {
+            if (remap[vertexIndex] != kept)
+                continue;
+
+            Vertex& vertex = mesh.vertices[kept++];
+            vertex.Pos.x = aiMesh->mVertices[vertexIndex].x;
+            vertex.Pos.y = aiMesh->mVertices[vertexIndex].y;
+            vertex.Pos.z = aiMesh->mVertices[vertexIndex].z;
+        }
+
+        // get the indices, Triangulate leaves points and lines as they are so those are skipped
+        mesh.indices.reserve(aiMesh->mNumFaces);
+        for (size_t triangleIndex = 0; triangleIndex < aiMesh->mNumFaces; triangleIndex++) {
+            const aiFace& face = aiMesh->mFaces[triangleIndex];
+            if (face.mNumIndices != 3)
+                continue;
+            mesh.indices.push_back(DirectX::XMUINT3{ remap[face.mIndices[0]], remap[face.mIndices[1]], remap[face.mIndices[2]] });
+        }
+
+        mesh.bounds = ComputeBounds(mesh.vertices.data(), mesh.vertices.size());
+        mesh.numberOfVertices = static_cast<unsigned int>(mesh.vertices.size());
+        mesh.numberOfIndices = static_cast<unsigned int>(mesh.indices.size() * 3);
+    }
+
+    if (profile)
+        profile->End(MeshBytes(meshes) - bytesBefore);
+    return true;
+}
+
+}
\ No newline at end of file
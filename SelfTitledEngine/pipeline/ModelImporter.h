@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../Dx11App/types.h"
+
+namespace pipeline {
+
+class ImportProfile;
+
+// material every imported mesh is drawn with until the importers read real ones
+const Material DefaultMaterial = { DirectX::XMFLOAT4(0.949f, 0.353f, 0.114f, 1.0f) };
+
+// bump whenever the importers or the optimization passes after them start producing
+// different meshes for the same file
+constexpr uint32_t ImporterVersion = 10;
+
+// per request switches for the stages after the import, part of the cache key
+struct ImportOptions {
+    // cluster and sort triangles to cut overdraw, only worth it for opaque meshes
+    bool optimizeOverdraw = false;
+    // how much the clustering may raise ACMR over the vertex cache order
+    float overdrawThreshold = 1.05f;
+    // what the vertices are packed into for cooking and upload
+    VertexFormat vertexFormat;
+    // cut meshes with more vertices than 16 bit indices address into submeshes that fit
+    bool splitLargeMeshes = true;
+    // cluster the full level into meshlets with culling bounds, see BuildMeshlets
+    bool buildMeshlets = false;
+    // append a chain of simplified levels of detail to every mesh, see GenerateLods
+    bool generateLods = false;
+    // store cooked vertices and indices as GeometryCodec streams, decoded on load
+    bool compressGeometry = false;
+    // center the model on the origin and scale it into -1 to 1, see NormalizeMeshes
+    bool normalizeToUnitCube = false;
+};
+
+// hash of everything besides the source bytes that decides what an import produces:
+// post process flags, Assimp and importer versions, vertex layout and options
+uint64_t ImportSettingsHash(const ImportOptions& options);
+
+// imports every mesh in the file, appending to meshes. OBJ files go through the native
+// parser, everything else through Assimp. With a profile every step is timed into it,
+// Assimp's post process steps one by one.
+bool ImportModel(const std::string& filePath, std::vector<Mesh>& meshes, std::string& error, ImportProfile* profile = nullptr);
+bool ImportModelAssimp(const std::string& filePath, std::vector<Mesh>& meshes, std::string& error, ImportProfile* profile = nullptr);
+
+}
\ No newline at end of file
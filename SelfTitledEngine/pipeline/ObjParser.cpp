@@ -0,0 +1,809 @@
+#include "ObjParser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define PIPELINE_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "MeshBounds.h"
+#include "PackFile.h"
+#include "Parallel.h"
+
+namespace pipeline {
+
+namespace {
+
+constexpr uint32_t NoIndex = 0xFFFFFFFF;
+
+// 10^-n, the same values fast_atof.h scales fractions with
+constexpr double FractionScale[16] = {
+    0.0, 1e-1, 1e-2, 1e-3, 1e-4, 1e-5, 1e-6, 1e-7,
+    1e-8, 1e-9, 1e-10, 1e-11, 1e-12, 1e-13, 1e-14, 1e-15
+};
+constexpr unsigned int MaxFractionDigits = 15;
+
+inline bool IsDigit(char c) {
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+inline bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline unsigned int CountTrailingZeros(unsigned int mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+}
+
+// returns the position of the next '\n', or end
+const char* FindLineEnd(const char* p, const char* end) {
+#ifdef PIPELINE_SSE2
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+        if (mask)
+            return p + CountTrailingZeros(static_cast<unsigned int>(mask));
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '\n')
+        ++p;
+    return p;
+}
+
+inline const char* SkipSpaces(const char* p, const char* end) {
+    while (p < end && IsSpace(*p))
+        ++p;
+    return p;
+}
+
+inline const char* SkipToken(const char* p, const char* end) {
+    while (p < end && !IsSpace(*p))
+        ++p;
+    return p;
+}
+
+// mirrors Assimp::fast_atoreal_move<float> step for step so both paths round identically:
+// integer part as float, up to 15 fraction digits through a double, exponent via powf
+const char* ParseFloat(const char* p, const char* end, float& out) {
+    bool negative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+'))
+        ++p;
+
+    bool hasInteger = p < end && IsDigit(*p);
+    bool hasFraction = end - p >= 2 && p[0] == '.' && IsDigit(p[1]);
+    if (!hasInteger && !hasFraction)
+        return nullptr;
+
+    float value = 0.0f;
+    if (hasInteger) {
+        uint64_t integer = 0;
+        while (p < end && IsDigit(*p)) {
+            integer = integer * 10 + static_cast<uint64_t>(*p - '0');
+            ++p;
+        }
+        value = static_cast<float>(integer);
+    }
+
+    if (end - p >= 2 && p[0] == '.' && IsDigit(p[1])) {
+        ++p;
+        uint64_t fraction = 0;
+        unsigned int digits = 0;
+        while (p < end && IsDigit(*p) && digits < MaxFractionDigits) {
+            fraction = fraction * 10 + static_cast<uint64_t>(*p - '0');
+            ++digits;
+            ++p;
+        }
+        while (p < end && IsDigit(*p))
+            ++p;
+
+        value += static_cast<float>(static_cast<double>(fraction) * FractionScale[digits]);
+    } else if (p < end && *p == '.') {
+        ++p;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negativeExponent = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+'))
+            ++p;
+
+        uint64_t exponent = 0;
+        while (p < end && IsDigit(*p)) {
+            exponent = exponent * 10 + static_cast<uint64_t>(*p - '0');
+            ++p;
+        }
+
+        float power = static_cast<float>(exponent);
+        value *= std::pow(10.0f, negativeExponent ? -power : power);
+    }
+
+    out = negative ? -value : value;
+    return p;
+}
+
+const char* ParseInt(const char* p, const char* end, int64_t& out) {
+    bool negative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+'))
+        ++p;
+
+    if (p == end || !IsDigit(*p))
+        return nullptr;
+
+    int64_t value = 0;
+    while (p < end && IsDigit(*p)) {
+        value = value * 10 + (*p - '0');
+        ++p;
+    }
+
+    out = negative ? -value : value;
+    return p;
+}
+
+// OBJ indices are 1-based, negative ones count back from the last element read so far
+inline uint32_t ResolveIndex(int64_t index, size_t readSoFar, size_t total) {
+    int64_t resolved = index > 0 ? index - 1 : static_cast<int64_t>(readSoFar) + index;
+    if (index == 0 || resolved < 0 || resolved >= static_cast<int64_t>(total))
+        return NoIndex;
+    return static_cast<uint32_t>(resolved);
+}
+
+inline uint32_t FloatKey(float value) {
+    // + 0.0f folds -0 into +0, which compare equal for welding purposes
+    value += 0.0f;
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline bool SameValue(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) {
+    return FloatKey(a.x) == FloatKey(b.x) && FloatKey(a.y) == FloatKey(b.y) && FloatKey(a.z) == FloatKey(b.z);
+}
+
+// open addressing set of indices into a value array, used to find the first element holding
+// a given value. Slots are bare indices so the table stays small enough to live in cache.
+class WeldTable {
+public:
+    void Reset(size_t expected) {
+        size_t capacity = 16;
+        while (capacity < expected * 2)
+            capacity *= 2;
+
+        _slots.assign(capacity, NoIndex);
+        _count = 0;
+    }
+
+    // values[index] must already be stored
+    uint32_t FindOrInsert(const std::vector<DirectX::XMFLOAT3>& values, uint32_t index) {
+        if ((_count + 1) * 2 > _slots.size())
+            grow(values);
+
+        const DirectX::XMFLOAT3& value = values[index];
+        size_t mask = _slots.size() - 1;
+
+        for (size_t i = hash(value) & mask;; i = (i + 1) & mask) {
+            uint32_t slot = _slots[i];
+
+            if (slot == NoIndex) {
+                _slots[i] = index;
+                _count++;
+                return index;
+            }
+
+            if (SameValue(values[slot], value))
+                return slot;
+        }
+    }
+
+    // appends the first matching index for every value that doesn't have one in ids yet
+    void Weld(const std::vector<DirectX::XMFLOAT3>& values, std::vector<uint32_t>& ids) {
+        for (size_t i = ids.size(); i < values.size(); i++)
+            ids.push_back(FindOrInsert(values, static_cast<uint32_t>(i)));
+    }
+
+private:
+    static size_t hash(const DirectX::XMFLOAT3& value) {
+        uint64_t h = 0;
+        h = (h ^ FloatKey(value.x)) * 0x9E3779B97F4A7C15ull;
+        h = (h ^ FloatKey(value.y)) * 0x9E3779B97F4A7C15ull;
+        h = (h ^ FloatKey(value.z)) * 0x9E3779B97F4A7C15ull;
+
+        // murmur3 finalizer, the table indexes with the low bits
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        return static_cast<size_t>(h);
+    }
+
+    void grow(const std::vector<DirectX::XMFLOAT3>& values) {
+        std::vector<uint32_t> old;
+        old.swap(_slots);
+        Reset(old.size());
+
+        for (uint32_t slot : old) {
+            if (slot != NoIndex)
+                FindOrInsert(values, slot);
+        }
+    }
+
+    std::vector<uint32_t> _slots;
+    size_t _count = 0;
+};
+
+enum class RecordType {
+    Other,
+    Position,
+    Texcoord,
+    Normal,
+    Face,
+    Group,
+    Material,
+};
+
+// identifies the record on a line and moves p past its keyword. The counting and parsing
+// passes both go through here so they can never disagree about what a line is.
+RecordType ClassifyLine(const char*& p, const char* end) {
+    if (end - p < 2)
+        return RecordType::Other;
+
+    switch (p[0]) {
+    case 'v':
+        if (IsSpace(p[1])) {
+            p += 2;
+            return RecordType::Position;
+        }
+        if (end - p > 2 && IsSpace(p[2])) {
+            if (p[1] == 't') {
+                p += 3;
+                return RecordType::Texcoord;
+            }
+            if (p[1] == 'n') {
+                p += 3;
+                return RecordType::Normal;
+            }
+        }
+        return RecordType::Other;
+
+    case 'f':
+        if (IsSpace(p[1])) {
+            p += 2;
+            return RecordType::Face;
+        }
+        return RecordType::Other;
+
+    case 'o':
+    case 'g':
+        if (IsSpace(p[1])) {
+            p += 2;
+            return RecordType::Group;
+        }
+        return RecordType::Other;
+
+    case 'u':
+        if (end - p > 7 && std::strncmp(p, "usemtl", 6) == 0 && IsSpace(p[6])) {
+            p += 7;
+            return RecordType::Material;
+        }
+        return RecordType::Other;
+
+    default:
+        // comments, smoothing groups, mtllib and anything else we don't use
+        return RecordType::Other;
+    }
+}
+
+// counts the whitespace separated tokens on a face line, branch free since it runs per byte
+size_t CountCorners(const char* p, const char* end) {
+    size_t corners = 0;
+    bool previousSpace = true;
+
+    for (; p < end; ++p) {
+        bool space = IsSpace(*p);
+        corners += previousSpace & !space;
+        previousSpace = space;
+    }
+
+    return corners;
+}
+
+// chunks are at least this big so small files stay on one thread
+constexpr size_t MinChunkSize = 1 << 20;
+
+// o, g or usemtl record, positioned by the first triangle that follows it
+struct MeshBreak {
+    size_t triangle;
+    bool material;
+    std::string name;
+};
+
+// a line aligned slice of the file. The counting pass fills in the element counts, a prefix
+// sum over all chunks turns them into global offsets, and the parse pass then writes the
+// chunk's records straight into the shared arrays at those offsets.
+struct Chunk {
+    const char* begin;
+    const char* end;
+
+    size_t lines = 0;
+    size_t positions = 0;
+    size_t texcoords = 0;
+    size_t normals = 0;
+    size_t triangles = 0;
+
+    size_t firstLine = 0;
+    size_t firstPosition = 0;
+    size_t firstTexcoord = 0;
+    size_t firstNormal = 0;
+    size_t firstTriangle = 0;
+
+    std::vector<MeshBreak> breaks;
+    std::string error;
+};
+
+// every record in the file, each array allocated once at its final size
+struct ObjData {
+    std::vector<DirectX::XMFLOAT3> positions;
+    std::vector<DirectX::XMFLOAT3> texcoords;
+    std::vector<DirectX::XMFLOAT3> normals;
+
+    // triangles hold position indices until welding rewrites them into vertex indices in
+    // place. Per corner texcoord and normal indices only exist if the file has any.
+    std::vector<DirectX::XMUINT3> triangles;
+    std::vector<uint32_t> cornerTexcoords;
+    std::vector<uint32_t> cornerNormals;
+};
+
+std::vector<Chunk> SplitChunks(const char* data, size_t size, unsigned int threadCount) {
+    // a few chunks per thread so a slow chunk doesn't hold everyone up
+    size_t target = std::max(MinChunkSize, size / (size_t(threadCount) * 4) + 1);
+
+    std::vector<Chunk> chunks;
+    const char* p = data;
+    const char* end = data + size;
+
+    while (p < end) {
+        const char* chunkEnd = end;
+        if (static_cast<size_t>(end - p) > target) {
+            chunkEnd = FindLineEnd(p + target, end);
+            if (chunkEnd < end)
+                ++chunkEnd;
+        }
+
+        Chunk chunk;
+        chunk.begin = p;
+        chunk.end = chunkEnd;
+        chunks.push_back(std::move(chunk));
+
+        p = chunkEnd;
+    }
+
+    return chunks;
+}
+
+void CountChunk(Chunk& chunk) {
+    const char* p = chunk.begin;
+
+    while (p < chunk.end) {
+        const char* lineEnd = FindLineEnd(p, chunk.end);
+        const char* line = SkipSpaces(p, lineEnd);
+        chunk.lines++;
+
+        switch (ClassifyLine(line, lineEnd)) {
+        case RecordType::Position:
+            chunk.positions++;
+            break;
+        case RecordType::Texcoord:
+            chunk.texcoords++;
+            break;
+        case RecordType::Normal:
+            chunk.normals++;
+            break;
+        case RecordType::Face: {
+            size_t corners = CountCorners(line, lineEnd);
+            if (corners >= 3)
+                chunk.triangles += corners - 2;
+            break;
+        }
+        default:
+            break;
+        }
+
+        p = lineEnd + 1;
+    }
+}
+
+class ChunkParser {
+public:
+    ChunkParser(Chunk& chunk, ObjData& data) : _chunk(chunk), _data(data) {}
+
+    bool Parse() {
+        _line = _chunk.firstLine;
+        _position = _chunk.firstPosition;
+        _texcoord = _chunk.firstTexcoord;
+        _normal = _chunk.firstNormal;
+        _triangle = _chunk.firstTriangle;
+
+        const char* p = _chunk.begin;
+        while (p < _chunk.end) {
+            const char* lineEnd = FindLineEnd(p, _chunk.end);
+            const char* line = SkipSpaces(p, lineEnd);
+            _line++;
+
+            bool ok = true;
+            switch (ClassifyLine(line, lineEnd)) {
+            case RecordType::Position:
+                ok = parseVector(line, lineEnd, 3, _data.positions[_position++]);
+                break;
+            case RecordType::Texcoord:
+                ok = parseVector(line, lineEnd, 1, _data.texcoords[_texcoord++]);
+                break;
+            case RecordType::Normal:
+                ok = parseVector(line, lineEnd, 3, _data.normals[_normal++]);
+                break;
+            case RecordType::Face:
+                ok = parseFace(line, lineEnd);
+                break;
+            case RecordType::Group:
+                addBreak(false, line, lineEnd);
+                break;
+            case RecordType::Material:
+                addBreak(true, line, lineEnd);
+                break;
+            default:
+                break;
+            }
+
+            if (!ok)
+                return false;
+
+            p = lineEnd + 1;
+        }
+
+        return true;
+    }
+
+private:
+    struct Corner {
+        uint32_t position;
+        uint32_t texcoord;
+        uint32_t normal;
+    };
+
+    bool parseVector(const char* p, const char* end, int minComponents, DirectX::XMFLOAT3& out) {
+        float values[3] = { 0.0f, 0.0f, 0.0f };
+
+        int components = 0;
+        for (; components < 3; components++) {
+            p = SkipSpaces(p, end);
+            if (p == end)
+                break;
+
+            p = ParseFloat(p, end, values[components]);
+            if (!p)
+                return fail("malformed number");
+        }
+
+        if (components < minComponents)
+            return fail("too few components");
+
+        out = DirectX::XMFLOAT3(values[0], values[1], values[2]);
+        return true;
+    }
+
+    bool parseFace(const char* p, const char* end) {
+        _polygon.clear();
+
+        for (;;) {
+            p = SkipSpaces(p, end);
+            if (p == end)
+                break;
+
+            // v, v/vt, v//vn or v/vt/vn
+            int64_t value;
+            p = ParseInt(p, end, value);
+            if (!p)
+                return fail("malformed face");
+
+            Corner corner{ ResolveIndex(value, _position, _data.positions.size()), NoIndex, NoIndex };
+            if (corner.position == NoIndex)
+                return fail("position index out of range");
+
+            if (p < end && *p == '/') {
+                ++p;
+                if (p < end && *p != '/') {
+                    p = ParseInt(p, end, value);
+                    if (!p)
+                        return fail("malformed face");
+
+                    corner.texcoord = ResolveIndex(value, _texcoord, _data.texcoords.size());
+                    if (corner.texcoord == NoIndex)
+                        return fail("texcoord index out of range");
+                }
+
+                if (p < end && *p == '/') {
+                    ++p;
+                    p = ParseInt(p, end, value);
+                    if (!p)
+                        return fail("malformed face");
+
+                    corner.normal = ResolveIndex(value, _normal, _data.normals.size());
+                    if (corner.normal == NoIndex)
+                        return fail("normal index out of range");
+                }
+            }
+
+            _polygon.push_back(corner);
+            p = SkipToken(p, end);
+        }
+
+        // points and lines have no triangles to contribute
+        for (size_t i = 1; i + 1 < _polygon.size(); i++)
+            addTriangle(_polygon[0], _polygon[i], _polygon[i + 1]);
+
+        return true;
+    }
+
+    void addTriangle(const Corner& a, const Corner& b, const Corner& c) {
+        size_t triangle = _triangle++;
+        _data.triangles[triangle] = DirectX::XMUINT3{ a.position, b.position, c.position };
+
+        if (!_data.cornerTexcoords.empty()) {
+            uint32_t* texcoords = &_data.cornerTexcoords[triangle * 3];
+            texcoords[0] = a.texcoord;
+            texcoords[1] = b.texcoord;
+            texcoords[2] = c.texcoord;
+        }
+
+        if (!_data.cornerNormals.empty()) {
+            uint32_t* normals = &_data.cornerNormals[triangle * 3];
+            normals[0] = a.normal;
+            normals[1] = b.normal;
+            normals[2] = c.normal;
+        }
+    }
+
+    void addBreak(bool material, const char* p, const char* end) {
+        while (end > p && IsSpace(end[-1]))
+            --end;
+
+        _chunk.breaks.push_back(MeshBreak{ _triangle, material, std::string(p, end) });
+    }
+
+    bool fail(const char* message) {
+        _chunk.error = "OBJ line " + std::to_string(_line) + ": " + message;
+        return false;
+    }
+
+private:
+    Chunk& _chunk;
+    ObjData& _data;
+
+    // global index of the next element of each kind this chunk writes
+    size_t _line = 0;
+    size_t _position = 0;
+    size_t _texcoord = 0;
+    size_t _normal = 0;
+    size_t _triangle = 0;
+
+    std::vector<Corner> _polygon;
+};
+
+// welds the parsed records into meshes. Runs on one thread, since vertex numbering follows
+// the order corners are first used in.
+class MeshBuilder {
+public:
+    MeshBuilder(ObjData& data, std::vector<Mesh>& meshes) : _data(data), _meshes(meshes) {}
+
+    void Build(const std::vector<Chunk>& chunks, unsigned int threadCount) {
+        // the three value arrays weld independently of each other
+        ParallelFor(3, threadCount, [&](size_t i) {
+            if (i == 0)
+                weldValues(_data.positions, _positionIds);
+            else if (i == 1)
+                weldValues(_data.texcoords, _texcoordIds);
+            else
+                weldValues(_data.normals, _normalIds);
+        });
+
+        _hasAttributes = !_data.cornerTexcoords.empty() || !_data.cornerNormals.empty();
+        _cornerHeads.assign(_data.positions.size(), NoIndex);
+
+        // a new mesh starts whenever the object, group or material name changes
+        std::string group;
+        std::string material;
+        size_t meshStart = 0;
+
+        for (const Chunk& chunk : chunks) {
+            for (const MeshBreak& meshBreak : chunk.breaks) {
+                std::string& current = meshBreak.material ? material : group;
+                if (meshBreak.name == current)
+                    continue;
+
+                current = meshBreak.name;
+                if (meshBreak.triangle > meshStart) {
+                    buildMesh(meshStart, meshBreak.triangle);
+                    meshStart = meshBreak.triangle;
+                }
+            }
+        }
+
+        if (_data.triangles.size() > meshStart)
+            buildMesh(meshStart, _data.triangles.size());
+    }
+
+private:
+    struct Corner {
+        uint32_t positionId;
+        uint32_t texcoordId;
+        uint32_t normalId;
+        uint32_t next;
+    };
+
+    static void weldValues(const std::vector<DirectX::XMFLOAT3>& values, std::vector<uint32_t>& ids) {
+        WeldTable table;
+        table.Reset(values.size());
+        ids.reserve(values.size());
+        table.Weld(values, ids);
+    }
+
+    void buildMesh(size_t begin, size_t end) {
+        Mesh mesh;
+        mesh.vertices.reserve(std::min(_data.positions.size(), (end - begin) * 3));
+
+        for (size_t triangle = begin; triangle < end; triangle++) {
+            DirectX::XMUINT3& indices = _data.triangles[triangle];
+            indices.x = addCorner(mesh, indices.x, triangle * 3 + 0);
+            indices.y = addCorner(mesh, indices.y, triangle * 3 + 1);
+            indices.z = addCorner(mesh, indices.z, triangle * 3 + 2);
+        }
+
+        // the common single mesh case takes over the triangle array without a copy
+        if (begin == 0 && end == _data.triangles.size())
+            mesh.indices = std::move(_data.triangles);
+        else
+            mesh.indices.assign(_data.triangles.begin() + begin, _data.triangles.begin() + end);
+
+        mesh.bounds = ComputeBounds(mesh.vertices.data(), mesh.vertices.size());
+        mesh.numberOfVertices = static_cast<unsigned int>(mesh.vertices.size());
+        mesh.numberOfIndices = static_cast<unsigned int>(mesh.indices.size() * 3);
+        _meshes.push_back(std::move(mesh));
+
+        // only the chains this mesh touched need clearing
+        for (const Corner& corner : _corners)
+            _cornerHeads[corner.positionId] = NoIndex;
+        _corners.clear();
+    }
+
+    uint32_t addCorner(Mesh& mesh, uint32_t position, size_t corner) {
+        uint32_t positionId = _positionIds[position];
+        uint32_t texcoordId = NoIndex;
+        uint32_t normalId = NoIndex;
+
+        if (_hasAttributes) {
+            if (!_data.cornerTexcoords.empty() && _data.cornerTexcoords[corner] != NoIndex)
+                texcoordId = _texcoordIds[_data.cornerTexcoords[corner]];
+
+            if (!_data.cornerNormals.empty() && _data.cornerNormals[corner] != NoIndex)
+                normalId = _normalIds[_data.cornerNormals[corner]];
+
+            // the vertices sharing a position are chained together, almost always just one or two
+            for (uint32_t index = _cornerHeads[positionId]; index != NoIndex; index = _corners[index].next) {
+                const Corner& existing = _corners[index];
+                if (existing.texcoordId == texcoordId && existing.normalId == normalId)
+                    return index;
+            }
+        } else if (_cornerHeads[positionId] != NoIndex) {
+            // position only files have at most one vertex per position
+            return _cornerHeads[positionId];
+        }
+
+        uint32_t index = static_cast<uint32_t>(mesh.vertices.size());
+        _corners.push_back(Corner{ positionId, texcoordId, normalId, _cornerHeads[positionId] });
+        _cornerHeads[positionId] = index;
+
+        Vertex vertex;
+        vertex.Pos = _data.positions[positionId];
+        mesh.vertices.push_back(vertex);
+
+        return index;
+    }
+
+private:
+    ObjData& _data;
+    std::vector<Mesh>& _meshes;
+
+    // index of the first v, vt and vn record holding the same value as each record
+    std::vector<uint32_t> _positionIds;
+    std::vector<uint32_t> _texcoordIds;
+    std::vector<uint32_t> _normalIds;
+
+    // welded vertices of the current mesh, chained per position id
+    std::vector<Corner> _corners;
+    std::vector<uint32_t> _cornerHeads;
+    bool _hasAttributes = false;
+};
+
+}
+
+bool ParseObj(const char* data, size_t size, std::vector<Mesh>& meshes, std::string& error, unsigned int threadCount) {
+    if (threadCount == 0)
+        threadCount = DefaultThreadCount();
+
+    std::vector<Chunk> chunks = SplitChunks(data, size, threadCount);
+    ParallelFor(chunks.size(), threadCount, [&](size_t i) {
+        CountChunk(chunks[i]);
+    });
+
+    // prefix sum over the counts gives each chunk the global offsets it writes at
+    Chunk totals;
+    for (Chunk& chunk : chunks) {
+        chunk.firstLine = totals.lines;
+        chunk.firstPosition = totals.positions;
+        chunk.firstTexcoord = totals.texcoords;
+        chunk.firstNormal = totals.normals;
+        chunk.firstTriangle = totals.triangles;
+
+        totals.lines += chunk.lines;
+        totals.positions += chunk.positions;
+        totals.texcoords += chunk.texcoords;
+        totals.normals += chunk.normals;
+        totals.triangles += chunk.triangles;
+    }
+
+    if (totals.positions >= NoIndex || totals.triangles * 3 >= NoIndex) {
+        error = "OBJ file has too many elements for 32-bit indices";
+        return false;
+    }
+
+    ObjData obj;
+    obj.positions.resize(totals.positions);
+    obj.texcoords.resize(totals.texcoords);
+    obj.normals.resize(totals.normals);
+    obj.triangles.resize(totals.triangles);
+
+    if (totals.texcoords)
+        obj.cornerTexcoords.resize(totals.triangles * 3);
+    if (totals.normals)
+        obj.cornerNormals.resize(totals.triangles * 3);
+
+    ParallelFor(chunks.size(), threadCount, [&](size_t i) {
+        ChunkParser(chunks[i], obj).Parse();
+    });
+
+    // report the first error in file order
+    for (const Chunk& chunk : chunks) {
+        if (!chunk.error.empty()) {
+            error = chunk.error;
+            return false;
+        }
+    }
+
+    MeshBuilder(obj, meshes).Build(chunks, threadCount);
+    return true;
+}
+
+bool ImportObj(const std::string& filePath, std::vector<Mesh>& meshes, std::string& error) {
+    AssetFile file;
+    if (!file.Open(filePath)) {
+        error = "Failed to open " + filePath;
+        return false;
+    }
+
+    return ParseObj(reinterpret_cast<const char*>(file.Data()), file.Size(), meshes, error);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "../Dx11App/types.h"
+
+namespace pipeline {
+
+// native Wavefront OBJ reader. Produces the same meshes as the Assimp path with
+// aiProcess_Triangulate | aiProcess_JoinIdenticalVertices: one mesh per object, group or
+// material run, vertices in first-use order, and corners that share position, normal and
+// texcoord values welded together.
+//
+// Large files are split into line aligned chunks that are counted and then parsed on
+// threadCount threads (0 picks one per core), each writing straight into the final arrays.
+bool ParseObj(const char* data, size_t size, std::vector<Mesh>& meshes, std::string& error, unsigned int threadCount = 0);
+bool ImportObj(const std::string& filePath, std::vector<Mesh>& meshes, std::string& error);
+
+}
\ No newline at end of file
@@ -0,0 +1,264 @@
+#include "Overdraw.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "Parallel.h"
+
+namespace pipeline {
+
+namespace {
+
+using DirectX::XMFLOAT3;
+
+inline XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+inline XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+inline float Dot(const XMFLOAT3& a, const XMFLOAT3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline XMFLOAT3 Normalize(const XMFLOAT3& a) {
+    float length = std::sqrt(Dot(a, a));
+    if (length == 0.0f)
+        return a;
+    return XMFLOAT3(a.x / length, a.y / length, a.z / length);
+}
+
+struct ScreenVertex {
+    float x;
+    float y;
+    float z;
+};
+
+inline float Edge(const ScreenVertex& a, const ScreenVertex& b, float x, float y) {
+    return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+}
+
+// forward is the view direction, right and up span the image plane
+void ViewBasis(unsigned int view, XMFLOAT3& right, XMFLOAT3& up, XMFLOAT3& forward) {
+    // fibonacci sphere
+    const float goldenAngle = 2.39996323f;
+    float y = 1.0f - (view + 0.5f) * 2.0f / OverdrawViewCount;
+    float radius = std::sqrt(std::max(0.0f, 1.0f - y * y));
+    float phi = view * goldenAngle;
+    forward = XMFLOAT3(radius * std::cos(phi), y, radius * std::sin(phi));
+
+    XMFLOAT3 helper = std::fabs(forward.y) > 0.99f ? XMFLOAT3(1.0f, 0.0f, 0.0f) : XMFLOAT3(0.0f, 1.0f, 0.0f);
+    right = Normalize(Cross(helper, forward));
+    up = Cross(forward, right);
+}
+
+void RasterizeView(unsigned int view, const Vertex* vertices, size_t vertexCount,
+    const DirectX::XMUINT3* triangles, size_t triangleCount, size_t& covered, size_t& shaded) {
+    XMFLOAT3 right, up, forward;
+    ViewBasis(view, right, up, forward);
+
+    std::vector<ScreenVertex> screen(vertexCount);
+    float minX = std::numeric_limits<float>::max(), maxX = -minX;
+    float minY = minX, maxY = -minX;
+    for (size_t i = 0; i < vertexCount; i++) {
+        ScreenVertex& s = screen[i];
+        s.x = Dot(vertices[i].Pos, right);
+        s.y = Dot(vertices[i].Pos, up);
+        s.z = Dot(vertices[i].Pos, forward);
+        minX = std::min(minX, s.x);
+        maxX = std::max(maxX, s.x);
+        minY = std::min(minY, s.y);
+        maxY = std::max(maxY, s.y);
+    }
+
+    // fit the larger extent to the buffer, keeping the aspect ratio
+    float extent = std::max(maxX - minX, maxY - minY);
+    float scale = extent > 0.0f ? (OverdrawResolution - 1) / extent : 0.0f;
+    for (ScreenVertex& s : screen) {
+        s.x = (s.x - minX) * scale;
+        s.y = (s.y - minY) * scale;
+    }
+
+    const int size = static_cast<int>(OverdrawResolution);
+    std::vector<float> depth(size_t(size) * size, std::numeric_limits<float>::infinity());
+    shaded = 0;
+
+    for (size_t t = 0; t < triangleCount; t++) {
+        const ScreenVertex& a = screen[triangles[t].x];
+        ScreenVertex b = screen[triangles[t].y];
+        ScreenVertex c = screen[triangles[t].z];
+
+        // (right, up, forward) is right handed, so a negative screen area means the
+        // counter clockwise front face points at the viewer
+        float area = Edge(a, b, c.x, c.y);
+        if (area >= 0.0f)
+            continue;
+        std::swap(b, c);
+        area = -area;
+
+        int x0 = std::max(0, static_cast<int>(std::floor(std::min({ a.x, b.x, c.x }))));
+        int x1 = std::min(size - 1, static_cast<int>(std::ceil(std::max({ a.x, b.x, c.x }))));
+        int y0 = std::max(0, static_cast<int>(std::floor(std::min({ a.y, b.y, c.y }))));
+        int y1 = std::min(size - 1, static_cast<int>(std::ceil(std::max({ a.y, b.y, c.y }))));
+
+        for (int y = y0; y <= y1; y++) {
+            float py = y + 0.5f;
+            for (int x = x0; x <= x1; x++) {
+                float px = x + 0.5f;
+                float w0 = Edge(b, c, px, py);
+                float w1 = Edge(c, a, px, py);
+                float w2 = Edge(a, b, px, py);
+                if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                    continue;
+
+                float z = (w0 * a.z + w1 * b.z + w2 * c.z) / area;
+                float& stored = depth[size_t(y) * size + x];
+                if (z < stored) {
+                    stored = z;
+                    shaded++;
+                }
+            }
+        }
+    }
+
+    covered = 0;
+    for (float z : depth)
+        covered += z != std::numeric_limits<float>::infinity();
+}
+
+}
+
+OverdrawStatistics MeasureOverdraw(const Vertex* vertices, size_t vertexCount, const DirectX::XMUINT3* triangles, size_t triangleCount) {
+    std::vector<size_t> covered(OverdrawViewCount), shaded(OverdrawViewCount);
+
+    ParallelFor(OverdrawViewCount, 0, [&](size_t view) {
+        RasterizeView(static_cast<unsigned int>(view), vertices, vertexCount, triangles, triangleCount, covered[view], shaded[view]);
+    });
+
+    OverdrawStatistics statistics = {};
+    for (unsigned int view = 0; view < OverdrawViewCount; view++) {
+        statistics.covered += covered[view];
+        statistics.shaded += shaded[view];
+    }
+    statistics.overdraw = statistics.covered ? static_cast<float>(statistics.shaded) / statistics.covered : 0.0f;
+    return statistics;
+}
+
+void OptimizeOverdraw(DirectX::XMUINT3* triangles, size_t triangleCount, const Vertex* vertices, size_t vertexCount,
+    unsigned int cacheSize, float threshold) {
+    if (triangleCount < 2 || cacheSize == 0)
+        return;
+
+    // FIFO cache by insertion time, bumping time past cacheSize empties it
+    std::vector<size_t> insertedAt(vertexCount, 0);
+    size_t time = cacheSize + 1;
+    auto misses = [&](const DirectX::XMUINT3& triangle) {
+        unsigned int count = 0;
+        for (uint32_t vertex : { triangle.x, triangle.y, triangle.z }) {
+            if (time - insertedAt[vertex] >= cacheSize) {
+                insertedAt[vertex] = ++time;
+                count++;
+            }
+        }
+        return count;
+    };
+
+    // hard boundaries, where the vertex cache order already starts over from nothing
+    std::vector<uint32_t> hard;
+    size_t totalMisses = 0;
+    for (size_t i = 0; i < triangleCount; i++) {
+        unsigned int count = misses(triangles[i]);
+        totalMisses += count;
+        if (i == 0 || count == 3)
+            hard.push_back(static_cast<uint32_t>(i));
+    }
+    hard.push_back(static_cast<uint32_t>(triangleCount));
+
+    const float limit = threshold * static_cast<float>(totalMisses) / triangleCount;
+
+    // soft boundaries, cut as soon as the cluster so far pays for its cold start
+    std::vector<uint32_t> clusters;
+    for (size_t h = 0; h + 1 < hard.size(); h++) {
+        size_t start = hard[h];
+        size_t clusterMisses = 0;
+        time += cacheSize + 1;
+        clusters.push_back(static_cast<uint32_t>(start));
+
+        for (size_t i = hard[h]; i < hard[h + 1]; i++) {
+            clusterMisses += misses(triangles[i]);
+
+            if (i + 1 < hard[h + 1] && static_cast<float>(clusterMisses) / (i - start + 1) <= limit) {
+                start = i + 1;
+                clusterMisses = 0;
+                time += cacheSize + 1;
+                clusters.push_back(static_cast<uint32_t>(start));
+            }
+        }
+    }
+    clusters.push_back(static_cast<uint32_t>(triangleCount));
+
+    // area weighted centroid and normal of every cluster and of the whole mesh
+    const size_t clusterCount = clusters.size() - 1;
+    std::vector<XMFLOAT3> centroids(clusterCount), normals(clusterCount);
+    XMFLOAT3 meshCentroid(0.0f, 0.0f, 0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t c = 0; c < clusterCount; c++) {
+        XMFLOAT3 centroid(0.0f, 0.0f, 0.0f), normal(0.0f, 0.0f, 0.0f);
+        float clusterArea = 0.0f;
+
+        for (size_t i = clusters[c]; i < clusters[c + 1]; i++) {
+            const XMFLOAT3& a = vertices[triangles[i].x].Pos;
+            const XMFLOAT3& b = vertices[triangles[i].y].Pos;
+            const XMFLOAT3& d = vertices[triangles[i].z].Pos;
+
+            XMFLOAT3 faceNormal = Cross(Subtract(b, a), Subtract(d, a));
+            float area = std::sqrt(Dot(faceNormal, faceNormal));
+
+            centroid.x += (a.x + b.x + d.x) * area;
+            centroid.y += (a.y + b.y + d.y) * area;
+            centroid.z += (a.z + b.z + d.z) * area;
+            normal.x += faceNormal.x;
+            normal.y += faceNormal.y;
+            normal.z += faceNormal.z;
+            clusterArea += area;
+        }
+
+        meshCentroid.x += centroid.x;
+        meshCentroid.y += centroid.y;
+        meshCentroid.z += centroid.z;
+        meshArea += clusterArea;
+
+        float inverse = clusterArea > 0.0f ? 1.0f / (3.0f * clusterArea) : 0.0f;
+        centroids[c] = XMFLOAT3(centroid.x * inverse, centroid.y * inverse, centroid.z * inverse);
+        normals[c] = Normalize(normal);
+    }
+
+    float inverse = meshArea > 0.0f ? 1.0f / (3.0f * meshArea) : 0.0f;
+    meshCentroid = XMFLOAT3(meshCentroid.x * inverse, meshCentroid.y * inverse, meshCentroid.z * inverse);
+
+    // clusters facing away from the middle sit on the outside and get drawn first
+    std::vector<float> keys(clusterCount);
+    std::vector<uint32_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++) {
+        keys[c] = Dot(Subtract(centroids[c], meshCentroid), normals[c]);
+        order[c] = static_cast<uint32_t>(c);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return keys[a] > keys[b];
+    });
+
+    std::vector<DirectX::XMUINT3> sorted;
+    sorted.reserve(triangleCount);
+    for (uint32_t c : order)
+        sorted.insert(sorted.end(), triangles + clusters[c], triangles + clusters[c + 1]);
+
+    std::copy(sorted.begin(), sorted.end(), triangles);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+
+#include <DirectXMath.h>
+
+#include "../Dx11App/types.h"
+
+namespace pipeline {
+
+// square depth buffer the measurement rasterizes into, per view
+constexpr unsigned int OverdrawResolution = 256;
+// orthographic views spread evenly over the sphere around the mesh
+constexpr unsigned int OverdrawViewCount = 16;
+
+struct OverdrawStatistics {
+    // pixels covered by the mesh, summed over every view
+    size_t covered;
+    // pixels that passed the depth test, i.e. would have been shaded
+    size_t shaded;
+    // shaded per covered pixel, 1 means every pixel was shaded once
+    float overdraw;
+};
+
+// software rasterizes the triangles in submission order with back face culling and a less
+// depth test, cpu only so it can run headless
+OverdrawStatistics MeasureOverdraw(const Vertex* vertices, size_t vertexCount, const DirectX::XMUINT3* triangles, size_t triangleCount);
+
+// splits a vertex cache ordered triangle list into clusters and draws the outward facing
+// ones first, so they occlude the rest. Clusters only start where a cold cache of cacheSize
+// keeps their ACMR within threshold times the whole mesh's.
+void OptimizeOverdraw(DirectX::XMUINT3* triangles, size_t triangleCount, const Vertex* vertices, size_t vertexCount,
+    unsigned int cacheSize, float threshold);
+
+}
\ No newline at end of file
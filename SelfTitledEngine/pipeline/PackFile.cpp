@@ -0,0 +1,329 @@
+#include "PackFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string_view>
+#include <system_error>
+
+#include "Hash.h"
+
+namespace pipeline {
+
+// layout: PackHeader, one Record per file sorted by name, the name block, then the bytes of
+// every file in the same order, each starting on a DataAlignment boundary
+struct PackFile::Record {
+    uint64_t dataOffset;
+    uint64_t size;
+    uint64_t contentHash;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+};
+
+namespace {
+
+constexpr uint32_t PackMagic = 0x4B505453; // "STPK"
+constexpr uint32_t PackVersion = 1;
+constexpr uint64_t DataAlignment = 16;
+
+struct PackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t fileCount;
+    uint32_t nameBytes;
+};
+
+uint64_t AlignUp(uint64_t value) {
+    return (value + DataAlignment - 1) & ~(DataAlignment - 1);
+}
+
+std::string_view NameOf(const char* names, uint32_t offset, uint32_t length) {
+    return std::string_view(names + offset, length);
+}
+
+struct Input {
+    std::string name;
+    std::string filePath;
+    uint64_t size;
+};
+
+bool AddInput(const std::filesystem::path& filePath, std::vector<Input>& files, std::string& error) {
+    std::error_code ec;
+    uint64_t size = std::filesystem::file_size(filePath, ec);
+    if (ec) {
+        error = "Failed to read the size of " + filePath.string();
+        return false;
+    }
+
+    files.push_back({ NormalizePackPath(filePath.generic_string()), filePath.string(), size });
+    return true;
+}
+
+std::mutex MountMutex;
+std::vector<std::shared_ptr<const PackFile>> Mounted;
+
+}
+
+std::string NormalizePackPath(const std::string& filePath) {
+    std::string path = filePath;
+    std::replace(path.begin(), path.end(), '\\', '/');
+    path = std::filesystem::path(path).lexically_normal().generic_string();
+
+    for (char& c : path)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return path;
+}
+
+bool PackFile::Open(const std::string& packPath, std::string& error) {
+    Close();
+
+    if (!_file.Open(packPath)) {
+        error = "Failed to open pack " + packPath;
+        return false;
+    }
+
+    const uint8_t* base = _file.Data();
+    uint64_t size = _file.Size();
+    const PackHeader* header = reinterpret_cast<const PackHeader*>(base);
+
+    uint64_t namesOffset = sizeof(PackHeader) + uint64_t(size >= sizeof(PackHeader) ? header->fileCount : 0) * sizeof(Record);
+    if (size < sizeof(PackHeader) || header->magic != PackMagic || header->version != PackVersion ||
+        namesOffset > size || header->nameBytes > size - namesOffset) {
+        error = "Not a pack or an unsupported version: " + packPath;
+        Close();
+        return false;
+    }
+
+    const Record* records = reinterpret_cast<const Record*>(base + sizeof(PackHeader));
+    const char* names = reinterpret_cast<const char*>(base + namesOffset);
+
+    // checked once here so lookups can trust the table
+    for (uint32_t i = 0; i < header->fileCount; i++) {
+        const Record& record = records[i];
+        if (record.nameOffset > header->nameBytes || record.nameLength > header->nameBytes - record.nameOffset ||
+            record.dataOffset > size || record.size > size - record.dataOffset ||
+            (i > 0 && !(NameOf(names, records[i - 1].nameOffset, records[i - 1].nameLength) <
+                NameOf(names, record.nameOffset, record.nameLength)))) {
+            error = "Corrupt table of contents in " + packPath;
+            Close();
+            return false;
+        }
+    }
+
+    _records = records;
+    _names = names;
+    _count = header->fileCount;
+    return true;
+}
+
+void PackFile::Close() {
+    _file.Close();
+    _records = nullptr;
+    _names = nullptr;
+    _count = 0;
+}
+
+bool PackFile::Find(const std::string& filePath, Entry& entry) const {
+    std::string name = NormalizePackPath(filePath);
+
+    const Record* end = _records + _count;
+    const Record* record = std::lower_bound(_records, end, std::string_view(name), [this](const Record& r, std::string_view key) {
+        return NameOf(_names, r.nameOffset, r.nameLength) < key;
+    });
+    if (record == end || NameOf(_names, record->nameOffset, record->nameLength) != name)
+        return false;
+
+    entry.data = _file.Data() + record->dataOffset;
+    entry.size = static_cast<size_t>(record->size);
+    entry.contentHash = record->contentHash;
+    return true;
+}
+
+bool WritePackFile(const std::string& packPath, const std::vector<std::string>& inputs, std::string& error) {
+    std::string tempPath = packPath + ".tmp";
+    std::string packName = NormalizePackPath(packPath);
+    std::string tempName = NormalizePackPath(tempPath);
+
+    std::vector<Input> files;
+    for (const std::string& input : inputs) {
+        std::error_code ec;
+        if (!std::filesystem::is_directory(input, ec)) {
+            if (!AddInput(input, files, error))
+                return false;
+            continue;
+        }
+
+        for (auto it = std::filesystem::recursive_directory_iterator(input, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->is_regular_file(ec) && !AddInput(it->path(), files, error))
+                return false;
+        }
+        if (ec) {
+            error = "Failed to list " + input;
+            return false;
+        }
+    }
+
+    // a pack written into one of its own inputs must not swallow itself
+    files.erase(std::remove_if(files.begin(), files.end(), [&](const Input& file) {
+        return file.name == packName || file.name == tempName;
+    }), files.end());
+
+    std::sort(files.begin(), files.end(), [](const Input& a, const Input& b) { return a.name < b.name; });
+    for (size_t i = 1; i < files.size(); i++) {
+        if (files[i].name == files[i - 1].name) {
+            error = "Two inputs pack to the same name: " + files[i].name;
+            return false;
+        }
+    }
+
+    PackHeader header;
+    header.magic = PackMagic;
+    header.version = PackVersion;
+    header.fileCount = static_cast<uint32_t>(files.size());
+
+    std::vector<PackFile::Record> records(files.size());
+    std::string names;
+    for (size_t i = 0; i < files.size(); i++) {
+        records[i].nameOffset = static_cast<uint32_t>(names.size());
+        records[i].nameLength = static_cast<uint32_t>(files[i].name.size());
+        names += files[i].name;
+    }
+    header.nameBytes = static_cast<uint32_t>(names.size());
+
+    uint64_t offset = sizeof(PackHeader) + records.size() * sizeof(PackFile::Record) + names.size();
+    for (size_t i = 0; i < files.size(); i++) {
+        records[i].dataOffset = AlignUp(offset);
+        records[i].size = files[i].size;
+        offset = records[i].dataOffset + records[i].size;
+    }
+
+    std::error_code ec;
+    std::filesystem::path parent = std::filesystem::path(packPath).parent_path();
+    if (!parent.empty())
+        std::filesystem::create_directories(parent, ec);
+
+    // same as the cooked models, written aside and swapped in
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            error = "Failed to create " + tempPath;
+            return false;
+        }
+
+        // the records go in again at the end, once the hashes are known
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(PackFile::Record));
+        file.write(names.data(), names.size());
+        uint64_t position = sizeof(PackHeader) + records.size() * sizeof(PackFile::Record) + names.size();
+
+        static const char zeros[DataAlignment] = {};
+        for (size_t i = 0; i < files.size(); i++) {
+            file.write(zeros, static_cast<std::streamsize>(records[i].dataOffset - position));
+            position = records[i].dataOffset;
+
+            // empty files can't be mapped, they only take a record
+            if (records[i].size == 0) {
+                records[i].contentHash = Hash64(nullptr, 0);
+                continue;
+            }
+
+            MappedFile source;
+            if (!source.Open(files[i].filePath) || source.Size() != records[i].size) {
+                error = "Failed to read " + files[i].filePath;
+                file.close();
+                std::filesystem::remove(tempPath, ec);
+                return false;
+            }
+
+            records[i].contentHash = Hash64(source.Data(), source.Size());
+            file.write(reinterpret_cast<const char*>(source.Data()), static_cast<std::streamsize>(source.Size()));
+            position += source.Size();
+        }
+
+        file.seekp(sizeof(PackHeader));
+        file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(PackFile::Record));
+
+        if (!file.good()) {
+            error = "Failed to write " + tempPath;
+            file.close();
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tempPath, packPath, ec);
+    if (ec) {
+        error = "Failed to replace " + packPath;
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+
+    return true;
+}
+
+bool MountPack(const std::string& packPath, std::string& error) {
+    std::shared_ptr<PackFile> pack = std::make_shared<PackFile>();
+    if (!pack->Open(packPath, error))
+        return false;
+
+    std::lock_guard<std::mutex> lock(MountMutex);
+    Mounted.push_back(std::move(pack));
+    return true;
+}
+
+void UnmountPacks() {
+    std::lock_guard<std::mutex> lock(MountMutex);
+    Mounted.clear();
+}
+
+bool AnyPacksMounted() {
+    std::lock_guard<std::mutex> lock(MountMutex);
+    return !Mounted.empty();
+}
+
+bool AssetFile::Open(const std::string& filePath) {
+    if (OpenPacked(filePath))
+        return true;
+
+    if (!_loose.Open(filePath))
+        return false;
+
+    _data = _loose.Data();
+    _size = _loose.Size();
+    _open = true;
+    return true;
+}
+
+bool AssetFile::OpenPacked(const std::string& filePath) {
+    Close();
+
+    std::lock_guard<std::mutex> lock(MountMutex);
+    for (auto pack = Mounted.rbegin(); pack != Mounted.rend(); ++pack) {
+        PackFile::Entry entry;
+        if (!(*pack)->Find(filePath, entry))
+            continue;
+
+        _pack = *pack;
+        _data = entry.data;
+        _size = entry.size;
+        _contentHash = entry.contentHash;
+        _open = true;
+        return true;
+    }
+
+    return false;
+}
+
+void AssetFile::Close() {
+    _pack.reset();
+    _loose.Close();
+    _data = nullptr;
+    _size = 0;
+    _contentHash = 0;
+    _open = false;
+}
+
+}
\ No newline at end of file
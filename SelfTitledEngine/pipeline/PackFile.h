@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+namespace pipeline {
+
+// pack mounted at startup when it sits in the working directory, see WritePackFile
+const char* const ContentPack = "Content.pack";
+
+// many files in one mapping, found through a table of contents sorted by path. Reads are
+// views straight into the mapping, so there is one open for the whole pack.
+class PackFile {
+public:
+    struct Entry {
+        const uint8_t* data;
+        size_t size;
+        // Hash64 of the bytes, the same the cache computes for loose files
+        uint64_t contentHash;
+    };
+
+    bool Open(const std::string& packPath, std::string& error);
+    void Close();
+
+    // paths are looked up the way NormalizePackPath spells them
+    bool Find(const std::string& filePath, Entry& entry) const;
+    size_t FileCount() const { return _count; }
+    size_t Size() const { return _file.Size(); }
+
+    // table of contents entry as stored, see PackFile.cpp
+    struct Record;
+
+private:
+    MappedFile _file;
+    const Record* _records = nullptr;
+    const char* _names = nullptr;
+    uint32_t _count = 0;
+};
+
+// forward slashes, no . or .. parts and ASCII lower case, so any spelling of a path
+// finds the same entry
+std::string NormalizePackPath(const std::string& filePath);
+
+// packs the files, directories are added with everything below them. Entries are named
+// by the path as given, so they are found under the same path as the loose files.
+bool WritePackFile(const std::string& packPath, const std::vector<std::string>& inputs, std::string& error);
+
+// packs searched before the loose files, the last one mounted first. Mount at startup;
+// files opened from a pack keep it alive after it is unmounted.
+bool MountPack(const std::string& packPath, std::string& error);
+void UnmountPacks();
+bool AnyPacksMounted();
+
+// the bytes of an asset, a view into a mounted pack or a mapping of the loose file
+class AssetFile {
+public:
+    bool Open(const std::string& filePath);
+    // only looks in the mounted packs
+    bool OpenPacked(const std::string& filePath);
+    void Close();
+
+    const uint8_t* Data() const { return _data; }
+    size_t Size() const { return _size; }
+    bool IsOpen() const { return _open; }
+    bool IsPacked() const { return _pack != nullptr; }
+    // only known for packed files
+    uint64_t ContentHash() const { return _contentHash; }
+
+private:
+    std::shared_ptr<const PackFile> _pack;
+    MappedFile _loose;
+    const uint8_t* _data = nullptr;
+    size_t _size = 0;
+    uint64_t _contentHash = 0;
+    bool _open = false;
+};
+
+}
\ No newline at end of file
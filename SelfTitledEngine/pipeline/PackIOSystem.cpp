@@ -0,0 +1,53 @@
+#include "PackIOSystem.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <assimp/MemoryIOWrapper.h>
+
+namespace pipeline {
+
+PackIOSystem::~PackIOSystem() {
+    // Assimp closes what it opens, this only catches streams left behind
+    for (PackedStream& packed : _streams)
+        delete packed.stream;
+}
+
+bool PackIOSystem::Exists(const char* filePath) const {
+    AssetFile file;
+    return file.OpenPacked(filePath) || _loose.Exists(filePath);
+}
+
+char PackIOSystem::getOsSeparator() const {
+    // pack lookups take either slash
+    return _loose.getOsSeparator();
+}
+
+Assimp::IOStream* PackIOSystem::Open(const char* filePath, const char* mode) {
+    // packs are read only
+    if (std::strchr(mode, 'w') || std::strchr(mode, 'a') || std::strchr(mode, '+'))
+        return _loose.Open(filePath, mode);
+
+    std::unique_ptr<AssetFile> file(new AssetFile());
+    if (!file->OpenPacked(filePath))
+        return _loose.Open(filePath, mode);
+
+    Assimp::IOStream* stream = new Assimp::MemoryIOStream(file->Data(), file->Size());
+    _streams.push_back({ stream, std::move(file) });
+    return stream;
+}
+
+void PackIOSystem::Close(Assimp::IOStream* stream) {
+    auto packed = std::find_if(_streams.begin(), _streams.end(), [stream](const PackedStream& s) {
+        return s.stream == stream;
+    });
+    if (packed == _streams.end()) {
+        _loose.Close(stream);
+        return;
+    }
+
+    delete stream;
+    _streams.erase(packed);
+}
+
+}
\ No newline at end of file
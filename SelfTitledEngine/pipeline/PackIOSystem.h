@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <assimp/DefaultIOSystem.h>
+#include <assimp/IOSystem.hpp>
+
+#include "PackFile.h"
+
+namespace pipeline {
+
+// serves Assimp's reads from the mounted packs through its MemoryIOStream, as views into
+// the pack mapping without a copy. Files that aren't packed go to the DefaultIOSystem.
+class PackIOSystem : public Assimp::IOSystem {
+public:
+    ~PackIOSystem() override;
+
+    bool Exists(const char* filePath) const override;
+    char getOsSeparator() const override;
+    Assimp::IOStream* Open(const char* filePath, const char* mode = "rb") override;
+    void Close(Assimp::IOStream* stream) override;
+
+private:
+    struct PackedStream {
+        Assimp::IOStream* stream;
+        // keeps the pack mapped while the stream reads from it
+        std::unique_ptr<AssetFile> file;
+    };
+
+    Assimp::DefaultIOSystem _loose;
+    std::vector<PackedStream> _streams;
+};
+
+}
\ No newline at end of file
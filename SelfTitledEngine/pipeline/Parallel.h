@@ -0,0 +1,54 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "AllocationStats.h"
+
+namespace pipeline {
+
+inline unsigned int DefaultThreadCount() {
+    unsigned int count = std::thread::hardware_concurrency();
+    return count ? count : 1;
+}
+
+// calls fn(index) for every index in [0, count) on up to threadCount threads, the calling
+// thread included. Indices are handed out one at a time so uneven work balances itself.
+// What the helper threads allocate counts for the calling thread, see AllocationStats.h.
+template <typename Fn>
+void ParallelFor(size_t count, unsigned int threadCount, Fn&& fn) {
+    if (threadCount == 0)
+        threadCount = DefaultThreadCount();
+
+    size_t workers = std::min<size_t>(threadCount, count);
+    if (workers <= 1) {
+        for (size_t i = 0; i < count; i++)
+            fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next{ 0 };
+    auto work = [&] {
+        for (size_t i = next++; i < count; i = next++)
+            fn(i);
+    };
+
+    ThreadAllocationCounters* counters = CurrentAllocationCounters();
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (size_t i = 1; i < workers; i++) {
+        threads.emplace_back([&] {
+            AllocationCountersScope scope(counters);
+            work();
+        });
+    }
+
+    work();
+
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+}
\ No newline at end of file
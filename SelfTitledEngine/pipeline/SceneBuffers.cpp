@@ -0,0 +1,158 @@
+#include "SceneBuffers.h"
+
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include "IndexBuffer.h"
+#include "VertexFormat.h"
+
+namespace pipeline {
+
+namespace {
+
+// room for every allocation's alignment in the single staging block
+constexpr size_t StagingAlignment = 16;
+
+template <typename T>
+const T* CopyInto(Arena& arena, const T* source, size_t count) {
+    if (count == 0)
+        return nullptr;
+
+    T* target = arena.Allocate<T>(count);
+    std::memcpy(target, source, count * sizeof(T));
+    return target;
+}
+
+// sizes and the submesh table of meshes packed back to back, without touching their data
+bool LayOut(const std::vector<MeshView>& meshes, SceneBuffers& buffers, std::string& error) {
+    buffers = SceneBuffers();
+    if (meshes.empty()) {
+        error = "Model has no meshes";
+        return false;
+    }
+
+    buffers.format = meshes[0].format;
+
+    uint64_t vertexCount = 0;
+    uint64_t indexCounts[IndexFormatCount] = {};
+    for (const MeshView& mesh : meshes) {
+        if (mesh.format.position != buffers.format.position) {
+            error = "Meshes of a model must share a vertex format";
+            return false;
+        }
+
+        vertexCount += mesh.numberOfVertices;
+        indexCounts[size_t(mesh.indexFormat)] += mesh.numberOfIndices;
+    }
+
+    if (vertexCount > uint64_t(std::numeric_limits<int32_t>::max()) || indexCounts[0] > std::numeric_limits<uint32_t>::max() ||
+        indexCounts[1] > std::numeric_limits<uint32_t>::max()) {
+        error = "Model is too large for one vertex and index buffer";
+        return false;
+    }
+
+    buffers.numberOfVertices = static_cast<uint32_t>(vertexCount);
+    buffers.vertexBytes = static_cast<size_t>(vertexCount) * VertexStride(buffers.format);
+    for (size_t format = 0; format < IndexFormatCount; format++) {
+        buffers.indices[format].numberOfIndices = static_cast<uint32_t>(indexCounts[format]);
+        buffers.indices[format].bytes = static_cast<size_t>(indexCounts[format]) * IndexSize(IndexFormat(format));
+    }
+
+    buffers.submeshes.reserve(meshes.size());
+    int32_t baseVertex = 0;
+    uint32_t firstIndex[IndexFormatCount] = {};
+    for (const MeshView& mesh : meshes) {
+        size_t format = size_t(mesh.indexFormat);
+        buffers.submeshes.push_back({ firstIndex[format], mesh.numberOfIndices, baseVertex, mesh.indexFormat });
+        firstIndex[format] += mesh.numberOfIndices;
+        baseVertex += static_cast<int32_t>(mesh.numberOfVertices);
+    }
+
+    return true;
+}
+
+}
+
+bool BuildSceneBuffers(std::vector<MeshView>& meshes, SceneBuffers& buffers, std::string& error) {
+    std::vector<MeshView> sources = meshes;
+    std::vector<uint8_t*> vertexSlots, indexSlots;
+    if (!ReserveSceneBuffers(meshes, buffers, vertexSlots, indexSlots, error))
+        return false;
+
+    uint32_t stride = VertexStride(buffers.format);
+    for (size_t i = 0; i < meshes.size(); i++) {
+        std::memcpy(vertexSlots[i], sources[i].vertices, size_t(sources[i].numberOfVertices) * stride);
+        std::memcpy(indexSlots[i], sources[i].indices, size_t(sources[i].numberOfIndices) * IndexSize(sources[i].indexFormat));
+    }
+
+    return true;
+}
+
+bool ReserveSceneBuffers(std::vector<MeshView>& meshes, SceneBuffers& buffers, std::vector<uint8_t*>& vertexSlots,
+    std::vector<uint8_t*>& indexSlots, std::string& error) {
+    if (!LayOut(meshes, buffers, error))
+        return false;
+
+    // one block for everything
+    size_t tableBytes = 0;
+    for (const MeshView& mesh : meshes)
+        tableBytes += mesh.numberOfLods * sizeof(MeshLod) + mesh.numberOfMeshlets * sizeof(Meshlet) + 2 * StagingAlignment;
+    buffers.staging = Arena(buffers.vertexBytes + buffers.IndexBytes() + tableBytes + (1 + IndexFormatCount) * StagingAlignment);
+
+    uint8_t* vertices = static_cast<uint8_t*>(buffers.staging.Allocate(buffers.vertexBytes, StagingAlignment));
+    uint8_t* indices[IndexFormatCount];
+    for (size_t format = 0; format < IndexFormatCount; format++) {
+        indices[format] = static_cast<uint8_t*>(buffers.staging.Allocate(buffers.indices[format].bytes, StagingAlignment));
+        buffers.indices[format].indices = indices[format];
+    }
+    buffers.vertices = vertices;
+
+    uint32_t stride = VertexStride(buffers.format);
+    vertexSlots.resize(meshes.size());
+    indexSlots.resize(meshes.size());
+    for (size_t i = 0; i < meshes.size(); i++) {
+        MeshView& mesh = meshes[i];
+        const SubmeshRange& range = buffers.submeshes[i];
+        size_t format = size_t(mesh.indexFormat);
+
+        vertexSlots[i] = vertices + size_t(range.baseVertex) * stride;
+        indexSlots[i] = indices[format] + size_t(range.firstIndex) * IndexSize(mesh.indexFormat);
+        mesh.vertices = vertexSlots[i];
+        mesh.indices = indexSlots[i];
+        mesh.lods = CopyInto(buffers.staging, mesh.lods, mesh.numberOfLods);
+        mesh.meshlets = CopyInto(buffers.staging, mesh.meshlets, mesh.numberOfMeshlets);
+    }
+
+    return true;
+}
+
+bool AdoptSceneBuffers(const std::vector<MeshView>& meshes, MappedFile&& mapping, Arena&& staging, SceneBuffers& buffers,
+    std::string& error) {
+    if (!LayOut(meshes, buffers, error))
+        return false;
+
+    // the regions start where their first mesh does
+    buffers.vertices = meshes[0].vertices;
+    for (size_t i = meshes.size(); i-- > 0;)
+        buffers.indices[size_t(meshes[i].indexFormat)].indices = meshes[i].indices;
+
+    // nothing moves, so every mesh has to sit where LayOut put it
+    uint32_t stride = VertexStride(buffers.format);
+    for (size_t i = 0; i < meshes.size(); i++) {
+        const MeshView& mesh = meshes[i];
+        const SubmeshRange& range = buffers.submeshes[i];
+        if (mesh.vertices != buffers.vertices + size_t(range.baseVertex) * stride ||
+            mesh.indices != buffers.indices[size_t(mesh.indexFormat)].indices + size_t(range.firstIndex) * IndexSize(mesh.indexFormat)) {
+            buffers = SceneBuffers();
+            error = "Meshes aren't laid out back to back";
+            return false;
+        }
+    }
+
+    buffers.mapping = std::move(mapping);
+    buffers.staging = std::move(staging);
+    return true;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../Dx11App/types.h"
+#include "Arena.h"
+#include "MappedFile.h"
+
+namespace pipeline {
+
+// where one mesh landed in the shared buffers. Its indices stay local to the mesh,
+// baseVertex is added to them when drawing.
+struct SubmeshRange {
+    // in elements of the index buffer of indexFormat
+    uint32_t firstIndex;
+    // every level of detail, lod ranges are relative to firstIndex
+    uint32_t numberOfIndices;
+    int32_t baseVertex;
+    // the mesh's own, which picks the index buffer it sits in
+    IndexFormat indexFormat = IndexFormat::Uint16;
+};
+
+// the indices of every mesh packed at one width, back to back
+struct IndexRegion {
+    const uint8_t* indices = nullptr;
+    size_t bytes = 0;
+    uint32_t numberOfIndices = 0;
+};
+
+// every mesh of a model packed back to back into one vertex buffer and one index buffer per
+// index format, so the whole model uploads in a few buffer creations and a 32 bit mesh
+// doesn't widen the 16 bit ones
+struct SceneBuffers {
+    // one block holding the buffers below and the meshes' lods and meshlets, buffer
+    // creation reads straight out of it and it is freed in one go with this
+    Arena staging;
+    // on a cache hit the cooked file, already laid out like the buffers, stands in for
+    // staging. It only holds what was decoded, if anything.
+    MappedFile mapping;
+    const uint8_t* vertices = nullptr;
+    size_t vertexBytes = 0;
+    VertexFormat format;
+    uint32_t numberOfVertices = 0;
+    // by IndexFormat
+    IndexRegion indices[IndexFormatCount];
+    // one per mesh, in order
+    std::vector<SubmeshRange> submeshes;
+
+    size_t IndexBytes() const { return indices[0].bytes + indices[1].bytes; }
+};
+
+// copies meshes into the staging block and points each view's vertices, indices, lods and
+// meshlets at its copy, so the views no longer depend on what they were built from. Each
+// mesh keeps its index format. Fails when the meshes don't share a vertex format or don't
+// fit 32 bit offsets.
+bool BuildSceneBuffers(std::vector<MeshView>& meshes, SceneBuffers& buffers, std::string& error);
+
+// lays out the staging block for meshes that aren't packed yet, copying only their lods and
+// meshlets. Each view's vertices and indices point at its uninitialized slot, also handed
+// out writable in vertexSlots and indexSlots for the packing passes to fill.
+bool ReserveSceneBuffers(std::vector<MeshView>& meshes, SceneBuffers& buffers, std::vector<uint8_t*>& vertexSlots,
+    std::vector<uint8_t*>& indexSlots, std::string& error);
+
+// takes meshes that already sit back to back the way BuildSceneBuffers lays them out, in memory
+// owned by mapping and staging, and keeps both alive instead of copying anything. Neither is
+// taken when the meshes aren't laid out that way.
+bool AdoptSceneBuffers(const std::vector<MeshView>& meshes, MappedFile&& mapping, Arena&& staging, SceneBuffers& buffers,
+    std::string& error);
+
+}
\ No newline at end of file
@@ -0,0 +1,347 @@
+#include "Simplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "Parallel.h"
+#include "VertexCache.h"
+
+namespace pipeline {
+
+namespace {
+
+const uint32_t NoVertex = UINT32_MAX;
+
+// area weighted sum of squared distances to a set of planes, in double since collapses
+// keep adding to it
+struct Quadric {
+    double a2, b2, c2, ab, ac, bc, ad, bd, cd, d2;
+    double weight;
+};
+
+void AddPlane(Quadric& q, double a, double b, double c, double d, double weight) {
+    q.a2 += weight * a * a;
+    q.b2 += weight * b * b;
+    q.c2 += weight * c * c;
+    q.ab += weight * a * b;
+    q.ac += weight * a * c;
+    q.bc += weight * b * c;
+    q.ad += weight * a * d;
+    q.bd += weight * b * d;
+    q.cd += weight * c * d;
+    q.d2 += weight * d * d;
+    q.weight += weight;
+}
+
+void AddQuadric(Quadric& q, const Quadric& other) {
+    q.a2 += other.a2;
+    q.b2 += other.b2;
+    q.c2 += other.c2;
+    q.ab += other.ab;
+    q.ac += other.ac;
+    q.bc += other.bc;
+    q.ad += other.ad;
+    q.bd += other.bd;
+    q.cd += other.cd;
+    q.d2 += other.d2;
+    q.weight += other.weight;
+}
+
+// mean squared distance of p to the planes
+double Evaluate(const Quadric& q, const DirectX::XMFLOAT3& p) {
+    if (q.weight == 0.0)
+        return 0.0;
+
+    double x = p.x, y = p.y, z = p.z;
+    double error = x * x * q.a2 + y * y * q.b2 + z * z * q.c2 +
+        2.0 * (x * y * q.ab + x * z * q.ac + y * z * q.bc) +
+        2.0 * (x * q.ad + y * q.bd + z * q.cd) + q.d2;
+    return std::max(error / q.weight, 0.0);
+}
+
+DirectX::XMFLOAT3 TriangleNormal(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b, const DirectX::XMFLOAT3& c) {
+    float ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+    float vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+    return DirectX::XMFLOAT3(uy * vz - uz * vy, uz * vx - ux * vz, ux * vy - uy * vx);
+}
+
+// vertices that must not move: ones sharing their position with another vertex, and ones
+// on an edge that doesn't have exactly one opposite edge
+std::vector<uint8_t> FindLockedVertices(const Vertex* vertices, size_t vertexCount, const DirectX::XMUINT3* triangles, size_t triangleCount) {
+    std::vector<uint8_t> locked(vertexCount, 0);
+
+    // group vertices by position bits
+    std::vector<uint32_t> order(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+        order[i] = static_cast<uint32_t>(i);
+
+    auto less = [&](uint32_t a, uint32_t b) {
+        const DirectX::XMFLOAT3& p = vertices[a].Pos;
+        const DirectX::XMFLOAT3& q = vertices[b].Pos;
+        if (p.x != q.x)
+            return p.x < q.x;
+        if (p.y != q.y)
+            return p.y < q.y;
+        return p.z < q.z;
+    };
+    std::sort(order.begin(), order.end(), less);
+
+    std::vector<uint32_t> positionIds(vertexCount);
+    uint32_t positionId = 0;
+    for (size_t i = 0; i < vertexCount; i++) {
+        if (i > 0 && less(order[i - 1], order[i]))
+            positionId++;
+        positionIds[order[i]] = positionId;
+
+        if (i > 0 && !less(order[i - 1], order[i])) {
+            locked[order[i - 1]] = 1;
+            locked[order[i]] = 1;
+        }
+    }
+
+    // directed edges between positions, a closed manifold surface has every one exactly once
+    // along with its opposite
+    std::vector<uint64_t> edges;
+    edges.reserve(triangleCount * 3);
+    for (size_t i = 0; i < triangleCount; i++) {
+        const uint32_t corners[3] = { triangles[i].x, triangles[i].y, triangles[i].z };
+        for (int e = 0; e < 3; e++) {
+            uint64_t from = positionIds[corners[e]];
+            uint64_t to = positionIds[corners[(e + 1) % 3]];
+            edges.push_back(from << 32 | to);
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    auto edgeCount = [&](uint64_t edge) {
+        auto range = std::equal_range(edges.begin(), edges.end(), edge);
+        return range.second - range.first;
+    };
+
+    for (size_t i = 0; i < triangleCount; i++) {
+        const uint32_t corners[3] = { triangles[i].x, triangles[i].y, triangles[i].z };
+        for (int e = 0; e < 3; e++) {
+            uint64_t from = positionIds[corners[e]];
+            uint64_t to = positionIds[corners[(e + 1) % 3]];
+            if (edgeCount(from << 32 | to) != 1 || edgeCount(to << 32 | from) != 1) {
+                locked[corners[e]] = 1;
+                locked[corners[(e + 1) % 3]] = 1;
+            }
+        }
+    }
+
+    return locked;
+}
+
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double cost;
+};
+
+}
+
+std::vector<SimplifiedLevel> SimplifyLevels(const Vertex* vertices, size_t vertexCount,
+    const DirectX::XMUINT3* triangles, size_t triangleCount, const float* ratios, size_t ratioCount) {
+    std::vector<SimplifiedLevel> levels;
+    std::vector<uint8_t> locked = FindLockedVertices(vertices, vertexCount, triangles, triangleCount);
+
+    // plane of every triangle around each vertex
+    std::vector<Quadric> quadrics(vertexCount, Quadric{});
+    for (size_t i = 0; i < triangleCount; i++) {
+        const DirectX::XMUINT3& t = triangles[i];
+        const DirectX::XMFLOAT3& a = vertices[t.x].Pos;
+        DirectX::XMFLOAT3 n = TriangleNormal(a, vertices[t.y].Pos, vertices[t.z].Pos);
+        double length = std::sqrt(double(n.x) * n.x + double(n.y) * n.y + double(n.z) * n.z);
+        if (length == 0.0)
+            continue;
+
+        double nx = n.x / length, ny = n.y / length, nz = n.z / length;
+        double d = -(nx * a.x + ny * a.y + nz * a.z);
+        double area = 0.5 * length;
+        AddPlane(quadrics[t.x], nx, ny, nz, d, area);
+        AddPlane(quadrics[t.y], nx, ny, nz, d, area);
+        AddPlane(quadrics[t.z], nx, ny, nz, d, area);
+    }
+
+    std::vector<DirectX::XMUINT3> current(triangles, triangles + triangleCount);
+    double maxCost = 0.0;
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<uint8_t> touched(vertexCount);
+    std::vector<Collapse> collapses;
+
+    for (size_t level = 0; level < ratioCount; level++) {
+        size_t target = static_cast<size_t>(triangleCount * ratios[level]);
+
+        // a pass collapses an independent set of edges, cheapest first, then rebuilds
+        while (current.size() > target) {
+            std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+            for (const DirectX::XMUINT3& t : current) {
+                adjacencyOffsets[t.x + 1]++;
+                adjacencyOffsets[t.y + 1]++;
+                adjacencyOffsets[t.z + 1]++;
+            }
+            for (size_t v = 0; v < vertexCount; v++)
+                adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+            adjacency.resize(current.size() * 3);
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < current.size(); i++) {
+                adjacency[fill[current[i].x]++] = static_cast<uint32_t>(i);
+                adjacency[fill[current[i].y]++] = static_cast<uint32_t>(i);
+                adjacency[fill[current[i].z]++] = static_cast<uint32_t>(i);
+            }
+
+            collapses.clear();
+            for (const DirectX::XMUINT3& t : current) {
+                const uint32_t corners[3] = { t.x, t.y, t.z };
+                for (int e = 0; e < 3; e++) {
+                    uint32_t a = corners[e];
+                    uint32_t b = corners[(e + 1) % 3];
+                    if (!locked[a])
+                        collapses.push_back({ a, b, Evaluate(quadrics[a], vertices[b].Pos) });
+                    if (!locked[b])
+                        collapses.push_back({ b, a, Evaluate(quadrics[b], vertices[a].Pos) });
+                }
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+                return a.cost < b.cost;
+            });
+
+            for (size_t v = 0; v < vertexCount; v++)
+                remap[v] = static_cast<uint32_t>(v);
+            std::fill(touched.begin(), touched.end(), 0);
+
+            size_t budget = current.size() - target;
+            size_t removed = 0;
+            size_t applied = 0;
+
+            for (const Collapse& collapse : collapses) {
+                if (removed >= budget)
+                    break;
+                if (touched[collapse.from] || touched[collapse.to])
+                    continue;
+
+                // the triangles that stay must keep facing the same way
+                bool flips = false;
+                size_t dropped = 0;
+                const DirectX::XMFLOAT3& destination = vertices[collapse.to].Pos;
+                for (uint32_t k = adjacencyOffsets[collapse.from]; k < adjacencyOffsets[collapse.from + 1]; k++) {
+                    const DirectX::XMUINT3& t = current[adjacency[k]];
+                    if (t.x == collapse.to || t.y == collapse.to || t.z == collapse.to) {
+                        dropped++;
+                        continue;
+                    }
+
+                    DirectX::XMFLOAT3 p[3] = { vertices[t.x].Pos, vertices[t.y].Pos, vertices[t.z].Pos };
+                    DirectX::XMFLOAT3 before = TriangleNormal(p[0], p[1], p[2]);
+                    p[t.x == collapse.from ? 0 : t.y == collapse.from ? 1 : 2] = destination;
+                    DirectX::XMFLOAT3 after = TriangleNormal(p[0], p[1], p[2]);
+
+                    if (before.x * after.x + before.y * after.y + before.z * after.z <= 0.0f) {
+                        flips = true;
+                        break;
+                    }
+                }
+                if (flips)
+                    continue;
+
+                remap[collapse.from] = collapse.to;
+                AddQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+                maxCost = std::max(maxCost, collapse.cost);
+
+                // everything around the collapse changed, leave it to the next pass
+                for (uint32_t k = adjacencyOffsets[collapse.from]; k < adjacencyOffsets[collapse.from + 1]; k++) {
+                    const DirectX::XMUINT3& t = current[adjacency[k]];
+                    touched[t.x] = 1;
+                    touched[t.y] = 1;
+                    touched[t.z] = 1;
+                }
+
+                removed += dropped;
+                applied++;
+            }
+
+            // only locked or flipping collapses left, this is as far as it goes
+            if (applied == 0)
+                break;
+
+            size_t kept = 0;
+            for (const DirectX::XMUINT3& t : current) {
+                DirectX::XMUINT3 r(remap[t.x], remap[t.y], remap[t.z]);
+                if (r.x != r.y && r.y != r.z && r.z != r.x)
+                    current[kept++] = r;
+            }
+            current.resize(kept);
+        }
+
+        levels.push_back({ current, static_cast<float>(std::sqrt(maxCost)) });
+    }
+
+    return levels;
+}
+
+void GenerateLods(const std::string& name, std::vector<Mesh>& meshes) {
+    ParallelFor(meshes.size(), 0, [&](size_t i) {
+        Mesh& mesh = meshes[i];
+        const size_t triangleCount = mesh.indices.size();
+
+        std::vector<SimplifiedLevel> levels = SimplifyLevels(mesh.vertices.data(), mesh.vertices.size(),
+            mesh.indices.data(), triangleCount, LodRatios, LodCount);
+
+        mesh.lods.clear();
+        mesh.lods.push_back(MeshLod{ 0, static_cast<uint32_t>(triangleCount * 3), 0.0f });
+
+        for (SimplifiedLevel& level : levels) {
+            // a level that couldn't get any coarser than the last one only costs memory
+            if (level.triangles.empty() || level.triangles.size() * 3 >= mesh.lods.back().numberOfIndices)
+                break;
+
+            OptimizeVertexCache(level.triangles.data(), level.triangles.size(), mesh.vertices.size());
+
+            MeshLod lod;
+            lod.firstIndex = static_cast<uint32_t>(mesh.indices.size() * 3);
+            lod.numberOfIndices = static_cast<uint32_t>(level.triangles.size() * 3);
+            lod.error = level.error;
+            mesh.lods.push_back(lod);
+
+            mesh.indices.insert(mesh.indices.end(), level.triangles.begin(), level.triangles.end());
+        }
+
+        mesh.numberOfIndices = static_cast<unsigned int>(mesh.indices.size() * 3);
+    });
+
+    std::ostringstream report;
+    for (size_t i = 0; i < meshes.size(); i++) {
+        const Mesh& mesh = meshes[i];
+
+        report << "lod " << name << " mesh " << i << ":";
+        for (const MeshLod& lod : mesh.lods)
+            report << " " << lod.numberOfIndices / 3;
+        report << " triangles, error" << std::scientific << std::setprecision(2);
+        for (const MeshLod& lod : mesh.lods)
+            report << " " << lod.error;
+        report << std::defaultfloat << "\n";
+    }
+    std::cout << report.str() << std::flush;
+}
+
+unsigned int SelectLod(const MeshLod* lods, unsigned int count, float distance, float pixelsPerUnit, float maxPixels) {
+    if (count == 0)
+        return 0;
+
+    distance = std::max(distance, 1e-6f);
+    for (unsigned int level = count - 1; level > 0; level--) {
+        if (lods[level].error * pixelsPerUnit / distance <= maxPixels)
+            return level;
+    }
+    return 0;
+}
+
+}
\ No newline at end of file
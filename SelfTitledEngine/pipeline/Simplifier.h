@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "../Dx11App/types.h"
+
+namespace pipeline {
+
+// triangle count of each level after the full mesh, as a fraction of the full mesh
+const float LodRatios[] = { 0.5f, 0.25f, 0.125f, 0.0625f };
+constexpr size_t LodCount = sizeof(LodRatios) / sizeof(LodRatios[0]);
+
+struct SimplifiedLevel {
+    std::vector<DirectX::XMUINT3> triangles;
+    // largest collapse error so far, the root mean square distance of a moved vertex to
+    // the planes it has absorbed, in model units
+    float error;
+};
+
+// quadric error edge collapse. Collapses vertices onto neighbours, so every level indexes
+// the original vertices, until each ratio of the input triangle count is reached; one
+// level per ratio, coarser ones continuing from finer ones. Vertices whose position is
+// shared with another vertex (uv, normal and material seams) and vertices on open borders
+// never move, so seams and boundaries stay exactly where they were.
+std::vector<SimplifiedLevel> SimplifyLevels(const Vertex* vertices, size_t vertexCount,
+    const DirectX::XMUINT3* triangles, size_t triangleCount, const float* ratios, size_t ratioCount);
+
+// appends a chain of levels at LodRatios to every mesh's indices and fills in mesh.lods,
+// meshes in parallel. Prints per mesh triangle counts and errors tagged with name.
+void GenerateLods(const std::string& name, std::vector<Mesh>& meshes);
+
+// coarsest level whose error, seen from distance, covers at most maxPixels on screen.
+// pixelsPerUnit is the projected size of one model unit at distance one.
+unsigned int SelectLod(const MeshLod* lods, unsigned int count, float distance, float pixelsPerUnit, float maxPixels);
+
+}
\ No newline at end of file
@@ -0,0 +1,451 @@
+#include "TangentSpace.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "Parallel.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define PIPELINE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace pipeline {
+
+namespace {
+
+// the face kernels below run LaneWidth triangles at a time, one per lane. Without SSE2 the
+// same code runs one triangle at a time on plain floats.
+#ifdef PIPELINE_SSE2
+constexpr size_t LaneWidth = 4;
+using Lane = __m128;
+
+inline Lane Splat(float value) { return _mm_set1_ps(value); }
+inline Lane Add(Lane a, Lane b) { return _mm_add_ps(a, b); }
+inline Lane Sub(Lane a, Lane b) { return _mm_sub_ps(a, b); }
+inline Lane Mul(Lane a, Lane b) { return _mm_mul_ps(a, b); }
+inline Lane Div(Lane a, Lane b) { return _mm_div_ps(a, b); }
+inline Lane Sqrt(Lane a) { return _mm_sqrt_ps(a); }
+inline Lane Min(Lane a, Lane b) { return _mm_min_ps(a, b); }
+inline Lane Max(Lane a, Lane b) { return _mm_max_ps(a, b); }
+inline Lane Abs(Lane a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+// masks are all ones where true
+inline Lane Greater(Lane a, Lane b) { return _mm_cmpgt_ps(a, b); }
+inline Lane Select(Lane mask, Lane a, Lane b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+inline void Store(Lane a, float* out) { _mm_storeu_ps(out, a); }
+
+template <typename Fn>
+inline Lane Gather(Fn&& fn) {
+    return _mm_setr_ps(fn(0), fn(1), fn(2), fn(3));
+}
+#else
+constexpr size_t LaneWidth = 1;
+using Lane = float;
+
+inline Lane Splat(float value) { return value; }
+inline Lane Add(Lane a, Lane b) { return a + b; }
+inline Lane Sub(Lane a, Lane b) { return a - b; }
+inline Lane Mul(Lane a, Lane b) { return a * b; }
+inline Lane Div(Lane a, Lane b) { return a / b; }
+inline Lane Sqrt(Lane a) { return std::sqrt(a); }
+inline Lane Min(Lane a, Lane b) { return std::min(a, b); }
+inline Lane Max(Lane a, Lane b) { return std::max(a, b); }
+inline Lane Abs(Lane a) { return std::fabs(a); }
+inline Lane Greater(Lane a, Lane b) { return a > b ? 1.0f : 0.0f; }
+inline Lane Select(Lane mask, Lane a, Lane b) { return mask != 0.0f ? a : b; }
+inline void Store(Lane a, float* out) { *out = a; }
+
+template <typename Fn>
+inline Lane Gather(Fn&& fn) {
+    return fn(0);
+}
+#endif
+
+// triangles per task, whole batches of lanes so batches are the same for any thread count
+constexpr size_t TriangleBlock = 4096;
+static_assert(TriangleBlock % LaneWidth == 0, "blocks must hold whole batches");
+
+// positions or vertices per accumulation task
+constexpr size_t AccumulateBlock = 4096;
+
+// corners around a position that are gathered into a local array, busier ones are read in place
+constexpr size_t MaxLocalCorners = 32;
+
+struct Lane3 {
+    Lane x, y, z;
+};
+
+inline Lane3 Sub(const Lane3& a, const Lane3& b) {
+    return Lane3{ Sub(a.x, b.x), Sub(a.y, b.y), Sub(a.z, b.z) };
+}
+
+inline Lane3 Scale(const Lane3& a, Lane s) {
+    return Lane3{ Mul(a.x, s), Mul(a.y, s), Mul(a.z, s) };
+}
+
+inline Lane Dot(const Lane3& a, const Lane3& b) {
+    return Add(Add(Mul(a.x, b.x), Mul(a.y, b.y)), Mul(a.z, b.z));
+}
+
+inline Lane3 Cross(const Lane3& a, const Lane3& b) {
+    return Lane3{
+        Sub(Mul(a.y, b.z), Mul(a.z, b.y)),
+        Sub(Mul(a.z, b.x), Mul(a.x, b.z)),
+        Sub(Mul(a.x, b.y), Mul(a.y, b.x))
+    };
+}
+
+// the part of a perpendicular to the unit vector n
+inline Lane3 Reject(const Lane3& a, const Lane3& n) {
+    return Sub(a, Scale(n, Dot(n, a)));
+}
+
+// unit length, zero stays zero. length gets the length before.
+inline Lane3 Normalize(const Lane3& v, Lane& length) {
+    length = Sqrt(Dot(v, v));
+    Lane valid = Greater(length, Splat(FLT_MIN));
+    Lane scale = Select(valid, Div(Splat(1.0f), Max(length, Splat(FLT_MIN))), Splat(0.0f));
+    return Scale(v, scale);
+}
+
+inline Lane3 Normalize(const Lane3& v) {
+    Lane length;
+    return Normalize(v, length);
+}
+
+// acos to within 7e-5 radians (Abramowitz and Stegun 4.4.45), plenty for a weight
+inline Lane Acos(Lane x) {
+    x = Max(Min(x, Splat(1.0f)), Splat(-1.0f));
+    Lane a = Abs(x);
+    Lane p = Add(Mul(Splat(-0.0187293f), a), Splat(0.0742610f));
+    p = Add(Mul(p, a), Splat(-0.2121144f));
+    p = Add(Mul(p, a), Splat(1.5707288f));
+    Lane r = Mul(Sqrt(Sub(Splat(1.0f), a)), p);
+    return Select(Greater(Splat(0.0f), x), Sub(Splat(3.14159265f), r), r);
+}
+
+// angle between two unit vectors
+inline Lane AngleBetween(const Lane3& a, const Lane3& b) {
+    return Acos(Dot(a, b));
+}
+
+inline uint32_t Corner(const DirectX::XMUINT3& triangle, size_t corner) {
+    return corner == 0 ? triangle.x : corner == 1 ? triangle.y : triangle.z;
+}
+
+// triangle of each lane in the batch at first, lanes past the end repeat the last one
+struct Batch {
+    size_t triangles[LaneWidth];
+    size_t count;
+
+    Batch(size_t first, size_t triangleCount) {
+        count = std::min(LaneWidth, triangleCount - first);
+        for (size_t lane = 0; lane < LaneWidth; lane++)
+            triangles[lane] = first + std::min(lane, count - 1);
+    }
+};
+
+inline Lane3 GatherCorner(const DirectX::XMFLOAT3* values, const DirectX::XMUINT3* triangles, const Batch& batch, size_t corner) {
+    uint32_t indices[LaneWidth];
+    for (size_t lane = 0; lane < LaneWidth; lane++)
+        indices[lane] = Corner(triangles[batch.triangles[lane]], corner);
+
+    return Lane3{
+        Gather([&](size_t lane) { return values[indices[lane]].x; }),
+        Gather([&](size_t lane) { return values[indices[lane]].y; }),
+        Gather([&](size_t lane) { return values[indices[lane]].z; })
+    };
+}
+
+// unit normal of a face and what it weighs at each corner
+struct Face {
+    DirectX::XMFLOAT3 normal;
+    float weights[3];
+};
+
+void FaceNormals(const DirectX::XMFLOAT3* positions, const DirectX::XMUINT3* triangles, const Batch& batch, NormalWeighting weighting,
+    Face* faces) {
+    Lane3 p0 = GatherCorner(positions, triangles, batch, 0);
+    Lane3 p1 = GatherCorner(positions, triangles, batch, 1);
+    Lane3 p2 = GatherCorner(positions, triangles, batch, 2);
+
+    Lane3 e1 = Sub(p1, p0);
+    Lane3 e2 = Sub(p2, p0);
+
+    // twice the area, only the ratios between faces matter
+    Lane area;
+    Lane3 normal = Normalize(Cross(e1, e2), area);
+
+    Lane weights[3] = { area, area, area };
+    if (weighting != NormalWeighting::Area) {
+        Lane3 u1 = Normalize(e1);
+        Lane3 u2 = Normalize(e2);
+        Lane3 u3 = Normalize(Sub(p2, p1));
+        Lane3 zero = { Splat(0.0f), Splat(0.0f), Splat(0.0f) };
+
+        // the angles of a degenerate face don't matter, its normal is zero
+        weights[0] = AngleBetween(u1, u2);
+        weights[1] = AngleBetween(Sub(zero, u1), u3);
+        weights[2] = AngleBetween(u2, u3);
+        if (weighting == NormalWeighting::AreaAngle) {
+            for (int corner = 0; corner < 3; corner++)
+                weights[corner] = Mul(weights[corner], area);
+        }
+    }
+
+    float x[LaneWidth], y[LaneWidth], z[LaneWidth], w[3][LaneWidth];
+    Store(normal.x, x);
+    Store(normal.y, y);
+    Store(normal.z, z);
+    for (int corner = 0; corner < 3; corner++)
+        Store(weights[corner], w[corner]);
+
+    for (size_t lane = 0; lane < batch.count; lane++) {
+        Face& face = faces[batch.triangles[lane]];
+        face.normal = DirectX::XMFLOAT3(x[lane], y[lane], z[lane]);
+        face.weights[0] = w[0][lane];
+        face.weights[1] = w[1][lane];
+        face.weights[2] = w[2][lane];
+    }
+}
+
+// MikkTSpace's per corner contribution: the face's texture space s direction, signed by
+// its orientation, projected onto the corner normal and weighted by the corner angle on
+// that plane. w is 1 or -1 for the orientation, 0 for faces without texture area.
+void CornerTangents(const TangentInput& input, const Batch& batch, DirectX::XMFLOAT4* contributions) {
+    Lane3 p[3];
+    Lane u[3], v[3];
+    for (size_t corner = 0; corner < 3; corner++) {
+        p[corner] = GatherCorner(input.positions, input.positionTriangles, batch, corner);
+
+        uint32_t indices[LaneWidth];
+        for (size_t lane = 0; lane < LaneWidth; lane++)
+            indices[lane] = Corner(input.texcoordTriangles[batch.triangles[lane]], corner);
+        u[corner] = Gather([&](size_t lane) { return input.texcoords[indices[lane]].x; });
+        v[corner] = Gather([&](size_t lane) { return input.texcoords[indices[lane]].y; });
+    }
+
+    Lane3 d1 = Sub(p[1], p[0]);
+    Lane3 d2 = Sub(p[2], p[0]);
+    Lane t21x = Sub(u[1], u[0]);
+    Lane t21y = Sub(v[1], v[0]);
+    Lane t31x = Sub(u[2], u[0]);
+    Lane t31y = Sub(v[2], v[0]);
+
+    Lane signedArea = Sub(Mul(t21x, t31y), Mul(t21y, t31x));
+    Lane preserving = Greater(signedArea, Splat(0.0f));
+    Lane sign = Select(preserving, Splat(1.0f), Splat(-1.0f));
+    Lane orientation = Select(Greater(Abs(signedArea), Splat(FLT_MIN)), sign, Splat(0.0f));
+
+    Lane3 s = Scale(Normalize(Sub(Scale(d1, t31y), Scale(d2, t21y))), sign);
+
+    float w[LaneWidth];
+    Store(orientation, w);
+
+    for (size_t corner = 0; corner < 3; corner++) {
+        Lane3 n = Lane3{
+            Gather([&](size_t lane) { return input.normals[batch.triangles[lane] * 3 + corner].x; }),
+            Gather([&](size_t lane) { return input.normals[batch.triangles[lane] * 3 + corner].y; }),
+            Gather([&](size_t lane) { return input.normals[batch.triangles[lane] * 3 + corner].z; })
+        };
+
+        const Lane3& at = p[corner];
+        const Lane3& previous = p[(corner + 2) % 3];
+        const Lane3& next = p[(corner + 1) % 3];
+        Lane3 edge1 = Normalize(Reject(Sub(previous, at), n));
+        Lane3 edge2 = Normalize(Reject(Sub(next, at), n));
+        Lane3 tangent = Scale(Normalize(Reject(s, n)), AngleBetween(edge1, edge2));
+
+        float x[LaneWidth], y[LaneWidth], z[LaneWidth];
+        Store(tangent.x, x);
+        Store(tangent.y, y);
+        Store(tangent.z, z);
+        for (size_t lane = 0; lane < batch.count; lane++)
+            contributions[batch.triangles[lane] * 3 + corner] = DirectX::XMFLOAT4(x[lane], y[lane], z[lane], w[lane]);
+    }
+}
+
+template <typename Fn>
+void ForEachBatch(size_t triangleCount, unsigned int threadCount, Fn&& fn) {
+    size_t blocks = (triangleCount + TriangleBlock - 1) / TriangleBlock;
+    ParallelFor(blocks, threadCount, [&](size_t block) {
+        size_t end = std::min(triangleCount, (block + 1) * TriangleBlock);
+        for (size_t first = block * TriangleBlock; first < end; first += LaneWidth)
+            fn(Batch(first, triangleCount));
+    });
+}
+
+// corners of every value, in corner order, so sums always run in the same order
+struct CornerLists {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> corners;
+
+    CornerLists(const DirectX::XMUINT3* triangles, size_t triangleCount, size_t valueCount) :
+        offsets(valueCount + 1, 0),
+        corners(triangleCount * 3) {
+        for (size_t i = 0; i < triangleCount; i++) {
+            offsets[triangles[i].x + 1]++;
+            offsets[triangles[i].y + 1]++;
+            offsets[triangles[i].z + 1]++;
+        }
+        for (size_t value = 0; value < valueCount; value++)
+            offsets[value + 1] += offsets[value];
+
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < triangleCount; i++) {
+            for (size_t corner = 0; corner < 3; corner++)
+                corners[fill[Corner(triangles[i], corner)]++] = static_cast<uint32_t>(i * 3 + corner);
+        }
+    }
+};
+
+template <typename Fn>
+void ForEachValue(size_t valueCount, unsigned int threadCount, Fn&& fn) {
+    size_t blocks = (valueCount + AccumulateBlock - 1) / AccumulateBlock;
+    ParallelFor(blocks, threadCount, [&](size_t block) {
+        size_t end = std::min(valueCount, (block + 1) * AccumulateBlock);
+        for (size_t value = block * AccumulateBlock; value < end; value++)
+            fn(value);
+    });
+}
+
+inline void Accumulate(DirectX::XMFLOAT3& sum, const DirectX::XMFLOAT3& value) {
+    sum.x += value.x;
+    sum.y += value.y;
+    sum.z += value.z;
+}
+
+inline float Dot(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline bool Normalize(DirectX::XMFLOAT3& v) {
+    float length = std::sqrt(Dot(v, v));
+    if (!(length > FLT_MIN))
+        return false;
+
+    v = DirectX::XMFLOAT3(v.x / length, v.y / length, v.z / length);
+    return true;
+}
+
+// any unit vector perpendicular to n, for corners nothing else decides
+DirectX::XMFLOAT3 Perpendicular(const DirectX::XMFLOAT3& n) {
+    DirectX::XMFLOAT3 axis = std::fabs(n.x) < 0.9f ? DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f) : DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f);
+    float d = Dot(axis, n);
+    DirectX::XMFLOAT3 result(axis.x - n.x * d, axis.y - n.y * d, axis.z - n.z * d);
+    if (!Normalize(result))
+        return axis;
+    return result;
+}
+
+}
+
+void GenerateNormals(const DirectX::XMFLOAT3* positions, size_t positionCount, const DirectX::XMUINT3* triangles, size_t triangleCount,
+    const NormalOptions& options, DirectX::XMFLOAT3* normals, unsigned int threadCount) {
+    if (triangleCount == 0)
+        return;
+
+    // written in full by the kernels, so left uninitialized
+    std::unique_ptr<Face[]> faces(new Face[triangleCount]);
+    ForEachBatch(triangleCount, threadCount, [&](const Batch& batch) {
+        FaceNormals(positions, triangles, batch, options.weighting, faces.get());
+    });
+
+    CornerLists lists(triangles, triangleCount, positionCount);
+    bool smoothAll = options.smoothingAngle >= 180.0f;
+    float minDot = std::cos(options.smoothingAngle * 3.14159265f / 180.0f);
+
+    ForEachValue(positionCount, threadCount, [&](size_t position) {
+        const uint32_t* corners = lists.corners.data() + lists.offsets[position];
+        size_t count = lists.offsets[position + 1] - lists.offsets[position];
+
+        // the faces around a position, copied out once since creases compare every pair
+        DirectX::XMFLOAT3 localNormals[MaxLocalCorners];
+        DirectX::XMFLOAT3 localWeighted[MaxLocalCorners];
+        bool local = count <= MaxLocalCorners;
+        auto faceNormal = [&](size_t i) -> const DirectX::XMFLOAT3& {
+            return local ? localNormals[i] : faces[corners[i] / 3].normal;
+        };
+        auto weighted = [&](size_t i) {
+            if (local)
+                return localWeighted[i];
+            const Face& face = faces[corners[i] / 3];
+            float weight = face.weights[corners[i] % 3];
+            return DirectX::XMFLOAT3(face.normal.x * weight, face.normal.y * weight, face.normal.z * weight);
+        };
+
+        DirectX::XMFLOAT3 smooth(0.0f, 0.0f, 0.0f);
+        for (size_t i = 0; i < count; i++) {
+            const Face& face = faces[corners[i] / 3];
+            float weight = face.weights[corners[i] % 3];
+            DirectX::XMFLOAT3 value(face.normal.x * weight, face.normal.y * weight, face.normal.z * weight);
+            if (local) {
+                localNormals[i] = face.normal;
+                localWeighted[i] = value;
+            }
+            Accumulate(smooth, value);
+        }
+        // isolated degenerate faces, anything unit length will do
+        if (!Normalize(smooth))
+            smooth = DirectX::XMFLOAT3(0.0f, 0.0f, 1.0f);
+
+        for (size_t i = 0; i < count; i++) {
+            const DirectX::XMFLOAT3& face = faceNormal(i);
+
+            // degenerate faces have no say in where the edge is, they take the smooth normal
+            if (smoothAll || Dot(face, face) == 0.0f) {
+                normals[corners[i]] = smooth;
+                continue;
+            }
+
+            DirectX::XMFLOAT3 sum(0.0f, 0.0f, 0.0f);
+            for (size_t other = 0; other < count; other++) {
+                if (Dot(face, faceNormal(other)) >= minDot)
+                    Accumulate(sum, weighted(other));
+            }
+            normals[corners[i]] = Normalize(sum) ? sum : smooth;
+        }
+    });
+}
+
+void GenerateTangents(const TangentInput& input, DirectX::XMFLOAT4* tangents, unsigned int threadCount) {
+    if (input.triangleCount == 0)
+        return;
+
+    std::vector<DirectX::XMFLOAT4> contributions(input.triangleCount * 3);
+    ForEachBatch(input.triangleCount, threadCount, [&](const Batch& batch) {
+        CornerTangents(input, batch, contributions.data());
+    });
+
+    CornerLists lists(input.vertexTriangles, input.triangleCount, input.vertexCount);
+
+    ForEachValue(input.vertexCount, threadCount, [&](size_t vertex) {
+        const uint32_t* begin = lists.corners.data() + lists.offsets[vertex];
+        const uint32_t* end = lists.corners.data() + lists.offsets[vertex + 1];
+        if (begin == end)
+            return;
+
+        // one sum per texture orientation, mirrored faces get their own tangent
+        DirectX::XMFLOAT3 sums[2] = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+        for (const uint32_t* corner = begin; corner != end; corner++) {
+            const DirectX::XMFLOAT4& contribution = contributions[*corner];
+            if (contribution.w != 0.0f)
+                Accumulate(sums[contribution.w > 0.0f ? 1 : 0], DirectX::XMFLOAT3(contribution.x, contribution.y, contribution.z));
+        }
+        bool valid[2] = { Normalize(sums[0]), Normalize(sums[1]) };
+
+        for (const uint32_t* corner = begin; corner != end; corner++) {
+            float w = contributions[*corner].w;
+            // faces without texture area join whichever group the vertex has, preserving first
+            int group = w > 0.0f ? 1 : w < 0.0f ? 0 : valid[1] ? 1 : 0;
+
+            DirectX::XMFLOAT3 tangent = valid[group] ? sums[group] : Perpendicular(input.normals[*corner]);
+            tangents[*corner] = DirectX::XMFLOAT4(tangent.x, tangent.y, tangent.z, group == 1 ? 1.0f : -1.0f);
+        }
+    });
+}
+
+}
\ No newline at end of file
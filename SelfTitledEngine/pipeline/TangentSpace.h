@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <DirectXMath.h>
+
+namespace pipeline {
+
+// how much each face counts towards the normal of a corner it shares
+enum class NormalWeighting {
+    Area,
+    // the face's angle at the corner, so tessellation doesn't skew the result
+    Angle,
+    AreaAngle
+};
+
+struct NormalOptions {
+    NormalWeighting weighting = NormalWeighting::Angle;
+    // faces meeting at a sharper angle than this, in degrees, stay apart at the corners
+    // they share. 180 smooths across every edge.
+    float smoothingAngle = 180.0f;
+};
+
+// one unit normal per corner, normals[triangle * 3 + corner]. triangles index positions and
+// every corner on a position is smoothed with the others there, whatever vertex it ended up
+// in. Degenerate faces count for nothing. Runs on threadCount threads (0 picks one per
+// core) and the result doesn't depend on how many.
+void GenerateNormals(const DirectX::XMFLOAT3* positions, size_t positionCount, const DirectX::XMUINT3* triangles, size_t triangleCount,
+    const NormalOptions& options, DirectX::XMFLOAT3* normals, unsigned int threadCount = 0);
+
+// what GenerateTangents reads, all per triangle except the value arrays
+struct TangentInput {
+    const DirectX::XMFLOAT3* positions;
+    const DirectX::XMUINT3* positionTriangles;
+    const DirectX::XMFLOAT2* texcoords;
+    const DirectX::XMUINT3* texcoordTriangles;
+    // per corner, as GenerateNormals writes them
+    const DirectX::XMFLOAT3* normals;
+    // the welded vertex of each corner, i.e. one per distinct position, texcoord and normal
+    const DirectX::XMUINT3* vertexTriangles;
+    size_t vertexCount;
+    size_t triangleCount;
+};
+
+// one tangent per corner following MikkTSpace: each face's texture space direction is
+// projected onto the corner normal and weighted by the corner angle, then summed over the
+// corners of a vertex whose faces have the same texture orientation. w is the bitangent
+// sign, bitangent = w * cross(normal, tangent). Faces without texture area take the tangent
+// of whatever their vertex has. Deterministic like GenerateNormals.
+void GenerateTangents(const TangentInput& input, DirectX::XMFLOAT4* tangents, unsigned int threadCount = 0);
+
+}
\ No newline at end of file
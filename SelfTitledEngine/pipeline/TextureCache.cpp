@@ -0,0 +1,315 @@
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <system_error>
+
+#include "Hash.h"
+
+namespace pipeline {
+
+namespace {
+
+// layout: TextureHeader, one LevelRecord per mip level, then the blocks of every level finest
+// first, each starting on a LevelAlignment boundary
+constexpr uint32_t TextureMagic = 0x58545453; // "STTX"
+constexpr uint32_t TextureVersion = 1;
+constexpr uint64_t LevelAlignment = 16;
+// a 65536 texel side has 17 levels
+constexpr uint32_t MaxLevels = 32;
+
+struct TextureHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t contentHash;
+    uint64_t settingsHash;
+    double cookMs;
+    uint32_t width;
+    uint32_t height;
+    BlockFormat format;
+    uint8_t srgb;
+    uint16_t levelCount;
+    uint32_t reserved;
+};
+
+struct LevelRecord {
+    uint64_t offset;
+    uint64_t bytes;
+    uint32_t width;
+    uint32_t height;
+};
+
+uint64_t AlignUp(uint64_t value) {
+    return (value + LevelAlignment - 1) & ~(LevelAlignment - 1);
+}
+
+double MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool EndsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::string Lowercase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+void PrintTextureResult(const std::string& filePath, bool hit, const CookedTexture& texture, double ms) {
+    uint64_t bytes = 0;
+    for (const TextureLevel& level : texture.Levels())
+        bytes += level.bytes;
+
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(2)
+        << "texture cache " << (hit ? "hit " : "miss ") << filePath << ", "
+        << texture.Width() << "x" << texture.Height() << " " << BlockFormatName(texture.Format())
+        << (texture.Srgb() ? " srgb" : "") << ", " << texture.Levels().size() << " levels, "
+        << bytes / 1024.0 << " KB, " << ms << " ms";
+    if (hit)
+        line << ", saved " << std::max(0.0, texture.CookMs() - ms) << " ms";
+    line << "\n";
+
+    std::cout << line.str() << std::flush;
+}
+
+}
+
+uint64_t TextureSettingsHash(const TextureOptions& options) {
+    uint64_t hash = HashCombine(TextureCookerVersion, static_cast<uint64_t>(options.format));
+    hash = HashCombine(hash, options.srgb ? 1 : 0);
+    hash = HashCombine(hash, options.generateMips ? 1 : 0);
+    hash = HashCombine(hash, static_cast<uint64_t>(options.mipFilter));
+    return hash;
+}
+
+TextureOptions DefaultTextureOptions(const std::string& filePath) {
+    std::string stem = Lowercase(std::filesystem::path(filePath).stem().string());
+
+    TextureOptions options;
+    if (EndsWith(stem, "_normal") || EndsWith(stem, "_n")) {
+        options.format = BlockFormat::BC5;
+        options.srgb = false;
+    }
+    return options;
+}
+
+void CompressTexture(const Image& image, const TextureOptions& options, CompressedTexture& texture, unsigned int threadCount) {
+    texture.format = options.format;
+    texture.srgb = options.srgb;
+    texture.width = image.width;
+    texture.height = image.height;
+    texture.levels.clear();
+
+    std::vector<Image> mips;
+    if (options.generateMips) {
+        MipOptions mipOptions;
+        mipOptions.filter = options.mipFilter;
+        mipOptions.srgb = options.srgb;
+        mipOptions.threadCount = threadCount;
+        GenerateMips(image, mipOptions, mips);
+    }
+
+    texture.levels.resize(1 + mips.size());
+    for (size_t level = 0; level < texture.levels.size(); level++) {
+        const Image& source = level == 0 ? image : mips[level - 1];
+        texture.levels[level].resize(CompressedSize(options.format, source.width, source.height));
+        CompressImage(source.rgba.data(), source.width, source.height, options.format, texture.levels[level].data(), threadCount);
+    }
+}
+
+bool CookedTexture::Load(const std::string& cookedPath, const CacheKey& key) {
+    Unload();
+
+    if (!_file.Open(cookedPath))
+        return false;
+
+    const uint8_t* base = _file.Data();
+    uint64_t size = _file.Size();
+
+    if (size < sizeof(TextureHeader)) {
+        Unload();
+        return false;
+    }
+
+    const TextureHeader* header = reinterpret_cast<const TextureHeader*>(base);
+
+    // anything that doesn't match exactly is stale and gets recooked
+    if (header->magic != TextureMagic ||
+        header->version != TextureVersion ||
+        header->contentHash != key.contentHash ||
+        header->settingsHash != key.settingsHash ||
+        !IsValidBlockFormat(header->format) ||
+        header->width == 0 || header->height == 0 ||
+        header->levelCount == 0 || header->levelCount > std::min(MaxLevels, MipCount(header->width, header->height)) ||
+        sizeof(TextureHeader) + uint64_t(header->levelCount) * sizeof(LevelRecord) > size) {
+        Unload();
+        return false;
+    }
+
+    const LevelRecord* records = reinterpret_cast<const LevelRecord*>(base + sizeof(TextureHeader));
+    _levels.reserve(header->levelCount);
+
+    for (uint32_t i = 0; i < header->levelCount; i++) {
+        const LevelRecord& record = records[i];
+        if (record.width != MipSize(header->width, i) || record.height != MipSize(header->height, i) ||
+            record.bytes != CompressedSize(header->format, record.width, record.height) ||
+            record.offset > size || record.bytes > size - record.offset) {
+            Unload();
+            return false;
+        }
+
+        TextureLevel level;
+        level.blocks = base + record.offset;
+        level.width = record.width;
+        level.height = record.height;
+        level.rowPitch = BlockCount(record.width) * BlockBytes(header->format);
+        level.bytes = static_cast<size_t>(record.bytes);
+        _levels.push_back(level);
+    }
+
+    _format = header->format;
+    _srgb = header->srgb != 0;
+    _cookMs = header->cookMs;
+    return true;
+}
+
+void CookedTexture::Unload() {
+    _levels.clear();
+    _file.Close();
+    _cookMs = 0.0;
+}
+
+bool WriteCookedTexture(const std::string& cookedPath, const CacheKey& key, double cookMs, const CompressedTexture& texture) {
+    if (texture.levels.empty() || texture.levels.size() > MaxLevels)
+        return false;
+
+    TextureHeader header = {};
+    header.magic = TextureMagic;
+    header.version = TextureVersion;
+    header.contentHash = key.contentHash;
+    header.settingsHash = key.settingsHash;
+    header.cookMs = cookMs;
+    header.width = texture.width;
+    header.height = texture.height;
+    header.format = texture.format;
+    header.srgb = texture.srgb ? 1 : 0;
+    header.levelCount = static_cast<uint16_t>(texture.levels.size());
+
+    std::vector<LevelRecord> records(texture.levels.size());
+    uint64_t offset = sizeof(TextureHeader) + records.size() * sizeof(LevelRecord);
+    for (size_t i = 0; i < records.size(); i++) {
+        LevelRecord& record = records[i];
+        record.width = MipSize(texture.width, static_cast<uint32_t>(i));
+        record.height = MipSize(texture.height, static_cast<uint32_t>(i));
+        record.bytes = texture.levels[i].size();
+        record.offset = AlignUp(offset);
+        offset = record.offset + record.bytes;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(cookedPath).parent_path(), ec);
+
+    // write to a temporary of our own and swap it in, so neither a crash nor another writer of
+    // the same key ever leaves a torn cache behind
+    std::string tempPath = UniqueTempPath(cookedPath);
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(LevelRecord));
+        uint64_t position = sizeof(TextureHeader) + records.size() * sizeof(LevelRecord);
+
+        static const char zeros[LevelAlignment] = {};
+        for (size_t i = 0; i < records.size(); i++) {
+            file.write(zeros, static_cast<std::streamsize>(records[i].offset - position));
+            file.write(reinterpret_cast<const char*>(texture.levels[i].data()), static_cast<std::streamsize>(records[i].bytes));
+            position = records[i].offset + records[i].bytes;
+        }
+
+        if (!file.good()) {
+            file.close();
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+    }
+
+    return ReplaceWithTemp(tempPath, cookedPath);
+}
+
+bool LoadTexture(const std::string& filePath, const TextureOptions& options, CookedTexture& texture, std::string& error) {
+    auto start = std::chrono::steady_clock::now();
+
+    CacheKey key;
+    bool rehashed = false;
+    if (!GetContentHash(filePath, key.contentHash, rehashed)) {
+        error = "Failed to open image file " + filePath;
+        return false;
+    }
+    key.settingsHash = TextureSettingsHash(options);
+
+    std::string cookedPath = CookedTexturePathFor(key);
+    if (texture.Load(cookedPath, key)) {
+        double ms = MsSince(start);
+        RecordCacheHit(std::max(0.0, texture.CookMs() - ms));
+        PrintTextureResult(filePath, true, texture, ms);
+        return true;
+    }
+
+    Image image;
+    if (!ReadImage(filePath, image, error))
+        return false;
+
+    auto cookStart = std::chrono::steady_clock::now();
+    CompressedTexture compressed;
+    CompressTexture(image, options, compressed);
+    double cookMs = MsSince(cookStart);
+    RecordCacheMiss(cookMs);
+
+    // served from the file just written, so a hit and a miss hand out the same mapping
+    if (!WriteCookedTexture(cookedPath, key, cookMs, compressed) || !texture.Load(cookedPath, key)) {
+        error = "Failed to write cooked texture " + cookedPath + " for " + filePath;
+        return false;
+    }
+
+    PrintTextureResult(filePath, false, texture, MsSince(start));
+    return true;
+}
+
+bool CookTextures(const std::string& directory, std::string& error) {
+    std::error_code ec;
+    std::vector<std::string> files;
+    for (auto it = std::filesystem::recursive_directory_iterator(directory, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+        if (it->is_regular_file(ec) && Lowercase(it->path().extension().string()) == ".tga")
+            files.push_back(it->path().generic_string());
+    }
+    if (ec) {
+        error = "Failed to list " + directory + ": " + ec.message();
+        return false;
+    }
+
+    std::sort(files.begin(), files.end());
+    size_t failed = 0;
+    for (const std::string& file : files) {
+        CookedTexture texture;
+        std::string textureError;
+        if (!LoadTexture(file, DefaultTextureOptions(file), texture, textureError)) {
+            error += textureError + "\n";
+            failed++;
+        }
+    }
+
+    std::cout << "cooked " << files.size() - failed << " of " << files.size() << " textures under " << directory << std::endl;
+    return failed == 0;
+}
+
+}
\ No newline at end of file
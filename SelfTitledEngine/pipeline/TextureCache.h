@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BlockCompression.h"
+#include "Image.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "Mipmaps.h"
+
+namespace pipeline {
+
+// bump when the encoders or the mip filter change, invalidates every cooked texture
+constexpr uint32_t TextureCookerVersion = 3;
+
+// per texture switches, part of the cache key
+struct TextureOptions {
+    BlockFormat format = BlockFormat::BC7;
+    // color, sampled through an _SRGB view and filtered in linear light. Off for data like
+    // normals and masks.
+    bool srgb = true;
+    bool generateMips = true;
+    MipFilter mipFilter = MipFilter::Kaiser;
+};
+
+uint64_t TextureSettingsHash(const TextureOptions& options);
+
+// BC5 without sRGB for names ending in _normal or _n, what tangent space normal maps are
+// called, and BC7 sRGB for everything else
+TextureOptions DefaultTextureOptions(const std::string& filePath);
+
+// one mip level as the gpu takes it, rowPitch is a row of blocks
+struct TextureLevel {
+    const uint8_t* blocks;
+    uint32_t width;
+    uint32_t height;
+    uint32_t rowPitch;
+    size_t bytes;
+};
+
+// a compressed mip chain in memory, finest level first
+struct CompressedTexture {
+    BlockFormat format = BlockFormat::BC7;
+    bool srgb = true;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<std::vector<uint8_t>> levels;
+};
+
+// builds the mip chain and compresses every level, blocks spread over threadCount threads,
+// 0 for one per core
+void CompressTexture(const Image& image, const TextureOptions& options, CompressedTexture& texture, unsigned int threadCount = 0);
+
+// levels served straight out of a mapped cooked file, valid while this object lives
+class CookedTexture {
+public:
+    bool Load(const std::string& cookedPath, const CacheKey& key);
+    void Unload();
+
+    BlockFormat Format() const { return _format; }
+    bool Srgb() const { return _srgb; }
+    uint32_t Width() const { return _levels.empty() ? 0 : _levels[0].width; }
+    uint32_t Height() const { return _levels.empty() ? 0 : _levels[0].height; }
+    const std::vector<TextureLevel>& Levels() const { return _levels; }
+    // how long compressing this took when it was cooked
+    double CookMs() const { return _cookMs; }
+
+private:
+    MappedFile _file;
+    BlockFormat _format = BlockFormat::BC7;
+    bool _srgb = false;
+    std::vector<TextureLevel> _levels;
+    double _cookMs = 0.0;
+};
+
+bool WriteCookedTexture(const std::string& cookedPath, const CacheKey& key, double cookMs, const CompressedTexture& texture);
+
+// loads through the cooked cache, reading and compressing the source when the cache is stale
+bool LoadTexture(const std::string& filePath, const TextureOptions& options, CookedTexture& texture, std::string& error);
+
+// cooks every TGA under directory ahead of time with DefaultTextureOptions, skipping the ones
+// already cooked. Returns false if any failed, error lists them.
+bool CookTextures(const std::string& directory, std::string& error);
+
+}
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include "VertexCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace pipeline {
+
+namespace {
+
+// scoring constants from Forsyth's "Linear-Speed Vertex Cache Optimisation"
+constexpr float CacheDecayPower = 1.5f;
+constexpr float LastTriangleScore = 0.75f;
+constexpr float ValenceBoostScale = 2.0f;
+constexpr float ValenceBoostPower = 0.5f;
+constexpr unsigned int MaxValenceTable = 64;
+
+struct ScoreTables {
+    float cache[OptimizerCacheSize];
+    float valence[MaxValenceTable];
+
+    ScoreTables() {
+        for (unsigned int i = 0; i < OptimizerCacheSize; i++) {
+            // the last triangle's vertices get a fixed score, so the next one doesn't just
+            // walk back over the same edge
+            if (i < 3) {
+                cache[i] = LastTriangleScore;
+            }
+            else {
+                float scale = 1.0f / (OptimizerCacheSize - 3);
+                cache[i] = std::pow(1.0f - (i - 3) * scale, CacheDecayPower);
+            }
+        }
+
+        // few triangles left means the vertex is worth finishing off before it is evicted
+        valence[0] = 0.0f;
+        for (unsigned int i = 1; i < MaxValenceTable; i++)
+            valence[i] = ValenceBoostScale * std::pow(static_cast<float>(i), -ValenceBoostPower);
+    }
+};
+
+const ScoreTables& Tables() {
+    static const ScoreTables tables;
+    return tables;
+}
+
+float VertexScore(int cachePosition, uint32_t remaining) {
+    if (remaining == 0)
+        return -1.0f;
+
+    const ScoreTables& tables = Tables();
+    float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+
+    if (remaining < MaxValenceTable)
+        score += tables.valence[remaining];
+    else
+        score += ValenceBoostScale * std::pow(static_cast<float>(remaining), -ValenceBoostPower);
+
+    return score;
+}
+
+inline uint32_t Corner(const DirectX::XMUINT3& triangle, int corner) {
+    return corner == 0 ? triangle.x : corner == 1 ? triangle.y : triangle.z;
+}
+
+}
+
+CacheStatistics SimulateVertexCache(const DirectX::XMUINT3* triangles, size_t triangleCount, size_t vertexCount,
+    unsigned int cacheSize, CacheModel model) {
+    CacheStatistics statistics = {};
+    if (triangleCount == 0 || cacheSize == 0)
+        return statistics;
+
+    std::vector<uint8_t> used(vertexCount, 0);
+    size_t usedCount = 0;
+
+    if (model == CacheModel::Fifo) {
+        // a vertex is still cached while fewer than cacheSize misses happened since it
+        // was inserted, so no queue has to be kept
+        std::vector<size_t> insertedAt(vertexCount, 0);
+
+        for (size_t i = 0; i < triangleCount; i++) {
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t vertex = Corner(triangles[i], corner);
+                if (!used[vertex]) {
+                    used[vertex] = 1;
+                    usedCount++;
+                }
+                else if (statistics.transforms - insertedAt[vertex] < cacheSize) {
+                    continue;
+                }
+
+                insertedAt[vertex] = statistics.transforms;
+                statistics.transforms++;
+            }
+        }
+    }
+    else {
+        // most recent first, caches are small enough that moving entries is cheapest
+        std::vector<uint32_t> cache;
+        cache.reserve(cacheSize);
+
+        for (size_t i = 0; i < triangleCount; i++) {
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t vertex = Corner(triangles[i], corner);
+                if (!used[vertex]) {
+                    used[vertex] = 1;
+                    usedCount++;
+                }
+
+                auto found = std::find(cache.begin(), cache.end(), vertex);
+                if (found == cache.end()) {
+                    statistics.transforms++;
+                    if (cache.size() == cacheSize)
+                        cache.pop_back();
+                    cache.insert(cache.begin(), vertex);
+                }
+                else {
+                    std::rotate(cache.begin(), found, found + 1);
+                }
+            }
+        }
+    }
+
+    statistics.acmr = static_cast<float>(statistics.transforms) / triangleCount;
+    statistics.atvr = usedCount ? static_cast<float>(statistics.transforms) / usedCount : 0.0f;
+    return statistics;
+}
+
+void OptimizeVertexCache(DirectX::XMUINT3* triangles, size_t triangleCount, size_t vertexCount) {
+    if (triangleCount < 2)
+        return;
+
+    // triangles using each vertex, the live ones kept at the front of every list
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount; i++) {
+        remaining[triangles[i].x]++;
+        remaining[triangles[i].y]++;
+        remaining[triangles[i].z]++;
+    }
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < triangleCount; i++) {
+            for (int corner = 0; corner < 3; corner++)
+                adjacency[fill[Corner(triangles[i], corner)]++] = static_cast<uint32_t>(i);
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertexScore[v] = VertexScore(-1, remaining[v]);
+
+    std::vector<float> triangleScore(triangleCount);
+    for (size_t i = 0; i < triangleCount; i++) {
+        triangleScore[i] = vertexScore[triangles[i].x] + vertexScore[triangles[i].y] + vertexScore[triangles[i].z];
+    }
+
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<DirectX::XMUINT3> output;
+    output.reserve(triangleCount);
+
+    // room for the full cache plus the three vertices pushed in front of it
+    uint32_t cache[OptimizerCacheSize + 3];
+    uint32_t nextCache[OptimizerCacheSize + 3];
+    unsigned int cacheCount = 0;
+
+    // triangles not yet emitted, compacted as the dead end search walks them
+    std::vector<uint32_t> live(triangleCount);
+    for (size_t i = 0; i < triangleCount; i++)
+        live[i] = static_cast<uint32_t>(i);
+
+    int64_t best = -1;
+
+    while (output.size() < triangleCount) {
+        // start, or a dead end where nothing in the cache touches a live triangle: carry on at
+        // the best scoring triangle left anywhere
+        if (best < 0) {
+            float bestScore = -1.0f;
+            size_t kept = 0;
+            for (uint32_t triangle : live) {
+                if (emitted[triangle])
+                    continue;
+                live[kept++] = triangle;
+                if (triangleScore[triangle] > bestScore) {
+                    bestScore = triangleScore[triangle];
+                    best = triangle;
+                }
+            }
+            live.resize(kept);
+        }
+
+        const DirectX::XMUINT3 triangle = triangles[best];
+        emitted[best] = 1;
+        output.push_back(triangle);
+
+        // unlink the triangle from its vertices
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t vertex = Corner(triangle, corner);
+            uint32_t* list = &adjacency[adjacencyOffsets[vertex]];
+            uint32_t count = remaining[vertex];
+            for (uint32_t i = 0; i < count; i++) {
+                if (list[i] == static_cast<uint32_t>(best)) {
+                    list[i] = list[count - 1];
+                    list[count - 1] = static_cast<uint32_t>(best);
+                    remaining[vertex]--;
+                    break;
+                }
+            }
+        }
+
+        // the triangle's vertices move to the front, everything else shifts back
+        unsigned int nextCount = 0;
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t vertex = Corner(triangle, corner);
+            if (std::find(nextCache, nextCache + nextCount, vertex) == nextCache + nextCount)
+                nextCache[nextCount++] = vertex;
+        }
+        for (unsigned int i = 0; i < cacheCount; i++) {
+            uint32_t vertex = cache[i];
+            if (vertex != triangle.x && vertex != triangle.y && vertex != triangle.z)
+                nextCache[nextCount++] = vertex;
+        }
+
+        // rescore every vertex whose position changed, including the ones pushed out
+        for (unsigned int i = 0; i < nextCount; i++) {
+            uint32_t vertex = nextCache[i];
+            int position = i < OptimizerCacheSize ? static_cast<int>(i) : -1;
+            cachePosition[vertex] = position;
+
+            float score = VertexScore(position, remaining[vertex]);
+            float delta = score - vertexScore[vertex];
+            vertexScore[vertex] = score;
+
+            const uint32_t* list = &adjacency[adjacencyOffsets[vertex]];
+            for (uint32_t t = 0; t < remaining[vertex]; t++)
+                triangleScore[list[t]] += delta;
+        }
+
+        cacheCount = std::min(nextCount, OptimizerCacheSize);
+        std::copy(nextCache, nextCache + cacheCount, cache);
+
+        // next triangle is the best scoring one touching the cache
+        best = -1;
+        float bestScore = -1.0f;
+        for (unsigned int i = 0; i < cacheCount; i++) {
+            uint32_t vertex = cache[i];
+            const uint32_t* list = &adjacency[adjacencyOffsets[vertex]];
+            for (uint32_t t = 0; t < remaining[vertex]; t++) {
+                if (triangleScore[list[t]] > bestScore) {
+                    bestScore = triangleScore[list[t]];
+                    best = list[t];
+                }
+            }
+        }
+    }
+
+    std::copy(output.begin(), output.end(), triangles);
+}
+
+}
\ No newline at end of file
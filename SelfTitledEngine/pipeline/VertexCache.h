@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+
+#include <DirectXMath.h>
+
+namespace pipeline {
+
+enum class CacheModel {
+    Fifo,
+    Lru
+};
+
+// post transform cache behaviour of an index stream
+struct CacheStatistics {
+    // vertex shader invocations
+    size_t transforms;
+    // average cache miss ratio, transforms per triangle. 0.5 is the best a regular grid
+    // can do, 3 means nothing was ever reused
+    float acmr;
+    // average transform to vertex ratio, 1 means every vertex was shaded exactly once
+    float atvr;
+};
+
+// replays the triangles through a simulated cache of cacheSize entries, cpu only
+CacheStatistics SimulateVertexCache(const DirectX::XMUINT3* triangles, size_t triangleCount, size_t vertexCount,
+    unsigned int cacheSize, CacheModel model);
+
+// the LRU cache OptimizeVertexCache scores against, and what its result should be judged by.
+// The same size the import reports use, what current GPUs reuse per batch.
+constexpr unsigned int OptimizerCacheSize = 16;
+
+// reorders triangles in place so consecutive ones reuse recently shaded vertices. Greedy
+// Forsyth style scoring against an OptimizerCacheSize entry LRU cache. Starts, and restarts
+// at dead ends, at the best scoring triangle left.
+void OptimizeVertexCache(DirectX::XMUINT3* triangles, size_t triangleCount, size_t vertexCount);
+
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "VertexFetch.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace pipeline {
+
+FetchStatistics AnalyzeVertexFetch(const DirectX::XMUINT3* triangles, size_t triangleCount, size_t vertexCount, size_t vertexStride,
+    unsigned int transformCacheSize) {
+    FetchStatistics statistics = {};
+    if (triangleCount == 0 || vertexStride == 0)
+        return statistics;
+
+    // tag per line slot, the line index plus one so zero means empty
+    const size_t lineCount = FetchCacheSize / FetchCacheLine;
+    std::vector<size_t> tags(lineCount, 0);
+    std::vector<uint8_t> used(vertexCount, 0);
+    size_t usedCount = 0;
+
+    // post transform FIFO by insertion time, as in SimulateVertexCache
+    std::vector<size_t> insertedAt(vertexCount, 0);
+    size_t transforms = 0;
+
+    for (size_t i = 0; i < triangleCount; i++) {
+        for (uint32_t vertex : { triangles[i].x, triangles[i].y, triangles[i].z }) {
+            if (!used[vertex]) {
+                used[vertex] = 1;
+                usedCount++;
+            }
+            else if (transforms - insertedAt[vertex] < transformCacheSize) {
+                continue;
+            }
+            insertedAt[vertex] = transforms++;
+
+            // a vertex can straddle two lines
+            size_t start = vertex * vertexStride;
+            size_t end = start + vertexStride;
+            for (size_t line = start / FetchCacheLine; line * FetchCacheLine < end; line++) {
+                size_t& tag = tags[line % lineCount];
+                if (tag != line + 1) {
+                    tag = line + 1;
+                    statistics.bytesFetched += FetchCacheLine;
+                }
+            }
+        }
+    }
+
+    size_t usedBytes = usedCount * vertexStride;
+    statistics.overfetch = usedBytes ? static_cast<float>(statistics.bytesFetched) / usedBytes : 0.0f;
+    return statistics;
+}
+
+size_t OptimizeVertexFetch(Vertex* destination, DirectX::XMUINT3* destinationTriangles, const Vertex* vertices, size_t vertexCount,
+    const DirectX::XMUINT3* triangles, size_t triangleCount) {
+    const uint32_t Unassigned = UINT32_MAX;
+    std::vector<uint32_t> remap(vertexCount, Unassigned);
+    uint32_t used = 0;
+
+    for (size_t i = 0; i < triangleCount; i++) {
+        // read before writing, the triangles may be renumbered in place
+        const uint32_t corners[3] = { triangles[i].x, triangles[i].y, triangles[i].z };
+        uint32_t renumbered[3];
+        for (unsigned int k = 0; k < 3; k++) {
+            uint32_t& target = remap[corners[k]];
+            if (target == Unassigned) {
+                target = used++;
+                destination[target] = vertices[corners[k]];
+            }
+            renumbered[k] = target;
+        }
+        destinationTriangles[i] = DirectX::XMUINT3(renumbered[0], renumbered[1], renumbered[2]);
+    }
+
+    return used;
+}
+
+size_t OptimizeVertexFetch(Vertex* vertices, size_t vertexCount, DirectX::XMUINT3* triangles, size_t triangleCount) {
+    std::vector<Vertex> ordered(vertexCount);
+    size_t used = OptimizeVertexFetch(ordered.data(), triangles, vertices, vertexCount, triangles, triangleCount);
+    std::copy(ordered.begin(), ordered.begin() + used, vertices);
+    return used;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+#include <DirectXMath.h>
+
+#include "../Dx11App/types.h"
+
+namespace pipeline {
+
+// simulated vertex fetch cache: direct mapped, FetchCacheSize bytes in FetchCacheLine lines
+constexpr size_t FetchCacheLine = 64;
+constexpr size_t FetchCacheSize = 16 * 1024;
+
+struct FetchStatistics {
+    // bytes pulled in from memory, in whole cache lines
+    size_t bytesFetched;
+    // bytes fetched per byte of vertex data used, 1 means every line was read once
+    float overfetch;
+};
+
+// fetches the vertices in index order through the simulated cache, cpu only. Vertices still
+// in a FIFO post transform cache of transformCacheSize entries aren't fetched again, 0 fetches
+// every index.
+FetchStatistics AnalyzeVertexFetch(const DirectX::XMUINT3* triangles, size_t triangleCount, size_t vertexCount, size_t vertexStride,
+    unsigned int transformCacheSize);
+
+// moves vertices into first use order of the triangles and renumbers the indices to match,
+// so fetches walk the buffer forward. Unused vertices are dropped, returns how many are left.
+size_t OptimizeVertexFetch(Vertex* vertices, size_t vertexCount, DirectX::XMUINT3* triangles, size_t triangleCount);
+// the same into destination and destinationTriangles, sized like vertices and triangles, which
+// are left as they are. destinationTriangles may be triangles.
+size_t OptimizeVertexFetch(Vertex* destination, DirectX::XMUINT3* destinationTriangles, const Vertex* vertices, size_t vertexCount,
+    const DirectX::XMUINT3* triangles, size_t triangleCount);
+
+}
\ No newline at end of file
@@ -0,0 +1,294 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "Parallel.h"
+
+namespace pipeline {
+
+namespace {
+
+uint32_t PositionSize(PositionFormat format) {
+    return format == PositionFormat::Float32 ? 12 : 8;
+}
+
+inline float Clamp(float value, float low, float high) {
+    return std::min(std::max(value, low), high);
+}
+
+inline float SignNotZero(float value) {
+    return value < 0.0f ? -1.0f : 1.0f;
+}
+
+inline int16_t EncodeSnorm16(float value) {
+    return static_cast<int16_t>(std::lround(Clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+DirectX::XMFLOAT3 Normalize(float x, float y, float z) {
+    float length = std::sqrt(x * x + y * y + z * z);
+    if (length == 0.0f)
+        return DirectX::XMFLOAT3(0.0f, 0.0f, 1.0f);
+    return DirectX::XMFLOAT3(x / length, y / length, z / length);
+}
+
+}
+
+bool IsValidFormat(const VertexFormat& format) {
+    return format.position == PositionFormat::Float32 || format.position == PositionFormat::Unorm16;
+}
+
+uint32_t VertexStride(const VertexFormat& format) {
+    return PositionSize(format.position);
+}
+
+std::vector<VertexElement> VertexElements(const VertexFormat& format) {
+    std::vector<VertexElement> elements;
+    elements.push_back({ "POSITION", format.position == PositionFormat::Float32 ? ElementType::Float3 : ElementType::Unorm16x4, 0 });
+    return elements;
+}
+
+uint16_t EncodeUnorm16(float value) {
+    return static_cast<uint16_t>(std::lround(Clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+float DecodeUnorm16(uint16_t value) {
+    return value / 65535.0f;
+}
+
+uint8_t EncodeUnorm8(float value) {
+    return static_cast<uint8_t>(std::lround(Clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+float DecodeUnorm8(uint8_t value) {
+    return value / 255.0f;
+}
+
+uint16_t FloatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    uint32_t magnitude = bits & 0x7FFFFFFF;
+
+    // infinity and nan, keeping nans quiet
+    if (magnitude >= 0x7F800000)
+        return sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x0200 : 0);
+
+    // 65520 and up round to infinity
+    if (magnitude >= 0x477FF000)
+        return sign | 0x7C00;
+
+    uint32_t half;
+    uint32_t remainder;
+    uint32_t halfway;
+
+    if (magnitude < 0x38800000) {
+        // below the smallest normal half, 2^-14. Under 2^-25 even rounding up gives zero
+        if (magnitude < 0x33000000)
+            return sign;
+
+        uint32_t shift = 126 - (magnitude >> 23);
+        uint32_t mantissa = (magnitude & 0x007FFFFF) | 0x00800000;
+        half = mantissa >> shift;
+        remainder = mantissa & ((1u << shift) - 1);
+        halfway = 1u << (shift - 1);
+    }
+    else {
+        // rebias the exponent from 127 to 15 and drop 13 mantissa bits, a carry out of
+        // the mantissa correctly bumps the exponent
+        uint32_t rebased = magnitude - (112u << 23);
+        half = rebased >> 13;
+        remainder = rebased & 0x1FFF;
+        halfway = 0x1000;
+    }
+
+    if (remainder > halfway || (remainder == halfway && (half & 1)))
+        half++;
+
+    return sign | static_cast<uint16_t>(half);
+}
+
+float HalfToFloat(uint16_t value) {
+    uint32_t sign = uint32_t(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1F;
+    uint32_t mantissa = value & 0x03FF;
+
+    if (exponent == 0) {
+        float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+
+    uint32_t bits;
+    if (exponent == 31)
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    else
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+void EncodeOctahedral(const DirectX::XMFLOAT3& normal, int16_t encoded[2]) {
+    float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    if (length == 0.0f) {
+        encoded[0] = 0;
+        encoded[1] = 0;
+        return;
+    }
+
+    float x = normal.x / length;
+    float y = normal.y / length;
+
+    // fold the lower hemisphere over the diagonals
+    if (normal.z < 0.0f) {
+        float foldedX = (1.0f - std::fabs(y)) * SignNotZero(x);
+        float foldedY = (1.0f - std::fabs(x)) * SignNotZero(y);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    encoded[0] = EncodeSnorm16(x);
+    encoded[1] = EncodeSnorm16(y);
+}
+
+DirectX::XMFLOAT3 DecodeOctahedral(const int16_t encoded[2]) {
+    float x = std::max(encoded[0] / 32767.0f, -1.0f);
+    float y = std::max(encoded[1] / 32767.0f, -1.0f);
+    float z = 1.0f - std::fabs(x) - std::fabs(y);
+
+    if (z < 0.0f) {
+        float unfoldedX = (1.0f - std::fabs(y)) * SignNotZero(x);
+        float unfoldedY = (1.0f - std::fabs(x)) * SignNotZero(y);
+        x = unfoldedX;
+        y = unfoldedY;
+    }
+
+    return Normalize(x, y, z);
+}
+
+void EncodeSnorm8(const DirectX::XMFLOAT3& normal, int8_t encoded[3]) {
+    encoded[0] = static_cast<int8_t>(std::lround(Clamp(normal.x, -1.0f, 1.0f) * 127.0f));
+    encoded[1] = static_cast<int8_t>(std::lround(Clamp(normal.y, -1.0f, 1.0f) * 127.0f));
+    encoded[2] = static_cast<int8_t>(std::lround(Clamp(normal.z, -1.0f, 1.0f) * 127.0f));
+}
+
+DirectX::XMFLOAT3 DecodeSnorm8(const int8_t encoded[3]) {
+    return Normalize(std::max(encoded[0] / 127.0f, -1.0f), std::max(encoded[1] / 127.0f, -1.0f), std::max(encoded[2] / 127.0f, -1.0f));
+}
+
+PackReport PackVertices(Mesh& mesh, const VertexFormat& format) {
+    mesh.packedVertices.assign(mesh.vertices.size() * VertexStride(format), 0);
+    return PackVertices(mesh, format, mesh.packedVertices.data());
+}
+
+PackReport PackVertices(Mesh& mesh, const VertexFormat& format, uint8_t* target) {
+    const uint32_t stride = VertexStride(format);
+
+    mesh.format = format;
+
+    if (format.position == PositionFormat::Float32) {
+        mesh.dequantization.offset = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+        mesh.dequantization.scale = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);
+    }
+    else {
+        const Bounds& bounds = mesh.bounds;
+        mesh.dequantization.offset = bounds.minCoord;
+        mesh.dequantization.scale = DirectX::XMFLOAT3(
+            bounds.maxCoord.x - bounds.minCoord.x,
+            bounds.maxCoord.y - bounds.minCoord.y,
+            bounds.maxCoord.z - bounds.minCoord.z);
+    }
+
+    const DirectX::XMFLOAT3& offset = mesh.dequantization.offset;
+    const DirectX::XMFLOAT3& scale = mesh.dequantization.scale;
+
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        const Vertex& vertex = mesh.vertices[i];
+        uint8_t* out = target + i * stride;
+
+        if (format.position == PositionFormat::Float32) {
+            std::memcpy(out, &vertex.Pos, sizeof(vertex.Pos));
+        }
+        else {
+            // flat axes have a zero scale and store zero
+            uint16_t position[4] = {
+                scale.x > 0.0f ? EncodeUnorm16((vertex.Pos.x - offset.x) / scale.x) : uint16_t(0),
+                scale.y > 0.0f ? EncodeUnorm16((vertex.Pos.y - offset.y) / scale.y) : uint16_t(0),
+                scale.z > 0.0f ? EncodeUnorm16((vertex.Pos.z - offset.z) / scale.z) : uint16_t(0),
+                0
+            };
+            std::memcpy(out, position, sizeof(position));
+        }
+    }
+
+    // measure against what the gpu will decode
+    PackReport report = { static_cast<uint32_t>(sizeof(Vertex)), stride, 0.0f };
+    MeshView view = mesh.View();
+    view.vertices = target;
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        const Vertex& original = mesh.vertices[i];
+        Vertex decoded = UnpackVertex(view, i);
+
+        float dx = decoded.Pos.x - original.Pos.x;
+        float dy = decoded.Pos.y - original.Pos.y;
+        float dz = decoded.Pos.z - original.Pos.z;
+        report.maxPositionError = std::max(report.maxPositionError, std::sqrt(dx * dx + dy * dy + dz * dz));
+    }
+
+    return report;
+}
+
+Vertex UnpackVertex(const MeshView& mesh, size_t index) {
+    const uint32_t stride = VertexStride(mesh.format);
+    const uint8_t* in = mesh.vertices + index * stride;
+    Vertex vertex;
+
+    if (mesh.format.position == PositionFormat::Float32) {
+        std::memcpy(&vertex.Pos, in, sizeof(vertex.Pos));
+    }
+    else {
+        uint16_t position[4];
+        std::memcpy(position, in, sizeof(position));
+        const Dequantization& dequantization = mesh.dequantization;
+        vertex.Pos.x = dequantization.offset.x + DecodeUnorm16(position[0]) * dequantization.scale.x;
+        vertex.Pos.y = dequantization.offset.y + DecodeUnorm16(position[1]) * dequantization.scale.y;
+        vertex.Pos.z = dequantization.offset.z + DecodeUnorm16(position[2]) * dequantization.scale.z;
+    }
+
+    return vertex;
+}
+
+void PackMeshes(const std::string& name, const VertexFormat& format, std::vector<Mesh>& meshes, const std::vector<uint8_t*>& targets) {
+    std::vector<PackReport> reports(meshes.size());
+
+    ParallelFor(meshes.size(), 0, [&](size_t i) {
+        reports[i] = targets.empty() ? PackVertices(meshes[i], format) : PackVertices(meshes[i], format, targets[i]);
+    });
+
+    std::ostringstream report;
+    for (size_t i = 0; i < meshes.size(); i++) {
+        const Mesh& mesh = meshes[i];
+        const PackReport& packed = reports[i];
+
+        float dx = mesh.bounds.maxCoord.x - mesh.bounds.minCoord.x;
+        float dy = mesh.bounds.maxCoord.y - mesh.bounds.minCoord.y;
+        float dz = mesh.bounds.maxCoord.z - mesh.bounds.minCoord.z;
+        float diagonal = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+        report << std::fixed << std::setprecision(1)
+            << "pack " << name << " mesh " << i << ": " << packed.strideBefore << " -> " << packed.strideAfter << " bytes/vertex, "
+            << mesh.vertices.size() * packed.strideBefore / 1024.0 << " -> " << mesh.vertices.size() * packed.strideAfter / 1024.0 << " KB"
+            << std::scientific << std::setprecision(2)
+            << ", position error " << packed.maxPositionError
+            << " (" << (diagonal > 0.0f ? packed.maxPositionError / diagonal : 0.0f) << " of the diagonal)\n";
+    }
+    std::cout << report.str() << std::flush;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "../Dx11App/types.h"
+
+namespace pipeline {
+
+// storage of a single vertex element, the input assembler widens every one to floats so
+// the vertex shader reads the same types whatever the format
+enum class ElementType {
+    Float3,
+    Float4,
+    Unorm16x4,
+    Unorm8x4
+};
+
+struct VertexElement {
+    const char* semantic;
+    ElementType type;
+    uint32_t offset;
+};
+
+bool IsValidFormat(const VertexFormat& format);
+uint32_t VertexStride(const VertexFormat& format);
+// tightly packed, currently just the position
+std::vector<VertexElement> VertexElements(const VertexFormat& format);
+
+// scalar encode/decode kernels, decoding matches what the gpu does for the same bits
+uint16_t EncodeUnorm16(float value);
+float DecodeUnorm16(uint16_t value);
+uint8_t EncodeUnorm8(float value);
+float DecodeUnorm8(uint8_t value);
+
+// IEEE half, rounding to nearest even
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
+
+// unit normals, for when the importer keeps them: octahedral in two snorm16 or three snorm8
+void EncodeOctahedral(const DirectX::XMFLOAT3& normal, int16_t encoded[2]);
+DirectX::XMFLOAT3 DecodeOctahedral(const int16_t encoded[2]);
+void EncodeSnorm8(const DirectX::XMFLOAT3& normal, int8_t encoded[3]);
+DirectX::XMFLOAT3 DecodeSnorm8(const int8_t encoded[3]);
+
+struct PackReport {
+    uint32_t strideBefore;
+    uint32_t strideAfter;
+    // largest distance of a decoded position from the original, in model units
+    float maxPositionError;
+};
+
+// packs mesh.vertices into mesh.packedVertices in format, quantizing positions against
+// mesh.bounds. Sets format and dequantization so View() describes the packed data.
+PackReport PackVertices(Mesh& mesh, const VertexFormat& format);
+// the same into target, mesh.vertices.size() * VertexStride(format) bytes, leaving
+// packedVertices alone
+PackReport PackVertices(Mesh& mesh, const VertexFormat& format, uint8_t* target);
+
+// decodes one packed vertex back to full precision, as the vertex shader sees it
+Vertex UnpackVertex(const MeshView& mesh, size_t index);
+
+// packs every mesh in parallel and prints the per mesh error and size saved, tagged with name.
+// Given targets, one per mesh, each packs into its target instead, see PackVertices.
+void PackMeshes(const std::string& name, const VertexFormat& format, std::vector<Mesh>& meshes,
+    const std::vector<uint8_t*>& targets = {});
+
+}
\ No newline at end of file
@@ -0,0 +1,362 @@
+#include "VertexWeld.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "Parallel.h"
+
+namespace pipeline {
+
+namespace {
+
+constexpr uint32_t Empty = UINT32_MAX;
+// an unclaimed slot
+constexpr uint64_t EmptyEntry = Empty;
+// vertices or slots per task
+constexpr size_t WeldBlock = 16384;
+// the first attribute is searched in up to 2^components cells
+constexpr uint32_t MaxSpatialComponents = 4;
+// grid cells are this many epsilons wide, so most values are far enough from the cell's
+// sides to only need their own cell searched
+constexpr double CellEpsilons = 16.0;
+// how close to a side, in epsilons, a value has to be to search the cell beyond it. A little
+// over one covers the rounding of the distance test.
+constexpr double NeighbourEpsilons = 1.01;
+
+inline uint32_t FloatKey(float value) {
+    // + 0.0f folds -0 into +0, which compare equal for welding purposes
+    value += 0.0f;
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline uint64_t Mix(uint64_t hash, uint64_t value) {
+    return (hash ^ value) * 0x9E3779B97F4A7C15ull;
+}
+
+// the first attribute's part of a vertex key, grid cells with an epsilon and bits without
+struct SpatialKey {
+    int64_t values[MaxSpatialComponents];
+};
+
+class Welder {
+public:
+    Welder(const WeldAttribute* attributes, size_t attributeCount, size_t vertexCount, unsigned int threadCount) :
+        _attributes(attributes),
+        _attributeCount(attributeCount),
+        _vertexCount(vertexCount),
+        _threadCount(threadCount),
+        _search(false) {
+        for (size_t i = 0; i < attributeCount; i++)
+            _search = _search || attributes[i].epsilon > 0.0f;
+
+        const WeldAttribute& spatial = attributes[0];
+        _spatialComponents = std::min(spatial.components, MaxSpatialComponents);
+        _inverseCell = spatial.epsilon > 0.0f ? 1.0 / (CellEpsilons * spatial.epsilon) : 0.0;
+    }
+
+    size_t Run(uint32_t* remap) {
+        size_t capacity = 16;
+        while (capacity < _vertexCount * 2)
+            capacity *= 2;
+        _mask = capacity - 1;
+        _entries.reset(new std::atomic<uint64_t>[capacity]);
+        if (_search) {
+            _members.reset(new std::atomic<uint32_t>[capacity]);
+            _next.reset(new uint32_t[_vertexCount]);
+        }
+
+        size_t slotBlocks = (capacity + WeldBlock - 1) / WeldBlock;
+        ParallelFor(slotBlocks, _threadCount, [&](size_t block) {
+            size_t end = std::min(capacity, (block + 1) * WeldBlock);
+            for (size_t i = block * WeldBlock; i < end; i++) {
+                _entries[i].store(EmptyEntry, std::memory_order_relaxed);
+                if (_search)
+                    _members[i].store(Empty, std::memory_order_relaxed);
+            }
+        });
+
+        // the slot of every vertex first, then the lowest vertex it matches, which always
+        // comes first
+        std::unique_ptr<uint32_t[]> match(new uint32_t[_vertexCount]);
+        size_t blocks = (_vertexCount + WeldBlock - 1) / WeldBlock;
+        forEachVertex(blocks, [&](uint32_t vertex) {
+            match[vertex] = static_cast<uint32_t>(insert(vertex));
+        });
+
+        forEachVertex(blocks, [&](uint32_t vertex) {
+            match[vertex] = _search ? nearest(vertex, match[vertex]) : owner(_entries[match[vertex]].load(std::memory_order_relaxed));
+        });
+
+        // near matches can chain, the earlier end of a chain is always resolved already
+        if (_search) {
+            for (size_t vertex = 0; vertex < _vertexCount; vertex++)
+                match[vertex] = match[match[vertex]];
+        }
+
+        // vertices matching themselves are kept, numbered in order through a prefix sum
+        std::vector<uint32_t> kept(blocks + 1, 0);
+        ParallelFor(blocks, _threadCount, [&](size_t block) {
+            size_t end = std::min(_vertexCount, (block + 1) * WeldBlock);
+            for (size_t vertex = block * WeldBlock; vertex < end; vertex++)
+                kept[block + 1] += match[vertex] == vertex;
+        });
+        for (size_t block = 0; block < blocks; block++)
+            kept[block + 1] += kept[block];
+
+        ParallelFor(blocks, _threadCount, [&](size_t block) {
+            uint32_t index = kept[block];
+            size_t end = std::min(_vertexCount, (block + 1) * WeldBlock);
+            for (size_t vertex = block * WeldBlock; vertex < end; vertex++) {
+                if (match[vertex] == vertex)
+                    remap[vertex] = index++;
+            }
+        });
+        forEachVertex(blocks, [&](uint32_t vertex) {
+            if (match[vertex] != vertex)
+                remap[vertex] = remap[match[vertex]];
+        });
+
+        return kept[blocks];
+    }
+
+private:
+    template <typename Fn>
+    void forEachVertex(size_t blocks, Fn&& fn) {
+        ParallelFor(blocks, _threadCount, [&](size_t block) {
+            size_t end = std::min(_vertexCount, (block + 1) * WeldBlock);
+            for (size_t vertex = block * WeldBlock; vertex < end; vertex++)
+                fn(static_cast<uint32_t>(vertex));
+        });
+    }
+
+    const float* value(size_t attribute, uint32_t vertex) const {
+        const WeldAttribute& a = _attributes[attribute];
+        return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(a.data) + a.stride * vertex);
+    }
+
+    double scaled(float value) const {
+        return static_cast<double>(value) * _inverseCell;
+    }
+
+    int64_t cell(float value) const {
+        double cell = std::floor(scaled(value));
+        // NaNs and huge values share a cell, the distance test tells them apart
+        if (!(cell > -9.0e18 && cell < 9.0e18))
+            cell = 0.0;
+        return static_cast<int64_t>(cell);
+    }
+
+    SpatialKey spatialKey(uint32_t vertex) const {
+        SpatialKey key = {};
+        const float* spatial = value(0, vertex);
+        for (uint32_t c = 0; c < _spatialComponents; c++)
+            key.values[c] = _inverseCell > 0.0 ? cell(spatial[c]) : FloatKey(spatial[c]);
+        return key;
+    }
+
+    // the spatial key plus the bits of every other attribute that has to match exactly
+    uint64_t hash(const SpatialKey& key, uint32_t vertex) const {
+        uint64_t h = 0;
+        for (uint32_t c = 0; c < _spatialComponents; c++)
+            h = Mix(h, static_cast<uint64_t>(key.values[c]));
+
+        for (size_t attribute = 1; attribute < _attributeCount; attribute++) {
+            if (_attributes[attribute].epsilon > 0.0f)
+                continue;
+            const float* values = value(attribute, vertex);
+            for (uint32_t c = 0; c < _attributes[attribute].components; c++)
+                h = Mix(h, FloatKey(values[c]));
+        }
+
+        // murmur3 finalizer, the table indexes with the low bits
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    bool sameKey(const SpatialKey& key, uint32_t vertex, uint32_t other) const {
+        SpatialKey otherKey = spatialKey(other);
+        for (uint32_t c = 0; c < _spatialComponents; c++) {
+            if (otherKey.values[c] != key.values[c])
+                return false;
+        }
+
+        for (size_t attribute = 1; attribute < _attributeCount; attribute++) {
+            if (_attributes[attribute].epsilon > 0.0f)
+                continue;
+            const float* a = value(attribute, vertex);
+            const float* b = value(attribute, other);
+            for (uint32_t c = 0; c < _attributes[attribute].components; c++) {
+                if (FloatKey(a[c]) != FloatKey(b[c]))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // every attribute within its epsilon, measured as a distance like Assimp does
+    bool matches(uint32_t vertex, uint32_t other) const {
+        for (size_t attribute = 0; attribute < _attributeCount; attribute++) {
+            const WeldAttribute& a = _attributes[attribute];
+            const float* p = value(attribute, vertex);
+            const float* q = value(attribute, other);
+
+            if (a.epsilon > 0.0f) {
+                float distance = 0.0f;
+                for (uint32_t c = 0; c < a.components; c++)
+                    distance += (p[c] - q[c]) * (p[c] - q[c]);
+                if (!(distance <= a.epsilon * a.epsilon))
+                    return false;
+            }
+            else {
+                for (uint32_t c = 0; c < a.components; c++) {
+                    if (FloatKey(p[c]) != FloatKey(q[c]))
+                        return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static uint64_t tag(uint64_t hash) {
+        return hash & 0xFFFFFFFF00000000ull;
+    }
+
+    static uint32_t owner(uint64_t entry) {
+        return static_cast<uint32_t>(entry);
+    }
+
+    // the slot vertex went into. A slot's owner ends up the lowest vertex with its key, the
+    // others only lower it, so which thread gets there first doesn't matter.
+    size_t insert(uint32_t vertex) {
+        SpatialKey key = spatialKey(vertex);
+        uint64_t h = hash(key, vertex);
+        uint64_t claimed = tag(h) | vertex;
+
+        for (size_t i = h & _mask;; i = (i + 1) & _mask) {
+            std::atomic<uint64_t>& slot = _entries[i];
+            uint64_t entry = slot.load(std::memory_order_relaxed);
+            bool found = false;
+            while (!found) {
+                if (entry == EmptyEntry) {
+                    found = slot.compare_exchange_weak(entry, claimed, std::memory_order_relaxed);
+                    continue;
+                }
+
+                if (tag(entry) != tag(h) || !sameKey(key, vertex, owner(entry)))
+                    break;
+
+                // the keys match, a failed exchange reloads an owner that is lower still
+                found = vertex > owner(entry) || slot.compare_exchange_weak(entry, claimed, std::memory_order_relaxed);
+            }
+
+            if (!found)
+                continue;
+
+            if (_search)
+                _next[vertex] = _members[i].exchange(vertex, std::memory_order_relaxed);
+            return i;
+        }
+    }
+
+    // slot holding key as seen from vertex, Empty when no vertex has it
+    size_t find(const SpatialKey& key, uint32_t vertex) const {
+        uint64_t h = hash(key, vertex);
+        for (size_t i = h & _mask;; i = (i + 1) & _mask) {
+            uint64_t entry = _entries[i].load(std::memory_order_relaxed);
+            if (entry == EmptyEntry)
+                return Empty;
+            if (tag(entry) == tag(h) && sameKey(key, vertex, owner(entry)))
+                return i;
+        }
+    }
+
+    // lowest vertex within tolerance. Per component everything within an epsilon of a value
+    // is in its cell, or also in the neighbour when the value is that close to the side.
+    uint32_t nearest(uint32_t vertex, size_t ownSlot) const {
+        SpatialKey key = spatialKey(vertex);
+        uint32_t sides[MaxSpatialComponents];
+        int64_t steps[MaxSpatialComponents];
+        uint32_t sideCount = 0;
+        if (_inverseCell > 0.0) {
+            const float* spatial = value(0, vertex);
+            for (uint32_t c = 0; c < _spatialComponents; c++) {
+                double scaledValue = scaled(spatial[c]);
+                double fraction = (scaledValue - std::floor(scaledValue)) * CellEpsilons;
+                if (fraction <= NeighbourEpsilons || fraction >= CellEpsilons - NeighbourEpsilons) {
+                    sides[sideCount] = c;
+                    steps[sideCount++] = fraction <= NeighbourEpsilons ? -1 : 1;
+                }
+            }
+        }
+
+        uint32_t best = vertex;
+        for (uint32_t probe = 0; probe < (1u << sideCount); probe++) {
+            SpatialKey probeKey = key;
+            for (uint32_t side = 0; side < sideCount; side++) {
+                if (probe & (1u << side))
+                    probeKey.values[sides[side]] += steps[side];
+            }
+
+            size_t slot = probe == 0 ? ownSlot : find(probeKey, vertex);
+            if (slot == Empty)
+                continue;
+
+            // the owner is the lowest vertex of the cell, when it matches nothing else there can do better
+            uint32_t first = owner(_entries[slot].load(std::memory_order_relaxed));
+            if (first >= best)
+                continue;
+            if (matches(vertex, first)) {
+                best = first;
+                continue;
+            }
+
+            for (uint32_t other = _members[slot].load(std::memory_order_relaxed); other != Empty; other = _next[other]) {
+                if (other < best && matches(vertex, other))
+                    best = other;
+            }
+        }
+        return best;
+    }
+
+private:
+    const WeldAttribute* _attributes;
+    size_t _attributeCount;
+    size_t _vertexCount;
+    unsigned int _threadCount;
+    bool _search;
+    uint32_t _spatialComponents;
+    double _inverseCell;
+
+    // the vertex data never changes while welding and the passes are joined in between, so
+    // every atomic only needs to be relaxed
+    size_t _mask = 0;
+    // per slot the vertex owning it in the low half, the lowest one with the slot's key, and
+    // the high bits of the key's hash in the high half so most mismatches never touch a vertex
+    std::unique_ptr<std::atomic<uint64_t>[]> _entries;
+    // every vertex with the slot's key chained through _next, only kept when searching
+    std::unique_ptr<std::atomic<uint32_t>[]> _members;
+    std::unique_ptr<uint32_t[]> _next;
+};
+
+}
+
+size_t WeldVertices(const WeldAttribute* attributes, size_t attributeCount, size_t vertexCount, uint32_t* remap,
+    unsigned int threadCount) {
+    if (vertexCount == 0 || attributeCount == 0) {
+        for (size_t i = 0; i < vertexCount; i++)
+            remap[i] = static_cast<uint32_t>(i);
+        return vertexCount;
+    }
+
+    return Welder(attributes, attributeCount, vertexCount, threadCount).Run(remap);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pipeline {
+
+// one attribute of the vertices being welded, components floats every stride bytes
+struct WeldAttribute {
+    const float* data;
+    size_t stride;
+    uint32_t components;
+    // furthest apart two values may be and still count as the same, 0 compares the bits
+    // with -0 equal to +0
+    float epsilon;
+};
+
+// joins vertices that match an earlier one in every attribute, with every epsilon at 0 the
+// same way Assimp's JoinIdenticalVertices does. remap gets the new index of every vertex; the
+// vertices kept are numbered in the order they first appear, so vertex i is kept when remap[i]
+// equals the count kept before it. Returns how many are kept.
+//
+// The first attribute is the spatial one. With an epsilon it is hashed by grid cell and the
+// neighbouring cells are searched too; the other attributes with an epsilon are only
+// compared, so keep their epsilon at 0 when exact matches will do. Within tolerance a vertex
+// goes to the earliest vertex near it, and on to wherever that one went.
+//
+// Runs on threadCount threads, 0 picks one per core. The result is the same for any count.
+size_t WeldVertices(const WeldAttribute* attributes, size_t attributeCount, size_t vertexCount, uint32_t* remap,
+    unsigned int threadCount = 0);
+
+}
\ No newline at end of file
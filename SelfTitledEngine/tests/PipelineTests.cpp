@@ -0,0 +1,1585 @@
+// headless checks of the asset pipeline, built by the CMake project at the repo root and run
+// with ctest from SelfTitledEngine so the Assets paths resolve. Exits nonzero if any fail.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef PIPELINE_TESTS_ASSIMP
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "../pipeline/ModelImporter.h"
+#endif
+
+#include "../pipeline/AssetLoader.h"
+#include "../pipeline/BlockCompression.h"
+#include "../pipeline/GeometryCodec.h"
+#include "../pipeline/GeometryLibrary.h"
+#include "../pipeline/Hash.h"
+#include "../pipeline/ImportProfile.h"
+#include "../pipeline/IndexBuffer.h"
+#include "../pipeline/MeshBounds.h"
+#include "../pipeline/MeshCache.h"
+#include "../pipeline/MeshOptimizer.h"
+#include "../pipeline/Meshlets.h"
+#include "../pipeline/Mipmaps.h"
+#include "../pipeline/ObjParser.h"
+#include "../pipeline/Overdraw.h"
+#include "../pipeline/PackFile.h"
+#include "../pipeline/Parallel.h"
+#include "../pipeline/Simplifier.h"
+#include "../pipeline/TangentSpace.h"
+#include "../pipeline/VertexCache.h"
+#include "../pipeline/VertexFetch.h"
+#include "../pipeline/VertexFormat.h"
+#include "../pipeline/VertexWeld.h"
+
+using namespace pipeline;
+
+namespace {
+
+const char* TeapotAssets[] = {
+    "Assets/teapot.obj",
+    "Assets/teapot_normals.obj",
+    "Assets/teapot_normals_uv.obj",
+};
+
+unsigned int checkFailures = 0;
+
+void Check(bool passed, const std::string& what) {
+    if (!passed) {
+        std::printf("  FAILED: %s\n", what.c_str());
+        checkFailures++;
+    }
+}
+
+double AngleBetween(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b) {
+    double crossX = double(a.y) * b.z - double(a.z) * b.y;
+    double crossY = double(a.z) * b.x - double(a.x) * b.z;
+    double crossZ = double(a.x) * b.y - double(a.y) * b.x;
+    double sine = std::sqrt(crossX * crossX + crossY * crossY + crossZ * crossZ);
+    double cosine = double(a.x) * b.x + double(a.y) * b.y + double(a.z) * b.z;
+    return std::atan2(sine, cosine) * 180.0 / 3.14159265358979;
+}
+
+bool LoadTeapot(const char* asset, std::vector<Mesh>& meshes) {
+    std::string error;
+    bool loaded = ImportObj(asset, meshes, error) && !meshes.empty();
+    Check(loaded, std::string("load ") + asset + ": " + error);
+    return loaded;
+}
+
+// a side x side vertex grid over the unit square in the xz plane, its triangles in scan order
+// facing +y
+Mesh GridMesh(uint32_t side) {
+    Mesh mesh;
+    for (uint32_t y = 0; y < side; y++) {
+        for (uint32_t x = 0; x < side; x++)
+            mesh.vertices.push_back(Vertex{ DirectX::XMFLOAT3(x / float(side - 1), 0.0f, y / float(side - 1)) });
+    }
+    for (uint32_t y = 0; y + 1 < side; y++) {
+        for (uint32_t x = 0; x + 1 < side; x++) {
+            uint32_t corner = y * side + x;
+            mesh.indices.push_back(DirectX::XMUINT3(corner, corner + side, corner + 1));
+            mesh.indices.push_back(DirectX::XMUINT3(corner + 1, corner + side, corner + side + 1));
+        }
+    }
+    mesh.numberOfVertices = static_cast<unsigned int>(mesh.vertices.size());
+    mesh.numberOfIndices = static_cast<unsigned int>(mesh.indices.size() * 3);
+    return mesh;
+}
+
+// every finite half converts to float and back to the same bits
+void TestHalfRoundTrip() {
+    unsigned int mismatches = 0;
+    for (uint32_t bits = 0; bits < 0x10000; bits++) {
+        uint16_t half = static_cast<uint16_t>(bits);
+        float value = HalfToFloat(half);
+        if (value == value && FloatToHalf(value) != half)
+            mismatches++;
+    }
+    Check(mismatches == 0, std::to_string(mismatches) + " halfs don't round trip");
+
+    // halfway between 1 and the next half rounds to even, just past it rounds up
+    Check(FloatToHalf(1.0f + 1.0f / 2048.0f) == 0x3C00, "1 + half an ulp rounds to even");
+    Check(FloatToHalf(1.0f + 3.0f / 2048.0f) == 0x3C02, "1 + 3 half ulps rounds to even");
+    Check(FloatToHalf(65520.0f) == 0x7C00, "65520 rounds to infinity");
+    Check(FloatToHalf(1e-8f) == 0, "below the smallest subnormal gives zero");
+}
+
+// unit directions spread over the sphere stay within each encoding's precision
+void TestOctahedralRoundTrip() {
+    const unsigned int directionCount = 100000;
+    double octError = 0.0;
+    double snormError = 0.0;
+    for (unsigned int i = 0; i < directionCount; i++) {
+        float y = 1.0f - (i + 0.5f) * 2.0f / directionCount;
+        float radius = std::sqrt(std::max(0.0f, 1.0f - y * y));
+        float phi = i * 2.39996323f;
+        DirectX::XMFLOAT3 normal(radius * std::cos(phi), y, radius * std::sin(phi));
+
+        int16_t oct[2];
+        EncodeOctahedral(normal, oct);
+        octError = std::max(octError, AngleBetween(normal, DecodeOctahedral(oct)));
+
+        int8_t snorm[3];
+        EncodeSnorm8(normal, snorm);
+        snormError = std::max(snormError, AngleBetween(normal, DecodeSnorm8(snorm)));
+    }
+
+    Check(octError < 0.01, "oct16 error " + std::to_string(octError) + " deg");
+    Check(snormError < 1.0, "snorm8 error " + std::to_string(snormError) + " deg");
+
+    // the axes land exactly on the octahedron's corners
+    const DirectX::XMFLOAT3 axes[] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    for (const DirectX::XMFLOAT3& axis : axes) {
+        int16_t oct[2];
+        EncodeOctahedral(axis, oct);
+        DirectX::XMFLOAT3 decoded = DecodeOctahedral(oct);
+        Check(decoded.x == axis.x && decoded.y == axis.y && decoded.z == axis.z, "oct16 axis round trip");
+    }
+}
+
+// every code decodes and encodes back to itself, and packed teapot positions stay within
+// half a step of the bounds
+void TestUnorm16RoundTrip() {
+    unsigned int mismatches = 0;
+    for (uint32_t code = 0; code < 0x10000; code++) {
+        if (EncodeUnorm16(DecodeUnorm16(static_cast<uint16_t>(code))) != code)
+            mismatches++;
+    }
+    Check(mismatches == 0, std::to_string(mismatches) + " unorm16 codes don't round trip");
+    Check(EncodeUnorm16(-1.0f) == 0 && EncodeUnorm16(2.0f) == 0xFFFF, "unorm16 clamps");
+
+    for (const char* asset : TeapotAssets) {
+        std::vector<Mesh> meshes;
+        if (!LoadTeapot(asset, meshes))
+            continue;
+
+        Mesh& mesh = meshes[0];
+        const Bounds& bounds = mesh.bounds;
+        float extent = std::max({ bounds.maxCoord.x - bounds.minCoord.x, bounds.maxCoord.y - bounds.minCoord.y, bounds.maxCoord.z - bounds.minCoord.z });
+        PackReport report = PackVertices(mesh, { PositionFormat::Unorm16 });
+
+        // half a step per axis, with room for the float math of the decode
+        float limit = extent / 65535.0f * 0.5f * std::sqrt(3.0f) * 1.01f;
+        Check(report.strideAfter == 8, std::string(asset) + " unorm16 stride");
+        Check(report.maxPositionError <= limit, std::string(asset) + " unorm16 error " + std::to_string(report.maxPositionError) + " over " + std::to_string(limit));
+
+        float worst = 0.0f;
+        MeshView view = mesh.View();
+        for (size_t i = 0; i < mesh.vertices.size(); i++) {
+            Vertex decoded = UnpackVertex(view, i);
+            const DirectX::XMFLOAT3& original = mesh.vertices[i].Pos;
+            float dx = decoded.Pos.x - original.x;
+            float dy = decoded.Pos.y - original.y;
+            float dz = decoded.Pos.z - original.z;
+            worst = std::max(worst, std::sqrt(dx * dx + dy * dy + dz * dz));
+        }
+        Check(worst <= limit, std::string(asset) + " unpacked error " + std::to_string(worst));
+    }
+}
+
+// a stream worked through by hand with 4 entries. FIFO keeps 0 from its first miss and loses
+// it on the 5th, LRU keeps it while it is used and only misses 1, 2 and 0 again at the end.
+void TestVertexCacheSimulator() {
+    const DirectX::XMUINT3 triangles[] = { { 0, 1, 2 }, { 0, 2, 3 }, { 0, 3, 4 }, { 0, 4, 5 }, { 1, 2, 0 } };
+    const size_t triangleCount = std::size(triangles);
+
+    CacheStatistics fifo = SimulateVertexCache(triangles, triangleCount, 6, 4, CacheModel::Fifo);
+    Check(fifo.transforms == 10, "FIFO4 transforms " + std::to_string(fifo.transforms) + ", expected 10");
+    Check(fifo.acmr == 2.0f, "FIFO4 ACMR " + std::to_string(fifo.acmr));
+    Check(fifo.atvr == 10.0f / 6.0f, "FIFO4 ATVR " + std::to_string(fifo.atvr));
+
+    CacheStatistics lru = SimulateVertexCache(triangles, triangleCount, 6, 4, CacheModel::Lru);
+    Check(lru.transforms == 9, "LRU4 transforms " + std::to_string(lru.transforms) + ", expected 9");
+    Check(lru.acmr == 9.0f / 5.0f, "LRU4 ACMR " + std::to_string(lru.acmr));
+    Check(lru.atvr == 1.5f, "LRU4 ATVR " + std::to_string(lru.atvr));
+
+    // a cache big enough for every vertex shades each exactly once
+    CacheStatistics large = SimulateVertexCache(triangles, triangleCount, 6, 16, CacheModel::Fifo);
+    Check(large.transforms == 6 && large.atvr == 1.0f, "FIFO16 shades every vertex once");
+}
+
+bool SameTriangles(std::vector<DirectX::XMUINT3> a, std::vector<DirectX::XMUINT3> b) {
+    auto less = [](const DirectX::XMUINT3& l, const DirectX::XMUINT3& r) {
+        return l.x != r.x ? l.x < r.x : l.y != r.y ? l.y < r.y : l.z < r.z;
+    };
+    std::sort(a.begin(), a.end(), less);
+    std::sort(b.begin(), b.end(), less);
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const DirectX::XMUINT3& l, const DirectX::XMUINT3& r) {
+        return l.x == r.x && l.y == r.y && l.z == r.z;
+    });
+}
+
+// the import pass never leaves the LRU ACMR the optimizer targets worse than the source order,
+// and the reordering only permutes triangles
+void TestVertexCacheOrder() {
+    for (const char* asset : TeapotAssets) {
+        std::vector<Mesh> meshes;
+        if (!LoadTeapot(asset, meshes))
+            continue;
+
+        std::vector<CacheStatistics> before;
+        for (const Mesh& mesh : meshes)
+            before.push_back(SimulateVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), OptimizerCacheSize, CacheModel::Lru));
+
+        OptimizeMeshes(asset, ImportOptions(), meshes);
+        for (size_t i = 0; i < meshes.size(); i++) {
+            const Mesh& mesh = meshes[i];
+            CacheStatistics after = SimulateVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), OptimizerCacheSize, CacheModel::Lru);
+            Check(after.acmr <= before[i].acmr, std::string(asset) + " ACMR " + std::to_string(before[i].acmr) + " -> " + std::to_string(after.acmr));
+        }
+
+        std::vector<DirectX::XMUINT3> original = meshes[0].indices;
+        OptimizeVertexCache(meshes[0].indices.data(), meshes[0].indices.size(), meshes[0].vertices.size());
+        Check(SameTriangles(original, meshes[0].indices), std::string(asset) + " triangles changed, not just their order");
+    }
+
+    // a grid in scan order and in random order, two patches of it apart, the pass has to beat
+    // both under its own cache
+    const uint32_t side = 64;
+    std::vector<DirectX::XMUINT3> grid;
+    for (uint32_t patch = 0; patch < 2; patch++) {
+        for (uint32_t y = 0; y + 1 < side; y++) {
+            for (uint32_t x = 0; x + 1 < side; x++) {
+                uint32_t corner = patch * side * side + y * side + x;
+                grid.push_back(DirectX::XMUINT3(corner, corner + side, corner + 1));
+                grid.push_back(DirectX::XMUINT3(corner + 1, corner + side, corner + side + 1));
+            }
+        }
+    }
+    std::vector<DirectX::XMUINT3> shuffled = grid;
+    std::mt19937 random(1234);
+    std::shuffle(shuffled.begin(), shuffled.end(), random);
+
+    for (std::vector<DirectX::XMUINT3>* order : { &grid, &shuffled }) {
+        const char* name = order == &grid ? "scan order grid" : "shuffled grid";
+        std::vector<DirectX::XMUINT3> triangles = *order;
+        CacheStatistics before = SimulateVertexCache(triangles.data(), triangles.size(), 2 * side * side, OptimizerCacheSize, CacheModel::Lru);
+        OptimizeVertexCache(triangles.data(), triangles.size(), 2 * side * side);
+        CacheStatistics after = SimulateVertexCache(triangles.data(), triangles.size(), 2 * side * side, OptimizerCacheSize, CacheModel::Lru);
+        Check(SameTriangles(*order, triangles), std::string(name) + " triangles changed, not just their order");
+        Check(after.acmr < 0.75f && after.acmr < before.acmr, std::string(name) + " ACMR " + std::to_string(before.acmr) + " -> " + std::to_string(after.acmr));
+    }
+}
+
+// clustering only permutes the cache order, keeps its ACMR within the threshold the clusters
+// were cut for, give or take the last cluster, and draws the outward facing clusters first so
+// fewer pixels get shaded
+void TestOverdrawClusters() {
+    const float threshold = 1.05f;
+    for (const char* asset : TeapotAssets) {
+        std::vector<Mesh> meshes;
+        if (!LoadTeapot(asset, meshes))
+            continue;
+        Mesh& mesh = meshes[0];
+        OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+
+        std::vector<DirectX::XMUINT3> cacheOrder = mesh.indices;
+        CacheStatistics cacheBefore = SimulateVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), ReportCacheSize, CacheModel::Fifo);
+        OverdrawStatistics before = MeasureOverdraw(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size());
+
+        OptimizeOverdraw(mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), mesh.vertices.size(), ReportCacheSize, threshold);
+        CacheStatistics cacheAfter = SimulateVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), ReportCacheSize, CacheModel::Fifo);
+        OverdrawStatistics after = MeasureOverdraw(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size());
+
+        Check(SameTriangles(cacheOrder, mesh.indices), std::string(asset) + " clustering changed triangles, not just their order");
+        Check(after.covered == before.covered, std::string(asset) + " coverage depends on the order");
+        Check(after.shaded < before.shaded, std::string(asset) + " shaded " + std::to_string(before.shaded) + " -> " + std::to_string(after.shaded));
+        Check(cacheAfter.acmr <= threshold * 1.02f * cacheBefore.acmr,
+            std::string(asset) + " clustered ACMR " + std::to_string(cacheBefore.acmr) + " -> " + std::to_string(cacheAfter.acmr));
+    }
+}
+
+// the fetch remap puts a scattered vertex buffer back in first use order, drops a vertex
+// nothing uses and leaves every triangle on the same positions, in place or not
+void TestVertexFetchOrder() {
+    std::vector<Mesh> meshes;
+    if (!LoadTeapot("Assets/teapot.obj", meshes))
+        return;
+    const Mesh& mesh = meshes[0];
+    size_t vertexCount = mesh.vertices.size(), triangleCount = mesh.indices.size();
+
+    std::vector<uint32_t> order(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+        order[i] = static_cast<uint32_t>(i);
+    std::mt19937 random(7);
+    std::shuffle(order.begin(), order.end(), random);
+
+    std::vector<Vertex> scattered(vertexCount + 1);
+    std::vector<uint32_t> moved(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        scattered[i] = mesh.vertices[order[i]];
+        moved[order[i]] = static_cast<uint32_t>(i);
+    }
+    scattered[vertexCount].Pos = DirectX::XMFLOAT3(1e3f, 1e3f, 1e3f);
+    std::vector<DirectX::XMUINT3> triangles(triangleCount);
+    for (size_t i = 0; i < triangleCount; i++)
+        triangles[i] = DirectX::XMUINT3(moved[mesh.indices[i].x], moved[mesh.indices[i].y], moved[mesh.indices[i].z]);
+
+    std::vector<Vertex> vertices(scattered.size());
+    std::vector<DirectX::XMUINT3> remapped(triangleCount);
+    size_t used = OptimizeVertexFetch(vertices.data(), remapped.data(), scattered.data(), scattered.size(), triangles.data(), triangleCount);
+    Check(used == vertexCount, "kept " + std::to_string(used) + " of " + std::to_string(vertexCount) + " used vertices");
+
+    uint32_t next = 0;
+    bool firstUse = true, samePositions = true;
+    for (size_t i = 0; i < triangleCount; i++) {
+        const uint32_t before[3] = { triangles[i].x, triangles[i].y, triangles[i].z };
+        const uint32_t after[3] = { remapped[i].x, remapped[i].y, remapped[i].z };
+        for (int corner = 0; corner < 3; corner++) {
+            if (after[corner] == next)
+                next++;
+            else if (after[corner] > next)
+                firstUse = false;
+            samePositions &= std::memcmp(&vertices[after[corner]], &scattered[before[corner]], sizeof(Vertex)) == 0;
+        }
+    }
+    Check(firstUse && next == used, "vertices not in first use order");
+    Check(samePositions, "triangles moved to other positions");
+
+    FetchStatistics fetchBefore = AnalyzeVertexFetch(triangles.data(), triangleCount, scattered.size(), sizeof(Vertex), ReportCacheSize);
+    FetchStatistics fetchAfter = AnalyzeVertexFetch(remapped.data(), triangleCount, used, sizeof(Vertex), ReportCacheSize);
+    Check(fetchAfter.bytesFetched < fetchBefore.bytesFetched,
+        "overfetch " + std::to_string(fetchBefore.overfetch) + " -> " + std::to_string(fetchAfter.overfetch));
+
+    size_t usedInPlace = OptimizeVertexFetch(scattered.data(), scattered.size(), triangles.data(), triangleCount);
+    Check(usedInPlace == used && std::memcmp(scattered.data(), vertices.data(), used * sizeof(Vertex)) == 0 &&
+        std::memcmp(triangles.data(), remapped.data(), triangleCount * sizeof(DirectX::XMUINT3)) == 0, "in place remap differs");
+}
+
+// every piece of a split fits 16 bit indices, and the pieces in order draw the same triangles
+// in the same order as the whole mesh
+void CheckSplit(const std::string& name, const Mesh& mesh, size_t maxVertices) {
+    std::vector<Mesh> pieces = SplitMesh(mesh, maxVertices);
+    Check(pieces.size() > 1, name + " wasn't split");
+
+    size_t triangle = 0;
+    bool fits = true, same = true;
+    for (Mesh& piece : pieces) {
+        fits &= piece.vertices.size() <= maxVertices && piece.numberOfVertices == piece.vertices.size();
+        for (const DirectX::XMUINT3& corners : piece.indices) {
+            if (std::max(corners.x, std::max(corners.y, corners.z)) >= piece.vertices.size() || triangle == mesh.indices.size()) {
+                fits = false;
+                continue;
+            }
+            const DirectX::XMUINT3& original = mesh.indices[triangle++];
+            same &= std::memcmp(&piece.vertices[corners.x], &mesh.vertices[original.x], sizeof(Vertex)) == 0 &&
+                std::memcmp(&piece.vertices[corners.y], &mesh.vertices[original.y], sizeof(Vertex)) == 0 &&
+                std::memcmp(&piece.vertices[corners.z], &mesh.vertices[original.z], sizeof(Vertex)) == 0;
+        }
+
+        PackIndices(piece);
+        fits &= piece.indexFormat == IndexFormat::Uint16 && piece.packedIndices.size() == piece.indices.size() * 3 * sizeof(uint16_t);
+    }
+    Check(fits, name + " has a piece 16 bit indices can't address");
+    Check(same && triangle == mesh.indices.size(),
+        name + " pieces hold " + std::to_string(triangle) + " of " + std::to_string(mesh.indices.size()) + " triangles, or other ones");
+}
+
+void TestSplitMesh() {
+    CheckSplit("400x400 grid", GridMesh(400), ShortIndexVertexLimit);
+
+    std::vector<Mesh> meshes;
+    if (LoadTeapot("Assets/teapot.obj", meshes)) {
+        OptimizeVertexCache(meshes[0].indices.data(), meshes[0].indices.size(), meshes[0].vertices.size());
+        CheckSplit("teapot in 500 vertex pieces", meshes[0], 500);
+    }
+}
+
+// area of triangles in the xz plane, counting the ones facing -y as negative
+double AreaXZ(const std::vector<Vertex>& vertices, const std::vector<DirectX::XMUINT3>& triangles) {
+    double area = 0.0;
+    for (const DirectX::XMUINT3& t : triangles) {
+        const DirectX::XMFLOAT3& a = vertices[t.x].Pos;
+        const DirectX::XMFLOAT3& b = vertices[t.y].Pos;
+        const DirectX::XMFLOAT3& c = vertices[t.z].Pos;
+        area += 0.5 * ((double(b.z) - a.z) * (double(c.x) - a.x) - (double(b.x) - a.x) * (double(c.z) - a.z));
+    }
+    return area;
+}
+
+// every level reaches its ratio, and the grid's open border and the uv seam down its middle,
+// both locked, stay where they were: the square is still covered exactly, as much of it
+// on each side of the seam, and every locked vertex is still used
+void TestSimplifyLevels() {
+    const uint32_t side = 64, seam = side / 2;
+    Mesh grid = GridMesh(side);
+
+    // the right half gets its own copy of the middle column, the way a uv seam splits vertices
+    std::vector<Vertex> vertices = grid.vertices;
+    std::vector<uint32_t> seamCopy(side);
+    for (uint32_t y = 0; y < side; y++) {
+        seamCopy[y] = static_cast<uint32_t>(vertices.size());
+        vertices.push_back(grid.vertices[y * side + seam]);
+    }
+    std::vector<DirectX::XMUINT3> triangles = grid.indices;
+    for (DirectX::XMUINT3& t : triangles) {
+        if (std::min(t.x % side, std::min(t.y % side, t.z % side)) < seam)
+            continue;
+        for (uint32_t* corner : { &t.x, &t.y, &t.z }) {
+            if (*corner % side == seam)
+                *corner = seamCopy[*corner / side];
+        }
+    }
+
+    std::vector<uint8_t> locked(vertices.size(), 0);
+    for (uint32_t y = 0; y < side; y++) {
+        for (uint32_t x = 0; x < side; x++)
+            locked[y * side + x] = x == 0 || y == 0 || x == side - 1 || y == side - 1 || x == seam;
+        locked[seamCopy[y]] = 1;
+    }
+
+    std::vector<SimplifiedLevel> levels = SimplifyLevels(vertices.data(), vertices.size(), triangles.data(), triangles.size(), LodRatios, LodCount);
+    Check(levels.size() == LodCount, "got " + std::to_string(levels.size()) + " levels");
+    for (size_t i = 0; i < levels.size(); i++) {
+        const std::vector<DirectX::XMUINT3>& level = levels[i].triangles;
+        std::string name = "level " + std::to_string(i + 1);
+        Check(level.size() <= size_t(LodRatios[i] * triangles.size()) + 1,
+            name + " has " + std::to_string(level.size()) + " of " + std::to_string(triangles.size()) + " triangles");
+
+        // a triangle is left of the seam when it uses neither a right-only vertex nor the seam copy
+        double left = 0.0, total = AreaXZ(vertices, level);
+        for (const DirectX::XMUINT3& t : level) {
+            auto rightSide = [&](uint32_t v) { return v >= side * side || v % side > seam; };
+            if (!rightSide(t.x) && !rightSide(t.y) && !rightSide(t.z))
+                left += AreaXZ(vertices, { t });
+        }
+        double expected = double(seam) / (side - 1);
+        Check(std::fabs(total - 1.0) < 1e-5 && std::fabs(left - expected) < 1e-5,
+            name + " covers " + std::to_string(total) + ", left of the seam " + std::to_string(left));
+
+        std::vector<uint8_t> used(vertices.size(), 0);
+        for (const DirectX::XMUINT3& t : level)
+            used[t.x] = used[t.y] = used[t.z] = 1;
+        size_t lost = 0;
+        for (size_t v = 0; v < vertices.size(); v++)
+            lost += locked[v] && !used[v];
+        Check(lost == 0, name + " dropped " + std::to_string(lost) + " border or seam vertices");
+    }
+}
+
+// a meshlet with a triangle that faces the eye and has a corner inside the frustum is
+// visible, so culling must keep it. Eyes orbit the teapot far and close, above and below.
+void TestCullMeshlets() {
+    std::vector<Mesh> meshes;
+    if (!LoadTeapot("Assets/teapot.obj", meshes))
+        return;
+
+    Mesh& mesh = meshes[0];
+    OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+    std::vector<Meshlet> meshlets = BuildMeshlets(mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), mesh.vertices.size());
+    Bounds bounds = ComputeBounds(mesh.vertices.data(), mesh.vertices.size());
+
+    std::vector<uint32_t> visible(meshlets.size());
+    std::vector<uint8_t> kept(meshlets.size());
+    size_t views = 0, culled = 0, wrong = 0;
+    for (float distance : { 3.0f, 1.2f, 0.75f }) {
+        for (float elevation : { -1.2f, -0.4f, 0.0f, 0.6f, 1.4f }) {
+            for (int step = 0; step < 12; step++) {
+                float azimuth = step * 2.0f * 3.14159265f / 12;
+                float reach = distance * bounds.radius;
+                DirectX::XMFLOAT3 eye(bounds.center.x + reach * std::cos(elevation) * std::cos(azimuth),
+                    bounds.center.y + reach * std::sin(elevation),
+                    bounds.center.z + reach * std::cos(elevation) * std::sin(azimuth));
+                CullView view = MakeCullView(eye, bounds.center, DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f), 0.785f, 16.0f / 9.0f, 0.01f, 1000.0f);
+
+                size_t count = CullMeshlets(meshlets.data(), meshlets.size(), view, visible.data());
+                std::fill(kept.begin(), kept.end(), 0);
+                for (size_t i = 0; i < count; i++)
+                    kept[visible[i]] = 1;
+                views++;
+                culled += meshlets.size() - count;
+
+                for (size_t m = 0; m < meshlets.size(); m++) {
+                    if (kept[m])
+                        continue;
+
+                    const Meshlet& meshlet = meshlets[m];
+                    for (size_t t = meshlet.firstIndex / 3; t < (meshlet.firstIndex + meshlet.numberOfIndices) / 3; t++) {
+                        const DirectX::XMFLOAT3& a = mesh.vertices[mesh.indices[t].x].Pos;
+                        const DirectX::XMFLOAT3& b = mesh.vertices[mesh.indices[t].y].Pos;
+                        const DirectX::XMFLOAT3& c = mesh.vertices[mesh.indices[t].z].Pos;
+                        double ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+                        double vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+                        double nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+                        double length = std::sqrt(nx * nx + ny * ny + nz * nz);
+                        // a margin for triangles seen edge on
+                        bool facing = nx * (eye.x - a.x) + ny * (eye.y - a.y) + nz * (eye.z - a.z) > 1e-5 * length * bounds.radius;
+
+                        bool inside = false;
+                        for (const DirectX::XMFLOAT3* corner : { &a, &b, &c }) {
+                            bool within = true;
+                            for (const DirectX::XMFLOAT4& plane : view.planes)
+                                within &= plane.x * corner->x + plane.y * corner->y + plane.z * corner->z + plane.w > 1e-5f * bounds.radius;
+                            inside |= within;
+                        }
+
+                        if (facing && inside) {
+                            wrong++;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    Check(wrong == 0, std::to_string(wrong) + " culled meshlets had a visible triangle");
+    Check(culled > 0, "nothing culled in " + std::to_string(views) + " views");
+}
+
+// a uv sphere's smoothed normals point away from its center, whatever the thread count, and
+// a cube's corners are smoothed across its edges or kept apart by the smoothing angle
+void TestGenerateNormals() {
+    const uint32_t rings = 48, segments = 96;
+    std::vector<DirectX::XMFLOAT3> sphere = { DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f), DirectX::XMFLOAT3(0.0f, -1.0f, 0.0f) };
+    for (uint32_t ring = 1; ring < rings; ring++) {
+        float theta = ring * 3.14159265f / rings;
+        for (uint32_t segment = 0; segment < segments; segment++) {
+            float phi = segment * 2.0f * 3.14159265f / segments;
+            sphere.push_back(DirectX::XMFLOAT3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+        }
+    }
+    auto ringVertex = [&](uint32_t ring, uint32_t segment) { return 2 + (ring - 1) * segments + segment % segments; };
+    std::vector<DirectX::XMUINT3> triangles;
+    for (uint32_t segment = 0; segment < segments; segment++) {
+        triangles.push_back(DirectX::XMUINT3(0, ringVertex(1, segment + 1), ringVertex(1, segment)));
+        triangles.push_back(DirectX::XMUINT3(1, ringVertex(rings - 1, segment), ringVertex(rings - 1, segment + 1)));
+        for (uint32_t ring = 1; ring + 1 < rings; ring++) {
+            uint32_t a = ringVertex(ring, segment), b = ringVertex(ring, segment + 1);
+            uint32_t c = ringVertex(ring + 1, segment), d = ringVertex(ring + 1, segment + 1);
+            triangles.push_back(DirectX::XMUINT3(a, b, c));
+            triangles.push_back(DirectX::XMUINT3(c, b, d));
+        }
+    }
+
+    for (NormalWeighting weighting : { NormalWeighting::Area, NormalWeighting::Angle, NormalWeighting::AreaAngle }) {
+        NormalOptions options;
+        options.weighting = weighting;
+        std::vector<DirectX::XMFLOAT3> single(triangles.size() * 3), threaded(triangles.size() * 3);
+        GenerateNormals(sphere.data(), sphere.size(), triangles.data(), triangles.size(), options, single.data(), 1);
+        GenerateNormals(sphere.data(), sphere.size(), triangles.data(), triangles.size(), options, threaded.data(), 3);
+        Check(std::memcmp(single.data(), threaded.data(), single.size() * sizeof(DirectX::XMFLOAT3)) == 0,
+            "sphere normals depend on the thread count");
+
+        double worst = 0.0;
+        for (size_t i = 0; i < single.size(); i++)
+            worst = std::max(worst, AngleBetween(single[i], sphere[(&triangles[i / 3].x)[i % 3]]));
+        Check(worst < 1.0, "sphere normals off by up to " + std::to_string(worst) + " deg");
+    }
+
+    // the corners of the unit cube, two triangles a face
+    std::vector<DirectX::XMFLOAT3> cube;
+    for (int i = 0; i < 8; i++)
+        cube.push_back(DirectX::XMFLOAT3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f));
+    const uint32_t faces[6][4] = { { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 } };
+    std::vector<DirectX::XMUINT3> box;
+    for (const uint32_t* face : faces) {
+        box.push_back(DirectX::XMUINT3(face[0], face[1], face[2]));
+        box.push_back(DirectX::XMUINT3(face[0], face[2], face[3]));
+    }
+
+    for (float smoothingAngle : { 180.0f, 60.0f }) {
+        NormalOptions options;
+        options.smoothingAngle = smoothingAngle;
+        std::vector<DirectX::XMFLOAT3> normals(box.size() * 3);
+        GenerateNormals(cube.data(), cube.size(), box.data(), box.size(), options, normals.data());
+
+        double worst = 0.0;
+        for (size_t i = 0; i < normals.size(); i++) {
+            const DirectX::XMUINT3& t = box[i / 3];
+            DirectX::XMFLOAT3 expected = cube[(&t.x)[i % 3]];
+            if (smoothingAngle < 90.0f) {
+                // the face normal
+                const DirectX::XMFLOAT3 &a = cube[t.x], &b = cube[t.y], &c = cube[t.z];
+                float ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+                float vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+                expected = DirectX::XMFLOAT3(uy * vz - uz * vy, uz * vx - ux * vz, ux * vy - uy * vx);
+            }
+            worst = std::max(worst, AngleBetween(normals[i], expected));
+        }
+        Check(worst < 0.01, "cube normals smoothed up to " + std::to_string(smoothingAngle) + " deg off by " + std::to_string(worst) + " deg");
+    }
+}
+
+// a grid whose right half mirrors the texture of its left, welded down the seam column
+// since the texcoords match there: the tangent follows u on each side and flips sign with
+// the mirror rather than averaging to nothing at the seam
+void TestGenerateTangents() {
+    const uint32_t side = 32, seam = side / 2;
+    Mesh grid = GridMesh(side);
+    std::vector<DirectX::XMFLOAT3> positions;
+    std::vector<DirectX::XMFLOAT2> texcoords;
+    float seamX = seam / float(side - 1);
+    for (const Vertex& vertex : grid.vertices) {
+        positions.push_back(vertex.Pos);
+        float u = vertex.Pos.x <= seamX ? vertex.Pos.x : 2.0f * seamX - vertex.Pos.x;
+        texcoords.push_back(DirectX::XMFLOAT2(u, vertex.Pos.z));
+    }
+
+    std::vector<DirectX::XMFLOAT3> normals(grid.indices.size() * 3);
+    GenerateNormals(positions.data(), positions.size(), grid.indices.data(), grid.indices.size(), NormalOptions(), normals.data());
+
+    TangentInput input;
+    input.positions = positions.data();
+    input.positionTriangles = grid.indices.data();
+    input.texcoords = texcoords.data();
+    input.texcoordTriangles = grid.indices.data();
+    input.normals = normals.data();
+    input.vertexTriangles = grid.indices.data();
+    input.vertexCount = positions.size();
+    input.triangleCount = grid.indices.size();
+
+    std::vector<DirectX::XMFLOAT4> single(grid.indices.size() * 3), threaded(grid.indices.size() * 3);
+    GenerateTangents(input, single.data(), 1);
+    GenerateTangents(input, threaded.data(), 3);
+    Check(std::memcmp(single.data(), threaded.data(), single.size() * sizeof(DirectX::XMFLOAT4)) == 0,
+        "tangents depend on the thread count");
+
+    // +y normal, v along +z: bitangent = w * cross(normal, tangent) gives w = -1 for u along +x
+    size_t wrong = 0;
+    for (size_t i = 0; i < single.size(); i++) {
+        const DirectX::XMUINT3& t = grid.indices[i / 3];
+        bool mirrored = std::max(t.x % side, std::max(t.y % side, t.z % side)) > seam;
+        DirectX::XMFLOAT4 expected = mirrored ? DirectX::XMFLOAT4(-1.0f, 0.0f, 0.0f, 1.0f) : DirectX::XMFLOAT4(1.0f, 0.0f, 0.0f, -1.0f);
+        const DirectX::XMFLOAT4& tangent = single[i];
+        wrong += std::fabs(tangent.x - expected.x) > 1e-4f || std::fabs(tangent.y) > 1e-4f || std::fabs(tangent.z) > 1e-4f ||
+            tangent.w != expected.w;
+    }
+    Check(wrong == 0, std::to_string(wrong) + " of " + std::to_string(single.size()) + " tangents off the mirrored u axis");
+}
+
+// clusters of points closer than the epsilon weld to one vertex and points just past it stay
+// apart, the same for any thread count and vertex order; exact attributes only weld on equal
+// bits, with -0 equal to +0
+void TestWeldEpsilon() {
+    const float epsilon = 1e-3f;
+    const int lattice = 13;
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> jitter(-0.28f * epsilon, 0.28f * epsilon);
+
+    // every cluster is within epsilon / 2 of its lattice point so any two of its points weld,
+    // and the six outliers sit 2.5 epsilons out along the axes, beyond reach of it and of each other
+    std::vector<DirectX::XMFLOAT3> positions;
+    std::vector<uint32_t> group;
+    const float offsets[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    for (int i = 0; i < lattice * lattice * lattice; i++) {
+        DirectX::XMFLOAT3 point(i % lattice * 10.0f * epsilon, i / lattice % lattice * 10.0f * epsilon, i / (lattice * lattice) * 10.0f * epsilon);
+        for (int copy = 0; copy < 4; copy++) {
+            positions.push_back(DirectX::XMFLOAT3(point.x + jitter(random), point.y + jitter(random), point.z + jitter(random)));
+            group.push_back(i * 7);
+        }
+        for (int k = 0; k < 6; k++) {
+            positions.push_back(DirectX::XMFLOAT3(point.x + offsets[k][0] * 2.5f * epsilon, point.y + offsets[k][1] * 2.5f * epsilon,
+                point.z + offsets[k][2] * 2.5f * epsilon));
+            group.push_back(i * 7 + 1 + k);
+        }
+    }
+    std::vector<uint32_t> order(positions.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = static_cast<uint32_t>(i);
+    std::shuffle(order.begin(), order.end(), random);
+    std::vector<DirectX::XMFLOAT3> shuffled;
+    std::vector<uint32_t> shuffledGroup;
+    for (uint32_t i : order) {
+        shuffled.push_back(positions[i]);
+        shuffledGroup.push_back(group[i]);
+    }
+
+    WeldAttribute attribute = { &shuffled[0].x, sizeof(DirectX::XMFLOAT3), 3, epsilon };
+    std::vector<uint32_t> single(shuffled.size()), threaded(shuffled.size());
+    size_t kept = WeldVertices(&attribute, 1, shuffled.size(), single.data(), 1);
+    size_t keptThreaded = WeldVertices(&attribute, 1, shuffled.size(), threaded.data(), 3);
+    Check(kept == keptThreaded && single == threaded, "weld depends on the thread count");
+    Check(kept == size_t(lattice * lattice * lattice * 7), "kept " + std::to_string(kept) + " vertices");
+
+    // one kept vertex per group, numbered in order of first appearance
+    std::vector<uint32_t> groupVertex(lattice * lattice * lattice * 7, UINT32_MAX);
+    size_t wrong = 0, next = 0;
+    for (size_t i = 0; i < shuffled.size(); i++) {
+        uint32_t& vertex = groupVertex[shuffledGroup[i]];
+        if (vertex == UINT32_MAX)
+            vertex = static_cast<uint32_t>(next++);
+        wrong += single[i] != vertex;
+    }
+    Check(wrong == 0, std::to_string(wrong) + " vertices welded across the epsilon or numbered out of order");
+
+    // exact normals on a shared position
+    const float vertices[4][6] = {
+        { 0, 0, 0, 0.0f, 0, 1 },
+        { 0, 0, 0, -0.0f, 0, 1 },
+        { 0, 0, 0, 0, 1, 0 },
+        { 0, 0, 0, 0, 0, 1.0000001f },
+    };
+    WeldAttribute attributes[2] = {
+        { &vertices[0][0], sizeof(vertices[0]), 3, epsilon },
+        { &vertices[0][3], sizeof(vertices[0]), 3, 0.0f },
+    };
+    std::vector<uint32_t> remap(4);
+    size_t exact = WeldVertices(attributes, 2, 4, remap.data());
+    Check(exact == 3 && remap == std::vector<uint32_t>{ 0, 0, 1, 2 }, "exact normals welded as " +
+        std::to_string(remap[0]) + " " + std::to_string(remap[1]) + " " + std::to_string(remap[2]) + " " + std::to_string(remap[3]));
+}
+
+// the box is exactly the extremes and the sphere holds every point without growing past the
+// box's own sphere, for counts on and off the four vertex kernel and awkward point sets
+void TestComputeBounds() {
+    std::mt19937 random(99);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+
+    std::vector<std::pair<std::string, std::vector<Vertex>>> sets;
+    for (size_t count : { 1, 2, 3, 5, 7, 1001 }) {
+        std::vector<Vertex> points;
+        for (size_t i = 0; i < count; i++)
+            points.push_back(Vertex{ DirectX::XMFLOAT3(100.0f + uniform(random) * 3.0f, uniform(random) * 0.01f, -50.0f + uniform(random)) });
+        sets.emplace_back(std::to_string(count) + " random points", points);
+    }
+    sets.emplace_back("a repeated point", std::vector<Vertex>(9, Vertex{ DirectX::XMFLOAT3(1.0f, 2.0f, 3.0f) }));
+    std::vector<Vertex> line, shell;
+    for (int i = 0; i < 257; i++) {
+        line.push_back(Vertex{ DirectX::XMFLOAT3(i * 0.5f, i * -0.25f, 1.0f) });
+        float y = 1.0f - (i + 0.5f) * 2.0f / 257, r = std::sqrt(1.0f - y * y);
+        shell.push_back(Vertex{ DirectX::XMFLOAT3(r * std::cos(i * 2.39996323f), y, r * std::sin(i * 2.39996323f)) });
+    }
+    sets.emplace_back("a line", line);
+    sets.emplace_back("a sphere shell", shell);
+    std::vector<Mesh> meshes;
+    if (LoadTeapot("Assets/teapot.obj", meshes))
+        sets.emplace_back("the teapot", meshes[0].vertices);
+
+    for (const auto& set : sets) {
+        const std::vector<Vertex>& points = set.second;
+        Bounds bounds = ComputeBounds(points.data(), points.size());
+
+        DirectX::XMFLOAT3 minCoord = points[0].Pos, maxCoord = points[0].Pos;
+        double farthest = 0.0;
+        for (const Vertex& point : points) {
+            const DirectX::XMFLOAT3& p = point.Pos;
+            minCoord = DirectX::XMFLOAT3(std::min(minCoord.x, p.x), std::min(minCoord.y, p.y), std::min(minCoord.z, p.z));
+            maxCoord = DirectX::XMFLOAT3(std::max(maxCoord.x, p.x), std::max(maxCoord.y, p.y), std::max(maxCoord.z, p.z));
+            double dx = double(p.x) - bounds.center.x, dy = double(p.y) - bounds.center.y, dz = double(p.z) - bounds.center.z;
+            farthest = std::max(farthest, std::sqrt(dx * dx + dy * dy + dz * dz));
+        }
+        Check(std::memcmp(&minCoord, &bounds.minCoord, sizeof(minCoord)) == 0 && std::memcmp(&maxCoord, &bounds.maxCoord, sizeof(maxCoord)) == 0,
+            set.first + " box isn't the extremes");
+        Check(farthest <= bounds.radius, set.first + " sphere misses a point " + std::to_string(farthest - bounds.radius) + " outside");
+
+        double dx = double(maxCoord.x) - minCoord.x, dy = double(maxCoord.y) - minCoord.y, dz = double(maxCoord.z) - minCoord.z;
+        double boxRadius = 0.5 * std::sqrt(dx * dx + dy * dy + dz * dz);
+        Check(bounds.radius <= boxRadius * (1.0 + 1e-5) + 1e-6, set.first + " sphere of " + std::to_string(bounds.radius) +
+            " is wider than the box's " + std::to_string(boxRadius));
+    }
+
+    Bounds none = ComputeBounds(nullptr, 0);
+    Check(none.radius == 0.0f && none.minCoord.x == 0.0f && none.maxCoord.x == 0.0f, "bounds of no points aren't zero");
+}
+
+// the triangles come back out of the index codec in both formats, and a cut short stream
+// or one with a rotation of 3 is refused
+void CheckIndexCodec(const std::string& name, const std::vector<DirectX::XMUINT3>& triangles, size_t vertexCount) {
+    std::vector<uint8_t> stream = EncodeIndexBuffer(triangles.data(), triangles.size());
+    for (IndexFormat format : { IndexFormat::Uint16, IndexFormat::Uint32 }) {
+        if (format == IndexFormat::Uint16 && vertexCount > ShortIndexVertexLimit)
+            continue;
+
+        size_t indexSize = format == IndexFormat::Uint16 ? 2 : 4;
+        std::vector<uint8_t> decoded(triangles.size() * 3 * indexSize);
+        bool same = DecodeIndexBuffer(decoded.data(), triangles.size(), format, vertexCount, stream.data(), stream.size());
+        for (size_t i = 0; same && i < triangles.size() * 3; i++) {
+            uint32_t index = 0;
+            std::memcpy(&index, decoded.data() + i * indexSize, indexSize);
+            same = index == (&triangles[i / 3].x)[i % 3];
+        }
+        Check(same, name + " u" + std::to_string(indexSize * 8) + " indices differ after decoding");
+        Check(!DecodeIndexBuffer(decoded.data(), triangles.size(), format, vertexCount, stream.data(), stream.size() - 1),
+            name + " truncated stream decoded");
+
+        // the last triangle's, in the rotation byte the padding shares
+        std::vector<uint8_t> rotated = stream;
+        size_t last = triangles.size() - 1;
+        rotated[1 + last / 4] |= static_cast<uint8_t>(3 << (last % 4 * 2));
+        Check(!DecodeIndexBuffer(decoded.data(), triangles.size(), format, vertexCount, rotated.data(), rotated.size()),
+            name + " rotation of 3 decoded");
+    }
+}
+
+void TestIndexCodecRoundTrip() {
+    for (const char* asset : TeapotAssets) {
+        std::vector<Mesh> meshes;
+        if (!LoadTeapot(asset, meshes))
+            continue;
+
+        CheckIndexCodec(std::string(asset) + " as loaded", meshes[0].indices, meshes[0].vertices.size());
+        OptimizeMeshes(asset, ImportOptions(), meshes);
+        CheckIndexCodec(std::string(asset) + " optimized", meshes[0].indices, meshes[0].vertices.size());
+    }
+
+    // random order leaves few shared edges, so most triangles code explicit vertices
+    const uint32_t side = 300;
+    std::vector<DirectX::XMUINT3> grid;
+    for (uint32_t y = 0; y + 1 < side; y++) {
+        for (uint32_t x = 0; x + 1 < side; x++) {
+            uint32_t corner = y * side + x;
+            grid.push_back(DirectX::XMUINT3(corner, corner + side, corner + 1));
+            grid.push_back(DirectX::XMUINT3(corner + 1, corner + side, corner + side + 1));
+        }
+    }
+    CheckIndexCodec("grid in order", grid, side * side);
+    std::mt19937 random(1234);
+    std::shuffle(grid.begin(), grid.end(), random);
+    CheckIndexCodec("shuffled grid", grid, side * side);
+}
+
+template <typename T>
+bool SameElements(const std::vector<T>& a, const std::vector<T>& b) {
+    return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+// every field DecodeMesh fills in, compared bit for bit
+bool SameCodedMesh(const Mesh& a, const Mesh& b) {
+    return SameElements(a.vertices, b.vertices) && SameElements(a.indices, b.indices) &&
+        SameElements(a.lods, b.lods) && SameElements(a.meshlets, b.meshlets) &&
+        SameElements(a.packedVertices, b.packedVertices) && SameElements(a.packedIndices, b.packedIndices) &&
+        std::memcmp(&a.bounds, &b.bounds, sizeof(Bounds)) == 0 &&
+        std::memcmp(&a.dequantization, &b.dequantization, sizeof(Dequantization)) == 0 &&
+        a.format.position == b.format.position && a.indexFormat == b.indexFormat &&
+        a.numberOfVertices == b.numberOfVertices && a.numberOfIndices == b.numberOfIndices;
+}
+
+// a mesh through the whole import, lods, meshlets and packed buffers included, comes back
+// out of the mesh codec unchanged, and no cut short copy of it decodes
+void TestMeshCodecRoundTrip() {
+    for (PositionFormat position : { PositionFormat::Float32, PositionFormat::Unorm16 }) {
+        std::vector<Mesh> meshes;
+        if (!LoadTeapot("Assets/teapot_normals_uv.obj", meshes))
+            return;
+
+        const char* name = position == PositionFormat::Float32 ? "float teapot" : "unorm16 teapot";
+        VertexFormat format;
+        format.position = position;
+        OptimizeMeshes(name, ImportOptions(), meshes);
+        BuildMeshlets(name, meshes);
+        GenerateLods(name, meshes);
+        PackMeshes(name, format, meshes);
+        PackIndexBuffers(name, meshes);
+
+        const Mesh& mesh = meshes[0];
+        std::vector<uint8_t> coded = EncodeMesh(mesh);
+        Mesh decoded;
+        Check(DecodeMesh(coded.data(), coded.size(), decoded) && SameCodedMesh(mesh, decoded),
+            std::string(name) + " differs after decoding");
+
+        std::mt19937 random(42);
+        std::vector<size_t> cuts = { 0, 1, coded.size() / 2, coded.size() - 1 };
+        for (int i = 0; i < 64; i++)
+            cuts.push_back(std::uniform_int_distribution<size_t>(0, coded.size() - 1)(random));
+        size_t decodedCuts = 0;
+        for (size_t cut : cuts) {
+            Mesh truncated;
+            decodedCuts += DecodeMesh(coded.data(), cut, truncated);
+        }
+        Check(decodedCuts == 0, std::string(name) + " decoded from " + std::to_string(decodedCuts) + " truncated copies");
+    }
+}
+
+// a model the way the loader hands it over, staged and hashed
+bool LoadStaged(const char* asset, ModelData& model) {
+    std::vector<Mesh> meshes;
+    if (!LoadTeapot(asset, meshes))
+        return false;
+
+    // packed straight into the staging block, like the loader does
+    model.filePath = asset;
+    for (Mesh& mesh : meshes) {
+        MeshView view = mesh.View();
+        view.format = VertexFormat();
+        view.indexFormat = ChooseIndexFormat(mesh.vertices.size());
+        model.views.push_back(view);
+    }
+    std::vector<uint8_t*> vertexSlots, indexSlots;
+    bool staged = ReserveSceneBuffers(model.views, model.scene, vertexSlots, indexSlots, model.error);
+    Check(staged, std::string("stage ") + asset + ": " + model.error);
+    if (!staged)
+        return false;
+
+    PackIndexBuffers(asset, meshes, indexSlots);
+    PackMeshes(asset, VertexFormat(), meshes, vertexSlots);
+    for (size_t i = 0; i < meshes.size(); i++) {
+        model.views[i].dequantization = meshes[i].dequantization;
+        Check(meshes[i].packedVertices.empty() && meshes[i].packedIndices.empty(), std::string("packing ") + asset + " didn't go to the staging block");
+    }
+    for (const MeshView& view : model.views)
+        model.hashes.push_back(MeshContentHash(view));
+    return true;
+}
+
+// repeats share a mesh and upload nothing, and a released mesh's ranges go to the next one
+void TestGeometryLibraryRanges() {
+    GeometryLibrary library;
+    ModelData first, repeat, other, again;
+    if (!LoadStaged("Assets/teapot.obj", first) || !LoadStaged("Assets/teapot.obj", repeat) ||
+        !LoadStaged("Assets/teapot_normals_uv.obj", other) || !LoadStaged("Assets/teapot.obj", again))
+        return;
+
+    uint32_t vertices = first.views[0].numberOfVertices;
+    uint32_t indices = first.views[0].numberOfIndices;
+    std::vector<GeometryLibrary::MeshId> firstIds, repeatIds, otherIds, againIds;
+    std::string error;
+
+    Check(library.Add(first, firstIds, error), "add teapot: " + error);
+    Check(first.scene.staging.BytesReserved() == 0, "the library didn't take the staging block");
+    Check(library.TakeAdded() == firstIds, "teapot not listed for upload");
+    Check(library.VertexExtent() == vertices && library.IndexExtent(IndexFormat::Uint16) == indices, "teapot extents");
+
+    Check(library.Add(repeat, repeatIds, error) && repeatIds == firstIds, "the same teapot again is not the same mesh");
+    Check(library.TakeAdded().empty(), "a repeat was listed for upload");
+    Check(library.VertexExtent() == vertices && library.IndexExtent(IndexFormat::Uint16) == indices, "a repeat grew the extents");
+
+    Check(library.Add(other, otherIds, error), "add teapot with uvs: " + error);
+    const SubmeshRange& otherRange = library.Range(otherIds[0]);
+    Check(otherRange.baseVertex == int32_t(vertices) && otherRange.firstIndex == indices, "teapot with uvs not placed after the teapot");
+    Check(library.TakeAdded() == otherIds, "teapot with uvs not listed for upload");
+
+    // both uses gone, the next teapot lands in the hole the first left
+    library.Release(firstIds);
+    library.Release(repeatIds);
+    Check(library.Add(again, againIds, error), "add teapot again: " + error);
+    const SubmeshRange& againRange = library.Range(againIds[0]);
+    Check(againRange.baseVertex == 0 && againRange.firstIndex == 0, "released ranges not reused");
+    Check(library.VertexExtent() == vertices + other.views[0].numberOfVertices, "reuse grew the extents");
+    Check(library.TakeAdded() == againIds, "reused range not listed for upload");
+
+    ModelData reference;
+    if (LoadStaged("Assets/teapot_normals_uv.obj", reference))
+        Check(SameContent(library.View(otherIds[0]), reference.views[0]), "the adopted staging no longer holds the mesh");
+}
+
+// a model with a mesh 16 bit indices can't address stages and places each mesh's indices at
+// their own width, the 16 bit meshes aren't widened for it
+void TestMixedIndexFormats() {
+    std::vector<Mesh> meshes;
+    if (!LoadTeapot("Assets/teapot.obj", meshes))
+        return;
+    meshes.push_back(GridMesh(300));
+    meshes.push_back(meshes[0]);
+    PackIndexBuffers("mixed", meshes);
+    PackMeshes("mixed", VertexFormat(), meshes);
+
+    ModelData model;
+    model.filePath = "mixed";
+    for (Mesh& mesh : meshes)
+        model.views.push_back(mesh.View());
+    if (!BuildSceneBuffers(model.views, model.scene, model.error)) {
+        Check(false, "stage mixed model: " + model.error);
+        return;
+    }
+
+    const IndexFormat expected[] = { IndexFormat::Uint16, IndexFormat::Uint32, IndexFormat::Uint16 };
+    uint32_t teapotIndices = meshes[0].numberOfIndices;
+    for (size_t i = 0; i < meshes.size(); i++) {
+        const SubmeshRange& range = model.scene.submeshes[i];
+        Check(model.views[i].indexFormat == expected[i] && range.indexFormat == expected[i] && SameContent(model.views[i], meshes[i].View()),
+            "staged mesh " + std::to_string(i) + " changed index format or content");
+    }
+    Check(model.scene.submeshes[2].firstIndex == teapotIndices && model.scene.submeshes[1].firstIndex == 0,
+        "staged meshes not back to back within their format");
+    Check(model.scene.indices[size_t(IndexFormat::Uint16)].bytes == 2 * teapotIndices * sizeof(uint16_t) &&
+        model.scene.indices[size_t(IndexFormat::Uint32)].bytes == meshes[1].numberOfIndices * sizeof(uint32_t),
+        "staged index regions are the wrong size");
+
+    GeometryLibrary library;
+    std::vector<GeometryLibrary::MeshId> ids;
+    std::string error;
+    Check(library.Add(model, ids, error), "add mixed model: " + error);
+    if (ids.size() != 3)
+        return;
+    Check(ids[0] == ids[2], "the repeated teapot is not the same mesh");
+    Check(library.Range(ids[0]).indexFormat == IndexFormat::Uint16 && library.Range(ids[1]).indexFormat == IndexFormat::Uint32 &&
+        library.Range(ids[1]).firstIndex == 0, "library ranges not in the index buffer of their format");
+    Check(library.IndexExtent(IndexFormat::Uint16) == teapotIndices && library.IndexExtent(IndexFormat::Uint32) == meshes[1].numberOfIndices,
+        "index extents " + std::to_string(library.IndexExtent(IndexFormat::Uint16)) + " and " +
+        std::to_string(library.IndexExtent(IndexFormat::Uint32)));
+
+    // the grid's indices go back, the 32 bit buffer empties and the teapot's stays
+    library.Release({ ids[1] });
+    Check(library.IndexExtent(IndexFormat::Uint32) == 0 && library.IndexExtent(IndexFormat::Uint16) == teapotIndices,
+        "releasing the 32 bit mesh left the extents at " + std::to_string(library.IndexExtent(IndexFormat::Uint16)) + " and " +
+        std::to_string(library.IndexExtent(IndexFormat::Uint32)));
+}
+
+// writers of one key racing each other leave one whole cooked file and no temporaries
+void TestCookedWriteRace() {
+    std::vector<Mesh> small, large;
+    if (!LoadTeapot("Assets/teapot.obj", small) || !LoadTeapot("Assets/teapot_normals_uv.obj", large))
+        return;
+    for (std::vector<Mesh>* meshes : { &small, &large }) {
+        PackIndexBuffers("race", *meshes);
+        PackMeshes("race", VertexFormat(), *meshes);
+    }
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "pipeline_tests_race";
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+    std::string cookedPath = (directory / "race.stmesh").string();
+    CacheKey key = { 1, 2 };
+
+    std::atomic<unsigned int> failedWrites(0);
+    std::vector<std::thread> writers;
+    for (unsigned int i = 0; i < 8; i++) {
+        writers.emplace_back([&, i] {
+            if (!WriteCookedModel(cookedPath, key, 0.0, i % 2 ? large : small))
+                failedWrites++;
+        });
+    }
+    for (std::thread& writer : writers)
+        writer.join();
+    Check(failedWrites == 0, std::to_string(failedWrites.load()) + " racing writes failed");
+
+    CookedModel cooked;
+    if (cooked.Load(cookedPath, key)) {
+        const MeshView& view = cooked.Meshes()[0];
+        Check(SameContent(view, small[0].View()) || SameContent(view, large[0].View()), "the cooked file mixes two writers");
+    }
+    else
+        Check(false, "racing writers left a cooked file that doesn't load");
+    cooked.Unload();
+
+    size_t files = 0;
+    for (auto it = std::filesystem::directory_iterator(directory, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec))
+        files++;
+    Check(files == 1, "racing writers left " + std::to_string(files) + " files behind");
+    std::filesystem::remove_all(directory, ec);
+}
+
+// a cooked model stages without a copy. Its views stay in the mapping, or in the block its
+// compressed meshes decoded into, laid out exactly as BuildSceneBuffers lays out a copy.
+void TestCookedStaging() {
+    std::vector<Mesh> meshes;
+    if (!LoadTeapot("Assets/teapot.obj", meshes))
+        return;
+    meshes.push_back(GridMesh(300));
+    meshes.push_back(meshes[0]);
+    PackIndexBuffers("cooked staging", meshes);
+    PackMeshes("cooked staging", VertexFormat(), meshes);
+
+    std::vector<MeshView> copied;
+    for (const Mesh& mesh : meshes)
+        copied.push_back(mesh.View());
+    SceneBuffers reference;
+    std::string error;
+    if (!BuildSceneBuffers(copied, reference, error)) {
+        Check(false, "stage reference: " + error);
+        return;
+    }
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "pipeline_tests_staging";
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+    CacheKey key = { 3, 4 };
+
+    for (bool compress : { false, true }) {
+        std::string name = compress ? "compressed" : "plain";
+        std::string cookedPath = (directory / (name + ".stmesh")).string();
+        CookedModel cooked;
+        std::vector<MeshView> views;
+        SceneBuffers scene;
+        if (!WriteCookedModel(cookedPath, key, 0.0, meshes, compress) || !cooked.Load(cookedPath, key) ||
+            !cooked.Stage(views, scene, error)) {
+            Check(false, name + " cooked model didn't stage: " + error);
+            continue;
+        }
+        // the buffers keep what they adopted alive
+        cooked.Unload();
+
+        const uint8_t* mapped = scene.mapping.Data();
+        bool inMapping = scene.vertices >= mapped && scene.vertices < mapped + scene.mapping.Size();
+        Check(compress ? !inMapping && scene.staging.BytesReserved() > 0 : inMapping && scene.staging.BytesReserved() == 0,
+            name + " cooked model was copied to stage it");
+
+        bool same = views.size() == copied.size() && scene.vertexBytes == reference.vertexBytes &&
+            std::memcmp(scene.vertices, reference.vertices, scene.vertexBytes) == 0;
+        for (size_t format = 0; same && format < IndexFormatCount; format++) {
+            same = scene.indices[format].bytes == reference.indices[format].bytes &&
+                std::memcmp(scene.indices[format].indices, reference.indices[format].indices, scene.indices[format].bytes) == 0;
+        }
+        for (size_t i = 0; same && i < views.size(); i++) {
+            const SubmeshRange& range = scene.submeshes[i];
+            const SubmeshRange& expected = reference.submeshes[i];
+            same = range.firstIndex == expected.firstIndex && range.numberOfIndices == expected.numberOfIndices &&
+                range.baseVertex == expected.baseVertex && range.indexFormat == expected.indexFormat &&
+                views[i].vertices == scene.vertices + size_t(range.baseVertex) * VertexStride(scene.format) &&
+                SameContent(views[i], copied[i]);
+        }
+        Check(same, name + " cooked model isn't laid out like a staged copy");
+    }
+    std::filesystem::remove_all(directory, ec);
+}
+
+// the assets come back out of a pack byte for byte under any spelling of their path,
+// mounted packs shadow the loose files and keep files open after unmounting, and a cut short
+// pack is refused
+void TestPackFileRoundTrip() {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "pipeline_tests_pack";
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+    std::filesystem::create_directories(directory, ec);
+    std::string packPath = (directory / "test.pack").string();
+
+    std::string error;
+    if (!WritePackFile(packPath, { "Assets" }, error)) {
+        Check(false, "write pack: " + error);
+        return;
+    }
+    Check(!WritePackFile((directory / "missing.pack").string(), { "Assets/missing.obj" }, error), "packed a missing file");
+
+    PackFile pack;
+    if (!pack.Open(packPath, error)) {
+        Check(false, "open pack: " + error);
+        return;
+    }
+    Check(pack.FileCount() == std::size(TeapotAssets), "pack holds " + std::to_string(pack.FileCount()) + " files");
+
+    for (const char* asset : TeapotAssets) {
+        MappedFile loose;
+        if (!loose.Open(asset)) {
+            Check(false, std::string("map ") + asset);
+            continue;
+        }
+
+        std::string spelling = std::string("./ASSETS/../Assets\\") + (std::strrchr(asset, '/') + 1);
+        for (const std::string& path : { std::string(asset), spelling }) {
+            PackFile::Entry entry;
+            Check(pack.Find(path, entry) && entry.size == loose.Size() && std::memcmp(entry.data, loose.Data(), entry.size) == 0 &&
+                entry.contentHash == Hash64(loose.Data(), loose.Size()), path + " differs in the pack");
+        }
+    }
+    PackFile::Entry entry;
+    Check(!pack.Find("Assets/teapot", entry) && !pack.Find("teapot.obj", entry), "found a file that isn't packed");
+
+    // the mounted pack serves the file and keeps it after unmounting
+    Check(MountPack(packPath, error), "mount pack: " + error);
+    AssetFile file;
+    Check(file.Open(TeapotAssets[0]) && file.IsPacked(), "mounted pack didn't serve the file");
+    UnmountPacks();
+    Check(!AnyPacksMounted(), "packs still mounted");
+    if (file.IsOpen()) {
+        PackFile::Entry packed;
+        Check(pack.Find(TeapotAssets[0], packed) && file.Size() == packed.size && std::memcmp(file.Data(), packed.data, packed.size) == 0,
+            "file opened from an unmounted pack changed");
+    }
+    file.Close();
+    pack.Close();
+
+    // anything short of the whole pack must not open
+    uintmax_t packSize = std::filesystem::file_size(packPath, ec);
+    std::string cutPath = (directory / "cut.pack").string();
+    for (uintmax_t cut : { uintmax_t(0), uintmax_t(16), packSize / 2, packSize - 1 }) {
+        std::filesystem::copy_file(packPath, cutPath, std::filesystem::copy_options::overwrite_existing, ec);
+        std::filesystem::resize_file(cutPath, cut, ec);
+        PackFile truncated;
+        Check(!truncated.Open(cutPath, error), "opened a pack cut to " + std::to_string(cut) + " bytes");
+    }
+    std::filesystem::remove_all(directory, ec);
+}
+
+// box levels of a power of two are plain averages of the texels under them, so a chain that
+// rounds only on store lands every texel within half a step of the exact average
+void TestMipChainRounding() {
+    Image image;
+    image.width = 64;
+    image.height = 48;
+    image.rgba.resize(size_t(image.width) * image.height * 4);
+    std::mt19937 random(99);
+    for (uint8_t& channel : image.rgba)
+        channel = static_cast<uint8_t>(random());
+
+    MipOptions options;
+    options.filter = MipFilter::Box;
+    options.srgb = false;
+    std::vector<Image> mips;
+    GenerateMips(image, options, mips);
+    Check(mips.size() + 1 == MipCount(image.width, image.height), "wrong number of levels");
+
+    for (const Image& mip : mips) {
+        uint32_t blockWidth = image.width / mip.width, blockHeight = image.height / mip.height;
+        double worst = 0.0;
+        for (uint32_t y = 0; y < mip.height; y++) {
+            for (uint32_t x = 0; x < mip.width; x++) {
+                for (uint32_t c = 0; c < 4; c++) {
+                    double sum = 0.0;
+                    for (uint32_t j = 0; j < blockHeight; j++) {
+                        for (uint32_t i = 0; i < blockWidth; i++)
+                            sum += image.rgba[((size_t(y) * blockHeight + j) * image.width + x * blockWidth + i) * 4 + c];
+                    }
+                    double stored = mip.rgba[(size_t(y) * mip.width + x) * 4 + c];
+                    worst = std::max(worst, std::fabs(stored - sum / (blockWidth * blockHeight)));
+                }
+            }
+        }
+        Check(worst <= 0.501, std::to_string(mip.width) + "x" + std::to_string(mip.height) + " off the exact average by " +
+            std::to_string(worst));
+    }
+}
+
+// smooth gradients, a hard edged checker with cut out alpha, a bumpy normal map and busy
+// detail, in the ways the cooker sees textures. Odd sizes leave partial edge blocks.
+Image MakeTestImage(int kind, uint32_t width, uint32_t height) {
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.rgba.resize(size_t(width) * height * 4);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            float u = (x + 0.5f) / width, v = (y + 0.5f) / height;
+            float r = 0.0f, g = 0.0f, b = 0.0f, a = 1.0f;
+            if (kind == 0) {
+                r = u;
+                g = v;
+                b = 0.5f + 0.5f * std::sin((u + v) * 6.2831853f);
+                a = 1.0f - u * 0.5f;
+            }
+            else if (kind == 1) {
+                bool odd = ((x / 8) + (y / 8)) & 1;
+                r = odd ? 0.9f : 0.1f;
+                g = odd ? 0.2f : 0.7f;
+                b = odd ? 0.1f : 0.9f;
+                a = odd ? 1.0f : 0.0f;
+            }
+            else if (kind == 2) {
+                float dx = 0.6f * std::cos(u * 37.0f) * std::sin(v * 23.0f);
+                float dy = 0.6f * std::sin(u * 29.0f + v * 11.0f);
+                float length = std::sqrt(dx * dx + dy * dy + 1.0f);
+                r = 0.5f - 0.5f * dx / length;
+                g = 0.5f - 0.5f * dy / length;
+                b = 0.5f + 0.5f / length;
+            }
+            else {
+                r = 0.5f + 0.25f * std::sin(u * 90.0f) + 0.2f * std::sin(v * 53.0f + u * 17.0f);
+                g = 0.5f + 0.3f * std::sin(u * 41.0f + v * 67.0f);
+                b = 0.4f + 0.3f * std::cos(v * 101.0f) * std::sin(u * 13.0f);
+                a = 0.5f + 0.45f * std::sin(u * 23.0f - v * 31.0f);
+            }
+
+            uint8_t* texel = &image.rgba[(size_t(y) * width + x) * 4];
+            const float channels[4] = { r, g, b, a };
+            for (int c = 0; c < 4; c++)
+                texel[c] = static_cast<uint8_t>(std::lround(std::min(1.0f, std::max(0.0f, channels[c])) * 255.0f));
+        }
+    }
+    return image;
+}
+
+// over the channels a format keeps, infinite for an exact match
+double Psnr(const Image& image, const std::vector<uint8_t>& decoded, int channelCount) {
+    double sum = 0.0;
+    for (size_t i = 0; i < image.rgba.size(); i += 4) {
+        for (int c = 0; c < channelCount; c++) {
+            double d = double(image.rgba[i + c]) - decoded[i + c];
+            sum += d * d;
+        }
+    }
+    double mse = sum / (double(image.rgba.size() / 4) * channelCount);
+    return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : INFINITY;
+}
+
+// every format stays above a quality floor on every test image, over the channels it keeps,
+// and gives the same blocks on any thread count
+void TestBlockCompressionQuality() {
+    const char* kinds[] = { "gradient", "checker", "normal map", "detail" };
+    const struct {
+        BlockFormat format;
+        int channels;
+        // dB per test image, a little under what the encoders reach now
+        double floors[4];
+    } formats[] = {
+        { BlockFormat::BC1, 3, { 41.0, 43.5, 36.5, 25.0 } },
+        { BlockFormat::BC3, 4, { 42.0, 45.0, 37.5, 26.0 } },
+        { BlockFormat::BC5, 2, { 60.0, 60.0, 47.0, 36.5 } },
+        { BlockFormat::BC7, 4, { 48.0, 51.0, 40.0, 25.5 } },
+    };
+
+    for (int kind = 0; kind < 4; kind++) {
+        Image image = MakeTestImage(kind, 258, 131);
+        for (const auto& entry : formats) {
+            std::string name = std::string(BlockFormatName(entry.format)) + " " + kinds[kind];
+            std::vector<uint8_t> single(CompressedSize(entry.format, image.width, image.height));
+            std::vector<uint8_t> threaded(single.size());
+            CompressImage(image.rgba.data(), image.width, image.height, entry.format, single.data(), 1);
+            CompressImage(image.rgba.data(), image.width, image.height, entry.format, threaded.data(), 3);
+            Check(single == threaded, name + " blocks depend on the thread count");
+
+            std::vector<uint8_t> decoded(image.rgba.size());
+            DecompressImage(single.data(), image.width, image.height, entry.format, decoded.data());
+            double psnr = Psnr(image, decoded, entry.channels);
+            Check(psnr >= entry.floors[kind], name + " at " + std::to_string(psnr) + " dB, below " +
+                std::to_string(entry.floors[kind]));
+        }
+    }
+}
+
+// a grid with texcoords and normals, split into objects and material runs, with comments and
+// CRLF lines mixed in. Big enough that every thread count splits it, at byte offsets that land
+// inside lines.
+std::string MakeChunkedObj(uint32_t side) {
+    std::string text;
+    char line[128];
+    for (uint32_t y = 0; y < side; y++) {
+        for (uint32_t x = 0; x < side; x++) {
+            int length = std::snprintf(line, sizeof(line), "v %f %f %f\nvt %f %f\nvn 0 1 0\n", x * 0.01f,
+                0.05f * ((x * 7 + y * 13) % 17), y * 0.01f, x / float(side), y / float(side));
+            text.append(line, length);
+        }
+    }
+
+    for (uint32_t y = 0; y + 1 < side; y++) {
+        if (y % 50 == 0)
+            text += "o row" + std::to_string(y) + "\n";
+        if (y % 20 == 0)
+            text += std::string("usemtl ") + (y % 40 ? "red" : "blue") + "\r\n# next run\n";
+        for (uint32_t x = 0; x + 1 < side; x++) {
+            uint32_t a = y * side + x + 1, b = a + 1, c = a + side, d = c + 1;
+            const char* end = x % 3 ? "\n" : "\r\n";
+            int length = x % 5 ? std::snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u%s", a, a, a, b, b, b, d, d, d, c, c, c, end) :
+                std::snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\nf %u/%u/%u %u/%u/%u %u/%u/%u%s", a, a, a, b, b, b, d, d, d,
+                    a, a, a, d, d, d, c, c, c, end);
+            text.append(line, length);
+        }
+    }
+    return text;
+}
+
+// same element counts and bit for bit the same vertices and indices
+bool SameMeshes(const std::vector<Mesh>& a, const std::vector<Mesh>& b, std::string& difference) {
+    if (a.size() != b.size()) {
+        difference = "mesh count " + std::to_string(a.size()) + " vs " + std::to_string(b.size());
+        return false;
+    }
+
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].vertices.size() != b[i].vertices.size() || a[i].indices.size() != b[i].indices.size()) {
+            difference = "mesh " + std::to_string(i) + " element counts differ";
+            return false;
+        }
+        if (std::memcmp(a[i].vertices.data(), b[i].vertices.data(), a[i].vertices.size() * sizeof(Vertex)) != 0) {
+            difference = "mesh " + std::to_string(i) + " vertices differ";
+            return false;
+        }
+        if (std::memcmp(a[i].indices.data(), b[i].indices.data(), a[i].indices.size() * sizeof(DirectX::XMUINT3)) != 0) {
+            difference = "mesh " + std::to_string(i) + " indices differ";
+            return false;
+        }
+    }
+    return true;
+}
+
+// the chunked parse on several threads gives what one thread does
+void TestObjThreadsAgree() {
+    std::string text = MakeChunkedObj(300);
+    std::vector<Mesh> single;
+    std::string error;
+    if (!ParseObj(text.data(), text.size(), single, error, 1)) {
+        Check(false, "parse on 1 thread: " + error);
+        return;
+    }
+    Check(single.size() > 1, "the objects and materials didn't split the grid");
+
+    size_t triangles = 0;
+    for (const Mesh& mesh : single)
+        triangles += mesh.indices.size();
+    Check(triangles == size_t(299) * 299 * 2, "parsed " + std::to_string(triangles) + " triangles");
+
+    for (unsigned int threads : { 2u, 3u, 5u, 16u }) {
+        std::vector<Mesh> parallel;
+        std::string difference;
+        bool parsed = ParseObj(text.data(), text.size(), parallel, error, threads);
+        Check(parsed && SameMeshes(single, parallel, difference), std::to_string(threads) + " threads: " + (parsed ? difference : error));
+    }
+}
+
+// a thread's allocation counters see what it and the ParallelFor helpers it starts allocate,
+// and nothing another thread does
+void TestThreadAllocationStats() {
+    const int64_t block = 1 << 18;
+    ThreadAllocationStats before = GetThreadAllocationStats();
+    std::thread other([block] {
+        std::vector<std::vector<char>> noise(8, std::vector<char>(size_t(block), 1));
+        volatile char sink = noise[7][0];
+        (void)sink;
+    });
+    other.join();
+    ThreadAllocationStats after = GetThreadAllocationStats();
+    Check(after.liveBytes - before.liveBytes < block, "another thread's allocations counted for this one");
+
+    // every index waits for the others, so each runs on a thread of its own
+    std::vector<std::vector<char>> blocks(4);
+    std::atomic<size_t> started(0);
+    ResetThreadAllocationPeak();
+    before = GetThreadAllocationStats();
+    ParallelFor(blocks.size(), 4, [&](size_t i) {
+        started++;
+        while (started < blocks.size())
+            std::this_thread::yield();
+        blocks[i].assign(size_t(block), 1);
+    });
+    after = GetThreadAllocationStats();
+    Check(after.liveBytes - before.liveBytes >= 4 * block && after.peakBytes - before.liveBytes >= 4 * block &&
+        after.allocations - before.allocations >= 4, "ParallelFor helpers' allocations not counted for the thread that started them");
+
+    blocks = std::vector<std::vector<char>>();
+    ThreadAllocationStats released = GetThreadAllocationStats();
+    Check(released.liveBytes - before.liveBytes < block, "freed blocks still counted as live");
+}
+
+#ifdef PIPELINE_TESTS_ASSIMP
+
+// the native parser reproduces the Assimp import bit for bit
+void TestObjMatchesAssimp() {
+    for (const char* asset : TeapotAssets) {
+        std::vector<Mesh> native;
+        if (!LoadTeapot(asset, native))
+            continue;
+
+        std::vector<Mesh> reference;
+        std::string error;
+        if (!ImportModelAssimp(asset, reference, error)) {
+            Check(false, std::string("Assimp import of ") + asset + ": " + error);
+            continue;
+        }
+
+        std::string difference;
+        Check(SameMeshes(reference, native, difference), std::string(asset) + ": " + difference);
+    }
+}
+
+// a profiled Assimp import times each step it runs under the step's own name, and skips the
+// ones it doesn't run
+void TestAssimpStepProfile() {
+    ImportProfile profile;
+    std::vector<Mesh> meshes;
+    std::string error;
+    if (!ImportModelAssimp(TeapotAssets[0], meshes, error, &profile)) {
+        Check(false, "profiled Assimp import: " + error);
+        return;
+    }
+
+    bool read = false, triangulate = false;
+    std::string unnamed;
+    for (const StageTiming& stage : profile.Stages()) {
+        read |= stage.name == "assimp read";
+        triangulate |= stage.name == "assimp triangulate";
+        if (stage.name.compare(0, 12, "assimp step ") == 0)
+            unnamed += " " + stage.name;
+    }
+    Check(read && triangulate, "the read or triangulate step wasn't profiled");
+    Check(unnamed.empty(), "steps profiled without a name:" + unnamed);
+}
+
+// the weld ImportModelAssimp runs gives what Assimp's own JoinIdenticalVertices does
+void TestWeldMatchesAssimpJoin() {
+    for (const char* asset : TeapotAssets) {
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(asset, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices);
+        if (!scene) {
+            Check(false, std::string("Assimp failed to read ") + asset);
+            continue;
+        }
+
+        std::vector<Mesh> reference;
+        for (unsigned int meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++) {
+            const aiMesh* aiMesh = scene->mMeshes[meshIndex];
+            Mesh mesh;
+            mesh.vertices.resize(aiMesh->mNumVertices);
+            for (unsigned int i = 0; i < aiMesh->mNumVertices; i++)
+                mesh.vertices[i].Pos = DirectX::XMFLOAT3(aiMesh->mVertices[i].x, aiMesh->mVertices[i].y, aiMesh->mVertices[i].z);
+            for (unsigned int i = 0; i < aiMesh->mNumFaces; i++) {
+                const aiFace& face = aiMesh->mFaces[i];
+                if (face.mNumIndices == 3)
+                    mesh.indices.push_back(DirectX::XMUINT3(face.mIndices[0], face.mIndices[1], face.mIndices[2]));
+            }
+            reference.push_back(std::move(mesh));
+        }
+
+        std::vector<Mesh> welded;
+        std::string error;
+        if (!ImportModelAssimp(asset, welded, error)) {
+            Check(false, std::string("Assimp import of ") + asset + ": " + error);
+            continue;
+        }
+
+        std::string difference;
+        Check(SameMeshes(reference, welded, difference), std::string(asset) + ": " + difference);
+    }
+}
+
+#endif
+
+struct Test {
+    const char* name;
+    void (*run)();
+};
+
+const Test Tests[] = {
+    { "half round trip", TestHalfRoundTrip },
+    { "octahedral round trip", TestOctahedralRoundTrip },
+    { "unorm16 round trip", TestUnorm16RoundTrip },
+    { "vertex cache simulator", TestVertexCacheSimulator },
+    { "vertex cache order", TestVertexCacheOrder },
+    { "overdraw clusters", TestOverdrawClusters },
+    { "vertex fetch order", TestVertexFetchOrder },
+    { "split mesh", TestSplitMesh },
+    { "simplify levels", TestSimplifyLevels },
+    { "meshlet culling", TestCullMeshlets },
+    { "normals", TestGenerateNormals },
+    { "tangents", TestGenerateTangents },
+    { "weld epsilon", TestWeldEpsilon },
+    { "bounds", TestComputeBounds },
+    { "index codec round trip", TestIndexCodecRoundTrip },
+    { "mesh codec round trip", TestMeshCodecRoundTrip },
+    { "geometry library ranges", TestGeometryLibraryRanges },
+    { "mixed index formats", TestMixedIndexFormats },
+    { "cooked write race", TestCookedWriteRace },
+    { "cooked staging", TestCookedStaging },
+    { "thread allocation stats", TestThreadAllocationStats },
+    { "pack file round trip", TestPackFileRoundTrip },
+    { "OBJ parse on threads", TestObjThreadsAgree },
+    { "mip chain rounding", TestMipChainRounding },
+    { "block compression quality", TestBlockCompressionQuality },
+#ifdef PIPELINE_TESTS_ASSIMP
+    { "OBJ parser matches Assimp", TestObjMatchesAssimp },
+    { "weld matches Assimp join", TestWeldMatchesAssimpJoin },
+    { "Assimp step profile", TestAssimpStepProfile },
+#endif
+};
+
+}
+
+int main() {
+    unsigned int failed = 0;
+    for (const Test& test : Tests) {
+        unsigned int before = checkFailures;
+        test.run();
+        bool passed = checkFailures == before;
+        std::printf("%-32s %s\n", test.name, passed ? "ok" : "FAILED");
+        if (!passed)
+            failed++;
+    }
+
+#ifndef PIPELINE_TESTS_ASSIMP
+    std::printf("%-32s skipped, built without Assimp\n", "Assimp comparisons");
+#endif
+
+    std::printf("%u of %zu tests passed\n", static_cast<unsigned int>(std::size(Tests)) - failed, std::size(Tests));
+    return failed == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+// DirectXMath ships with the Windows SDK. The pipeline only keeps its storage types, so
+// the headless build elsewhere gets just those.
+
+#include <cstdint>
+
+namespace DirectX {
+
+struct XMFLOAT2 {
+    float x, y;
+    XMFLOAT2() = default;
+    constexpr XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+};
+
+struct XMFLOAT3 {
+    float x, y, z;
+    XMFLOAT3() = default;
+    constexpr XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+};
+
+struct XMFLOAT4 {
+    float x, y, z, w;
+    XMFLOAT4() = default;
+    constexpr XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+};
+
+struct XMUINT3 {
+    uint32_t x, y, z;
+    XMUINT3() = default;
+    constexpr XMUINT3(uint32_t _x, uint32_t _y, uint32_t _z) : x(_x), y(_y), z(_z) {}
+};
+
+struct alignas(16) XMMATRIX {
+    float r[4][4];
+};
+
+}
\ No newline at end of file